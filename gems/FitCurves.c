@@ -12,14 +12,73 @@ from "Graphics Gems", Academic Press, 1990
 #include "GraphicsGems.h"					
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 typedef Point2 *BezierCurve;
 
+/*
+ *  Where fitted curves go: called with the user's data pointer and
+ *  the 4 control points of each cubic, in order along the points.
+ */
+typedef void (*FitOutput)();
+
+/*
+ *  Scratch space for fitting: the parameter values of the points
+ *  being fitted, kept from one fit to the next so that nothing is
+ *  allocated unless a longer run of points comes along.
+ */
+typedef struct FitScratchStruct {
+	double	*u, *uPrime;		/*  Parameter values		*/
+	int	size;			/*  Room in u and uPrime	*/
+	FitOutput output;		/*  Called for each fitted curve */
+	void	*data;			/*  First argument of output	*/
+} FitScratch;
+
+/*
+ *  A curve being fitted as its points arrive.  The points from the
+ *  start of the open segment on are kept in d; the segment is refit
+ *  every so often as it grows, and once a fit fails the last good
+ *  fit is output and the segment starts again from its end.
+ */
+typedef struct FitStreamStruct {
+	Point2	*d;			/*  Points of the open segment	*/
+	int	nPts, max;		/*  Number of points, room for	*/
+	int	seen;			/*  Points looked at so far	*/
+	int	next;			/*  Fit again when seen reaches */
+	int	good;			/*  Last point fitted by curve	*/
+	Point2	curve[4];		/*  Fit to d[0..good]		*/
+	Vector2	tHat1;			/*  Unit tangent at d[0]	*/
+	int	haveTangent;		/*  Set if tHat1 is given	*/
+	double	error;			/*  User-defined error squared	*/
+	double	cosCorner;		/*  Cosine of the corner angle	*/
+	FitScratch scratch;
+} FitStream;
+
 /* Forward declarations */
 void		FitCurve();
+void		InitFitScratch();
+void		FreeFitScratch();
+void		FitCurveScratch();
+int		FindCorners();
+void		FitCurveParallel();
+void		FitStreamBegin();
+void		FitStreamAdd();
+void		FitStreamEnd();
+void		DrawBezierCurve();
+static	void		DrawCurve();
+static	void		GrowFitScratch();
+static	void		FitRange();
 static	void		FitCubic();
-static	double		*Reparameterize();
+static	double		FitSingle();
+static	int		IsCorner();
+static	void		FitStreamStep();
+static	void		FitStreamCut();
+static	void		Reparameterize();
 static	double		NewtonRaphsonRootFind();
 static	Point2		BezierII();
 static	double 		B0(), B1(), B2(), B3();
@@ -27,21 +86,118 @@ static	Vector2		ComputeLeftTangent();
 static	Vector2		ComputeRightTangent();
 static	Vector2		ComputeCenterTangent();
 static	double		ComputeMaxError();
-static	double		*ChordLengthParameterize();
-static	BezierCurve	GenerateBezier();
+static	void		ChordLengthParameterize();
+static	void		GenerateBezier();
 static	Vector2		V2AddII();
 static	Vector2		V2ScaleIII();
 static	Vector2		V2SubII();
 
-#define MAXPOINTS	1000		/* The most points you can have */
+#define	MAXDEGREE	3		/* BezierII handles up to cubics */
+#define	STREAM_STRIDE	4		/* Refit after 1/STREAM_STRIDE more */
 
 #ifdef TESTMODE
+#include <time.h>
 
 void DrawBezierCurve(int n, BezierCurve curve)
 {
 	/* You'll have to write this yourself. */
 }
 
+/*
+ *  Bench :
+ *	Time the fitting of one long digitized path: a sequence of
+ *	noisy circular arcs meeting at corners, like a pen stroke or
+ *	a traced outline.  FitCurveScratch (one range between
+ *	corners at a time), FitCurveParallel and a FitStream are
+ *	each run on it, and the curves they make counted.
+ */
+static int	nCurves;		/*  Curves output so far	*/
+
+static void CountCurve(data, curve)
+    void	*data;
+    BezierCurve	curve;
+{
+    nCurves++;
+}
+
+static double BenchSeconds()
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void Bench(n, nthreads)
+    int		n, nthreads;
+{
+    Point2	*benchPts, p;
+    double	error = 1e-4;		/*  Squared error		*/
+    double	corner = PI / 4.0;	/*  Turning angle at corners	*/
+    double	heading = 0.0, turn = 0.0, t;
+    int		i, nCorners;
+    int		*corners;
+    FitStream	stream;
+    FitScratch	scratch;
+
+    benchPts = (Point2 *)malloc((unsigned)n * sizeof(Point2));
+    corners = (int *)malloc((unsigned)n * sizeof(int));
+    srand(1);
+    p.x = p.y = 0.0;
+    for (i = 0; i < n; i++) {
+		if (i % 500 == 0) {
+	    	heading += PIOVER2 * (0.6 + 0.8 * rand() / RAND_MAX);
+	    	turn = 0.02 * ((double)rand() / RAND_MAX - 0.5);
+		}
+		heading += turn;
+		p.x += 0.01 * cos(heading);
+		p.y += 0.01 * sin(heading);
+		benchPts[i].x = p.x + 1e-4 * ((double)rand() / RAND_MAX - 0.5);
+		benchPts[i].y = p.y + 1e-4 * ((double)rand() / RAND_MAX - 0.5);
+    }
+    nCorners = FindCorners(benchPts, n, corner, corners);
+    printf("%d points, %d corners, squared error %g\n", n, nCorners - 2,
+		error);
+
+    nCurves = 0;
+    t = BenchSeconds();
+    InitFitScratch(&scratch, CountCurve, (void *)NULL);
+    for (i = 0; i + 1 < nCorners; i++)
+		FitCurveScratch(&benchPts[corners[i]],
+			corners[i+1] - corners[i] + 1, error, &scratch);
+    FreeFitScratch(&scratch);
+    t = BenchSeconds() - t;
+    printf("  FitCurveScratch  %10.0f points/sec  %d curves\n", n / t,
+		nCurves);
+
+    nCurves = 0;
+    t = BenchSeconds();
+    FitCurveParallel(benchPts, n, error, corner, CountCurve, (void *)NULL,
+		nthreads);
+    t = BenchSeconds() - t;
+    printf("  FitCurveParallel %10.0f points/sec  %d curves  (%d threads)\n",
+		n / t, nCurves,
+#ifdef _OPENMP
+		nthreads > 0 ? nthreads : omp_get_max_threads());
+#else
+		1);
+#endif
+
+    nCurves = 0;
+    t = BenchSeconds();
+    FitStreamBegin(&stream, error, corner, CountCurve, (void *)NULL);
+    for (i = 0; i < n; i++)
+		FitStreamAdd(&stream, benchPts[i]);
+    FitStreamEnd(&stream);
+    t = BenchSeconds() - t;
+    printf("  FitStream        %10.0f points/sec  %d curves\n", n / t,
+		nCurves);
+
+    free((void *)corners);
+    free((void *)benchPts);
+}
+
 /*
  *  main:
  *	Example of how to use the curve-fitting code.  Given an array
@@ -54,8 +210,12 @@ void DrawBezierCurve(int n, BezierCurve curve)
  *	Users will have to implement this function themselves 	
  *   ascii output, etc. 
  *
+ *	With -b [points [threads]], times the fitting of a long path.
+ *
  */
-int main()
+int main(argc, argv)
+    int		argc;
+    char	**argv;
 {
     static Point2 d[7] = {	/*  Digitized points */
 	{ 0.0, 0.0 },
@@ -67,7 +227,14 @@ int main()
 	{ 4.0, 0.0 },
     };
     double	error = 4.0;		/*  Squared error */
+
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		Bench(argc > 2 ? atoi(argv[2]) : 1000000,
+	      	argc > 3 ? atoi(argv[3]) : 0);
+		return 0;
+    }
     FitCurve(d, 7, error);		/*  Fit the Bezier curves */
+    return 0;
 }
 #endif						 /* TESTMODE */
 
@@ -79,12 +246,352 @@ void FitCurve(d, nPts, error)
     Point2	*d;			/*  Array of digitized points	*/
     int		nPts;		/*  Number of digitized points	*/
     double	error;		/*  User-defined error squared	*/
+{
+    FitScratch	scratch;	/*  Parameter values, reused	*/
+
+    InitFitScratch(&scratch, DrawCurve, (void *)NULL);
+    FitCurveScratch(d, nPts, error, &scratch);
+    FreeFitScratch(&scratch);
+}
+
+static void DrawCurve(data, curve)
+    void	*data;
+    BezierCurve	curve;
+{
+    DrawBezierCurve(3, curve);
+}
+
+
+/*
+ *  InitFitScratch, FreeFitScratch :
+ *	Set up empty scratch space whose fitted curves go to
+ *	output(data, curve), and free it when done.
+ */
+void InitFitScratch(scratch, output, data)
+    FitScratch	*scratch;
+    FitOutput	output;		/*  Called for each fitted curve */
+    void	*data;		/*  First argument of output	*/
+{
+    scratch->u = scratch->uPrime = (double *)NULL;
+    scratch->size = 0;
+    scratch->output = output;
+    scratch->data = data;
+}
+
+void FreeFitScratch(scratch)
+    FitScratch	*scratch;
+{
+    free((void *)scratch->u);
+    free((void *)scratch->uPrime);
+    scratch->u = scratch->uPrime = (double *)NULL;
+    scratch->size = 0;
+}
+
+static void GrowFitScratch(scratch, nPts)
+    FitScratch	*scratch;
+    int		nPts;		/*  Number of points to fit	*/
+{
+    if (nPts <= scratch->size)
+		return;
+    free((void *)scratch->u);
+    free((void *)scratch->uPrime);
+    scratch->u = (double *)malloc((unsigned)nPts * sizeof(double));
+    scratch->uPrime = (double *)malloc((unsigned)nPts * sizeof(double));
+    scratch->size = nPts;
+}
+
+
+/*
+ *  FitCurveScratch :
+ *	FitCurve, with the parameter values kept in scratch and the
+ *	curves sent to its output.  Fitting many sets of points with
+ *	the same scratch allocates only when a set is the longest yet.
+ */
+void FitCurveScratch(d, nPts, error, scratch)
+    Point2	*d;			/*  Array of digitized points	*/
+    int		nPts;		/*  Number of digitized points	*/
+    double	error;		/*  User-defined error squared	*/
+    FitScratch	*scratch;
+{
+    FitRange(d, 0, nPts - 1, error, scratch);
+}
+
+static void FitRange(d, first, last, error, scratch)
+    Point2	*d;			/*  Array of digitized points	*/
+    int		first, last;	/* Indices of first and last pts in region */
+    double	error;		/*  User-defined error squared	*/
+    FitScratch	*scratch;
 {
     Vector2	tHat1, tHat2;	/*  Unit tangent vectors at endpoints */
 
-    tHat1 = ComputeLeftTangent(d, 0);
-    tHat2 = ComputeRightTangent(d, nPts - 1);
-    FitCubic(d, 0, nPts - 1, tHat1, tHat2, error);
+    GrowFitScratch(scratch, last - first + 1);
+    tHat1 = ComputeLeftTangent(d, first);
+    tHat2 = ComputeRightTangent(d, last);
+    FitCubic(d, first, last, tHat1, tHat2, error, scratch);
+}
+
+
+/*
+ *  FindCorners :
+ *	Find the points where the digitized curve turns through more
+ *	than cornerAngle (in radians).  Their indices go in corners,
+ *	in order, between 0 and nPts-1, which always start and end
+ *	the list; corners needs room for nPts of them.  Returns the
+ *	number of indices stored.
+ */
+int FindCorners(d, nPts, cornerAngle, corners)
+    Point2	*d;			/*  Array of digitized points	*/
+    int		nPts;		/*  Number of digitized points	*/
+    double	cornerAngle;	/*  Least turning angle at a corner */
+    int		*corners;	/*  RETURN indices of corners	*/
+{
+    double	cosCorner = cos(cornerAngle);
+    int		i, n = 0;
+
+    corners[n++] = 0;
+    for (i = 1; i < nPts - 1; i++)
+		if (IsCorner(d, i, cosCorner))
+	    	corners[n++] = i;
+    corners[n++] = nPts - 1;
+    return n;
+}
+
+static int IsCorner(d, i, cosCorner)
+    Point2	*d;			/*  Digitized points		*/
+    int		i;		/*  Index of point inside region */
+    double	cosCorner;	/*  Cosine of least corner angle */
+{
+    Vector2	v1, v2;
+    double	len;
+
+    v1 = V2SubII(d[i], d[i-1]);
+    v2 = V2SubII(d[i+1], d[i]);
+    len = V2Length(&v1) * V2Length(&v2);
+    return len != 0.0 && V2Dot(&v1, &v2) < cosCorner * len;
+}
+
+
+/*
+ *  FitCurveParallel :
+ *	Split the points at their corners, and fit the ranges between
+ *	corners on up to nthreads threads (all of them if nthreads is
+ *	0), each with its own scratch.  The curves are collected per
+ *	range and passed to output(data, curve) in order once all the
+ *	ranges are done.  The curves are the same as those fitting
+ *	each range with FitCurve would give; a cornerAngle of PI
+ *	finds no corners and fits the whole set on one thread.
+ */
+typedef struct FitCurvesStruct {
+	Point2	*curves;		/*  4 control points per curve	*/
+	int	n, max;			/*  Number of curves, room for	*/
+} FitCurves;
+
+static void CollectCurve(data, curve)
+    void	*data;
+    BezierCurve	curve;
+{
+    FitCurves	*c = (FitCurves *)data;
+
+    if (c->n == c->max) {
+		c->max = c->max ? 2 * c->max : 8;
+		c->curves = (Point2 *)realloc((void *)c->curves,
+			(unsigned)(4 * c->max) * sizeof(Point2));
+    }
+    memcpy(&c->curves[4 * c->n++], curve, 4 * sizeof(Point2));
+}
+
+void FitCurveParallel(d, nPts, error, cornerAngle, output, data, nthreads)
+    Point2	*d;			/*  Array of digitized points	*/
+    int		nPts;		/*  Number of digitized points	*/
+    double	error;		/*  User-defined error squared	*/
+    double	cornerAngle;	/*  Least turning angle at a corner */
+    FitOutput	output;		/*  Called for each fitted curve */
+    void	*data;		/*  First argument of output	*/
+    int		nthreads;	/*  Threads to use, 0 for all	*/
+{
+    int		*corners;	/*  Ends of the ranges		*/
+    int		nRanges;	/*  Number of ranges between them */
+    FitCurves	*ranges;	/*  Curves fitted to each range	*/
+    int		i, j;
+
+    if (nPts < 2)
+		return;
+    corners = (int *)malloc((unsigned)nPts * sizeof(int));
+    nRanges = FindCorners(d, nPts, cornerAngle, corners) - 1;
+    ranges = (FitCurves *)calloc((unsigned)nRanges, sizeof(FitCurves));
+
+#ifdef _OPENMP
+#pragma omp parallel private(i) \
+	num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+    {
+		FitScratch	scratch;
+
+		InitFitScratch(&scratch, CollectCurve, (void *)NULL);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 1)
+#endif
+		for (i = 0; i < nRanges; i++) {
+	    	scratch.data = (void *)&ranges[i];
+	    	FitRange(d, corners[i], corners[i+1], error, &scratch);
+		}
+		FreeFitScratch(&scratch);
+    }
+
+    for (i = 0; i < nRanges; i++) {
+		for (j = 0; j < ranges[i].n; j++)
+	    	(*output)(data, &ranges[i].curves[4 * j]);
+		free((void *)ranges[i].curves);
+    }
+    free((void *)ranges);
+    free((void *)corners);
+}
+
+
+/*
+ *  FitStreamBegin, FitStreamAdd, FitStreamEnd :
+ *	Fit a curve whose points are given one at a time, sending
+ *	the curves to output(data, curve) as soon as they are known.
+ *	The open segment is refit only after it has grown by a
+ *	quarter, so each point costs a few fits of the segment it is
+ *	in, and only that segment's points are kept.  Corners (as in
+ *	FindCorners) end the segment at once.  The segments are
+ *	chosen greedily, as long as they fit, rather than by splitting
+ *	at the worst point as FitCurve does, so the curves differ from
+ *	FitCurve's but are within error of the points just the same.
+ *	FitStreamEnd fits whatever is left and frees the stream's
+ *	storage; the stream may then be begun again.
+ */
+void FitStreamBegin(stream, error, cornerAngle, output, data)
+    FitStream	*stream;
+    double	error;		/*  User-defined error squared	*/
+    double	cornerAngle;	/*  Least turning angle at a corner */
+    FitOutput	output;		/*  Called for each fitted curve */
+    void	*data;		/*  First argument of output	*/
+{
+    stream->d = (Point2 *)NULL;
+    stream->nPts = stream->max = 0;
+    stream->seen = stream->good = 0;
+    stream->next = 2;
+    stream->haveTangent = FALSE;
+    stream->error = error;
+    stream->cosCorner = cos(cornerAngle);
+    InitFitScratch(&stream->scratch, output, data);
+}
+
+void FitStreamAdd(stream, p)
+    FitStream	*stream;
+    Point2	p;			/*  Next digitized point	*/
+{
+    if (stream->nPts == stream->max) {
+		stream->max = stream->max ? 2 * stream->max : 64;
+		stream->d = (Point2 *)realloc((void *)stream->d,
+			(unsigned)stream->max * sizeof(Point2));
+		GrowFitScratch(&stream->scratch, stream->max);
+    }
+    stream->d[stream->nPts++] = p;
+    FitStreamStep(stream);
+}
+
+void FitStreamEnd(stream)
+    FitStream	*stream;
+{
+    Vector2	tHat1, tHat2;
+
+    if (stream->nPts >= 2) {
+		if (stream->good == stream->nPts - 1)
+	    	(*stream->scratch.output)(stream->scratch.data, stream->curve);
+		else {
+	    	tHat1 = stream->haveTangent ? stream->tHat1 :
+				ComputeLeftTangent(stream->d, 0);
+	    	tHat2 = ComputeRightTangent(stream->d, stream->nPts - 1);
+	    	FitCubic(stream->d, 0, stream->nPts - 1, tHat1, tHat2,
+				stream->error, &stream->scratch);
+		}
+    }
+    free((void *)stream->d);
+    FreeFitScratch(&stream->scratch);
+    stream->d = (Point2 *)NULL;
+    stream->nPts = stream->max = 0;
+    stream->seen = stream->good = 0;
+    stream->next = 2;
+    stream->haveTangent = FALSE;
+}
+
+/*
+ *  FitStreamStep :
+ *	Look at the points that have arrived since the last call.
+ *	d[0..good] are known to fit, with curve; the segment is tried
+ *	again on d[0..seen-1] when seen reaches next.
+ */
+static void FitStreamStep(stream)
+    FitStream	*stream;
+{
+    Point2	*d;
+    Point2	bezCurve[4];	/*  Fit to d[0..last]		*/
+    Vector2	tHat2;		/*  Unit tangent at d[last]	*/
+    int		last;		/*  Last point of the segment	*/
+    int		splitPoint;	/*  Point of maximum error	*/
+
+    while (stream->seen < stream->nPts) {
+		d = stream->d;
+		last = stream->seen++;
+
+		/*  A corner at the point before ends the segment there */
+		if (last >= 2 && IsCorner(d, last - 1, stream->cosCorner)) {
+	    	if (!stream->haveTangent)
+				stream->tHat1 = ComputeLeftTangent(d, 0);
+	    	tHat2 = ComputeRightTangent(d, last - 1);
+	    	if (stream->good == last - 1)
+				(*stream->scratch.output)(stream->scratch.data,
+					stream->curve);
+	    	else
+				FitCubic(d, 0, last - 1, stream->tHat1, tHat2,
+					stream->error, &stream->scratch);
+	    	FitStreamCut(stream, last - 1);
+	    	stream->haveTangent = FALSE;
+	    	continue;
+		}
+		if (stream->seen < stream->next)
+	    	continue;
+
+		if (!stream->haveTangent) {
+	    	stream->tHat1 = ComputeLeftTangent(d, 0);
+	    	stream->haveTangent = TRUE;
+		}
+		tHat2 = ComputeRightTangent(d, last);
+		if (FitSingle(d, 0, last, stream->tHat1, tHat2, stream->error,
+				&stream->scratch, bezCurve, &splitPoint) < stream->error
+				|| last == 1) {
+	    	memcpy(stream->curve, bezCurve, 4 * sizeof(Point2));
+	    	stream->good = last;
+	    	stream->next = stream->seen + 1 + last / STREAM_STRIDE;
+	    	continue;
+		}
+
+		/*  Output the last good fit, and go on from its end */
+		(*stream->scratch.output)(stream->scratch.data, stream->curve);
+		stream->tHat1 = ComputeRightTangent(d, stream->good);
+		V2Negate(&stream->tHat1);
+		FitStreamCut(stream, stream->good);
+    }
+}
+
+/*
+ *  FitStreamCut :
+ *	Start a new segment at d[first], dropping the points before
+ *	it; the points after it are looked at again.
+ */
+static void FitStreamCut(stream, first)
+    FitStream	*stream;
+    int		first;		/*  First point of the new segment */
+{
+    stream->nPts -= first;
+    memmove((void *)stream->d, (void *)&stream->d[first],
+		(unsigned)stream->nPts * sizeof(Point2));
+    stream->seen = 1;
+    stream->good = 0;
+    stream->next = 2;
 }
 
 
@@ -93,21 +600,56 @@ void FitCurve(d, nPts, error)
  *  FitCubic :
  *  	Fit a Bezier curve to a (sub)set of digitized points
  */
-static void FitCubic(d, first, last, tHat1, tHat2, error)
+static void FitCubic(d, first, last, tHat1, tHat2, error, scratch)
+    Point2	*d;			/*  Array of digitized points */
+    int		first, last;	/* Indices of first and last pts in region */
+    Vector2	tHat1, tHat2;	/* Unit tangent vectors at endpoints */
+    double	error;		/*  User-defined error squared	   */
+    FitScratch	*scratch;	/*  Parameter values, and output */
+{
+    Point2	bezCurve[4]; /*Control points of fitted Bezier curve*/
+    int		splitPoint;	/*  Point to split point set at	 */
+    Vector2	tHatCenter;   	/* Unit tangent vector at splitPoint */
+
+    /*  Two points always fit, with the heuristic in FitSingle */
+    if (FitSingle(d, first, last, tHat1, tHat2, error, scratch,
+	    	bezCurve, &splitPoint) < error || last - first == 1) {
+		(*scratch->output)(scratch->data, bezCurve);
+		return;
+    }
+
+    /* Fitting failed -- split at max error point and fit recursively */
+    tHatCenter = ComputeCenterTangent(d, splitPoint);
+    FitCubic(d, first, splitPoint, tHat1, tHatCenter, error, scratch);
+    V2Negate(&tHatCenter);
+    FitCubic(d, splitPoint, last, tHatCenter, tHat2, error, scratch);
+}
+
+
+/*
+ *  FitSingle :
+ *	Fit one Bezier curve to a (sub)set of digitized points, using
+ *	scratch->u and scratch->uPrime (which must have room for them
+ *	all) for the parameter values.  Returns the maximum squared
+ *	error, with the point where it occurs in splitPoint.
+ */
+static double FitSingle(d, first, last, tHat1, tHat2, error, scratch,
+			bezCurve, splitPoint)
     Point2	*d;			/*  Array of digitized points */
     int		first, last;	/* Indices of first and last pts in region */
     Vector2	tHat1, tHat2;	/* Unit tangent vectors at endpoints */
     double	error;		/*  User-defined error squared	   */
+    FitScratch	*scratch;	/*  Parameter values		*/
+    BezierCurve	bezCurve;	/*  RETURN bezier curve ctl pts	*/
+    int		*splitPoint;	/*  RETURN point of maximum error */
 {
-    BezierCurve	bezCurve; /*Control points of fitted Bezier curve*/
     double	*u;		/*  Parameter values for point  */
     double	*uPrime;	/*  Improved parameter values */
+    double	*tmp;
     double	maxError;	/*  Maximum fitting error	 */
-    int		splitPoint;	/*  Point to split point set at	 */
     int		nPts;		/*  Number of points in subset  */
     double	iterationError; /*Error below which you try iterating  */
     int		maxIterations = 4; /*  Max times to try iterating  */
-    Vector2	tHatCenter;   	/* Unit tangent vector at splitPoint */
     int		i;		
 
     iterationError = error * 4.0;	/* fixed issue 23 */
@@ -117,58 +659,42 @@ static void FitCubic(d, first, last, tHat1, tHat2, error)
     if (nPts == 2) {
 	    double dist = V2DistanceBetween2Points(&d[last], &d[first]) / 3.0;
 
-		bezCurve = (Point2 *)malloc(4 * sizeof(Point2));
 		bezCurve[0] = d[first];
 		bezCurve[3] = d[last];
 		V2Add(&bezCurve[0], V2Scale(&tHat1, dist), &bezCurve[1]);
 		V2Add(&bezCurve[3], V2Scale(&tHat2, dist), &bezCurve[2]);
-		DrawBezierCurve(3, bezCurve);
-		free((void *)bezCurve);
-		return;
+		*splitPoint = first;
+		return 0.0;
     }
 
     /*  Parameterize points, and attempt to fit curve */
-    u = ChordLengthParameterize(d, first, last);
-    bezCurve = GenerateBezier(d, first, last, u, tHat1, tHat2);
+    u = scratch->u;
+    uPrime = scratch->uPrime;
+    ChordLengthParameterize(d, first, last, u);
+    GenerateBezier(d, first, last, u, tHat1, tHat2, bezCurve);
 
     /*  Find max deviation of points to fitted curve */
-    maxError = ComputeMaxError(d, first, last, bezCurve, u, &splitPoint);
-    if (maxError < error) {
-		DrawBezierCurve(3, bezCurve);
-		free((void *)u);
-		free((void *)bezCurve);
-		return;
-    }
+    maxError = ComputeMaxError(d, first, last, bezCurve, u, splitPoint);
+    if (maxError < error)
+		return maxError;
 
 
     /*  If error not too large, try some reparameterization  */
     /*  and iteration */
     if (maxError < iterationError) {
 		for (i = 0; i < maxIterations; i++) {
-	    	uPrime = Reparameterize(d, first, last, u, bezCurve);
-	    	free((void *)bezCurve);
-	    	bezCurve = GenerateBezier(d, first, last, uPrime, tHat1, tHat2);
+	    	Reparameterize(d, first, last, u, bezCurve, uPrime);
+	    	GenerateBezier(d, first, last, uPrime, tHat1, tHat2, bezCurve);
 	    	maxError = ComputeMaxError(d, first, last,
-				       bezCurve, uPrime, &splitPoint);
-	    	if (maxError < error) {
-			DrawBezierCurve(3, bezCurve);
-			free((void *)u);
-			free((void *)bezCurve);
-			free((void *)uPrime);
-			return;
-	    }
-	    free((void *)u);
-	    u = uPrime;
-	}
+				       bezCurve, uPrime, splitPoint);
+	    	if (maxError < error)
+				return maxError;
+	    	tmp = u;
+	    	u = uPrime;
+	    	uPrime = tmp;
+		}
     }
-
-    /* Fitting failed -- split at max error point and fit recursively */
-    free((void *)u);
-    free((void *)bezCurve);
-    tHatCenter = ComputeCenterTangent(d, splitPoint);
-    FitCubic(d, first, splitPoint, tHat1, tHatCenter, error);
-    V2Negate(&tHatCenter);
-    FitCubic(d, splitPoint, last, tHatCenter, tHat2, error);
+    return maxError;
 }
 
 
@@ -177,14 +703,15 @@ static void FitCubic(d, first, last, tHat1, tHat2, error)
  *  Use least-squares method to find Bezier control points for region.
  *
  */
-static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
+static void  GenerateBezier(d, first, last, uPrime, tHat1, tHat2, bezCurve)
     Point2	*d;			/*  Array of digitized points	*/
     int		first, last;		/*  Indices defining region	*/
     double	*uPrime;		/*  Parameter values for region */
     Vector2	tHat1, tHat2;	/*  Unit tangents at endpoints	*/
+    BezierCurve	bezCurve;	/*  RETURN bezier curve ctl pts	*/
 {
     int 	i;
-    Vector2 	A[MAXPOINTS][2];	/* Precomputed rhs for eqn	*/
+    Vector2 	A[2];			/* Rhs for eqn, at point i	*/
     int 	nPts;			/* Number of pts in sub-curve */
     double 	C[2][2];			/* Matrix C		*/
     double 	X[2];			/* Matrix X			*/
@@ -194,25 +721,11 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
     double 	alpha_l,		/* Alpha values, left and right	*/
     	   	alpha_r;
     Vector2 	tmp;			/* Utility variable		*/
-    BezierCurve	bezCurve;	/* RETURN bezier curve ctl pts	*/
 	double  segLength;
 	double  epsilon;
 
-    bezCurve = (Point2 *)malloc(4 * sizeof(Point2));
     nPts = last - first + 1;
 
- 
-    /* Compute the A's	*/
-    for (i = 0; i < nPts; i++) {
-		Vector2		v1, v2;
-		v1 = tHat1;
-		v2 = tHat2;
-		V2Scale(&v1, B1(uPrime[i]));
-		V2Scale(&v2, B2(uPrime[i]));
-		A[i][0] = v1;
-		A[i][1] = v2;
-    }
-
     /* Create the C and X matrices	*/
     C[0][0] = 0.0;
     C[0][1] = 0.0;
@@ -221,12 +734,19 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
     X[0]    = 0.0;
     X[1]    = 0.0;
 
+    /* The A's are computed as they are needed, so that any number */
+    /* of points can be fitted */
     for (i = 0; i < nPts; i++) {
-        C[0][0] += V2Dot(&A[i][0], &A[i][0]);
-		C[0][1] += V2Dot(&A[i][0], &A[i][1]);
-/*					C[1][0] += V2Dot(&A[i][0], &A[i][1]);*/	
+		A[0] = tHat1;
+		A[1] = tHat2;
+		V2Scale(&A[0], B1(uPrime[i]));
+		V2Scale(&A[1], B2(uPrime[i]));
+
+        C[0][0] += V2Dot(&A[0], &A[0]);
+		C[0][1] += V2Dot(&A[0], &A[1]);
+/*					C[1][0] += V2Dot(&A[0], &A[1]);*/	
 		C[1][0] = C[0][1];
-		C[1][1] += V2Dot(&A[i][1], &A[i][1]);
+		C[1][1] += V2Dot(&A[1], &A[1]);
 
 		tmp = V2SubII(d[first + i],
 	        V2AddII(
@@ -238,8 +758,8 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
 	                    		V2ScaleIII(d[last], B3(uPrime[i]))))));
 	
 
-	X[0] += V2Dot(&A[i][0], &tmp);
-	X[1] += V2Dot(&A[i][1], &tmp);
+	X[0] += V2Dot(&A[0], &tmp);
+	X[1] += V2Dot(&A[1], &tmp);
     }
 
     /* Compute the determinants of C and X	*/
@@ -264,7 +784,7 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
 		bezCurve[3] = d[last];
 		V2Add(&bezCurve[0], V2Scale(&tHat1, dist), &bezCurve[1]);
 		V2Add(&bezCurve[3], V2Scale(&tHat2, dist), &bezCurve[2]);
-		return (bezCurve);
+		return;
     }
 
     /*  First and last control points of the Bezier curve are */
@@ -275,7 +795,6 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
     bezCurve[3] = d[last];
     V2Add(&bezCurve[0], V2Scale(&tHat1, alpha_l), &bezCurve[1]);
     V2Add(&bezCurve[3], V2Scale(&tHat2, alpha_r), &bezCurve[2]);
-    return (bezCurve);
 }
 
 
@@ -285,26 +804,21 @@ static BezierCurve  GenerateBezier(d, first, last, uPrime, tHat1, tHat2)
  *   a better parameterization.
  *
  */
-static double *Reparameterize(d, first, last, u, bezCurve)
+static void Reparameterize(d, first, last, u, bezCurve, uPrime)
     Point2	*d;			/*  Array of digitized points	*/
     int		first, last;		/*  Indices defining region	*/
     double	*u;			/*  Current parameter values	*/
     BezierCurve	bezCurve;	/*  Current fitted curve	*/
+    double	*uPrime;		/*  RETURN new parameter values	*/
 {
-    int 	nPts = last-first+1;	
     int 	i;
-    double	*uPrime;		/*  New parameter values	*/
 
-    uPrime = (double *)malloc(nPts * sizeof(double));
     for (i = first; i <= last; i++) {
 		uPrime[i-first] = NewtonRaphsonRootFind(bezCurve, d[i], u[i-
 					first]);
     }
-    return (uPrime);
 }
 
-
-
 /*
  *  NewtonRaphsonRootFind :
  *	Use Newton-Raphson iteration to find better root.
@@ -364,11 +878,9 @@ static Point2 BezierII(degree, V, t)
 {
     int 	i, j;		
     Point2 	Q;	        /* Point on curve at parameter t	*/
-    Point2 	*Vtemp;		/* Local copy of control points		*/
+    Point2 	Vtemp[MAXDEGREE+1];	/* Local copy of control points	*/
 
     /* Copy array	*/
-    Vtemp = (Point2 *)malloc((unsigned)((degree+1) 
-				* sizeof (Point2)));
     for (i = 0; i <= degree; i++) {
 		Vtemp[i] = V[i];
     }
@@ -382,7 +894,6 @@ static Point2 BezierII(degree, V, t)
     }
 
     Q = Vtemp[0];
-    free((void *)Vtemp);
     return Q;
 }
 
@@ -466,14 +977,12 @@ static Vector2 ComputeCenterTangent(d, center)
  *	Assign parameter values to digitized points 
  *	using relative distances between points.
  */
-static double *ChordLengthParameterize(d, first, last)
+static void ChordLengthParameterize(d, first, last, u)
     Point2	*d;			/* Array of digitized points */
     int		first, last;		/*  Indices defining region	*/
+    double	*u;			/*  RETURN parameterization	*/
 {
     int		i;	
-    double	*u;			/*  Parameterization		*/
-
-    u = (double *)malloc((unsigned)(last-first+1) * sizeof(double));
 
     u[0] = 0.0;
     for (i = first+1; i <= last; i++) {
@@ -484,8 +993,6 @@ static double *ChordLengthParameterize(d, first, last)
     for (i = first + 1; i <= last; i++) {
 		u[i-first] = u[i-first] / u[last-first];
     }
-
-    return(u);
 }
 
 
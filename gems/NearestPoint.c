@@ -19,6 +19,8 @@ from "Graphics Gems", Academic Press, 1990
  *  Forward declarations
  */
 Point2  NearestPointOnCurve();
+double  NearestParameterOnCurve();
+static	double	ClosestCandidate();
 static	int	FindRoots();
 static	Point2	*ConvertToBezierForm();
 static	double	ComputeXIntercept();
@@ -32,15 +34,138 @@ int		MAXDEPTH = 64;	/*  Maximum depth for recursion */
 #define	EPSILON	(ldexp(1.0,-MAXDEPTH-1)) /*Flatness control value */
 #define	DEGREE	3			/*  Cubic Bezier curve		*/
 #define	W_DEGREE 5			/*  Degree of eqn to find roots of */
+#define	NSAMPLES 32			/*  Intervals in a curve's table   */
+#define	NEWTON_STEPS 4			/*  Newton steps after the table   */
+
+/*
+ *  A cubic Bezier curve prepared for many nearest point queries:
+ *  everything that does not depend on the query point P is worked
+ *  out once.  The 5th-degree equation of ConvertToBezierForm has
+ *  control points (k/5, A[k] - B[k].P), and the curve is tabulated
+ *  at NSAMPLES+1 evenly spaced parameter values to start Newton's
+ *  method from.
+ */
+typedef struct PreparedCurveStruct {
+	Point2	V[DEGREE+1];		/*  Control points		*/
+	double	A[W_DEGREE+1];		/*  Sum of z[j][i] d[j].V[i]	*/
+	Vector2	B[W_DEGREE+1];		/*  Sum of z[j][i] d[j]		*/
+	Vector2	a[DEGREE+1];		/*  Power basis coefficients	*/
+	Point2	table[NSAMPLES+1];	/*  Curve at t = i / NSAMPLES	*/
+} PreparedCurve;
+
+void	PrepareCurve();
+double	NearestParameterPrepared();
+void	NearestPointsOnCurve();
 
 #ifdef TESTMODE
+#include <string.h>
+#include <time.h>
+
+/*
+ *  Distance :
+ *	Distance from P to the curve V at parameter value t.
+ */
+static double Distance(P, V, t)
+    Point2	P;
+    Point2	*V;
+    double	t;
+{
+    Point2	p;
+    Vector2	v;
+
+    p = Bezier(V, DEGREE, t, (Point2 *)NULL, (Point2 *)NULL);
+    return (V2Length(V2Sub(&P, &p, &v)));
+}
+
+/*
+ *  Bench :
+ *	Time n random points in [-1, 5] x [-1, 4] against each of
+ *	ncurves random curves with control points in [0, 4] x [0, 3],
+ *	finding the nearest points exactly from scratch, exactly on
+ *	prepared curves, and in a batch; and count how often the batch
+ *	answer is further away than the exact one.
+ */
+static void Bench(n, ncurves)
+    int		n, ncurves;
+{
+    PreparedCurve curve;
+    Point2	V[DEGREE+1], *P;
+    double	*t_exact, *t_prep, *t_batch;
+    double	d, excess, max_excess;
+    double	time_exact = 0.0, time_prep = 0.0, time_batch = 0.0;
+    clock_t	start;
+    int		c, i, worse = 0, differ = 0;
+
+    P = (Point2 *)malloc((unsigned)n * sizeof(Point2));
+    t_exact = (double *)malloc((unsigned)n * sizeof(double));
+    t_prep = (double *)malloc((unsigned)n * sizeof(double));
+    t_batch = (double *)malloc((unsigned)n * sizeof(double));
+    max_excess = 0.0;
+
+    srand(1);
+    for (c = 0; c < ncurves; c++) {
+		for (i = 0; i <= DEGREE; i++) {
+	    	V[i].x = 4.0 * rand() / RAND_MAX;
+	    	V[i].y = 3.0 * rand() / RAND_MAX;
+		}
+		for (i = 0; i < n; i++) {
+	    	P[i].x = 6.0 * rand() / RAND_MAX - 1.0;
+	    	P[i].y = 5.0 * rand() / RAND_MAX - 1.0;
+		}
+
+		start = clock();
+		for (i = 0; i < n; i++)
+	    	t_exact[i] = NearestParameterOnCurve(P[i], V);
+		time_exact += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		PrepareCurve(V, &curve);
+		for (i = 0; i < n; i++)
+	    	t_prep[i] = NearestParameterPrepared(&curve, P[i]);
+		time_prep += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		start = clock();
+		PrepareCurve(V, &curve);
+		NearestPointsOnCurve(&curve, n, P, t_batch, (Point2 *)NULL);
+		time_batch += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+		for (i = 0; i < n; i++) {
+	    	d = Distance(P[i], V, t_exact[i]);
+	    	if (fabs(Distance(P[i], V, t_prep[i]) - d) > 1e-12)
+				differ++;
+	    	excess = Distance(P[i], V, t_batch[i]) - d;
+	    	if (excess > 1e-9)
+				worse++;
+	    	if (excess > max_excess)
+				max_excess = excess;
+		}
+    }
+
+    n *= ncurves;
+    printf("%d points on %d curves\n", n, ncurves);
+    printf("  NearestParameterOnCurve  %10.0f points/sec\n",
+		n / time_exact);
+    printf("  NearestParameterPrepared %10.0f points/sec  (%d differ)\n",
+		n / time_prep, differ);
+    printf("  NearestPointsOnCurve     %10.0f points/sec  (%d further by "
+		"over 1e-9, at most %.3g)\n", n / time_batch, worse, max_excess);
+
+    free((char *)P);
+    free((char *)t_exact);
+    free((char *)t_prep);
+    free((char *)t_batch);
+}
+
 /*
  *  main :
  *	Given a cubic Bezier curve (i.e., its control points), and some
  *	arbitrary point in the plane, find the point on the curve
- *	closest to that arbitrary point.
+ *	closest to that arbitrary point.  With "-b [points [curves]]",
+ *	time the ways of doing that instead.
  */
-int main()
+int main(argc, argv)
+    int		argc;
+    char	**argv;
 {
    
  static Point2 bezCurve[4] = {	/*  A cubic Bezier curve	*/
@@ -52,6 +177,12 @@ int main()
     static Point2 arbPoint = { 3.5, 2.0 }; /*Some arbitrary point*/
     Point2	pointOnCurve;		 /*  Nearest point on the curve */
 
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		Bench(argc > 2 ? atoi(argv[2]) : 100000,
+	      	argc > 3 ? atoi(argv[3]) : 10);
+		return 0;
+    }
+
     /*  Find the closest point */
     pointOnCurve = NearestPointOnCurve(arbPoint, bezCurve);
     printf("pointOnCurve : (%4.4f, %4.4f)\n", pointOnCurve.x,
@@ -70,11 +201,31 @@ int main()
 Point2 NearestPointOnCurve(P, V)
     Point2 	P;			/* The user-supplied point	  */
     Point2 	*V;			/* Control points of cubic Bezier */
+{
+    double	t;			/* Parameter value of closest pt*/
+
+    t = NearestParameterOnCurve(P, V);
+
+    /*  Return the point on the curve at parameter value t */
+    printf("t : %4.12f\n", t);
+    return (Bezier(V, DEGREE, t, (Point2 *)NULL, (Point2 *)NULL));
+}
+
+
+/*
+ *  NearestParameterOnCurve :
+ *	Compute the parameter value of the point on a Bezier curve
+ *	segment closest to P, by finding all the roots of the
+ *	5th-degree equation.  This is the exact method the faster
+ *	ones below are measured against.
+ */
+double NearestParameterOnCurve(P, V)
+    Point2 	P;			/* The user-supplied point	  */
+    Point2 	*V;			/* Control points of cubic Bezier */
 {
     Point2	*w;			/* Ctl pts for 5th-degree eqn	*/
     double 	t_candidate[W_DEGREE];	/* Possible roots		*/     
     int 	n_solutions;		/* Number of roots found	*/
-    double	t;			/* Parameter value of closest pt*/
 
     /*  Convert problem to 5th-degree Bezier form	*/
     w = ConvertToBezierForm(P, V);
@@ -83,12 +234,26 @@ Point2 NearestPointOnCurve(P, V)
     n_solutions = FindRoots(w, W_DEGREE, t_candidate, 0);
     free((char *)w);
 
-    /* Compare distances of P to all candidates, and to t=0, and t=1 */
-    {
-		double 	dist, new_dist;
-		Point2 	p;
-		Vector2  v;
-		int		i;
+    return (ClosestCandidate(P, V, t_candidate, n_solutions));
+}
+
+
+/*
+ *  ClosestCandidate :
+ *	Compare distances of P to all candidates, and to t=0, and
+ *	t=1, returning the parameter value of the closest.
+ */
+static double ClosestCandidate(P, V, t_candidate, n_solutions)
+    Point2 	P;			/* The user-supplied point	  */
+    Point2 	*V;			/* Control points of cubic Bezier */
+    double 	*t_candidate;		/* Possible roots		*/     
+    int 	n_solutions;		/* Number of roots found	*/
+{
+	double 	dist, new_dist;
+	double	t;
+	Point2 	p;
+	Vector2  v;
+	int		i;
 
 	
 	/* Check distance to beginning of curve, where t = 0	*/
@@ -112,11 +277,7 @@ Point2 NearestPointOnCurve(P, V)
             	dist = new_dist;
 	    	t = 1.0;
         }
-    }
-
-    /*  Return the point on the curve at parameter value t */
-    printf("t : %4.12f\n", t);
-    return (Bezier(V, DEGREE, t, (Point2 *)NULL, (Point2 *)NULL));
+	return (t);
 }
 
 
@@ -483,3 +644,226 @@ static Vector2 V2ScaleII(v, s)
     result.x = v->x * s; result.y = v->y * s;
     return (result);
 }
+
+
+/*
+ *  PrepareCurve :
+ *	Work out everything about a cubic Bezier curve that nearest
+ *	point queries need but that does not depend on the point.
+ *	The control points of the 5th-degree equation are linear in P,
+ *	so three calls of ConvertToBezierForm give them for all P.
+ */
+void PrepareCurve(V, curve)
+    Point2 	*V;			/* Control points of cubic Bezier */
+    PreparedCurve *curve;		/* RETURN the prepared curve	  */
+{
+    static Point2 origin = { 0.0, 0.0 }, xunit = { 1.0, 0.0 },
+		  yunit = { 0.0, 1.0 };
+    Point2	*w0, *wx, *wy;
+    double	t;
+    int		i;
+
+    for (i = 0; i <= DEGREE; i++) {
+		curve->V[i] = V[i];
+    }
+
+    w0 = ConvertToBezierForm(origin, V);
+    wx = ConvertToBezierForm(xunit, V);
+    wy = ConvertToBezierForm(yunit, V);
+    for (i = 0; i <= W_DEGREE; i++) {
+		curve->A[i] = w0[i].y;
+		curve->B[i].x = w0[i].y - wx[i].y;
+		curve->B[i].y = w0[i].y - wy[i].y;
+    }
+    free((char *)w0);
+    free((char *)wx);
+    free((char *)wy);
+
+    /* Power basis, for the curve and its derivatives	*/
+    curve->a[0].x = V[0].x;
+    curve->a[0].y = V[0].y;
+    curve->a[1].x = 3.0 * (V[1].x - V[0].x);
+    curve->a[1].y = 3.0 * (V[1].y - V[0].y);
+    curve->a[2].x = 3.0 * (V[2].x - 2.0 * V[1].x + V[0].x);
+    curve->a[2].y = 3.0 * (V[2].y - 2.0 * V[1].y + V[0].y);
+    curve->a[3].x = V[3].x - 3.0 * (V[2].x - V[1].x) - V[0].x;
+    curve->a[3].y = V[3].y - 3.0 * (V[2].y - V[1].y) - V[0].y;
+
+    for (i = 0; i <= NSAMPLES; i++) {
+		t = (double)i / NSAMPLES;
+		curve->table[i] = Bezier(V, DEGREE, t,
+			(Point2 *)NULL, (Point2 *)NULL);
+    }
+}
+
+
+/*
+ *  NearestParameterPrepared :
+ *	NearestParameterOnCurve for a prepared curve: the same roots
+ *	of the same equation, without building it from scratch.
+ */
+double NearestParameterPrepared(curve, P)
+    PreparedCurve *curve;		/* The prepared curve		  */
+    Point2 	P;			/* The user-supplied point	  */
+{
+    Point2	w[W_DEGREE+1];		/* Ctl pts for 5th-degree eqn	*/
+    double 	t_candidate[W_DEGREE];	/* Possible roots		*/     
+    int 	n_solutions;		/* Number of roots found	*/
+    int		i;
+
+    for (i = 0; i <= W_DEGREE; i++) {
+		w[i].x = (double)(i) / W_DEGREE;
+		w[i].y = curve->A[i] - V2Dot(&curve->B[i], &P);
+    }
+
+    n_solutions = FindRoots(w, W_DEGREE, t_candidate, 0);
+
+    return (ClosestCandidate(P, curve->V, t_candidate, n_solutions));
+}
+
+
+/*
+ *  TableMinima :
+ *	Find the two table entries nearest P among those nearer than
+ *	their neighbours, that is, the starts for the two best local
+ *	minima of the distance along the curve.  If there is only one
+ *	both are it.  Their squared distances are returned too.
+ */
+static void TableMinima(curve, P, best, dist)
+    PreparedCurve *curve;		/* The prepared curve		  */
+    Point2 	P;			/* The user-supplied point	  */
+    int		*best;			/* RETURN the two entries	  */
+    double	*dist;			/* RETURN their squared distances */
+{
+    double	d[NSAMPLES+1], dx, dy;
+    int		i;
+
+    for (i = 0; i <= NSAMPLES; i++) {
+		dx = curve->table[i].x - P.x;
+		dy = curve->table[i].y - P.y;
+		d[i] = dx * dx + dy * dy;
+    }
+
+    best[0] = best[1] = 0;
+    dist[0] = dist[1] = HUGE_VAL;
+    for (i = 0; i <= NSAMPLES; i++) {
+		if ((i > 0 && d[i] > d[i-1]) || (i < NSAMPLES && d[i] > d[i+1]))
+	    	continue;
+		if (d[i] < dist[0]) {
+	    	best[1] = best[0];
+	    	dist[1] = dist[0];
+	    	best[0] = i;
+	    	dist[0] = d[i];
+		}
+		else if (d[i] < dist[1]) {
+	    	best[1] = i;
+	    	dist[1] = d[i];
+		}
+    }
+    if (dist[1] == HUGE_VAL) {
+		best[1] = best[0];
+		dist[1] = dist[0];
+    }
+}
+
+
+/*
+ *  Refine :
+ *	Starting from table entry best, take Newton steps on
+ *	(B(t) - P).B'(t) = 0, kept between the entries either side,
+ *	where a local minimum of the distance must lie.  Returns the
+ *	parameter value, and its squared distance in *dist, which
+ *	on entry is that of the table entry.
+ */
+static double Refine(curve, P, best, dist)
+    PreparedCurve *curve;		/* The prepared curve		  */
+    Point2 	P;			/* The user-supplied point	  */
+    int		best;			/* Table entry to start from	  */
+    double	*dist;			/* Squared distance, in and out	  */
+{
+    Vector2	*a = curve->a;
+    double	t, lo, hi, g, dg, bx, by, b1x, b1y, b2x, b2y;
+    int		i;
+
+    t = (double)best / NSAMPLES;
+    lo = (double)MAX(best - 1, 0) / NSAMPLES;
+    hi = (double)MIN(best + 1, NSAMPLES) / NSAMPLES;
+
+    for (i = 0; i < NEWTON_STEPS; i++) {
+		bx = ((a[3].x * t + a[2].x) * t + a[1].x) * t + a[0].x - P.x;
+		by = ((a[3].y * t + a[2].y) * t + a[1].y) * t + a[0].y - P.y;
+		b1x = (3.0 * a[3].x * t + 2.0 * a[2].x) * t + a[1].x;
+		b1y = (3.0 * a[3].y * t + 2.0 * a[2].y) * t + a[1].y;
+		b2x = 6.0 * a[3].x * t + 2.0 * a[2].x;
+		b2y = 6.0 * a[3].y * t + 2.0 * a[2].y;
+		g = bx * b1x + by * b1y;
+		dg = b1x * b1x + b1y * b1y + bx * b2x + by * b2y;
+		if (dg <= 0.0)
+	    	break;
+		t = MIN(MAX(t - g / dg, lo), hi);
+    }
+
+    bx = ((a[3].x * t + a[2].x) * t + a[1].x) * t + a[0].x - P.x;
+    by = ((a[3].y * t + a[2].y) * t + a[1].y) * t + a[0].y - P.y;
+    if (bx * bx + by * by > *dist)
+		return ((double)best / NSAMPLES);
+    *dist = bx * bx + by * by;
+    return (t);
+}
+
+
+/*
+ *  NearestByTable :
+ *	Find the parameter value of the point on a prepared curve
+ *	nearest P by refining the two best local minima in its table.
+ *	Not exact: a third stretch of the curve could be nearer still,
+ *	or a minimum fall between table entries, but the answer is
+ *	never further from P than the nearest entry.
+ */
+static double NearestByTable(curve, P)
+    PreparedCurve *curve;		/* The prepared curve		  */
+    Point2 	P;			/* The user-supplied point	  */
+{
+    double	dist[2], t[2];
+    int		best[2];
+
+    TableMinima(curve, P, best, dist);
+    t[0] = Refine(curve, P, best[0], &dist[0]);
+    if (best[1] == best[0])
+		return (t[0]);
+    t[1] = Refine(curve, P, best[1], &dist[1]);
+    return (dist[1] < dist[0] ? t[1] : t[0]);
+}
+
+
+
+
+/*
+ *  NearestPointsOnCurve :
+ *	For each of n points P[i], find the parameter value t[i] of
+ *	the nearest point Q[i] on a prepared curve, by way of its
+ *	table and Newton's method; t or Q may be NULL.  Much faster
+ *	than NearestParameterPrepared, and almost always as close; see
+ *	NearestByTable for when it is not.
+ */
+void NearestPointsOnCurve(curve, n, P, t, Q)
+    PreparedCurve *curve;		/* The prepared curve		  */
+    int		n;			/* Number of points		  */
+    Point2 	*P;			/* The user-supplied points	  */
+    double	*t;			/* RETURN their parameter values  */
+    Point2	*Q;			/* RETURN their nearest points	  */
+{
+    Vector2	*a = curve->a;
+    double	u;
+    int		i;
+
+    for (i = 0; i < n; i++) {
+		u = NearestByTable(curve, P[i]);
+		if (t != NULL)
+	    	t[i] = u;
+		if (Q != NULL) {
+	    	Q[i].x = ((a[3].x * u + a[2].x) * u + a[1].x) * u + a[0].x;
+	    	Q[i].y = ((a[3].y * u + a[2].y) * u + a[1].y) * u + a[0].y;
+		}
+    }
+}
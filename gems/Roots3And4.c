@@ -22,6 +22,8 @@
  *                  reduced considerably (e.g. to 1E-30), results will be
  *                  correct but multiple roots might be reported more
  *                  than once.
+ *  Oct 18, 2026    SolveQuadrics(), SolveCubics() and SolveQuartics() for
+ *                  many equations at once, two at a time with SSE2.
  */
 
 #include    <math.h>
@@ -241,3 +243,428 @@ int SolveQuartic(c, s)
     return num;
 }
 
+
+
+/*
+ *  Batch versions of the solvers above, for many equations at a time.
+ *  Coefficients are passed in structure-of-arrays form: c[ k ][ i ] is
+ *  the coefficient of x^k in equation i.  The roots come back the same
+ *  way, s[ j ][ i ] being the j-th root of equation i in increasing
+ *  order, num[ i ] the number of them, and the places after the last
+ *  root set to HUGE_VAL.  The functions return the total number of
+ *  roots found.
+ *
+ *  Each equation is solved by the same formulas as the scalar functions
+ *  use, but without branches: every case is worked out for every
+ *  equation and the right one picked with a mask.  With SSE2, two
+ *  equations go through together; cbrt() and acos() then have to be
+ *  done in registers too, by Halley's iteration and a polynomial.
+ */
+
+#include    <stdlib.h>
+
+#ifdef __SSE2__
+#include    <emmintrin.h>
+
+typedef __m128d VEC;
+#define     LANES	    2
+#define     V_SET(x)	    _mm_set1_pd(x)
+#define     V_LOAD(p)	    _mm_loadu_pd(p)
+#define     V_STORE(p, a)   _mm_storeu_pd(p, a)
+#define     V_ADD(a, b)	    _mm_add_pd(a, b)
+#define     V_SUB(a, b)	    _mm_sub_pd(a, b)
+#define     V_MUL(a, b)	    _mm_mul_pd(a, b)
+#define     V_DIV(a, b)	    _mm_div_pd(a, b)
+#define     V_SQRT(a)	    _mm_sqrt_pd(a)
+#define     V_MIN(a, b)	    _mm_min_pd(a, b)
+#define     V_MAX(a, b)	    _mm_max_pd(a, b)
+#define     V_ABS(a)	    _mm_andnot_pd(_mm_set1_pd(-0.0), a)
+#define     V_LT(a, b)	    _mm_cmplt_pd(a, b)
+#define     V_GT(a, b)	    _mm_cmpgt_pd(a, b)
+#define     V_AND(m, n)	    _mm_and_pd(m, n)
+#define     V_OR(m, n)	    _mm_or_pd(m, n)
+#define     V_ANDNOT(m, n)  _mm_andnot_pd(m, n)	    /* n and not m */
+#define     V_SEL(m, a, b)  _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b))
+#define     V_ONE(m)	    _mm_and_pd(m, _mm_set1_pd(1.0))
+
+#else
+
+typedef double VEC;
+#define     LANES	    1
+#define     V_SET(x)	    (x)
+#define     V_LOAD(p)	    (*(p))
+#define     V_STORE(p, a)   (*(p) = (a))
+#define     V_ADD(a, b)	    ((a) + (b))
+#define     V_SUB(a, b)	    ((a) - (b))
+#define     V_MUL(a, b)	    ((a) * (b))
+#define     V_DIV(a, b)	    ((a) / (b))
+#define     V_SQRT(a)	    sqrt(a)
+#define     V_MIN(a, b)	    ((a) < (b) ? (a) : (b))
+#define     V_MAX(a, b)	    ((a) > (b) ? (a) : (b))
+#define     V_ABS(a)	    fabs(a)
+#define     V_LT(a, b)	    ((a) < (b) ? 1.0 : 0.0)
+#define     V_GT(a, b)	    ((a) > (b) ? 1.0 : 0.0)
+#define     V_AND(m, n)	    ((m) != 0.0 && (n) != 0.0 ? 1.0 : 0.0)
+#define     V_OR(m, n)	    ((m) != 0.0 || (n) != 0.0 ? 1.0 : 0.0)
+#define     V_ANDNOT(m, n)  ((m) == 0.0 && (n) != 0.0 ? 1.0 : 0.0)
+#define     V_SEL(m, a, b)  ((m) != 0.0 ? (a) : (b))
+#define     V_ONE(m)	    (m)
+
+#endif
+
+#define     V_ISZERO(x)	    V_AND(V_GT(x, V_SET(-EQN_EPS)), V_LT(x, V_SET(EQN_EPS)))
+
+/* sort a pair into increasing order; HUGE_VAL places sort last */
+
+#define     V_ORDER(a, b)   { VEC t_ = V_MIN(a, b); b = V_MAX(a, b); a = t_; }
+
+#ifdef __SSE2__
+
+/* cube root: a guess from the exponent, then three Halley steps */
+
+static VEC v_cbrt(x)
+    VEC x;
+{
+    VEC	    a, y, y3, d;
+    __m128i hi;
+    int	    i;
+
+    a = V_ABS(x);
+
+    /* divide the high words by 3, as in fdlibm's cbrt() */
+
+    hi = _mm_shuffle_epi32(_mm_castpd_si128(a), _MM_SHUFFLE(3, 1, 3, 1));
+    d = V_ADD(V_MUL(_mm_cvtepi32_pd(hi), V_SET(1.0/3)), V_SET(715094163.0));
+    hi = _mm_shuffle_epi32(_mm_cvttpd_epi32(d), _MM_SHUFFLE(1, 3, 0, 3));
+    y = _mm_castsi128_pd(hi);
+
+    for (i = 0; i < 3; ++i)
+    {
+	y3 = V_MUL(V_MUL(y, y), y);
+	y = V_DIV(V_MUL(y, V_ADD(y3, V_ADD(a, a))), V_ADD(V_ADD(y3, y3), a));
+    }
+    y = V_SEL(V_GT(a, V_SET(0.0)), y, V_SET(0.0));
+
+    return _mm_or_pd(y, _mm_and_pd(x, _mm_set1_pd(-0.0)));
+}
+
+/* cos and sin of acos(x)/3, for -1 <= x <= 1 */
+
+static void v_acos3(x, c, s)
+    VEC x, *c, *s;
+{
+    static const double asin_t[ 13 ] = {	/* asin(u)/u in t = 8u^2 - 1 */
+	1.33866251417202879e-12, 3.83444387352938049e-12,
+	2.55653276326484047e-11, 2.28421281889268357e-10,
+	1.90234408976681416e-09, 1.61019353850377918e-08,
+	1.40338628991630071e-07, 1.26993056731028462e-06,
+	1.21165233269365246e-05, 1.25293133316087290e-04,
+	1.48594155784524088e-03, 2.34721962002249346e-02,
+	1.02210057524925002e+00 };
+    static const double cos_t[ 11 ] = {
+	4.11031762331216484e-19, -1.56192069685862253e-16,
+	4.77947733238738525e-14, -1.14707455977297245e-11,
+	2.08767569878681002e-09, -2.75573192239858883e-07,
+	2.48015873015873016e-05, -1.38888888888888894e-03,
+	4.16666666666666644e-02, -5.00000000000000000e-01,
+	1.00000000000000000e+00 };
+    static const double sin_t[ 10 ] = {
+	-8.22063524662432950e-18, 2.81145725434552060e-15,
+	-7.64716373181981641e-13, 1.60590438368216133e-10,
+	-2.50521083854417202e-08, 2.75573192239858925e-06,
+	-1.98412698412698413e-04, 8.33333333333333322e-03,
+	-1.66666666666666657e-01, 1.00000000000000000e+00 };
+    VEC	    a, big, u, t, p, phi, phi2;
+    int	    i;
+
+    /* acos(x) from asin(u) with 0 <= u <= 1/2: u = |x| for small |x|, */
+    /* else u = sqrt((1 - |x|)/2) and acos(|x|) = 2 asin(u) */
+
+    a = V_ABS(x);
+    big = V_GT(a, V_SET(0.5));
+    u = V_SEL(big, V_SQRT(V_MUL(V_SUB(V_SET(1.0), a), V_SET(0.5))), a);
+    t = V_SUB(V_MUL(V_MUL(u, u), V_SET(8.0)), V_SET(1.0));
+    p = V_SET(asin_t[ 0 ]);
+    for (i = 1; i < 13; ++i)
+	p = V_ADD(V_MUL(p, t), V_SET(asin_t[ i ]));
+    p = V_MUL(p, u);				/* asin(u) */
+
+    phi = V_SEL(big, V_ADD(p, p), V_SUB(V_SET(M_PI / 2), p));
+    phi = V_SEL(V_LT(x, V_SET(0.0)), V_SUB(V_SET(M_PI), phi), phi);
+    phi = V_MUL(phi, V_SET(1.0/3));		/* 0 <= phi <= pi/3 */
+
+    phi2 = V_MUL(phi, phi);
+    p = V_SET(cos_t[ 0 ]);
+    for (i = 1; i < 11; ++i)
+	p = V_ADD(V_MUL(p, phi2), V_SET(cos_t[ i ]));
+    *c = p;
+    p = V_SET(sin_t[ 0 ]);
+    for (i = 1; i < 10; ++i)
+	p = V_ADD(V_MUL(p, phi2), V_SET(sin_t[ i ]));
+    *s = V_MUL(p, phi);
+}
+
+#else
+
+#define     v_cbrt(x)	    cbrt(x)
+
+static void v_acos3(x, c, s)
+    VEC x, *c, *s;
+{
+    double phi = 1.0/3 * acos(x);
+
+    *c = cos(phi);
+    *s = sin(phi);
+}
+
+#endif
+
+/* x^2 + 2px + q = 0: roots in increasing order, as in SolveQuadric() */
+
+static void v_quadric(p, q, s0, s1, num)
+    VEC p, q, *s0, *s1, *num;
+{
+    VEC	    D, zero, pos, sqrt_D;
+
+    D = V_SUB(V_MUL(p, p), q);
+    zero = V_ISZERO(D);
+    pos = V_ANDNOT(zero, V_GT(D, V_SET(0.0)));
+    sqrt_D = V_SEL(pos, V_SQRT(V_MAX(D, V_SET(0.0))), V_SET(0.0));
+
+    *s0 = V_SEL(V_OR(zero, pos), V_SUB(V_SET(0.0), V_ADD(sqrt_D, p)),
+		V_SET(HUGE_VAL));
+    *s1 = V_SEL(pos, V_SUB(sqrt_D, p), V_SET(HUGE_VAL));
+    *num = V_ADD(V_ONE(zero), V_ADD(V_ONE(pos), V_ONE(pos)));
+}
+
+/* x^3 + Ax^2 + Bx + C = 0: roots in the order SolveCubic() gives */
+
+static void v_cubic(A, B, C, s, num)
+    VEC A, B, C, s[ 3 ], *num;
+{
+    VEC	    sq_A, p, q, cb_p, D, zero, triple, three, sqrt_D, u, v, one;
+    VEC	    t, cs, sn, sub, huge;
+
+    sq_A = V_MUL(A, A);
+    p = V_MUL(V_SET(1.0/3), V_ADD(V_MUL(V_SET(-1.0/3), sq_A), B));
+    q = V_MUL(V_SET(1.0/2), V_ADD(V_SUB(V_MUL(V_MUL(V_SET(2.0/27), A), sq_A),
+				    V_MUL(V_MUL(V_SET(1.0/3), A), B)), C));
+
+    cb_p = V_MUL(V_MUL(p, p), p);
+    D = V_ADD(V_MUL(q, q), cb_p);
+
+    zero = V_ISZERO(D);
+    triple = V_AND(zero, V_ISZERO(q));
+    three = V_ANDNOT(zero, V_LT(D, V_SET(0.0)));
+
+    /* Cardano, with the larger cube root taken and the other got from */
+    /* u v = -p; where D is zero this is the double root's cbrt(-q) */
+
+    sqrt_D = V_SEL(zero, V_SET(0.0), V_SQRT(V_MAX(D, V_SET(0.0))));
+    u = v_cbrt(V_SEL(V_LT(q, V_SET(0.0)), V_SUB(sqrt_D, q),
+					   V_SUB(V_SET(0.0), V_ADD(sqrt_D, q))));
+    v = V_DIV(V_SUB(V_SET(0.0), p), u);
+    one = V_ADD(u, v);
+
+    /* Casus irreducibilis */
+
+    t = V_SEL(three, V_DIV(V_SUB(V_SET(0.0), q),
+			   V_SQRT(V_MAX(V_SUB(V_SET(0.0), cb_p), V_SET(0.0)))),
+		     V_SET(0.0));
+    v_acos3(V_MAX(V_SET(-1.0), V_MIN(V_SET(1.0), t)), &cs, &sn);
+    t = V_MUL(V_SET(2.0), V_SQRT(V_MAX(V_SUB(V_SET(0.0), p), V_SET(0.0))));
+
+    huge = V_SET(HUGE_VAL);
+    s[ 0 ] = V_SEL(zero, V_SEL(triple, V_SET(0.0), V_ADD(u, u)),
+		   V_SEL(three, V_MUL(t, cs), one));
+    s[ 1 ] = V_SEL(zero, V_SEL(triple, huge, V_SUB(V_SET(0.0), u)),
+		   V_SEL(three, V_MUL(t, V_SUB(V_MUL(V_SET(sqrt(0.75)), sn),
+					     V_MUL(V_SET(0.5), cs))), huge));
+    s[ 2 ] = V_SEL(three, V_MUL(t, V_SUB(V_SET(0.0),
+					 V_ADD(V_MUL(V_SET(sqrt(0.75)), sn),
+					       V_MUL(V_SET(0.5), cs)))), huge);
+    *num = V_SEL(zero, V_SEL(triple, V_SET(1.0), V_SET(2.0)),
+		 V_SEL(three, V_SET(3.0), V_SET(1.0)));
+
+    /* resubstitute */
+
+    sub = V_MUL(V_SET(1.0/3), A);
+    s[ 0 ] = V_SUB(s[ 0 ], sub);
+    s[ 1 ] = V_SUB(s[ 1 ], sub);
+    s[ 2 ] = V_SUB(s[ 2 ], sub);
+}
+
+/* x^4 + Ax^3 + Bx^2 + Cx + D = 0: roots as SolveQuartic() finds them */
+
+static void v_quartic(A, B, C, D, s, num)
+    VEC A, B, C, D, s[ 4 ], *num;
+{
+    VEC	    sq_A, p, q, r, zero_r, z, u, v, fail, t[ 3 ], n, n1, n2, huge;
+    VEC	    qneg, sub;
+
+    sq_A = V_MUL(A, A);
+    p = V_ADD(V_MUL(V_SET(-3.0/8), sq_A), B);
+    q = V_ADD(V_SUB(V_MUL(V_MUL(V_SET(1.0/8), sq_A), A),
+		    V_MUL(V_MUL(V_SET(1.0/2), A), B)), C);
+    r = V_ADD(V_SUB(V_ADD(V_MUL(V_MUL(V_SET(-3.0/256), sq_A), sq_A),
+			  V_MUL(V_MUL(V_SET(1.0/16), sq_A), B)),
+		    V_MUL(V_MUL(V_SET(1.0/4), A), C)), D);
+
+    /* one cubic serves both cases: y^3 + py + q = 0 when r is zero, */
+    /* else the resolvent z^3 - p/2 z^2 - rz + rp/2 - q^2/8 = 0 */
+
+    zero_r = V_ISZERO(r);
+    v_cubic(V_SEL(zero_r, V_SET(0.0), V_MUL(V_SET(-1.0/2), p)),
+	    V_SEL(zero_r, p, V_SUB(V_SET(0.0), r)),
+	    V_SEL(zero_r, q, V_SUB(V_MUL(V_MUL(V_SET(1.0/2), r), p),
+				   V_MUL(V_MUL(V_SET(1.0/8), q), q))),
+	    t, &n);
+
+    /* build two quadric equations from the first root */
+
+    z = t[ 0 ];
+    u = V_SUB(V_MUL(z, z), r);
+    v = V_SUB(V_ADD(z, z), p);
+    fail = V_OR(V_ANDNOT(V_ISZERO(u), V_LT(u, V_SET(0.0))),
+		V_ANDNOT(V_ISZERO(v), V_LT(v, V_SET(0.0))));
+    u = V_SEL(V_ISZERO(u), V_SET(0.0), V_SQRT(V_MAX(u, V_SET(0.0))));
+    v = V_SEL(V_ISZERO(v), V_SET(0.0), V_SQRT(V_MAX(v, V_SET(0.0))));
+
+    qneg = V_LT(q, V_SET(0.0));
+    v_quadric(V_MUL(V_SET(0.5), V_SEL(qneg, V_SUB(V_SET(0.0), v), v)),
+	      V_SUB(z, u), &s[ 0 ], &s[ 1 ], &n1);
+    v_quadric(V_MUL(V_SET(0.5), V_SEL(qneg, v, V_SUB(V_SET(0.0), v))),
+	      V_ADD(z, u), &s[ 2 ], &s[ 3 ], &n2);
+
+    huge = V_SET(HUGE_VAL);
+    s[ 0 ] = V_SEL(zero_r, t[ 0 ], V_SEL(fail, huge, s[ 0 ]));
+    s[ 1 ] = V_SEL(zero_r, t[ 1 ], V_SEL(fail, huge, s[ 1 ]));
+    s[ 2 ] = V_SEL(zero_r, t[ 2 ], V_SEL(fail, huge, s[ 2 ]));
+    s[ 3 ] = V_SEL(zero_r, V_SET(0.0), V_SEL(fail, huge, s[ 3 ]));
+    *num = V_SEL(zero_r, V_ADD(n, V_SET(1.0)),
+		 V_SEL(fail, V_SET(0.0), V_ADD(n1, n2)));
+
+    /* resubstitute */
+
+    sub = V_MUL(V_SET(1.0/4), A);
+    s[ 0 ] = V_SUB(s[ 0 ], sub);
+    s[ 1 ] = V_SUB(s[ 1 ], sub);
+    s[ 2 ] = V_SUB(s[ 2 ], sub);
+    s[ 3 ] = V_SUB(s[ 3 ], sub);
+}
+
+/*
+ *  Load LANES coefficients of each of the k arrays starting at equation i,
+ *  repeating the last equation if fewer than LANES remain, and store the
+ *  roots and counts back for those that exist.
+ */
+
+static void v_load(c, k, i, n, v)
+    double *c[];
+    int k, i, n;
+    VEC v[];
+{
+    double buf[ LANES ];
+    int j, l;
+
+    for (j = 0; j < k; ++j)
+	if (i + LANES <= n)
+	    v[ j ] = V_LOAD(c[ j ] + i);
+	else
+	{
+	    for (l = 0; l < LANES; ++l)
+		buf[ l ] = c[ j ][ i + l < n ? i + l : n - 1 ];
+	    v[ j ] = V_LOAD(buf);
+	}
+}
+
+static long v_store(s, k, i, n, v, cnt, num)
+    double *s[];
+    int k, i, n;
+    VEC v[], cnt;
+    int num[];
+{
+    double buf[ LANES ];
+    long total = 0;
+    int j, l;
+
+    for (j = 0; j < k; ++j)
+    {
+	V_STORE(buf, v[ j ]);
+	for (l = 0; l < LANES && i + l < n; ++l)
+	    s[ j ][ i + l ] = buf[ l ];
+    }
+    V_STORE(buf, cnt);
+    for (l = 0; l < LANES && i + l < n; ++l)
+	total += num[ i + l ] = (int) buf[ l ];
+
+    return total;
+}
+
+long SolveQuadrics(n, c, s, num)
+    int n;
+    double *c[ 3 ];
+    double *s[ 2 ];
+    int num[];
+{
+    VEC	    cv[ 3 ], sv[ 2 ], cnt;
+    long    total = 0;
+    int	    i;
+
+    for (i = 0; i < n; i += LANES)
+    {
+	v_load(c, 3, i, n, cv);
+	v_quadric(V_DIV(cv[ 1 ], V_MUL(V_SET(2.0), cv[ 2 ])),
+		  V_DIV(cv[ 0 ], cv[ 2 ]), &sv[ 0 ], &sv[ 1 ], &cnt);
+	total += v_store(s, 2, i, n, sv, cnt, num);
+    }
+    return total;
+}
+
+long SolveCubics(n, c, s, num)
+    int n;
+    double *c[ 4 ];
+    double *s[ 3 ];
+    int num[];
+{
+    VEC	    cv[ 4 ], sv[ 3 ], cnt;
+    long    total = 0;
+    int	    i;
+
+    for (i = 0; i < n; i += LANES)
+    {
+	v_load(c, 4, i, n, cv);
+	v_cubic(V_DIV(cv[ 2 ], cv[ 3 ]), V_DIV(cv[ 1 ], cv[ 3 ]),
+		V_DIV(cv[ 0 ], cv[ 3 ]), sv, &cnt);
+	V_ORDER(sv[ 0 ], sv[ 1 ]);
+	V_ORDER(sv[ 1 ], sv[ 2 ]);
+	V_ORDER(sv[ 0 ], sv[ 1 ]);
+	total += v_store(s, 3, i, n, sv, cnt, num);
+    }
+    return total;
+}
+
+long SolveQuartics(n, c, s, num)
+    int n;
+    double *c[ 5 ];
+    double *s[ 4 ];
+    int num[];
+{
+    VEC	    cv[ 5 ], sv[ 4 ], cnt;
+    long    total = 0;
+    int	    i;
+
+    for (i = 0; i < n; i += LANES)
+    {
+	v_load(c, 5, i, n, cv);
+	v_quartic(V_DIV(cv[ 3 ], cv[ 4 ]), V_DIV(cv[ 2 ], cv[ 4 ]),
+		  V_DIV(cv[ 1 ], cv[ 4 ]), V_DIV(cv[ 0 ], cv[ 4 ]), sv, &cnt);
+	V_ORDER(sv[ 0 ], sv[ 1 ]);
+	V_ORDER(sv[ 2 ], sv[ 3 ]);
+	V_ORDER(sv[ 0 ], sv[ 2 ]);
+	V_ORDER(sv[ 1 ], sv[ 3 ]);
+	V_ORDER(sv[ 1 ], sv[ 2 ]);
+	total += v_store(s, 4, i, n, sv, cnt, num);
+    }
+    return total;
+}
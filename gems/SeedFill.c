@@ -81,3 +81,561 @@ skip:	    for (x++; x<=x2 && pixelread(x, y)!=ov; x++);
 	} while (x<=x2);
     }
 }
+
+/*
+ * spanfill.c : span-based seed fill for large frame buffers
+ *
+ * Same algorithm as fill() above, with three changes for big images:
+ * the segment stack grows on demand instead of silently dropping
+ * segments at MAX, pixels are reached through row pointers rather than
+ * pixelread()/pixelwrite(), and the ends of each run are found a machine
+ * word (sizeof(unsigned long) 8-bit pixels) at a time.  A tiled variant
+ * asks the caller for each tile the first time the fill touches it, so
+ * only the part of a paged or memory-mapped image reached by the fill
+ * is ever brought in.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {		/* contiguous frame buffer */
+    unsigned char *base;	/* address of pixel (0,0) */
+    long stride;		/* bytes from one scan line to the next */
+    int depth;			/* bits per pixel: 8 or 32 */
+} FillImage;
+
+typedef struct {		/* tiled frame buffer */
+    int tw, th;			/* tile width and height in pixels */
+    int depth;			/* bits per pixel: 8 or 32 */
+    unsigned char *(*tileget)(void *cd, int tx, int ty);
+				/* page in tile (tx,ty); returns the address
+				 * of its upper left pixel, rows are
+				 * tw*depth/8 bytes apart */
+    void (*tilerelease)(void *cd, int tx, int ty, unsigned char *t);
+				/* optional: called once per tile touched */
+    void *cd;			/* client data for the two calls above */
+} FillTiles;
+
+typedef struct {int y, xl, xr, dy;} Span;
+
+typedef struct {		/* growable stack of spans */
+    Span *base, *sp, *top;
+} SpanStack;
+
+static int spanpush(SpanStack *s, int y, int xl, int xr, int dy)
+{
+    if (s->sp==s->top) {
+	long n = s->top-s->base, nn = n ? 2*n : 256;
+	Span *b = (Span *)realloc(s->base, nn*sizeof(Span));
+
+	if (!b) return -1;
+	s->base = b; s->sp = b+n; s->top = b+nn;
+    }
+    s->sp->y = y; s->sp->xl = xl; s->sp->xr = xr; s->sp->dy = dy;
+    s->sp++;
+    return 0;
+}
+
+/*
+ * Word-at-a-time scanning of 8-bit pixels.  A word XORed with a word of
+ * repeated ov has a zero byte exactly where a pixel equals ov.
+ */
+
+#define ONES	((unsigned long)-1/0xff)	/* 0x0101...01 */
+#define HIGHS	(ONES<<7)			/* 0x8080...80 */
+#define HASZERO(v)	(((v)-ONES) & ~(v) & HIGHS)
+#define WBYTES	((int)sizeof(unsigned long))
+
+static unsigned long loadword(unsigned char *p)
+{
+    unsigned long w;
+
+    memcpy(&w, p, sizeof w);
+    return w;
+}
+
+/* first x in [x,xr] with p[x]!=ov, else xr+1 */
+static int run8right(unsigned char *p, int x, int xr, unsigned long ovw)
+{
+    unsigned char ov = (unsigned char)ovw;
+
+    for (; x+WBYTES-1<=xr; x+=WBYTES)
+	if (loadword(p+x)!=ovw) break;
+    for (; x<=xr && p[x]==ov; x++);
+    return x;
+}
+
+/* last x in [xl,x] with p[x]!=ov, else xl-1 */
+static int run8left(unsigned char *p, int x, int xl, unsigned long ovw)
+{
+    unsigned char ov = (unsigned char)ovw;
+
+    for (; x-WBYTES+1>=xl; x-=WBYTES)
+	if (loadword(p+x-WBYTES+1)!=ovw) break;
+    for (; x>=xl && p[x]==ov; x--);
+    return x;
+}
+
+/* first x in [x,xr] with p[x]==ov, else xr+1 */
+static int gap8right(unsigned char *p, int x, int xr, unsigned long ovw)
+{
+    unsigned char ov = (unsigned char)ovw;
+
+    for (; x+WBYTES-1<=xr; x+=WBYTES) {
+	unsigned long v = loadword(p+x)^ovw;
+	if (HASZERO(v)) break;
+    }
+    for (; x<=xr && p[x]!=ov; x++);
+    return x;
+}
+
+static int run32right(unsigned char *p, int x, int xr, unsigned long ov)
+{
+    unsigned int *q = (unsigned int *)p;
+
+    for (; x<=xr && q[x]==(unsigned int)ov; x++);
+    return x;
+}
+
+static int run32left(unsigned char *p, int x, int xl, unsigned long ov)
+{
+    unsigned int *q = (unsigned int *)p;
+
+    for (; x>=xl && q[x]==(unsigned int)ov; x--);
+    return x;
+}
+
+static int gap32right(unsigned char *p, int x, int xr, unsigned long ov)
+{
+    unsigned int *q = (unsigned int *)p;
+
+    for (; x<=xr && q[x]!=(unsigned int)ov; x++);
+    return x;
+}
+
+static void set8(unsigned char *p, int xl, int xr, unsigned long nv)
+{
+    memset(p+xl, (int)(nv&0xff), xr-xl+1);
+}
+
+static void set32(unsigned char *p, int xl, int xr, unsigned long nv)
+{
+    unsigned int *q = (unsigned int *)p;
+
+    for (; xl<=xr; xl++) q[xl] = (unsigned int)nv;
+}
+
+typedef struct {		/* pixel access for the span engine */
+    int (*runright)(unsigned char *, int, int, unsigned long);
+    int (*runleft)(unsigned char *, int, int, unsigned long);
+    int (*gapright)(unsigned char *, int, int, unsigned long);
+    void (*set)(unsigned char *, int, int, unsigned long);
+    /* row(): narrows [*xl,*xr] to the piece of row y holding x (one
+     * tile) and returns the address of pixel (*xl,y); p[i] (scaled by
+     * depth) is then pixel *xl+i */
+    unsigned char *(*row)(void *ac, int y, int x, int *xl, int *xr);
+    void *ac;
+    int depth;			/* 8 or 32 */
+    int err;			/* set when row() fails */
+    unsigned long ovw, nvw;	/* old and new pixel, ov repeated per byte */
+} SpanAccess;
+
+/*
+ * The scanners below walk across row() pieces so that the engine can
+ * ignore tile boundaries.
+ */
+
+static int runright(SpanAccess *a, int y, int x, int xr)
+{
+    int l, r, e;
+    unsigned char *p;
+
+    while (x<=xr) {
+	l = x; r = xr;
+	p = (*a->row)(a->ac, y, x, &l, &r);
+	if (!p) {a->err = 1; return x;}
+	e = (*a->runright)(p, x-l, r-l, a->ovw)+l;
+	if (e<=r) return e;
+	x = r+1;
+    }
+    return x;
+}
+
+static int runleft(SpanAccess *a, int y, int x, int xl)
+{
+    int l, r, e;
+    unsigned char *p;
+
+    while (x>=xl) {
+	l = xl; r = x;
+	p = (*a->row)(a->ac, y, x, &l, &r);
+	if (!p) {a->err = 1; return x;}
+	e = (*a->runleft)(p, x-l, 0, a->ovw)+l;
+	if (e>=l) return e;
+	x = l-1;
+    }
+    return x;
+}
+
+static int gapright(SpanAccess *a, int y, int x, int xr)
+{
+    int l, r, e;
+    unsigned char *p;
+
+    while (x<=xr) {
+	l = x; r = xr;
+	p = (*a->row)(a->ac, y, x, &l, &r);
+	if (!p) {a->err = 1; return xr+1;}
+	e = (*a->gapright)(p, x-l, r-l, a->ovw)+l;
+	if (e<=r) return e;
+	x = r+1;
+    }
+    return x;
+}
+
+static void setspan(SpanAccess *a, int y, int xl, int xr)
+{
+    int l, r;
+    unsigned char *p;
+
+    while (xl<=xr) {
+	l = xl; r = xr;
+	p = (*a->row)(a->ac, y, xl, &l, &r);
+	if (!p) {a->err = 1; return;}
+	(*a->set)(p, xl-l, r-l, a->nvw);
+	xl = r+1;
+    }
+}
+
+static int readpixel(SpanAccess *a, int x, int y, unsigned long *pv)
+{
+    int l = x, r = x;
+    unsigned char *p = (*a->row)(a->ac, y, x, &l, &r);
+
+    if (!p) return -1;
+    *pv = a->depth==8 ? p[0] : ((unsigned int *)p)[0];
+    return 0;
+}
+
+#define SPUSH(Y, XL, XR, DY) \
+    if (Y+(DY)>=win->y0 && Y+(DY)<=win->y1 && \
+	spanpush(&st, Y, XL, XR, DY)) goto nomem;
+
+/*
+ * spanengine: fill() over a SpanAccess.
+ * Returns 0 on success, -1 if the stack could not grow or a tile could
+ * not be paged in.
+ */
+
+static int spanengine(SpanAccess *a, int x, int y, Window *win,
+    unsigned long nv)
+{
+    int l, x1, x2, dy, e;
+    unsigned long ov;
+    SpanStack st;
+
+    if (x<win->x0 || x>win->x1 || y<win->y0 || y>win->y1) return 0;
+    if (readpixel(a, x, y, &ov)) return -1;
+    if (a->depth==8) {
+	nv &= 0xff;
+	a->ovw = ov*ONES;
+	a->nvw = nv;
+    }
+    else {
+	nv &= 0xffffffffUL;
+	a->ovw = ov;
+	a->nvw = nv;
+    }
+    if (ov==nv) return 0;
+
+    a->err = 0;
+    st.base = st.sp = st.top = 0;
+    SPUSH(y, x, x, 1);			/* needed in some cases */
+    SPUSH(y+1, x, x, -1);		/* seed segment (popped 1st) */
+
+    while (st.sp>st.base && !a->err) {
+	st.sp--;
+	y = st.sp->y+(dy = st.sp->dy); x1 = st.sp->xl; x2 = st.sp->xr;
+
+	x = runleft(a, y, x1, win->x0);
+	if (x>=x1) goto skip;
+	setspan(a, y, x+1, x1);
+	l = x+1;
+	if (l<x1) SPUSH(y, l, x1-1, -dy);	/* leak on left? */
+	x = x1+1;
+	do {
+	    e = runright(a, y, x, win->x1);
+	    if (e>x) setspan(a, y, x, e-1);
+	    x = e;
+	    SPUSH(y, l, x-1, dy);
+	    if (x>x2+1) SPUSH(y, x2+1, x-1, -dy);	/* leak on right? */
+skip:	    x = gapright(a, y, x+1, x2);
+	    l = x;
+	} while (x<=x2);
+    }
+    free(st.base);
+    return a->err ? -1 : 0;
+
+nomem:
+    free(st.base);
+    return -1;
+}
+
+/* direct access: every row is contiguous, row() never narrows */
+
+static unsigned char *imagerow(void *ac, int y, int x, int *xl, int *xr)
+{
+    FillImage *img = (FillImage *)ac;
+
+    return img->base+y*img->stride+(long)*xl*(img->depth/8);
+}
+
+static void spaninit(SpanAccess *a, int depth)
+{
+    a->depth = depth;
+    if (depth==8) {
+	a->runright = run8right; a->runleft = run8left;
+	a->gapright = gap8right; a->set = set8;
+    }
+    else {
+	a->runright = run32right; a->runleft = run32left;
+	a->gapright = gap32right; a->set = set32;
+    }
+}
+
+/*
+ * spanfill: fill() on a contiguous 8 or 32 bit frame buffer.
+ * Returns 0 on success, -1 if out of memory.
+ */
+
+int spanfill(FillImage *img, int x, int y, Window *win, Pixel nv)
+{
+    SpanAccess a;
+
+    if (img->depth!=8 && img->depth!=32) return -1;
+    spaninit(&a, img->depth);
+    a.row = imagerow;
+    a.ac = (void *)img;
+    return spanengine(&a, x, y, win, (unsigned long)nv);
+}
+
+/*
+ * tiled access: tiles are paged in through tileget() on first touch and
+ * remembered in a table covering the window, so every tile is requested
+ * at most once per fill.
+ */
+
+typedef struct {
+    FillTiles *img;
+    int tx0, ty0, ntx, nty;	/* tiles covering the window */
+    unsigned char **tile;	/* ntx*nty tile addresses, 0 until touched */
+    long bpp;			/* bytes per pixel */
+} TileAccess;
+
+static unsigned char *tilerow(void *ac, int y, int x, int *xl, int *xr)
+{
+    TileAccess *ta = (TileAccess *)ac;
+    FillTiles *img = ta->img;
+    int tx = x/img->tw, ty = y/img->th, txl = tx*img->tw;
+    unsigned char **t = &ta->tile[(ty-ta->ty0)*ta->ntx+(tx-ta->tx0)];
+
+    if (!*t && !(*t = (*img->tileget)(img->cd, tx, ty))) return 0;
+    if (*xl<txl) *xl = txl;
+    if (*xr>txl+img->tw-1) *xr = txl+img->tw-1;
+    return *t+((y-ty*img->th)*(long)img->tw+*xl-txl)*ta->bpp;
+}
+
+/*
+ * spanfilltiled: fill() on a tiled frame buffer, paging in only the tiles
+ * the fill reaches.  The window must lie in the positive quadrant.
+ * Returns 0 on success, -1 if out of memory or a tile could not be read.
+ */
+
+int spanfilltiled(FillTiles *img, int x, int y, Window *win, Pixel nv)
+{
+    SpanAccess a;
+    TileAccess ta;
+    int i, r;
+
+    if ((img->depth!=8 && img->depth!=32) || win->x0<0 || win->y0<0)
+	return -1;
+    ta.img = img;
+    ta.bpp = img->depth/8;
+    ta.tx0 = win->x0/img->tw; ta.ntx = win->x1/img->tw-ta.tx0+1;
+    ta.ty0 = win->y0/img->th; ta.nty = win->y1/img->th-ta.ty0+1;
+    ta.tile = (unsigned char **)calloc((size_t)ta.ntx*ta.nty,
+	sizeof(unsigned char *));
+    if (!ta.tile) return -1;
+
+    spaninit(&a, img->depth);
+    a.row = tilerow;
+    a.ac = (void *)&ta;
+    r = spanengine(&a, x, y, win, (unsigned long)nv);
+
+    if (img->tilerelease)
+	for (i=0; i<ta.ntx*ta.nty; i++)
+	    if (ta.tile[i])
+		(*img->tilerelease)(img->cd, ta.tx0+i%ta.ntx,
+		    ta.ty0+i/ta.ntx, ta.tile[i]);
+    free(ta.tile);
+    return r;
+}
+
+#ifdef TESTPROGRAM
+/*
+ * cc -O2 -DTESTPROGRAM SeedFill.c
+ *
+ * Fills the same image from the same seeds with fill() and with spanfill()
+ * and spanfilltiled() at 8 and 32 bits, and reports any pixel where they
+ * differ.  The right part of the image is walled off from every seed, so
+ * the tiled runs should leave its tiles alone; the number of tiles each
+ * run asked for is printed.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#define W	1000		/* deliberately not a multiple of TW, TH */
+#define H	700
+#define TW	64
+#define TH	48
+#define NTX	((W+TW-1)/TW)
+#define NTY	((H+TH-1)/TH)
+
+static int ref[H][W];		/* image seen by pixelread/pixelwrite */
+
+Pixel pixelread(int x, int y) {return ref[y][x];}
+void pixelwrite(int x, int y, Pixel p) {ref[y][x] = p;}
+
+static int image[H][W];		/* the test image before any fill */
+
+static void makeimage(void)
+{
+    int i, x, y, cx, cy, rr;
+
+    srand(1);
+    memset(image, 0, sizeof image);
+    for (i=0; i<300; i++) {		/* discs of a few values */
+	cx = rand()%W; cy = rand()%H; rr = 2+rand()%20;
+	for (y=cy-rr; y<=cy+rr; y++)
+	    for (x=cx-rr; x<=cx+rr; x++)
+		if (x>=0 && x<W && y>=0 && y<H &&
+		    (x-cx)*(x-cx)+(y-cy)*(y-cy)<=rr*rr)
+		    image[y][x] = 1+i%3;
+    }
+    for (i=0; i<200; i++) {		/* single pixel dots */
+	image[rand()%H][rand()%W] = 1;
+    }
+    for (y=0; y<H; y++)			/* wall off the right part */
+	image[y][W*2/3] = 1;
+}
+
+typedef struct {
+    unsigned char *tile[NTY][NTX];
+    int gets, releases;
+} Tiles;
+
+static unsigned char *tileget(void *cd, int tx, int ty)
+{
+    Tiles *t = (Tiles *)cd;
+
+    t->gets++;
+    return t->tile[ty][tx];
+}
+
+static void tilerelease(void *cd, int tx, int ty, unsigned char *p)
+{
+    ((Tiles *)cd)->releases++;
+}
+
+static unsigned char *tilepixel(Tiles *t, int x, int y, int bpp)
+{
+    return t->tile[y/TH][x/TW]+((y%TH)*TW+x%TW)*bpp;
+}
+
+static unsigned long getpix(unsigned char *p, int bpp)
+{
+    return bpp==1 ? *p : *(unsigned int *)p;
+}
+
+static void setpix(unsigned char *p, int bpp, unsigned long v)
+{
+    if (bpp==1) *p = (unsigned char)v;
+    else *(unsigned int *)p = (unsigned int)v;
+}
+
+int main()
+{
+    static Window wins[2] = {{0, 0, W-1, H-1}, {37, 21, W-50, H-30}};
+    static int seeds[][2] = {{5, 5}, {300, 400}, {600, 100}, {100, 650}};
+    static unsigned char buf[H*W*4];
+    Tiles tiles;
+    FillImage img;
+    FillTiles ft;
+    int w, s, depth, tiled, x, y, i, bad, fails = 0, bpp;
+    int nseed = sizeof seeds/sizeof seeds[0];
+    Pixel nv;
+    unsigned long pv, want;
+
+    makeimage();
+    for (y=0; y<NTY; y++)
+	for (x=0; x<NTX; x++)
+	    tiles.tile[y][x] = (unsigned char *)malloc(TW*TH*4);
+
+    for (w=0; w<2; w++)
+	for (s=0; s<nseed; s++) {
+	    Window *win = &wins[w];
+
+	    memcpy(ref, image, sizeof ref);
+	    nv = 0x7b;				/* fits in 8 bits */
+	    fill(seeds[s][0], seeds[s][1], win, nv);
+
+	    for (depth=8; depth<=32; depth+=24)
+		for (tiled=0; tiled<2; tiled++) {
+		    bpp = depth/8;
+		    for (y=0; y<H; y++)
+			for (x=0; x<W; x++)
+			    setpix(tiled ? tilepixel(&tiles, x, y, bpp) :
+				buf+((long)y*W+x)*bpp, bpp,
+				(unsigned long)image[y][x]);
+		    if (tiled) {
+			tiles.gets = tiles.releases = 0;
+			ft.tw = TW; ft.th = TH; ft.depth = depth;
+			ft.tileget = tileget; ft.tilerelease = tilerelease;
+			ft.cd = (void *)&tiles;
+			i = spanfilltiled(&ft, seeds[s][0], seeds[s][1], win,
+			    nv);
+		    }
+		    else {
+			img.base = buf; img.stride = (long)W*bpp;
+			img.depth = depth;
+			i = spanfill(&img, seeds[s][0], seeds[s][1], win, nv);
+		    }
+		    bad = i!=0;
+		    for (y=0; y<H; y++)
+			for (x=0; x<W; x++) {
+			    pv = getpix(tiled ? tilepixel(&tiles, x, y, bpp) :
+				buf+((long)y*W+x)*bpp, bpp);
+			    want = (unsigned long)ref[y][x];
+			    if (pv!=want) bad++;
+			}
+		    printf("window %d seed (%3d,%3d) %2d bit %s: %d differ",
+			w, seeds[s][0], seeds[s][1], depth,
+			tiled ? "tiled" : "flat ", bad);
+		    if (tiled) {
+			printf(", %d of %d tiles touched", tiles.gets,
+			    NTX*NTY);
+			if (tiles.releases!=tiles.gets) {
+			    printf(", %d released", tiles.releases);
+			    bad++;
+			}
+		    }
+		    printf("\n");
+		    if (bad) fails++;
+		}
+	}
+
+    printf(fails ? "*** %d runs FAILED\n" : "all runs agree\n", fails);
+    return fails!=0;
+}
+#endif
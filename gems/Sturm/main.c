@@ -14,17 +14,184 @@ from "Graphics Gems", Academic Press, 1990
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
+#include <time.h>
 #include "solve.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * seconds of wall clock time, as the threads in the batch run are
+ * not well measured by clock().
+ */
+static double
+seconds(void)
+{
+#ifdef _OPENMP
+	return(omp_get_wtime());
+#else
+	return((double)clock() / CLOCKS_PER_SEC);
+#endif
+}
+
+/*
+ * bench
+ *
+ *	time n random polynomials of the given order, made from their
+ * roots: about half of the roots lie in [-1, 1], the others come in
+ * complex pairs.  Each is solved as the driver below does it, with a
+ * solver reused from one polynomial to the next, for its first root in
+ * (0, 1] only, and in a batch over nthreads threads.
+ */
+static void
+bench(int n, int order, int nthreads)
+{
+	sturm_solver	s;
+	poly	sseq[MAX_ORDER + 1];
+	double	*coef, *min, *max, *roots, r[MAX_ORDER], x, y, t, err;
+	int		*ord, *nroots, i, j, k, m, np, atmin, atmax, bad;
+	long	total;
+
+	coef = (double *)malloc((size_t)n * (MAX_ORDER + 1) * sizeof(double));
+	roots = (double *)malloc((size_t)n * MAX_ORDER * sizeof(double));
+	min = (double *)malloc(n * sizeof(double));
+	max = (double *)malloc(n * sizeof(double));
+	ord = (int *)malloc(n * sizeof(int));
+	nroots = (int *)malloc(n * sizeof(int));
+
+	srand(1);
+	for (i = 0; i < n; i++) {
+		double	*c = &coef[(size_t)i * (MAX_ORDER + 1)];
+
+		memset(c, 0, (MAX_ORDER + 1) * sizeof(double));
+		c[0] = 1.0;
+		for (k = 0; k < order; ) {
+			x = 2.0 * rand() / RAND_MAX - 1.0;
+			if (k + 2 <= order && rand() % 2) {
+				y = 0.1 + 0.9 * rand() / RAND_MAX;
+				for (j = k + 2; j >= 0; j--)
+					c[j] = (j >= 2 ? c[j - 2] : 0.0)
+						- (j >= 1 ? 2.0 * x * c[j - 1] : 0.0)
+						+ (x * x + y * y) * c[j];
+				k += 2;
+			} else {
+				for (j = k + 1; j > 0; j--)
+					c[j] = c[j - 1] - x * c[j];
+				c[0] *= -x;
+				k++;
+			}
+		}
+		ord[i] = order;
+		min[i] = -2.0;
+		max[i] = 2.0;
+	}
+
+	printf("%d polynomials of order %d\n", n, order);
+
+	/*
+	 * as the driver does it
+	 */
+	total = 0;
+	t = seconds();
+	for (i = 0; i < n; i++) {
+		for (j = 0; j <= order; j++)
+			sseq[0].coef[j] = coef[(size_t)i * (MAX_ORDER + 1) + j];
+		np = (int)buildsturm(order, sseq);
+		numroots(np, sseq, &atmin, &atmax);
+		atmin = numchanges(np, sseq, min[i]);
+		atmax = numchanges(np, sseq, max[i]);
+		if (atmin > atmax) {
+			sbisect(np, sseq, min[i], max[i], atmin, atmax, r);
+			total += atmin - atmax;
+		}
+	}
+	t = seconds() - t;
+	printf("  buildsturm and sbisect %10.0f roots/sec  (%ld roots)\n",
+		total / t, total);
+
+	/*
+	 * one solver for all of them, checking the roots
+	 */
+	total = 0;
+	bad = 0;
+	err = 0.0;
+	t = seconds();
+	for (i = 0; i < n; i++) {
+		double	*c = &coef[(size_t)i * (MAX_ORDER + 1)];
+
+		sturm_set(&s, order, c);
+		m = sturm_roots(&s, min[i], max[i], r);
+		total += m;
+		for (j = 0; j < m; j++) {
+			x = fabs(evalpoly(order, c, r[j]));
+			if (x > err)
+				err = x;
+			if (j > 0 && r[j] < r[j - 1])
+				bad++;
+		}
+	}
+	t = seconds() - t;
+	printf("  sturm_roots            %10.0f roots/sec  (%ld roots,"
+		" max |p(root)| %.3g, %d out of order)\n", total / t, total, err, bad);
+
+	/*
+	 * the first root in (0, 1], as for a ray
+	 */
+	total = 0;
+	t = seconds();
+	for (i = 0; i < n; i++) {
+		sturm_set(&s, order, &coef[(size_t)i * (MAX_ORDER + 1)]);
+		total += sturm_first_root(&s, 0.0, 1.0, r);
+	}
+	t = seconds() - t;
+	printf("  sturm_first_root       %10.0f roots/sec  (%ld roots,"
+		" %.0f polynomials/sec)\n", total / t, total, n / t);
+
+	/*
+	 * in a batch
+	 */
+	t = seconds();
+	total = sturm_batch(n, ord, coef, min, max, 0, roots, nroots, nthreads);
+	t = seconds() - t;
+	printf("  sturm_batch            %10.0f roots/sec  (%ld roots,"
+		" %d threads)\n", total / t, total,
+#ifdef _OPENMP
+		nthreads > 0 ? nthreads : omp_get_max_threads());
+#else
+		1);
+#endif
+
+	free(coef);
+	free(roots);
+	free(min);
+	free(max);
+	free(ord);
+	free(nroots);
+}
+
 /*
- * a driver program for a root solver.
+ * a driver program for a root solver.  Run as "solve -b [n [order
+ * [threads]]]" it times the solvers instead.
  */
-int main()
+int main(int argc, char** argv)
 {
-	poly	sseq[MAX_ORDER];
+	poly	sseq[MAX_ORDER + 1];
 	double 	min, max, roots[MAX_ORDER];
 	int		i, j, np, order, nroots, nchanges, atmin, atmax;
 
+	if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+		order = argc > 3 ? atoi(argv[3]) : 8;
+		if (order < 1 || order > MAX_ORDER) {
+			fprintf(stderr, "solve: order must be 1 to %d\n", MAX_ORDER);
+			exit(1);
+		}
+		bench(argc > 2 ? atoi(argv[2]) : 100000, order,
+			argc > 4 ? atoi(argv[4]) : 0);
+		exit(0);
+	}
+
 	/*
 	 * get the details...
 	 */
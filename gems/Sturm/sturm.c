@@ -6,7 +6,11 @@
  */
 #include <math.h>
 #include <stdio.h>
-#include "solve.h"
+#include "sturm.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 /*
  * modp
@@ -280,3 +284,208 @@ void sbisect(int np, poly* sseq, double min, double max, int atmin, int atmax, d
 			roots[n1 - atmax] = mid;
 	}
 }
+
+/*
+ * sturm_set
+ *
+ *	build the Sturm sequence for the polynomial of order ord with
+ * coefficients coef[0..ord] in the solver s, returning the number of
+ * distinct real roots.  The sequence is kept in s for any number of
+ * later calls to sturm_count, sturm_roots and sturm_first_root.
+ */
+int sturm_set(sturm_solver* s, int ord, const double* coef)
+{
+	int		i;
+
+	while (ord > 0 && fabs(coef[ord]) < SMALL_ENOUGH)
+		ord--;
+
+	for (i = 0; i <= ord; i++)
+		s->sseq[0].coef[i] = coef[i];
+	s->sseq[0].ord = ord;
+
+	if (ord == 0) {
+		s->np = 0;
+		s->atneg = s->atpos = 0;
+		return(0);
+	}
+
+	s->np = (int)buildsturm(ord, s->sseq);
+
+	return(numroots(s->np, s->sseq, &s->atneg, &s->atpos));
+}
+
+/*
+ * changes
+ *
+ *	the number of sign changes at a, allowing a to be infinite.
+ */
+static int
+changes(const sturm_solver* s, double a)
+{
+	if (a == -HUGE_VAL)
+		return(s->atneg);
+	if (a == HUGE_VAL)
+		return(s->atpos);
+	return(numchanges(s->np, (poly *)s->sseq, a));
+}
+
+/*
+ * bracket
+ *
+ *	replace infinite ends of [*min, *max] by finite ones with the same
+ * number of sign changes, searching out by powers of 10 as the driver
+ * program does.  The changes at the ends are returned in *atmin and
+ * *atmax.
+ */
+static void
+bracket(const sturm_solver* s, double* min, double* max, int* atmin, int* atmax)
+{
+	double	x;
+	int		i, n;
+
+	*atmin = changes(s, *min);
+	*atmax = changes(s, *max);
+
+	if (*min == -HUGE_VAL) {
+		x = -1.0;
+		n = changes(s, x);
+		for (i = 0; n != *atmin && i != MAXPOW; i++) {
+			x *= 10.0;
+			n = changes(s, x);
+		}
+		*min = x;
+		*atmin = n;
+	}
+
+	if (*max == HUGE_VAL) {
+		x = 1.0;
+		n = changes(s, x);
+		for (i = 0; n != *atmax && i != MAXPOW; i++) {
+			x *= 10.0;
+			n = changes(s, x);
+		}
+		*max = x;
+		*atmax = n;
+	}
+}
+
+/*
+ * sturm_count
+ *
+ *	return the number of distinct real roots in (min, max].  Either
+ * end may be infinite.
+ */
+int sturm_count(const sturm_solver* s, double min, double max)
+{
+	if (s->np == 0 || min >= max)
+		return(0);
+
+	return(changes(s, min) - changes(s, max));
+}
+
+/*
+ * sturm_roots
+ *
+ *	find the distinct real roots in (min, max], returning them in
+ * increasing order in roots and their number as the function value.
+ * Either end may be infinite.
+ */
+int sturm_roots(const sturm_solver* s, double min, double max, double* roots)
+{
+	int		atmin, atmax;
+
+	if (s->np == 0 || min >= max)
+		return(0);
+
+	bracket(s, &min, &max, &atmin, &atmax);
+	if (atmin <= atmax)
+		return(0);
+
+	sbisect(s->np, (poly *)s->sseq, min, max, atmin, atmax, roots);
+
+	return(atmin - atmax);
+}
+
+/*
+ * sturm_first_root
+ *
+ *	find the smallest real root in (min, max], as a ray tracer wants
+ * for the interval [tmin, tmax] along a ray.  Only the half of the
+ * interval holding that root is bisected at each step, so the other
+ * roots are never isolated.  Returns 1 and sets *root if there is a
+ * root, 0 otherwise.
+ */
+int sturm_first_root(const sturm_solver* s, double min, double max, double* root)
+{
+	double	mid;
+	int		its, atmin, atmax, atmid;
+
+	if (s->np == 0 || min >= max)
+		return(0);
+
+	bracket(s, &min, &max, &atmin, &atmax);
+	if (atmin <= atmax)
+		return(0);
+
+	for (its = 0; atmin - atmax > 1 && its < MAXIT; its++) {
+		mid = (min + max) / 2;
+		atmid = changes(s, mid);
+
+		if (atmin - atmid > 0) {
+			max = mid;
+			atmax = atmid;
+		} else {
+			min = mid;
+			atmin = atmid;
+		}
+	}
+
+	if (atmin - atmax > 1) {
+		fprintf(stderr, "sturm_first_root: roots too close together\n");
+		*root = (min + max) / 2;
+		return(1);
+	}
+
+	sbisect(s->np, (poly *)s->sseq, min, max, atmin, atmax, root);
+
+	return(1);
+}
+
+/*
+ * sturm_batch
+ *
+ *	solve n polynomials, polynomial i having order ord[i] and
+ * coefficients coef[i * (MAX_ORDER + 1) + 0..ord[i]], over (min[i], max[i]].
+ * With first nonzero only the smallest root in each interval is found,
+ * otherwise all of them.  The roots of polynomial i go in increasing
+ * order to roots[i * MAX_ORDER ...], and their number to nroots[i].
+ * The polynomials are shared out among nthreads threads (0 for the
+ * OpenMP default), each with a solver of its own.  Returns the total
+ * number of roots found.
+ */
+long sturm_batch(int n, const int* ord, const double* coef,
+			const double* min, const double* max, int first,
+			double* roots, int* nroots, int nthreads)
+{
+	sturm_solver	s;
+	long	total = 0;
+	int		i;
+
+#ifdef _OPENMP
+#pragma omp parallel for private(s) reduction(+:total) schedule(dynamic, 16) \
+	num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+	for (i = 0; i < n; i++) {
+		sturm_set(&s, ord[i], &coef[(size_t)i * (MAX_ORDER + 1)]);
+		if (first)
+			nroots[i] = sturm_first_root(&s, min[i], max[i],
+						&roots[(size_t)i * MAX_ORDER]);
+		else
+			nroots[i] = sturm_roots(&s, min[i], max[i],
+						&roots[(size_t)i * MAX_ORDER]);
+		total += nroots[i];
+	}
+
+	return(total);
+}
@@ -3,3 +3,22 @@
 #include "solve.h"
 
 void sbisect(int np, poly* sseq, double min, double max, int atmin, int atmax, double* roots);
+
+/*
+ * a solver holding the Sturm sequence of one polynomial, so that it can
+ * be queried over several intervals, and reused for the next polynomial
+ * without building anything but the sequence again.
+ */
+typedef struct {
+	poly	sseq[MAX_ORDER + 1];	/* the Sturm sequence */
+	int		np;						/* index of its last polynomial */
+	int		atneg, atpos;			/* sign changes at -/+ infinity */
+} sturm_solver;
+
+int sturm_set(sturm_solver* s, int ord, const double* coef);
+int sturm_count(const sturm_solver* s, double min, double max);
+int sturm_roots(const sturm_solver* s, double min, double max, double* roots);
+int sturm_first_root(const sturm_solver* s, double min, double max, double* root);
+long sturm_batch(int n, const int* ord, const double* coef,
+			const double* min, const double* max, int first,
+			double* roots, int* nroots, int nthreads);
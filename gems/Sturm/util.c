@@ -85,6 +85,15 @@ modrf(ord, coef, a, b, val)
 		for (fp = ecoef - 1; fp >= scoef; fp--)
 				fx = x * fx + *fp;
 
+		/*
+		 * stop if the bracket has closed up, as it can when f is
+		 * too small near the root for the tests below
+		 */
+		if (fx == 0.0 || fabs(b - a) <= RELERROR * fabs(x)) {
+				*val = x;
+				return(1);
+		}
+
 		if (fabs(x) > RELERROR) {
 				if (fabs(fx / x) < RELERROR) {
 					*val = x;
@@ -4,17 +4,32 @@
  *  color.c - routines for color calculations.
  *
  *     10/10/85
+ *
+ *  Scanlines are encoded into memory and written with one fwrite,
+ *  whole scanlines are converted between COLOR and COLR with SSE2
+ *  when it is there, and fwritescans() encodes groups of scanlines
+ *  on several threads.
  */
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include  "color.h"
 
-#define  MINELEN	8	/* minimum scanline length for encoding */
 #define  MINRUN		4	/* minimum run length */
 
+#define  SCANGROUP	16	/* scanlines encoded together by a thread */
+#define  GROUPSPERTHR	4	/* groups per thread in each batch */
+
 
 char *
 tempbuffer(len)			/* get a temporary buffer */
@@ -34,19 +49,22 @@ unsigned int len;
 }
 
 
-int fwritecolrs(COLR* scanline, int len, FILE* fp)		/* write out a colr scanline */
+int encodecolrs(COLR* scanline, int len, BYTE* buf)	/* encode a colr scanline */
 {
-	register int  i, j, beg, cnt;
+	register BYTE  *bp = buf;
+	register int  i, j, beg, cnt = 0;
 	int  c2;
 	
-	if (len < MINELEN)		/* too small to encode */
-		return (int)(fwrite((char *)scanline,sizeof(COLR),len,fp) - len);
+	if (len < MINELEN) {		/* too small to encode */
+		memcpy(buf, (char *)scanline, len*sizeof(COLR));
+		return(len*sizeof(COLR));
+	}
 	if (len > 32767)		/* too big! */
 		return(-1);
-	putc(2, fp);			/* put magic header */
-	putc(2, fp);
-	putc(len>>8, fp);
-	putc(len&255, fp);
+	*bp++ = 2;			/* put magic header */
+	*bp++ = 2;
+	*bp++ = len>>8;
+	*bp++ = len&255;
 					/* put components separately */
 	for (i = 0; i < 4; i++) {
 	    for (j = 0; j < len; j += cnt) {	/* find next run */
@@ -61,25 +79,56 @@ int fwritecolrs(COLR* scanline, int len, FILE* fp)		/* write out a colr scanline
 		    c2 = j+1;
 		    while (scanline[c2++][i] == scanline[j][i])
 			if (c2 == beg) {	/* short run */
-			    putc(128+beg-j, fp);
-			    putc(scanline[j][i], fp);
+			    *bp++ = 128+beg-j;
+			    *bp++ = scanline[j][i];
 			    j = beg;
 			    break;
 			}
 		}
 		while (j < beg) {		/* write out non-run */
 		    if ((c2 = beg-j) > 128) c2 = 128;
-		    putc(c2, fp);
+		    *bp++ = c2;
 		    while (c2--)
-			putc(scanline[j++][i], fp);
+			*bp++ = scanline[j++][i];
 		}
 		if (cnt >= MINRUN) {		/* write out run */
-		    putc(128+cnt, fp);
-		    putc(scanline[beg][i], fp);
+		    *bp++ = 128+cnt;
+		    *bp++ = scanline[beg][i];
 		} else
 		    cnt = 0;
 	    }
 	}
+	return(bp - buf);
+}
+
+
+static BYTE *
+encodebuffer(len)		/* get the buffer fwritecolrs() encodes into */
+long len;
+{
+	static BYTE  *encbuf = NULL;
+	static long  encbuflen = 0;
+
+	if (len > encbuflen) {
+		free(encbuf);
+		encbuf = (BYTE *)malloc(len);
+		encbuflen = encbuf==NULL ? 0 : len;
+	}
+	return(encbuf);
+}
+
+
+int fwritecolrs(COLR* scanline, int len, FILE* fp)		/* write out a colr scanline */
+{
+	BYTE  *buf;
+	int  n;
+				/* not tempbuffer(), scanline may be in it */
+	if ((buf = encodebuffer(MAXCOLRBYTES(len))) == NULL)
+		return(-1);
+	if ((n = encodecolrs(scanline, len, buf)) < 0)
+		return(-1);
+	if (fwrite((char *)buf, 1, n, fp) != (size_t)n)
+		return(-1);
 	return(ferror(fp) ? -1 : 0);
 }
 
@@ -184,25 +233,206 @@ double  r, g, b;
 }
 
 
+void colors_colrs(COLOR* scan, COLR* clrscan, int len)	/* convert a scanline to colrs */
+{
+	float  lim = 1e-32;
+	register int  i = 0;
+
+	if (lim > 1e-32)		/* same test as setcolr */
+		lim = nextafterf(lim, 0.f);
+#ifdef __SSE2__
+	{
+	__m128  a, b, c, t0, t1, r, g, bl, d, zero, scale;
+	__m128i  e, w;
+	__m128i  m255 = _mm_set1_epi32(255);
+
+	for ( ; i+4 <= len; i += 4) {
+		a = _mm_loadu_ps(scan[i]);	/* r0 g0 b0 r1 */
+		b = _mm_loadu_ps(scan[i]+4);	/* g1 b1 r2 g2 */
+		c = _mm_loadu_ps(scan[i]+8);	/* b2 r3 g3 b3 */
+		t0 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1,1,2,2));
+		r = _mm_shuffle_ps(a, t0, _MM_SHUFFLE(2,0,3,0));
+		t0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0,0,1,1));
+		t1 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(2,2,3,3));
+		g = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2,0,2,0));
+		t0 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1,1,2,2));
+		t1 = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3,3,0,0));
+		bl = _mm_shuffle_ps(t0, t1, _MM_SHUFFLE(2,0,2,0));
+					/* 2^(8-e) from the exponent of max */
+		d = _mm_max_ps(r, _mm_max_ps(g, bl));
+		zero = _mm_cmple_ps(d, _mm_set1_ps(lim));
+		e = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(d), 23), m255);
+		scale = _mm_castsi128_ps(_mm_slli_epi32(
+				_mm_sub_epi32(_mm_set1_epi32(261), e), 23));
+		w = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(r, scale)), m255);
+		w = _mm_or_si128(w, _mm_slli_epi32(_mm_and_si128(
+			_mm_cvttps_epi32(_mm_mul_ps(g, scale)), m255), 8));
+		w = _mm_or_si128(w, _mm_slli_epi32(_mm_and_si128(
+			_mm_cvttps_epi32(_mm_mul_ps(bl, scale)), m255), 16));
+		w = _mm_or_si128(w, _mm_slli_epi32(
+			_mm_add_epi32(e, _mm_set1_epi32(COLXS-126)), 24));
+		w = _mm_andnot_si128(_mm_castps_si128(zero), w);
+		_mm_storeu_si128((__m128i *)clrscan[i], w);
+	}
+	}
+#endif
+	for ( ; i < len; i++)
+		setcolr(clrscan[i], scan[i][RED], scan[i][GRN], scan[i][BLU]);
+}
+
+
+void colrs_colors(COLR* clrscan, COLOR* scan, int len)	/* convert colrs to a scanline */
+{
+	register int  i = 0;
+
+#ifdef __SSE2__
+	{
+	__m128  r, g, b, f, t0, t1;
+	__m128i  w, e, zero;
+	__m128i  m255 = _mm_set1_epi32(255), bias = _mm_set1_epi32(59);
+	__m128  half = _mm_set1_ps(.5f);
+
+	for ( ; i+4 <= len; i += 4) {
+		w = _mm_loadu_si128((__m128i *)clrscan[i]);
+		e = _mm_srli_epi32(w, 24);
+		zero = _mm_cmpeq_epi32(e, _mm_setzero_si128());
+					/* 2^(e-136) as two factors, both normal */
+		f = _mm_mul_ps(
+			_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(
+				_mm_srli_epi32(e, 1), bias), 23)),
+			_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(
+				_mm_srli_epi32(_mm_add_epi32(e,
+					_mm_set1_epi32(1)), 1), bias), 23)));
+		f = _mm_andnot_ps(_mm_castsi128_ps(zero), f);
+		r = _mm_add_ps(_mm_cvtepi32_ps(_mm_and_si128(w, m255)), half);
+		g = _mm_add_ps(_mm_cvtepi32_ps(_mm_and_si128(
+				_mm_srli_epi32(w, 8), m255)), half);
+		b = _mm_add_ps(_mm_cvtepi32_ps(_mm_and_si128(
+				_mm_srli_epi32(w, 16), m255)), half);
+		r = _mm_mul_ps(r, f);
+		g = _mm_mul_ps(g, f);
+		b = _mm_mul_ps(b, f);
+					/* back to r g b r g b ... */
+		t0 = _mm_shuffle_ps(b, r, _MM_SHUFFLE(1,1,0,0));
+		_mm_storeu_ps(scan[i], _mm_shuffle_ps(_mm_unpacklo_ps(r, g),
+				t0, _MM_SHUFFLE(2,0,1,0)));
+		t0 = _mm_shuffle_ps(g, b, _MM_SHUFFLE(1,1,1,1));
+		t1 = _mm_shuffle_ps(r, g, _MM_SHUFFLE(2,2,2,2));
+		_mm_storeu_ps(scan[i]+4, _mm_shuffle_ps(t0, t1,
+				_MM_SHUFFLE(2,0,2,0)));
+		t0 = _mm_shuffle_ps(b, r, _MM_SHUFFLE(3,3,2,2));
+		t1 = _mm_shuffle_ps(g, b, _MM_SHUFFLE(3,3,3,3));
+		_mm_storeu_ps(scan[i]+8, _mm_shuffle_ps(t0, t1,
+				_MM_SHUFFLE(2,0,2,0)));
+	}
+	}
+#endif
+	for ( ; i < len; i++)
+		colr_color(scan[i], clrscan[i]);
+}
+
+
 size_t fwritescan(COLOR* scanline, int len, FILE* fp)		/* write out a scanline */
 {
 	COLR  *clrscan;
+	BYTE  *buf;
 	int  n;
-	register COLR  *sp;
-					/* get scanline buffer */
-	if ((sp = (COLR *)tempbuffer(len*sizeof(COLR))) == NULL)
+					/* get scanline buffers */
+	if ((clrscan = (COLR *)tempbuffer(len*sizeof(COLR) +
+			MAXCOLRBYTES(len))) == NULL)
 		return(-1);
-	clrscan = sp;
+	buf = (BYTE *)(clrscan + len);
 					/* convert scanline */
-	n = len;
-	while (n-- > 0) {
-		setcolr(sp[0], scanline[0][RED],
-				  scanline[0][GRN],
-				  scanline[0][BLU]);
-		scanline++;
-		sp++;
+	colors_colrs(scanline, clrscan, len);
+	if ((n = encodecolrs(clrscan, len, buf)) < 0 ||
+			fwrite((char *)buf, 1, n, fp) != (size_t)n)
+		return(-1);
+	return(ferror(fp) ? -1 : 0);
+}
+
+
+/*
+ * Write yres scanlines of xres pixels, in file order, from fpic
+ * (converted) or cpic.  The scanlines are encoded in groups of
+ * SCANGROUP on nthreads threads (all there are if 0), a batch of
+ * groups at a time, and the batch written out in order.
+ */
+static int writescans(COLOR* fpic, COLR* cpic, int xres, int yres,
+		FILE* fp, int nthreads)
+{
+	long  gsize = (long)SCANGROUP*MAXCOLRBYTES(xres);
+	int  ngroups, batch, first, n, g;
+	int  *nbytes;
+	BYTE  *buf;
+	COLR  *clrs = NULL;
+	int  err = 0;
+
+#ifdef _OPENMP
+	if (nthreads <= 0)
+		nthreads = omp_get_max_threads();
+#else
+	nthreads = 1;
+#endif
+	ngroups = (yres + SCANGROUP-1)/SCANGROUP;
+	if ((batch = nthreads*GROUPSPERTHR) > ngroups)
+		batch = ngroups;
+	if (batch <= 0)
+		return(0);
+	buf = (BYTE *)malloc(batch*gsize);
+	nbytes = (int *)malloc(batch*sizeof(int));
+	if (fpic != NULL)
+		clrs = (COLR *)malloc((long)batch*xres*sizeof(COLR));
+	if (buf == NULL || nbytes == NULL || (fpic != NULL && clrs == NULL))
+		err = 1;
+
+	for (first = 0; first < ngroups && !err; first += batch) {
+		n = ngroups - first < batch ? ngroups - first : batch;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+#endif
+		for (g = 0; g < n; g++) {
+			BYTE  *bp = buf + g*gsize;
+			COLR  *cs;
+			int  y, y1, k;
+
+			nbytes[g] = 0;
+			y = (first+g)*SCANGROUP;
+			y1 = y+SCANGROUP < yres ? y+SCANGROUP : yres;
+			for ( ; y < y1; y++) {
+				if (fpic != NULL) {
+					cs = clrs + (long)g*xres;
+					colors_colrs(fpic + (long)y*xres, cs, xres);
+				} else
+					cs = cpic + (long)y*xres;
+				if ((k = encodecolrs(cs, xres, bp)) < 0) {
+					nbytes[g] = -1;
+					break;
+				}
+				bp += k;
+				nbytes[g] += k;
+			}
+		}
+		for (g = 0; g < n && !err; g++)
+			if (nbytes[g] < 0 || fwrite((char *)(buf + g*gsize), 1,
+					nbytes[g], fp) != (size_t)nbytes[g])
+				err = 1;
 	}
-	return(fwritecolrs(clrscan, len, fp));
+	free(clrs);
+	free(nbytes);
+	free(buf);
+	return(err || ferror(fp) ? -1 : 0);
+}
+
+
+int fwritescans(COLOR* pic, int xres, int yres, FILE* fp, int nthreads)	/* write a picture */
+{
+	return(writescans(pic, NULL, xres, yres, fp, nthreads));
+}
+
+
+int fwritecolrscans(COLR* pic, int xres, int yres, FILE* fp, int nthreads)	/* write a colr picture */
+{
+	return(writescans(NULL, pic, xres, yres, fp, nthreads));
 }
 
 
@@ -214,9 +444,9 @@ void colr_color(COLOR col, COLR clr)		/* convert short to float color */
 		col[RED] = col[GRN] = col[BLU] = 0.0;
 	else {
 		f = ldexp(1.0, (int)clr[EXP]-(COLXS+8));
-		col[RED] = (BYTE)((clr[RED] + 0.5)*f);
-		col[GRN] = (BYTE)((clr[GRN] + 0.5)*f);
-		col[BLU] = (BYTE)((clr[BLU] + 0.5)*f);
+		col[RED] = (clr[RED] + 0.5)*f;
+		col[GRN] = (clr[GRN] + 0.5)*f;
+		col[BLU] = (clr[BLU] + 0.5)*f;
 	}
 }
 
@@ -230,17 +460,7 @@ int freadscan(COLOR* scanline, int len, FILE* fp)		/* read in a scanline */
 	if (freadcolrs(clrscan, len, fp) < 0)
 		return -1 ;
 					/* convert scanline */
-	colr_color(scanline[0], clrscan[0]);
-	while (--len > 0) {
-		scanline++; clrscan++;
-		if (clrscan[0][RED] == clrscan[-1][RED] &&
-			    clrscan[0][GRN] == clrscan[-1][GRN] &&
-			    clrscan[0][BLU] == clrscan[-1][BLU] &&
-			    clrscan[0][EXP] == clrscan[-1][EXP])
-			copycolor(scanline[0], scanline[-1]);
-		else
-			colr_color(scanline[0], clrscan[0]);
-	}
+	colrs_colors(clrscan, scanline, len);
 	return 0;
 }
 
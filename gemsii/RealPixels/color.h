@@ -98,5 +98,19 @@ typedef float  COLOR[3];	/* red, green, blue */
 
 /* if needed: extern double  ldexp(), atof(); */
 
+#define  MINELEN		8	/* minimum scanline length for encoding */
+
+				/* most bytes encodecolrs() puts out */
+#define  MAXCOLRBYTES(len)	(8*(long)(len)+4)
+
+int encodecolrs(COLR* scanline, int len, BYTE* buf);
 int freadcolrs(COLR* scanline, int len, FILE* fp);
 int fwritecolrs(COLR* scanline, int len, FILE* fp);
+void setcolr(COLR clr, double r, double g, double b);
+void colr_color(COLOR col, COLR clr);
+void colors_colrs(COLOR* scan, COLR* clrscan, int len);
+void colrs_colors(COLR* clrscan, COLOR* scan, int len);
+size_t fwritescan(COLOR* scanline, int len, FILE* fp);
+int freadscan(COLOR* scanline, int len, FILE* fp);
+int fwritescans(COLOR* pic, int xres, int yres, FILE* fp, int nthreads);
+int fwritecolrscans(COLR* pic, int xres, int yres, FILE* fp, int nthreads);
@@ -0,0 +1,250 @@
+/*
+ *  rgbe_time.c - time conversion, writing and reading of pictures.
+ *
+ *  A size x size picture (sky, sun, shading and noise over a wide
+ *  range of values, with some flat areas) is converted to colrs and
+ *  back one pixel at a time and one scanline at a time, written
+ *  with fwritescan and with fwritescans, and read back with
+ *  freadscan and through a SCANMAP.  The results of each pair are
+ *  checked against each other, and rgbe_time exits with status 1 if
+ *  any pair differs.  Rates are MB/s of COLOR data.
+ *
+ *  usage: rgbe_time [-s size] [-r repeats] [-t threads] [picture]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "header.h"
+#include "resolu.h"
+#include "scanmap.h"
+
+
+static double
+seconds()
+{
+#ifdef _OPENMP
+	return(omp_get_wtime());
+#else
+	return((double)clock()/CLOCKS_PER_SEC);
+#endif
+}
+
+
+static void
+makepicture(COLOR* pic, int size)		/* fill in a test picture */
+{
+	double  x, y, d, v;
+	int  i, j;
+
+	srand(1);
+	for (j = 0; j < size; j++)
+		for (i = 0; i < size; i++) {
+			x = (double)i/size;
+			y = (double)j/size;
+			if (y > .9) {			/* flat ground */
+				setcolor(pic[j*size+i], .1, .08, .05);
+				continue;
+			}
+			d = (x-.7)*(x-.7) + (y-.2)*(y-.2);
+			v = exp(-200.*d) * 1e4;		/* sun */
+			v += .5 + 2.*sin(9.*x)*sin(7.*y)*sin(7.*y);
+			v *= 1. + .05*((double)rand()/RAND_MAX - .5);
+			setcolor(pic[j*size+i], v*(.6+.4*y), v*(.7+.2*y), v);
+		}
+}
+
+
+static void
+report(char* name, double t, double mb)
+{
+	printf("  %-30s %8.1f MB/s\n", name, mb/t);
+}
+
+
+static FILE *
+newpicture(char* fname, int size)		/* open and write a header */
+{
+	FILE  *fp;
+
+	if ((fp = fopen(fname, "wb")) == NULL) {
+		perror(fname);
+		exit(1);
+	}
+	fputformat(COLRFMT, fp);
+	putc('\n', fp);
+	fputresolu(YMAJOR|YDECR, size, size, fp);
+	return(fp);
+}
+
+
+static int
+samefile(char* f1, char* f2)			/* compare two files */
+{
+	FILE  *fp1, *fp2;
+	int  c;
+
+	if ((fp1 = fopen(f1, "rb")) == NULL || (fp2 = fopen(f2, "rb")) == NULL)
+		return(0);
+	while ((c = getc(fp1)) == getc(fp2))
+		if (c == EOF)
+			break;
+	fclose(fp1);
+	fclose(fp2);
+	return(c == EOF);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	char  *fname = "rgbe_time.pic", fname2[512];
+	int  size = 2048, repeats = 4, nthreads = 0;
+	COLOR  *pic, *back;
+	COLR  *clrs, *clrs2;
+	SCANMAP  sm;
+	FILE  *fp;
+	double  t, mb;
+	long  n, i, bad;
+	int  j, k, all, failures = 0;
+
+	for (j = 1; j < argc; j++)
+		if (!strcmp(argv[j], "-s") && j+1 < argc)
+			size = atoi(argv[++j]);
+		else if (!strcmp(argv[j], "-r") && j+1 < argc)
+			repeats = atoi(argv[++j]);
+		else if (!strcmp(argv[j], "-t") && j+1 < argc)
+			nthreads = atoi(argv[++j]);
+		else
+			fname = argv[j];
+	sprintf(fname2, "%.500s.2", fname);
+#ifdef _OPENMP
+	all = nthreads > 0 ? nthreads : omp_get_max_threads();
+#else
+	all = 1;
+#endif
+
+	n = (long)size*size;
+	mb = (double)n*sizeof(COLOR)*repeats/1e6;
+	pic = (COLOR *)malloc(n*sizeof(COLOR));
+	back = (COLOR *)malloc(n*sizeof(COLOR));
+	clrs = (COLR *)malloc(n*sizeof(COLR));
+	clrs2 = (COLR *)malloc(n*sizeof(COLR));
+	if (pic == NULL || back == NULL || clrs == NULL || clrs2 == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	makepicture(pic, size);
+	printf("%dx%d picture\n", size, size);
+
+					/* conversions */
+	t = seconds();
+	for (k = 0; k < repeats; k++)
+		for (i = 0; i < n; i++)
+			setcolr(clrs[i], pic[i][RED], pic[i][GRN], pic[i][BLU]);
+	report("setcolr", seconds() - t, mb);
+	t = seconds();
+	for (k = 0; k < repeats; k++)
+		colors_colrs(pic, clrs2, n);
+	report("colors_colrs", seconds() - t, mb);
+	for (i = bad = 0; i < n; i++)
+		bad += memcmp(clrs[i], clrs2[i], sizeof(COLR)) != 0;
+	if (bad) {
+		printf("  %ld colrs differ\n", bad);
+		failures++;
+	}
+
+	t = seconds();
+	for (k = 0; k < repeats; k++)
+		for (i = 0; i < n; i++)
+			colr_color(back[i], clrs[i]);
+	report("colr_color", seconds() - t, mb);
+	t = seconds();
+	for (k = 0; k < repeats; k++)
+		colrs_colors(clrs, pic, n);
+	report("colrs_colors", seconds() - t, mb);
+	if (memcmp(back, pic, n*sizeof(COLOR))) {
+		printf("  colors differ\n");
+		failures++;
+	}
+
+					/* writing */
+	t = seconds();
+	for (k = 0; k < repeats; k++) {
+		fp = newpicture(fname, size);
+		for (j = 0; j < size; j++)
+			if (fwritescan(pic + (long)j*size, size, fp) != 0) {
+				fprintf(stderr, "%s: write error\n", fname);
+				exit(1);
+			}
+		fclose(fp);
+	}
+	report("fwritescan", seconds() - t, mb);
+	t = seconds();
+	for (k = 0; k < repeats; k++) {
+		fp = newpicture(fname2, size);
+		if (fwritescans(pic, size, size, fp, nthreads) < 0) {
+			fprintf(stderr, "%s: write error\n", fname2);
+			exit(1);
+		}
+		fclose(fp);
+	}
+	printf("  %-30s %8.1f MB/s  (%d threads)\n", "fwritescans",
+			mb/(seconds() - t), all);
+	if (!samefile(fname, fname2)) {
+		printf("  files differ\n");
+		failures++;
+	}
+
+					/* reading */
+	t = seconds();
+	for (k = 0; k < repeats; k++) {
+		if ((fp = fopen(fname, "rb")) == NULL ||
+				checkheader(fp, COLRFMT, NULL) < 0 ||
+				fgetresolu(&j, &j, fp) < 0) {
+			fprintf(stderr, "%s: bad picture\n", fname);
+			exit(1);
+		}
+		for (j = 0; j < size; j++)
+			if (freadscan(back + (long)j*size, size, fp) < 0) {
+				fprintf(stderr, "%s: read error\n", fname);
+				exit(1);
+			}
+		fclose(fp);
+	}
+	report("freadscan", seconds() - t, mb);
+	memset(pic, 0, n*sizeof(COLOR));
+	t = seconds();
+	for (k = 0; k < repeats; k++) {
+		if (openscanmap(&sm, fname) < 0) {
+			fprintf(stderr, "%s: bad picture\n", fname);
+			exit(1);
+		}
+		for (j = 0; j < size; j++)
+			if (readscanmapcolors(&sm, pic + (long)j*size) < 0) {
+				fprintf(stderr, "%s: read error\n", fname);
+				exit(1);
+			}
+		closescanmap(&sm);
+	}
+	report("readscanmapcolors", seconds() - t, mb);
+	if (memcmp(back, pic, n*sizeof(COLOR))) {
+		printf("  scanlines differ\n");
+		failures++;
+	}
+
+	remove(fname);
+	remove(fname2);
+	free(clrs2);
+	free(clrs);
+	free(back);
+	free(pic);
+	return(failures ? 1 : 0);
+}
@@ -0,0 +1,203 @@
+/*
+ *  scanmap.c - read the scanlines of a picture file in memory.
+ *
+ *  The file is mapped (or read whole where there is no mmap) and
+ *  scanlines are decoded straight from it, without going through
+ *  stdio.  Flat scanlines, with no runs in them, are handed back
+ *  where they lie in the file; encoded ones are decoded into a
+ *  scanline buffer.
+ *
+ *  openscanmap(sm,fname)	open a picture, reading its header
+ *  readscanmap(sm)		pointer to the next colr scanline
+ *  readscanmapcolors(sm,scan)	next scanline converted to colors
+ *  closescanmap(sm)		unmap and free
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#define  USE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include "header.h"
+#include "resolu.h"
+#include "scanmap.h"
+
+
+static int
+oldcolrs(COLR* scanline, int len, BYTE** pp, BYTE* end)	/* decode an old colr scanline */
+{
+	register BYTE  *p = *pp;
+	register int  i, j = 0;
+	int  rshift = 0;
+
+	while (j < len) {
+		if (end - p < 4)
+			return(-1);
+		if (p[RED] == 1 && p[GRN] == 1 && p[BLU] == 1) {
+			if (j == 0)
+				return(-1);
+			for (i = p[EXP] << rshift; i > 0; i--, j++) {
+				if (j >= len)
+					return(-1);
+				copycolr(scanline[j], scanline[j-1]);
+			}
+			rshift += 8;
+		} else {
+			copycolr(scanline[j], p);
+			j++;
+			rshift = 0;
+		}
+		p += 4;
+	}
+	*pp = p;
+	return(0);
+}
+
+
+static int
+decodecolrs(COLR* scanline, int len, BYTE** pp, BYTE* end)	/* decode a colr scanline */
+{
+	register BYTE  *p = *pp;
+	register int  i, j, code;
+
+	if (len < MINELEN || end - p < 4 ||
+			p[0] != 2 || p[1] != 2 || p[2] & 128)
+		return(oldcolrs(scanline, len, pp, end));
+	if ((p[2]<<8 | p[3]) != len)
+		return(-1);		/* length mismatch! */
+	p += 4;
+					/* decode each component */
+	for (i = 0; i < 4; i++)
+	    for (j = 0; j < len; ) {
+		if (p >= end)
+		    return(-1);
+		if ((code = *p++) > 128) {	/* run */
+		    code &= 127;
+		    if (p >= end || j+code > len)
+			return(-1);
+		    while (code--)
+			scanline[j++][i] = *p;
+		    p++;
+		} else {			/* non-run */
+		    if (end - p < code || j+code > len)
+			return(-1);
+		    while (code--)
+			scanline[j++][i] = *p++;
+		}
+	    }
+	*pp = p;
+	return(0);
+}
+
+
+static int
+isflat(BYTE* p, int len, BYTE* end)		/* is scanline at p stored as is? */
+{
+	register int  j;
+
+	if (end - p < 4L*len)
+		return(0);
+	if (len >= MINELEN && p[0] == 2 && p[1] == 2 && !(p[2] & 128))
+		return(0);
+	for (j = 0; j < len; j++, p += 4)
+		if (p[RED] == 1 && p[GRN] == 1 && p[BLU] == 1)
+			return(0);
+	return(1);
+}
+
+
+int
+openscanmap(SCANMAP* sm, char* fname)		/* open a picture file */
+{
+	FILE  *fp;
+	long  start;
+
+	memset((char *)sm, 0, sizeof(SCANMAP));
+	if ((fp = fopen(fname, "rb")) == NULL)
+		return(-1);
+	if (checkheader(fp, COLRFMT, NULL) < 0 ||
+			(sm->ord = fgetresolu(&sm->xres, &sm->yres, fp)) < 0)
+		goto fail;
+	start = ftell(fp);
+	if (fseek(fp, 0L, SEEK_END) < 0 || (sm->size = ftell(fp)) < start)
+		goto fail;
+#ifdef USE_MMAP
+	sm->data = (BYTE *)mmap(NULL, sm->size, PROT_READ, MAP_PRIVATE,
+			fileno(fp), 0);
+	if (sm->data == (BYTE *)MAP_FAILED)
+		sm->data = NULL;
+	else {
+		sm->mapped = 1;
+#ifdef MADV_SEQUENTIAL
+		madvise((void *)sm->data, sm->size, MADV_SEQUENTIAL);
+#endif
+	}
+#endif
+	if (sm->data == NULL) {		/* read it in */
+		if ((sm->data = (BYTE *)malloc(sm->size)) == NULL ||
+				fseek(fp, 0L, SEEK_SET) < 0 ||
+				fread((char *)sm->data, 1, sm->size, fp)
+					!= (size_t)sm->size)
+			goto fail;
+	}
+	if ((sm->line = (COLR *)malloc(sm->xres*sizeof(COLR))) == NULL)
+		goto fail;
+	sm->pos = sm->data + start;
+	sm->end = sm->data + sm->size;
+	fclose(fp);
+	return(0);
+fail:
+	fclose(fp);
+	closescanmap(sm);
+	return(-1);
+}
+
+
+COLR *
+readscanmap(SCANMAP* sm)		/* get the next colr scanline */
+{
+	COLR  *scan;
+
+	if (sm->y >= sm->yres)
+		return(NULL);
+	if (isflat(sm->pos, sm->xres, sm->end)) {
+		scan = (COLR *)sm->pos;
+		sm->pos += 4L*sm->xres;
+	} else if (decodecolrs(sm->line, sm->xres, &sm->pos, sm->end) < 0)
+		return(NULL);
+	else
+		scan = sm->line;
+	sm->y++;
+	return(scan);
+}
+
+
+int
+readscanmapcolors(SCANMAP* sm, COLOR* scan)	/* get the next scanline */
+{
+	COLR  *clrscan;
+
+	if ((clrscan = readscanmap(sm)) == NULL)
+		return(-1);
+	colrs_colors(clrscan, scan, sm->xres);
+	return(0);
+}
+
+
+void
+closescanmap(SCANMAP* sm)		/* done with a picture */
+{
+#ifdef USE_MMAP
+	if (sm->mapped)
+		munmap((void *)sm->data, sm->size);
+	else
+#endif
+		free(sm->data);
+	free(sm->line);
+	sm->data = NULL;
+	sm->line = NULL;
+}
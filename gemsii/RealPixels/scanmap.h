@@ -0,0 +1,19 @@
+#pragma once
+
+#include "color.h"
+
+typedef struct {
+	BYTE	*data;		/* the picture file */
+	long	size;		/* its length */
+	int	mapped;		/* data is mapped, else read in */
+	BYTE	*pos, *end;	/* next scanline, end of data */
+	int	xres, yres;	/* resolution */
+	int	ord;		/* scanline order */
+	int	y;		/* scanlines read so far */
+	COLR	*line;		/* scanline decoded from pos */
+} SCANMAP;
+
+int openscanmap(SCANMAP* sm, char* fname);
+COLR *readscanmap(SCANMAP* sm);
+int readscanmapcolors(SCANMAP* sm, COLOR* scan);
+void closescanmap(SCANMAP* sm);
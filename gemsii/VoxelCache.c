@@ -12,6 +12,7 @@
  */
 
 #include <stddef.h>
+#include <stdlib.h>
 
 typedef struct { int transparency_value; } TRIANGLE_REC;
 typedef struct { int i; } RAY_REC;
@@ -22,7 +23,39 @@ typedef struct _stree {
     struct _stree  *refraction_ray;
     struct _stree  *reflection_ray;
 } SHADOW_TREE;
-typedef struct { SHADOW_TREE* cache_tree; } LIGHT_REC;
+typedef struct {
+    SHADOW_TREE* cache_tree;
+    int index;              /* which light this is, 0 .. nlights-1 */
+} LIGHT_REC;
+
+/*
+ * Everything check_shadowing() keeps for one thread: for every light, a
+ * cache for every node of the vision ray tree down to max_depth, so that
+ * threads tracing at the same time never share a cache entry.  The nodes
+ * of each light's tree are stored in an array, heap fashion: the node for
+ * a ray spawning at level l along path has index 2^l - 1 + (the low l bits
+ * of path), which is also what the refraction_ray/reflection_ray pointers
+ * lead to.  Each thread allocates its own with new_shadow_cache().
+ */
+
+#define CACHE_OBJECT 0x01   /* retry the last object that shadowed */
+#define CACHE_VOXEL  0x02   /* then the rest of the voxel it was in */
+
+typedef struct {
+    long lookups;           /* shadow rays checked */
+    long object_hits;       /* ... blocked by the cached object */
+    long voxel_hits;        /* ... blocked by another object in its voxel */
+    long traversals;        /* ... that had to traverse the voxels */
+    long lit;               /* ... of which no shadowing was found */
+} SHADOW_STATS;
+
+typedef struct {
+    int nlights;
+    int max_depth;          /* deepest Spawning_ray_level cached */
+    int policy;             /* CACHE_OBJECT, CACHE_OBJECT|CACHE_VOXEL, or 0 */
+    SHADOW_TREE *nodes;     /* nlights trees of 2^(max_depth+1) - 1 nodes */
+    SHADOW_STATS stats;
+} SHADOW_CACHE;
 
 int intersect_object(RAY_REC* ray, TRIANGLE_REC* last_object, TRIANGLE_REC** object) {
 	// User defined
@@ -32,34 +65,87 @@ int intersect_objects_in_voxel_for_shadows(RAY_REC* ray, TRIANGLE_REC**last_voxe
 	// User defined
 	return 0;
 }
-int traverse_voxels_for_shadows(RAY_REC* ray, TRIANGLE_REC** object, TRIANGLE_REC** voxel, float* shadow_percent) {
+int traverse_voxels_for_shadows(RAY_REC* ray, TRIANGLE_REC** object, TRIANGLE_REC*** voxel, float* shadow_percent) {
 	// User defined
 	return 0;
 }
 
-float check_shadowing(ray, light, path, Spawning_ray_level)
-RAY_REC   *ray;   /* ray from shading point to light source */
-LIGHT_REC *light; /* the light source we are interested in */
-int        path;  /* bit table describing current position in vision ray tree */
-int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
+SHADOW_CACHE *new_shadow_cache(nlights, max_depth, policy)
+int nlights, max_depth, policy;
 {
-    unsigned int  Mask;
-    SHADOW_TREE *cache;
-    int i, hit ;
-    float shadow_percent;
-    /* user needs to define cache, object, voxel structures */
-	TRIANGLE_REC* object;
-	TRIANGLE_REC* voxel;
+    SHADOW_CACHE *cache;
+    SHADOW_TREE *tree;
+    int i, l, k, size;
 
-    cache = light->cache_tree;
-    Mask = 0x01;
-    /* If the spawning ray's level is 0 (primary ray), then we */
-    /* use the head of the cache_tree. */
-    for (i = 0; i < Spawning_ray_level; ++i) {
-        if (Mask & path) cache = cache->refraction_ray;
-        else             cache = cache->reflection_ray;
-        Mask = Mask << 1; /* Shift mask left 1 bit */
+    cache = (SHADOW_CACHE *) malloc(sizeof(SHADOW_CACHE));
+    size = (2 << max_depth) - 1;
+    cache->nlights   = nlights;
+    cache->max_depth = max_depth;
+    cache->policy    = policy;
+    cache->nodes = (SHADOW_TREE *) malloc(nlights * size * sizeof(SHADOW_TREE));
+    for (l = 0; l < nlights; ++l) {
+        tree = cache->nodes + l * size;
+        for (i = 0; i < size; ++i) {
+            tree[i].last_object = NULL;
+            tree[i].last_voxel  = NULL;
+            tree[i].reflection_ray = tree[i].refraction_ray = NULL;
+            /* node i is at level k with 2^k - 1 <= i < 2^(k+1) - 1 */
+            for (k = 0; (2 << k) - 1 <= i; ++k)
+                ;
+            if (k < max_depth) {
+                /* bit k of path picks the child below level k */
+                tree[i].reflection_ray = tree + (i + (1 << k));
+                tree[i].refraction_ray = tree + (i + (2 << k));
+            }
+        }
     }
+    cache->stats.lookups = cache->stats.object_hits = 0;
+    cache->stats.voxel_hits = cache->stats.traversals = cache->stats.lit = 0;
+    return cache;
+}
+
+void free_shadow_cache(cache)
+SHADOW_CACHE *cache;
+{
+    free(cache->nodes);
+    free(cache);
+}
+
+/* Add up the statistics of n threads' caches into total. */
+void sum_shadow_stats(caches, n, total)
+SHADOW_CACHE **caches;
+int n;
+SHADOW_STATS *total;
+{
+    int i;
+
+    total->lookups = total->object_hits = total->voxel_hits = 0;
+    total->traversals = total->lit = 0;
+    for (i = 0; i < n; ++i) {
+        total->lookups     += caches[i]->stats.lookups;
+        total->object_hits += caches[i]->stats.object_hits;
+        total->voxel_hits  += caches[i]->stats.voxel_hits;
+        total->traversals  += caches[i]->stats.traversals;
+        total->lit         += caches[i]->stats.lit;
+    }
+}
+
+/*
+ * The cache lookup proper, for the cache node belonging to this light and
+ * this position in the vision ray tree.  stats may be NULL.
+ */
+static float shadow_from_node(cache, ray, policy, stats)
+SHADOW_TREE  *cache;
+RAY_REC      *ray;
+int           policy;
+SHADOW_STATS *stats;
+{
+    int hit;
+    float shadow_percent;
+    TRIANGLE_REC* object;
+    TRIANGLE_REC** voxel;
+
+    if (stats) stats->lookups++;
 
     if (cache->last_object != NULL) {
         /* intersect_object() marks object as having been */
@@ -67,6 +153,7 @@ int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
         hit = intersect_object( ray, cache->last_object, &object);
 
         if (hit) {
+            if (stats) stats->object_hits++;
             return(1.0); /* full shadowing */
         }
         cache->last_object = NULL; /* object was not hit */
@@ -78,6 +165,7 @@ int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
             /* It ignores transparent objects altogether. */
             hit = intersect_objects_in_voxel_for_shadows( ray, cache->last_voxel, &object);
             if (hit) {
+                if (stats) stats->voxel_hits++;
                 cache->last_object = object;
                 return(1.0);
             }
@@ -91,14 +179,16 @@ int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
     /* intersections must be transparent, and the object returned is the    */
     /* transparent one. Tracing of the shadow ray halts once the light      */
     /* source has been reached. */
+    if (stats) stats->traversals++;
     hit = traverse_voxels_for_shadows(ray, &object, &voxel, &shadow_percent);
 
     if (!hit) {
+        if (stats) stats->lit++;
         cache->last_object = NULL;
         cache->last_voxel  = NULL;
         return(0.0); /* No shadowing was found. */
     }
-    if (object->transparency_value > 0.0) {
+    if (object->transparency_value > 0.0 || !(policy & CACHE_OBJECT)) {
         /* the object is transparent */
         cache->last_object = NULL;
         cache->last_voxel  = NULL;
@@ -106,11 +196,62 @@ int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
     else {
         /* The object was NOT transparent, cache the info. */
         cache->last_object = object;
-        cache->last_voxel  = &voxel;
+        cache->last_voxel  = (policy & CACHE_VOXEL) ? voxel : NULL;
     }
     return shadow_percent;
 }
 
+float check_shadowing(ray, light, path, Spawning_ray_level)
+RAY_REC   *ray;   /* ray from shading point to light source */
+LIGHT_REC *light; /* the light source we are interested in */
+int        path;  /* bit table describing current position in vision ray tree */
+int        Spawning_ray_level; /* level of the ray spawning this shadow ray */
+{
+    unsigned int  Mask;
+    SHADOW_TREE *cache;
+    int i;
+
+    cache = light->cache_tree;
+    Mask = 0x01;
+    /* If the spawning ray's level is 0 (primary ray), then we */
+    /* use the head of the cache_tree. */
+    for (i = 0; i < Spawning_ray_level; ++i) {
+        if (Mask & path) cache = cache->refraction_ray;
+        else             cache = cache->reflection_ray;
+        Mask = Mask << 1; /* Shift mask left 1 bit */
+    }
+
+    return shadow_from_node(cache, ray, CACHE_OBJECT | CACHE_VOXEL, NULL);
+}
+
+/*
+ * check_shadowing() for one thread of many: the same, with the cache taken
+ * from this thread's SHADOW_CACHE rather than from the light, so no two
+ * threads touch the same entry and no locking is needed.  Each thread
+ * still sees the coherence of its own rays, which is where the hits come
+ * from when neighbouring pixels go to the same thread.  Rays spawned
+ * deeper than the cache's max_depth are traced without it.
+ */
+float check_shadowing_cached(cache, ray, light, path, Spawning_ray_level)
+SHADOW_CACHE *cache;
+RAY_REC   *ray;
+LIGHT_REC *light;
+int        path;
+int        Spawning_ray_level;
+{
+    SHADOW_TREE uncached;
+    int node;
+
+    if (Spawning_ray_level > cache->max_depth || cache->policy == 0) {
+        uncached.last_object = NULL;
+        uncached.last_voxel  = NULL;
+        return shadow_from_node(&uncached, ray, 0, &cache->stats);
+    }
+    node = (1 << Spawning_ray_level) - 1 + (path & ((1 << Spawning_ray_level) - 1));
+    return shadow_from_node(cache->nodes + light->index * ((2 << cache->max_depth) - 1) + node,
+                            ray, cache->policy, &cache->stats);
+}
+
 /*
 - Andrew Pearce, Alias, someplace in Toronto - pearce@alias.com
 */
@@ -0,0 +1,38 @@
+/* 
+ * dither.h - Declarations for RGB color dithering (see dither.c).
+ */
+
+#ifndef DITHER_H
+#define DITHER_H
+
+void	dithermap( int levels, double gamma, int rgbmap[][3],
+		   int divN[256], int modN[256], int magic[16][16] );
+void	bwdithermap( int levels, double gamma, int bwmap[],
+		     int divN[256], int modN[256], int magic[16][16] );
+int	dithergb( int x, int y, int r, int g, int b, int levels,
+		  int divN[256], int modN[256], int magic[16][16] );
+int	ditherbw( int x, int y, int val,
+		  int divN[256], int modN[256], int magic[16][16] );
+
+/* Tables for dithering whole scan lines; see dither_image_init. */
+typedef struct {
+    int width;			/* pixels per scan line */
+    int levels;			/* intensity levels per primary */
+    unsigned char base[3][256];	/* divN[v] * 1, levels, levels^2 */
+    unsigned char mod[256];	/* modN[v] */
+    unsigned char *magicrows;	/* magic[x%16][y%16], 16 rows of pitch bytes */
+    int pitch;			/* width rounded up to a whole chunk */
+} dither_image;
+
+int	dither_image_init( dither_image *di, int width, int levels,
+			   int divN[256], int modN[256], int magic[16][16] );
+void	dither_image_free( dither_image *di );
+void	dither_row_rgb( dither_image *di, int y, const unsigned char *rgb,
+			unsigned char *out );
+void	dither_row_bw( dither_image *di, int y, const unsigned char *val,
+		       unsigned char *out );
+void	dither_frame_rgb( dither_image *di, int height,
+			  const unsigned char *rgb, long rgbstride,
+			  unsigned char *out, long outstride, int nthreads );
+
+#endif /* DITHER_H */
@@ -7,7 +7,12 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 typedef long	       Boolean;
 
@@ -40,6 +45,12 @@ typedef long	       Boolean;
  * rendering purposes should be straight forward and will have no effect on
  * the collision detection computations.
  *
+ * For the hill climbing support functions the edges of the convex hull of
+ * the vertex set are kept as adjacency lists: the neighbours of vertex i
+ * are nbr[nbr_first[i]] ... nbr[nbr_first[i+1]-1].  Vertices inside the
+ * hull have no neighbours.  If the vertex set is flat nbr is NULL, and
+ * the support functions fall back to scanning all vertices.
+ *
  **************************************************************************/
 
 typedef struct polyhedron {
@@ -47,6 +58,11 @@ typedef struct polyhedron {
    int	    m;			 /* number of 3-D vertices.  */
    double   trn[3];		 /* translational position in world coords. */
    double   itrn[3];		 /* inverse of translational position. */
+   int	    nbr_first[MAX_VERTS+1]; /* start of each vertex's neighbours. */
+   int	    *nbr;		 /* neighbours along hull edges, or NULL. */
+   int	    hull_vert;		 /* some vertex of the hull. */
+   double   lo[3];		 /* bounding box in local coords. */
+   double   hi[3];
 } *Polyhedron;
 
 /**************************************************************************
@@ -57,6 +73,8 @@ typedef struct polyhedron {
  * is a cached prospective proper separating plane, two points for
  * constructing the proper separating plane, and possibly a cached set
  * of points from each polyhedron for speeding up the distance algorithm.
+ * The hill climbing functions also keep the last support vertex found in
+ * each polyhedron, and start the next climb from there.
  *
  **************************************************************************/
 
@@ -68,6 +86,7 @@ typedef struct couple {
    double      pln_pnt2[3];	/* 2nd point used to form separating plane. */
    int	       vert_indx[4][2]; /* cached points for distance algorithm. */
    int	       n;		/* number of cached points, if any. */
+   int	       supp[2];		/* last support vertex in P1 and in P2. */
 } *Couple;
 
 
@@ -590,7 +609,7 @@ int		    m1, m2, near_indx[][2], *m3;
    Boolean	    pass;
    int		    set_size, I[4], i, j, i_tab[4], j_tab[4], P1_i, P2_i, k;
    double	    Hs(), Pk[4][3], Pk_subset[4][3], Vk[3], neg_Vk[3], Cp[3],
-		    Gp;
+		    Gp, last_vv;
 
    if ((*m3) == 0) {	     /** if *m3 == 0 use single point initialization **/
       set_size = 1;
@@ -606,7 +625,7 @@ int		    m1, m2, near_indx[][2], *m3;
       set_size = *m3;
    }
 
-   pass = FALSE;
+   pass = FALSE;   last_vv = HUGE_VAL;
    while (!pass) {
 
       /** compute Vk **/
@@ -631,9 +650,13 @@ int		    m1, m2, near_indx[][2], *m3;
 	 j_tab[i] = j_tab[j];	  /** j is value from member of some Is **/
       }
 
-      if (EQZ(Gp))		  /** Do we have a solution **/
+      /** Do we have a solution, or has rounding stopped Vk from **/
+      /** getting any shorter					 **/
+
+      if (EQZ(Gp) || DOT3(Vk, Vk) >= last_vv)
 	 pass = TRUE;
       else {
+	 last_vv = DOT3(Vk, Vk);
 	 for (i = 0; i < set_size; i++) {
 	    j = I[i];
 	    CPVECTOR3(Pk_subset[i], Pk[j]);  /** extract affine subset of Pk **/
@@ -795,6 +818,578 @@ Couple		  couple;
 }
 
 
+/****************************************************************************
+ *
+ *   Function to evaluate the support function at A for a polyhedron by
+ *   hill climbing along the edges of its hull.  On a convex polytope a
+ *   vertex none of whose neighbours does better is a maximum, so when the
+ *   start is close to the answer, as it is when the polyhedra move a
+ *   little between tests, only a few vertices are looked at instead of
+ *   all of them.
+ *
+ *   On Entry:
+ *	polyhedron - polyhedron in local coordinates.
+ *	A	   - vector at which the support function will be evaluated.
+ *	P_i	   - pointer to the index of the vertex to start from.
+ *
+ *   On Exit:
+ *	P_i - index of a contact point of the polyhedron w.r.t. A.
+ *
+ *   Function Return :
+ *	the result of the evaluation of eq. (6) at A.
+ *
+ ****************************************************************************/
+
+double Hp_climb(polyhedron, A, P_i)
+Polyhedron	polyhedron;
+double		A[];
+int		*P_i;
+{
+   int		i, j, k, best;
+   double	max_val, val, Cp[3];
+
+   if (polyhedron->nbr == NULL)
+      return Hp(polyhedron->verts, polyhedron->m, A, Cp, P_i);
+
+   i = *P_i;
+   max_val = DOT3(polyhedron->verts[i], A);
+
+   for (;;) {
+      best = i;
+      for (k = polyhedron->nbr_first[i]; k < polyhedron->nbr_first[i+1]; k++) {
+	 j = polyhedron->nbr[k];
+	 val = DOT3(polyhedron->verts[j], A);
+	 if (val > max_val) {
+	    best = j;
+	    max_val = val;
+	 }
+      }
+      if (best == i)
+	 break;
+      i = best;
+   }
+   *P_i = i;
+
+   return max_val;
+}
+
+
+/****************************************************************************
+ *
+ *   Function to evaluate the support and contact functions at A for the
+ *   set difference of two polyhedra, by hill climbing.  The vertices are
+ *   left in local coordinates; t is the translation of P1 relative to P2.
+ *
+ *   On Entry:
+ *	couple - couple structure, whose supp gives the starting vertices.
+ *	t      - trn of P1 minus trn of P2.
+ *	A      - vector at which to evaluate support and contact functions.
+ *	Cs     - an empty array of size 3.
+ *
+ *   On Exit:
+ *	Cs     - solution to equation 9.
+ *	couple - supp holds the indices into P1 and P2 for the solution.
+ *
+ *   Function Return :
+ *	the result of the evaluation of eq. (8) for P1 and P2 at A.
+ *
+ ****************************************************************************/
+
+double Hs_climb(couple, t, A, Cs)
+Couple		couple;
+double		t[], A[], Cs[];
+{
+   double	neg_A[3], Hp_1, Hp_2;
+
+   Hp_1 = Hp_climb(couple->polyhdrn1, A, &couple->supp[0]);
+
+   CPVECTOR3(neg_A, A);
+   VECNEGATE3(neg_A);
+   Hp_2 = Hp_climb(couple->polyhdrn2, neg_A, &couple->supp[1]);
+
+   VECSUB3(Cs, couple->polyhdrn1->verts[couple->supp[0]],
+	       couple->polyhdrn2->verts[couple->supp[1]]);
+   VECADD3(Cs, Cs, t);
+
+   return (Hp_1 + Hp_2 + DOT3(t, A));
+}
+
+
+/****************************************************************************
+ *
+ *   Function to compute the minimum distance between the two polyhedra of
+ *   a couple.	This is dist3d with the support functions replaced by
+ *   Hs_climb, and with the simplex taken from and returned to the couple,
+ *   so that each call starts from where the last one for the pair ended.
+ *   The vertices are never copied into world coordinates.
+ *
+ *   On Entry:
+ *	couple - couple structure; vert_indx and n are used to initialize
+ *		 the iteration, as near_indx and m3 are in dist3d.
+ *	VP     - an empty array of size 3.
+ *	lambda - an empty array of size 4.
+ *
+ *   On Exit:
+ *	VP     - vector difference of the two near points in P1 and P2.
+ *	couple - vert_indx and n updated as near_indx and m3 in dist3d.
+ *	lambda - the lambda as in eqs. (11) & (12).
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+void dist3d_climb(couple, VP, lambda)
+Couple		    couple;
+double		    VP[], lambda[];
+{
+   Boolean	    pass;
+   int		    set_size, I[4], i, j, i_tab[4], j_tab[4], k;
+   double	    (*P1)[3], (*P2)[3], t[3], Pk[4][3], Pk_subset[4][3],
+		    Vk[3], neg_Vk[3], Cp[3], Gp, last_vv;
+
+   P1 = couple->polyhdrn1->verts;   P2 = couple->polyhdrn2->verts;
+   VECSUB3(t, couple->polyhdrn1->trn, couple->polyhdrn2->trn);
+
+   if (couple->n == 0) {     /** start from the last support points **/
+      set_size = 1;
+      i = i_tab[0] = couple->supp[0];
+      j = j_tab[0] = couple->supp[1];
+      VECSUB3(Pk[0], P1[i], P2[j]);
+      VECADD3(Pk[0], Pk[0], t);
+   }
+   else {
+      for (k = 0; k < couple->n; k++) {
+	 i = i_tab[k] = couple->vert_indx[k][0];
+	 j = j_tab[k] = couple->vert_indx[k][1];
+	 VECSUB3(Pk[k], P1[i], P2[j]);
+	 VECADD3(Pk[k], Pk[k], t);
+      }
+      set_size = couple->n;
+   }
+
+   pass = FALSE;   last_vv = HUGE_VAL;
+   while (!pass) {
+
+      /** compute Vk **/
+
+      if (set_size == 1) {
+	 CPVECTOR3(Vk, Pk[0]);
+	 I[0] = 0;
+      }
+      else
+	 set_size = sub_dist(Pk, set_size, Vk, I, lambda);
+
+      /** eq. (13) **/
+
+      CPVECTOR3(neg_Vk, Vk);	  VECNEGATE3(neg_Vk);
+      Gp = DOT3(Vk, Vk) + Hs_climb(couple, t, neg_Vk, Cp);
+
+      for (i = 0; i < set_size; i++) {
+	 j = I[i];
+	 i_tab[i] = i_tab[j];
+	 j_tab[i] = j_tab[j];
+      }
+
+      if (EQZ(Gp) || DOT3(Vk, Vk) >= last_vv)
+	 pass = TRUE;
+      else {
+	 last_vv = DOT3(Vk, Vk);
+	 for (i = 0; i < set_size; i++) {
+	    j = I[i];
+	    CPVECTOR3(Pk_subset[i], Pk[j]);
+	 }
+	 for (i = 0; i < set_size; i++)
+	    CPVECTOR3(Pk[i], Pk_subset[i]);
+
+	 CPVECTOR3(Pk[i], Cp);
+	 i_tab[i] = couple->supp[0];  j_tab[i] = couple->supp[1];
+	 set_size++;
+      }
+   }
+
+   if (set_size == 1)
+      lambda[0] = 1.0;
+   CPVECTOR3(VP, Vk);
+   couple->n = set_size;
+   for(i = 0; i < set_size; i++) {
+      couple->vert_indx[i][0] = i_tab[i];
+      couple->vert_indx[i][1] = j_tab[i];
+   }
+}
+
+/****************************************************************************
+ *
+ *   Function to compute a proper separating plane between a pair of
+ *   polytopes using dist3d_climb.  See get_new_plane.
+ *
+ *   On Entry:
+ *	couple - couple structure for a pair of polytopes.
+ *
+ *   On Exit:
+ *	couple - containing new proper separating plane, if one was
+ *		 found.
+ *
+ *   Function Return :
+ *	result of whether a separating plane exists, or not.
+ *
+ ****************************************************************************/
+
+Boolean get_new_plane_climb(couple)
+Couple		  couple;
+{
+   Polyhedron	  polyhedron1, polyhedron2;
+   double	  dist, u[3], v[3], lambda[4], VP[3];
+   int		  i, k;
+
+   polyhedron1 = couple->polyhdrn1;    polyhedron2 = couple->polyhdrn2;
+
+   dist3d_climb(couple, VP, lambda);
+
+   dist = sqrt(DOT3(VP,VP));   /** distance between polytopes **/
+
+   if (EQZ(dist))
+      return FALSE;
+
+   u[0] = u[1] = u[2] = v[0] = v[1] = v[2] = 0.0;
+   for (i = 0; i < couple->n; i++) {
+      k = couple->vert_indx[i][0];
+      VECADDS3(u, lambda[i], polyhedron1->verts[k], u);	 /** point in P1 **/
+      k = couple->vert_indx[i][1];
+      VECADDS3(v, lambda[i], polyhedron2->verts[k], v);	 /** point in P2 **/
+   }
+
+   /** Store separating plane in P1's local coordinates; the lambdas **/
+   /** sum to one, so v moves by the translation between P2 and P1.  **/
+
+   VECADD3(v, v, polyhedron2->trn);
+   VECADD3(v, v, polyhedron1->itrn);
+
+   CPVECTOR3(couple->pln_pnt1, u);
+   CPVECTOR3(couple->pln_pnt2, v);
+
+   return TRUE;
+}
+
+/****************************************************************************
+ *
+ *   Function to detect if two polyhedra are intersecting.  This gives the
+ *   same answers as Collision, but the cached plane is tested against the
+ *   vertex of P2 found by hill climbing towards it rather than against
+ *   every vertex, and a new plane is found with get_new_plane_climb.
+ *   The couple must have been set up with init_couple.
+ *
+ *   On Entry:
+ *	couple - couple structure for a pair of polytopes.
+ *
+ *   On Exit:
+ *
+ *   Function Return :
+ *	result of whether polyhedra are intersecting or not.
+ *
+ ****************************************************************************/
+
+Boolean Collision_climb(couple)
+Couple		  couple;
+{
+   Polyhedron	  polyhedron1, polyhedron2;
+   double	  u[3], v[3], norm[3], d;
+
+   polyhedron1 = couple->polyhdrn1;	polyhedron2 = couple->polyhdrn2;
+
+   if (couple->plane_exists) {
+
+      /** Transform proper separating plane to P2 local coordinates. **/
+
+      CPVECTOR3(u, couple->pln_pnt1);	CPVECTOR3(v, couple->pln_pnt2);
+      VECADD3(u, u, polyhedron1->trn);	VECADD3(v, v, polyhedron1->trn);
+      VECADD3(u, u, polyhedron2->itrn); VECADD3(v, v, polyhedron2->itrn);
+      VECSUB3(norm, v, u);
+
+      /** The vertex of P2 furthest towards P1 decides the test: **/
+      /** d is the least value of the plane equation over P2.	   **/
+
+      VECNEGATE3(norm);
+      d = DOT3(u, norm) - Hp_climb(polyhedron2, norm, &couple->supp[1]);
+      if (d > 0.0)
+	 return FALSE;
+
+      if (get_new_plane_climb(couple))
+	 return FALSE;
+      couple->plane_exists = FALSE;
+      return TRUE;				 /** Collision **/
+   }
+
+   if (get_new_plane_climb(couple)) {
+      couple->plane_exists = TRUE;		 /** No Collision **/
+      return FALSE;
+   }
+   return TRUE;					 /** Collision **/
+}
+
+/****************************************************************************
+ *
+ *   Function to test many couples for collision at once, with
+ *   Collision_climb.  Each couple only touches its own cached data and
+ *   reads its polyhedra, so the couples are shared out among nthreads
+ *   threads when OpenMP is available.
+ *
+ *   On Entry:
+ *	couples  - array of n couple structures set up with init_couple.
+ *	n	 - number of couples.
+ *	collide  - an array of size n, or NULL.
+ *	nthreads - number of threads, or 0 for the OpenMP default.
+ *
+ *   On Exit:
+ *	collide  - result of each collision test, if not NULL.
+ *
+ *   Function Return :
+ *	the number of couples that are intersecting.
+ *
+ ****************************************************************************/
+
+long Collisions(couples, n, collide, nthreads)
+Couple		couples;
+int		n, nthreads;
+Boolean		collide[];
+{
+   int		i;
+   long		hits;
+   Boolean	c;
+
+   hits = 0;
+#ifdef _OPENMP
+#pragma omp parallel for private(c) reduction(+:hits) schedule(dynamic, 64) \
+   num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+   for (i = 0; i < n; i++) {
+      c = Collision_climb(&couples[i]);
+      if (collide != NULL)
+	 collide[i] = c;
+      if (c)
+	 hits++;
+   }
+   return hits;
+}
+
+
+/****************************************************************************
+ *
+ *   Function to find the edges of the convex hull of a polyhedron's
+ *   vertex set, for the hill climbing support functions.  The hull is
+ *   built incrementally, adding the vertices in order of decreasing
+ *   distance from a point inside it; a vertex inside a face or an edge of
+ *   the hull is then always reached after the corners around it, and is
+ *   left out, so every vertex on the final hull is extreme.
+ *
+ *   On Entry:
+ *	polyhedron - polyhedron with verts and m set.
+ *
+ *   On Exit:
+ *	polyhedron - nbr_first, nbr and hull_vert set; nbr is NULL if
+ *		     the vertices do not span 3-space.
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+typedef struct {
+   double   d;
+   int	    i;
+} Hull_key;
+
+static int cmp_hull_key(a, b)
+const void    *a, *b;
+{
+   double     da, db;
+
+   da = ((Hull_key *)a)->d;   db = ((Hull_key *)b)->d;
+   return (da > db) ? -1 : (da < db) ? 1 : 0;
+}
+
+static void hull_face(P, f, n, off, a, b, c)
+double	    P[][3], n[], *off;
+int	    f[], a, b, c;
+{
+   double   e1[3], e2[3], len;
+
+   f[0] = a;  f[1] = b;	 f[2] = c;
+   VECSUB3(e1, P[b], P[a]);   VECSUB3(e2, P[c], P[a]);
+   n[0] = e1[1]*e2[2] - e1[2]*e2[1];
+   n[1] = e1[2]*e2[0] - e1[0]*e2[2];
+   n[2] = e1[0]*e2[1] - e1[1]*e2[0];
+   len = sqrt(DOT3(n, n));
+   if (len > 0.0)
+      VECSMULT3(1.0 / len, n);
+   *off = DOT3(n, P[a]);
+}
+
+void hull_graph(polyhedron)
+Polyhedron   polyhedron;
+{
+   double    (*P)[3], (*norms)[3], *offs, o[3], x[3], d, best, scale, eps;
+   int	     (*faces)[3], (*edges)[2], i, j, k, f, m, nf, nvis, ne,
+	     max_faces, s[4], *vis, *first;
+   Hull_key  *keys;
+
+   P = polyhedron->verts;   m = polyhedron->m;
+   polyhedron->nbr = NULL;  polyhedron->hull_vert = 0;
+   if (m < 4)
+      return;
+
+   /** Size of the vertex set, for the coplanarity tolerance **/
+
+   scale = 0.0;
+   for (i = 0; i < m; i++)
+      for (k = 0; k < 3; k++)
+	 if (ABS(P[i][k]) > scale)
+	    scale = ABS(P[i][k]);
+   eps = 1e-9 * scale;
+
+   /** Initial tetrahedron: extreme x, then furthest from point, line, **/
+   /** and plane.							 **/
+
+   s[0] = 0;
+   for (i = 1; i < m; i++)
+      if (P[i][0] < P[s[0]][0])
+	 s[0] = i;
+   best = 0.0;	s[1] = s[0];
+   for (i = 0; i < m; i++) {
+      VECSUB3(x, P[i], P[s[0]]);
+      if ((d = DOT3(x, x)) > best) {
+	 best = d;   s[1] = i;
+      }
+   }
+   if (best <= eps * eps)
+      return;
+   best = 0.0;	s[2] = s[0];
+   for (i = 0; i < m; i++) {
+      double a[3], b[3];
+      VECSUB3(a, P[s[1]], P[s[0]]);   VECSUB3(b, P[i], P[s[0]]);
+      x[0] = a[1]*b[2] - a[2]*b[1];
+      x[1] = a[2]*b[0] - a[0]*b[2];
+      x[2] = a[0]*b[1] - a[1]*b[0];
+      if ((d = DOT3(x, x) / DOT3(a, a)) > best) {
+	 best = d;   s[2] = i;
+      }
+   }
+   if (best <= eps * eps)
+      return;
+
+   max_faces = 2 * m + 8;
+   faces = (int (*)[3])malloc(max_faces * sizeof(*faces));
+   norms = (double (*)[3])malloc(max_faces * sizeof(*norms));
+   offs	 = (double *)malloc(max_faces * sizeof(double));
+   vis	 = (int *)malloc(max_faces * sizeof(int));
+   edges = (int (*)[2])malloc(3 * max_faces * sizeof(*edges));
+   keys	 = (Hull_key *)malloc(m * sizeof(Hull_key));
+
+   hull_face(P, faces[0], norms[0], &offs[0], s[0], s[1], s[2]);
+   best = 0.0;	s[3] = s[0];
+   for (i = 0; i < m; i++)
+      if ((d = ABS(DOT3(norms[0], P[i]) - offs[0])) > best) {
+	 best = d;   s[3] = i;
+      }
+   if (best <= eps) {
+      free(faces);  free(norms);  free(offs);  free(vis);
+      free(edges);  free(keys);
+      return;
+   }
+
+   /** Orient the tetrahedron's faces away from its centroid **/
+
+   for (k = 0; k < 3; k++)
+      o[k] = 0.25 * (P[s[0]][k] + P[s[1]][k] + P[s[2]][k] + P[s[3]][k]);
+   for (f = 0; f < 4; f++) {
+      hull_face(P, faces[f], norms[f], &offs[f], s[f], s[(f+1) % 4],
+							      s[(f+2) % 4]);
+      if (DOT3(norms[f], o) - offs[f] > 0.0)
+	 hull_face(P, faces[f], norms[f], &offs[f], s[(f+1) % 4], s[f],
+							      s[(f+2) % 4]);
+   }
+   nf = 4;
+
+   for (i = 0; i < m; i++) {
+      VECSUB3(x, P[i], o);
+      keys[i].d = DOT3(x, x);	keys[i].i = i;
+   }
+   qsort(keys, m, sizeof(Hull_key), cmp_hull_key);
+
+   for (j = 0; j < m; j++) {
+      i = keys[j].i;
+
+      /** Faces that see the new vertex, and their edges **/
+
+      nvis = ne = 0;
+      for (f = 0; f < nf; f++) {
+	 vis[f] = (DOT3(norms[f], P[i]) - offs[f] > eps);
+	 if (vis[f]) {
+	    nvis++;
+	    for (k = 0; k < 3; k++) {
+	       edges[ne][0] = faces[f][k];
+	       edges[ne][1] = faces[f][(k+1) % 3];
+	       ne++;
+	    }
+	 }
+      }
+      if (nvis == 0)
+	 continue;
+
+      /** Drop the visible faces, then cone the horizon to the vertex **/
+
+      k = 0;
+      for (f = 0; f < nf; f++)
+	 if (!vis[f]) {
+	    CPVECTOR3(faces[k], faces[f]);
+	    CPVECTOR3(norms[k], norms[f]);
+	    offs[k] = offs[f];
+	    k++;
+	 }
+      nf = k;
+
+      for (k = 0; k < ne; k++) {
+	 for (f = 0; f < ne; f++)
+	    if (edges[f][0] == edges[k][1] && edges[f][1] == edges[k][0])
+	       break;
+	 if (f < ne)
+	    continue;		       /** interior to the visible region **/
+	 if (nf >= max_faces) {
+	    max_faces *= 2;
+	    faces = (int (*)[3])realloc(faces, max_faces * sizeof(*faces));
+	    norms = (double (*)[3])realloc(norms, max_faces * sizeof(*norms));
+	    offs  = (double *)realloc(offs, max_faces * sizeof(double));
+	    vis	  = (int *)realloc(vis, max_faces * sizeof(int));
+	    edges = (int (*)[2])realloc(edges, 3 * max_faces * sizeof(*edges));
+	 }
+	 hull_face(P, faces[nf], norms[nf], &offs[nf], edges[k][0],
+							edges[k][1], i);
+	 nf++;
+      }
+   }
+
+   /** Each directed edge of a face gives one neighbour **/
+
+   first = polyhedron->nbr_first;
+   for (i = 0; i <= m; i++)
+      first[i] = 0;
+   for (f = 0; f < nf; f++)
+      for (k = 0; k < 3; k++)
+	 first[faces[f][k] + 1]++;
+   for (i = 0; i < m; i++)
+      first[i+1] += first[i];
+   polyhedron->nbr = (int *)malloc((first[m] + 1) * sizeof(int));
+   for (f = 0; f < nf; f++)
+      for (k = 0; k < 3; k++)
+	 polyhedron->nbr[first[faces[f][k]]++] = faces[f][(k+1) % 3];
+   for (i = m; i > 0; i--)
+      first[i] = first[i-1];
+   first[0] = 0;
+   polyhedron->hull_vert = faces[0][0];
+
+   free(faces);	 free(norms);  free(offs);  free(vis);
+   free(edges);	 free(keys);
+}
+
+
 /*** RJR 05/26/93 ***********************************************************
  *
  *   Function to initialize a polyhedron.
@@ -808,7 +1403,8 @@ Couple		  couple;
  *	     tz - z translation.
  *
  *   On Exit:
- *	polyhedron - an initialized polyhedron.
+ *	polyhedron - an initialized polyhedron, with its bounding box, and
+ *		     its hull edges found by hull_graph.
  *
  *   Function Return : none.
  *
@@ -819,7 +1415,7 @@ Polyhedron    polyhedron;
 double	      *verts, tx, ty, tz;
 int	      m;
 {
-   int	      i;
+   int	      i, k;
    double     *p;
 
    polyhedron->trn[0]  =  tx;  polyhedron->trn[1]  =  ty;
@@ -835,6 +1431,46 @@ int	      m;
       CPVECTOR3(polyhedron->verts[i], p);
       p += 3;
    }
+
+   CPVECTOR3(polyhedron->lo, polyhedron->verts[0]);
+   CPVECTOR3(polyhedron->hi, polyhedron->verts[0]);
+   for (i = 1; i < m; i++)
+      for (k = 0; k < 3; k++) {
+	 if (polyhedron->verts[i][k] < polyhedron->lo[k])
+	    polyhedron->lo[k] = polyhedron->verts[i][k];
+	 if (polyhedron->verts[i][k] > polyhedron->hi[k])
+	    polyhedron->hi[k] = polyhedron->verts[i][k];
+      }
+
+   hull_graph(polyhedron);
+}
+
+
+/****************************************************************************
+ *
+ *   Function to initialize a couple.
+ *
+ *   On Entry:
+ *	couple	    - pointer to a couple structure.
+ *	polyhedron1 - first polyhedron, initialized.
+ *	polyhedron2 - second polyhedron, initialized.
+ *
+ *   On Exit:
+ *	couple - a couple with no cached separating plane or points.
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+void init_couple(couple, polyhedron1, polyhedron2)
+Couple	      couple;
+Polyhedron    polyhedron1, polyhedron2;
+{
+   couple->polyhdrn1 = polyhedron1;   couple->polyhdrn2 = polyhedron2;
+   couple->plane_exists = FALSE;
+   couple->n = 0;
+   couple->supp[0] = polyhedron1->hull_vert;
+   couple->supp[1] = polyhedron2->hull_vert;
 }
 
 /*** RJR 05/26/93 ***********************************************************
@@ -865,6 +1501,643 @@ double	     tx, ty, tz;
    polyhedron->itrn[2] -= tz;
 }
 
+/**************************************************************************
+ *
+ * The structure sweep is a broad phase for many polyhedra: sweep and
+ * prune over the bodies' axis aligned bounding boxes.  For each axis the
+ * ends of all the boxes are kept sorted; as the bodies move the lists are
+ * re-sorted by insertion sort, which is nearly linear since little changes
+ * from one step to the next.  Two boxes start or stop overlapping only
+ * when an end of one passes an end of the other, so the set of pairs
+ * whose boxes overlap is kept up to date by the swaps alone.	Those pairs
+ * are held as couples, in couples[0..npairs-1], which stay in place (with
+ * their cached planes and points) for as long as the boxes overlap, and
+ * can be handed straight to Collisions.
+ *
+ **************************************************************************/
+
+typedef struct sweep_end {
+   double   val;		 /* position of the end along the axis. */
+   int	    end;		 /* 2 * body, plus 1 for a box's max. */
+} Sweep_end;
+
+typedef struct sweep {
+   Polyhedron	      *bodies;	     /* the polyhedra. */
+   int		      nbodies;	     /* number of polyhedra. */
+   double	      (*boxes)[2][3]; /* world box of each body, lo and hi. */
+   Sweep_end	      *ends[3];	     /* sorted box ends along each axis. */
+   struct couple      *couples;	     /* pairs whose boxes overlap. */
+   unsigned long long *pair_keys;    /* i * nbodies + j for each of them. */
+   int		      npairs;	     /* number of such pairs. */
+   int		      max_pairs;     /* size of couples and pair_keys. */
+   unsigned long long *keys;	     /* hash table of the pairs ... */
+   int		      *slot;	     /* ... and their indices in couples. */
+   int		      table_size;    /* size of keys and slot, a power of 2. */
+} *Sweep;
+
+#define NO_PAIR	       (~0ULL)
+
+/****************************************************************************
+ *
+ *   Functions to find, add and remove a pair of bodies in the sweep's
+ *   pairs.  The hash table uses linear probing; removal shifts the
+ *   following entries back so no tombstones are needed.
+ *
+ ****************************************************************************/
+
+static int pair_hash(sweep, key)
+Sweep		      sweep;
+unsigned long long    key;
+{
+   key *= 0x9E3779B97F4A7C15ULL;
+   return (int)((key ^ (key >> 29)) & (sweep->table_size - 1));
+}
+
+static int find_pair(sweep, key)
+Sweep		      sweep;
+unsigned long long    key;
+{
+   int		      h;
+
+   for (h = pair_hash(sweep, key); sweep->keys[h] != NO_PAIR;
+					 h = (h + 1) & (sweep->table_size - 1))
+      if (sweep->keys[h] == key)
+	 return h;
+   return -1;
+}
+
+static void put_pair(sweep, key, slot)
+Sweep		      sweep;
+unsigned long long    key;
+int		      slot;
+{
+   int		      h;
+
+   for (h = pair_hash(sweep, key); sweep->keys[h] != NO_PAIR;
+					 h = (h + 1) & (sweep->table_size - 1))
+      ;
+   sweep->keys[h] = key;
+   sweep->slot[h] = slot;
+}
+
+static void add_pair(sweep, i, j)
+Sweep		      sweep;
+int		      i, j;
+{
+   unsigned long long key, *old_keys;
+   int		      k, old_size, *old_slot;
+
+   if (i > j) {
+      k = i;  i = j;  j = k;
+   }
+   key = (unsigned long long)i * sweep->nbodies + j;
+   if (find_pair(sweep, key) >= 0)
+      return;
+
+   /** Keep the table at most half full **/
+
+   if (2 * (sweep->npairs + 1) > sweep->table_size) {
+      old_keys = sweep->keys;  old_slot = sweep->slot;
+      old_size = sweep->table_size;
+      sweep->table_size *= 2;
+      sweep->keys = (unsigned long long *)
+		    malloc(sweep->table_size * sizeof(unsigned long long));
+      sweep->slot = (int *)malloc(sweep->table_size * sizeof(int));
+      for (k = 0; k < sweep->table_size; k++)
+	 sweep->keys[k] = NO_PAIR;
+      for (k = 0; k < old_size; k++)
+	 if (old_keys[k] != NO_PAIR)
+	    put_pair(sweep, old_keys[k], old_slot[k]);
+      free(old_keys);  free(old_slot);
+   }
+   if (sweep->npairs == sweep->max_pairs) {
+      sweep->max_pairs *= 2;
+      sweep->couples = (struct couple *)realloc(sweep->couples,
+			     sweep->max_pairs * sizeof(struct couple));
+      sweep->pair_keys = (unsigned long long *)realloc(sweep->pair_keys,
+			     sweep->max_pairs * sizeof(unsigned long long));
+   }
+
+   init_couple(&sweep->couples[sweep->npairs], sweep->bodies[i],
+						sweep->bodies[j]);
+   sweep->pair_keys[sweep->npairs] = key;
+   put_pair(sweep, key, sweep->npairs);
+   sweep->npairs++;
+}
+
+static void remove_pair(sweep, i, j)
+Sweep		      sweep;
+int		      i, j;
+{
+   unsigned long long key;
+   int		      h, k, g, s, mask;
+
+   if (i > j) {
+      k = i;  i = j;  j = k;
+   }
+   key = (unsigned long long)i * sweep->nbodies + j;
+   if ((h = find_pair(sweep, key)) < 0)
+      return;
+   s = sweep->slot[h];
+   mask = sweep->table_size - 1;
+
+   /** Shift back the entries that probed past h **/
+
+   for (k = (h + 1) & mask; sweep->keys[k] != NO_PAIR; k = (k + 1) & mask) {
+      g = pair_hash(sweep, sweep->keys[k]);
+      if (((k - g) & mask) >= ((k - h) & mask)) {
+	 sweep->keys[h] = sweep->keys[k];
+	 sweep->slot[h] = sweep->slot[k];
+	 h = k;
+      }
+   }
+   sweep->keys[h] = NO_PAIR;
+
+   /** Move the last couple into the hole **/
+
+   sweep->npairs--;
+   if (s != sweep->npairs) {
+      sweep->couples[s] = sweep->couples[sweep->npairs];
+      sweep->pair_keys[s] = sweep->pair_keys[sweep->npairs];
+      sweep->slot[find_pair(sweep, sweep->pair_keys[s])] = s;
+   }
+}
+
+/****************************************************************************
+ *
+ *   Functions to find the boxes of the bodies in world coordinates, and
+ *   to test whether the boxes of two bodies overlap.  Boxes that touch
+ *   overlap.  The boxes are copied into the sweep so that sorting does
+ *   not have to go back to the polyhedra, which are large and scattered.
+ *
+ ****************************************************************************/
+
+static void set_boxes(sweep)
+Sweep	     sweep;
+{
+   Polyhedron p;
+   int	      i;
+
+   for (i = 0; i < sweep->nbodies; i++) {
+      p = sweep->bodies[i];
+      VECADD3(sweep->boxes[i][0], p->lo, p->trn);
+      VECADD3(sweep->boxes[i][1], p->hi, p->trn);
+   }
+}
+
+static Boolean boxes_overlap(sweep, a, b)
+Sweep	     sweep;
+int	     a, b;
+{
+   double     (*p)[3], (*q)[3];
+   int	      k;
+
+   p = sweep->boxes[a];	  q = sweep->boxes[b];
+   for (k = 0; k < 3; k++)
+      if (p[1][k] < q[0][k] || q[1][k] < p[0][k])
+	 return FALSE;
+   return TRUE;
+}
+
+/****************************************************************************
+ *
+ *   Functions to order box ends.  At equal values a min comes before a
+ *   max, so that the order of the ends of two intervals always says
+ *   whether they overlap.
+ *
+ ****************************************************************************/
+
+#define END_BEFORE(a,b) ( (a).val < (b).val || \
+			  ((a).val == (b).val && !((a).end & 1) && ((b).end & 1)) )
+
+static int cmp_sweep_end(a, b)
+const void    *a, *b;
+{
+   if (END_BEFORE(*(Sweep_end *)a, *(Sweep_end *)b))
+      return -1;
+   if (END_BEFORE(*(Sweep_end *)b, *(Sweep_end *)a))
+      return 1;
+   return 0;
+}
+
+static void set_ends(sweep, k)
+Sweep	      sweep;
+int	      k;
+{
+   Sweep_end  *ends;
+   int	      i;
+
+   ends = sweep->ends[k];
+   for (i = 0; i < 2 * sweep->nbodies; i++)
+      ends[i].val = sweep->boxes[ends[i].end >> 1][ends[i].end & 1][k];
+}
+
+/****************************************************************************
+ *
+ *   Function to re-sort the box ends along one axis after the bodies have
+ *   moved.  Whenever a min moves below a max the two boxes may have begun
+ *   to overlap, and whenever a max moves below a min they have stopped.
+ *
+ *   On Entry:
+ *	sweep - sweep whose bodies have moved.
+ *	k     - the axis.
+ *
+ *   On Exit:
+ *	sweep - with ends[k] sorted, and the pairs updated for the ends
+ *		that crossed.
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+static void sort_axis(sweep, k)
+Sweep	     sweep;
+int	     k;
+{
+   Sweep_end  *ends, e;
+   int	      i, j, a, b;
+
+   set_ends(sweep, k);
+   ends = sweep->ends[k];
+
+   for (i = 1; i < 2 * sweep->nbodies; i++) {
+      e = ends[i];
+      for (j = i; j > 0 && END_BEFORE(e, ends[j-1]); j--) {
+	 a = e.end >> 1;   b = ends[j-1].end >> 1;
+	 if (!(e.end & 1) && (ends[j-1].end & 1)) {	 /** min passes a max **/
+	    if (boxes_overlap(sweep, a, b))
+	       add_pair(sweep, a, b);
+	 }
+	 else if ((e.end & 1) && !(ends[j-1].end & 1))	 /** max passes a min **/
+	    remove_pair(sweep, a, b);
+	 ends[j] = ends[j-1];
+      }
+      ends[j] = e;
+   }
+}
+
+/****************************************************************************
+ *
+ *   Function to initialize a sweep.  The ends are sorted from scratch,
+ *   and the pairs found by sweeping along x, in time proportional to the
+ *   number of pairs whose boxes overlap along x.
+ *
+ *   On Entry:
+ *	sweep	- pointer to a sweep structure.
+ *	bodies	- array of n initialized polyhedra.
+ *	n	- number of polyhedra.
+ *
+ *   On Exit:
+ *	sweep	- an initialized sweep, with couples for the pairs of
+ *		  bodies whose boxes overlap.
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+void init_sweep(sweep, bodies, n)
+Sweep	      sweep;
+Polyhedron    bodies[];
+int	      n;
+{
+   int	      i, j, k, a, nopen, *open, *where;
+
+   sweep->bodies = bodies;  sweep->nbodies = n;
+   sweep->npairs = 0;	    sweep->max_pairs = 64;
+   sweep->couples = (struct couple *)
+		    malloc(sweep->max_pairs * sizeof(struct couple));
+   sweep->pair_keys = (unsigned long long *)
+		      malloc(sweep->max_pairs * sizeof(unsigned long long));
+   sweep->table_size = 128;
+   sweep->keys = (unsigned long long *)
+		 malloc(sweep->table_size * sizeof(unsigned long long));
+   sweep->slot = (int *)malloc(sweep->table_size * sizeof(int));
+   for (i = 0; i < sweep->table_size; i++)
+      sweep->keys[i] = NO_PAIR;
+
+   sweep->boxes = (double (*)[2][3])malloc(n * sizeof(*sweep->boxes));
+   set_boxes(sweep);
+   for (k = 0; k < 3; k++) {
+      sweep->ends[k] = (Sweep_end *)malloc(2 * n * sizeof(Sweep_end));
+      for (i = 0; i < 2 * n; i++)
+	 sweep->ends[k][i].end = i;
+      set_ends(sweep, k);
+      qsort(sweep->ends[k], 2 * n, sizeof(Sweep_end), cmp_sweep_end);
+   }
+
+   /** Each body entering along x is tested against those still open **/
+
+   open	 = (int *)malloc(n * sizeof(int));
+   where = (int *)malloc(n * sizeof(int));
+   nopen = 0;
+   for (i = 0; i < 2 * n; i++) {
+      a = sweep->ends[0][i].end >> 1;
+      if (sweep->ends[0][i].end & 1) {
+	 j = where[a];
+	 open[j] = open[--nopen];
+	 where[open[j]] = j;
+      }
+      else {
+	 for (j = 0; j < nopen; j++)
+	    if (boxes_overlap(sweep, a, open[j]))
+	       add_pair(sweep, a, open[j]);
+	 where[a] = nopen;
+	 open[nopen++] = a;
+      }
+   }
+   free(open);	free(where);
+}
+
+/****************************************************************************
+ *
+ *   Function to bring a sweep up to date after its bodies have moved.
+ *
+ *   On Entry:
+ *	sweep - an initialized sweep.
+ *
+ *   On Exit:
+ *	sweep - couples[0..npairs-1] are the pairs whose boxes now
+ *		overlap.  Pairs that overlapped before keep their couples,
+ *		though maybe not their places in the array.
+ *
+ *   Function Return :
+ *	the number of pairs whose boxes overlap.
+ *
+ ****************************************************************************/
+
+int update_sweep(sweep)
+Sweep	     sweep;
+{
+   int	     k;
+
+   set_boxes(sweep);
+   for (k = 0; k < 3; k++)
+      sort_axis(sweep, k);
+   return sweep->npairs;
+}
+
+
+/****************************************************************************
+ *
+ *   Wall clock time in seconds, for the benchmarks.  clock() would add
+ *   up the time of all the threads running Collisions.
+ *
+ ****************************************************************************/
+
+static double seconds()
+{
+#ifdef _OPENMP
+   return omp_get_wtime();
+#else
+   return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/****************************************************************************
+ *
+ *   Benchmark of the narrow phase on many bodies.  Spheres, boxes and
+ *   cylinders sit in a row along the x-axis, each oscillating about its
+ *   own place, and each body is tested against the next two in the row.
+ *   Every step the couples are tested with Collision, with
+ *   Collision_climb, and with Collisions on nthreads threads, each on its
+ *   own copy of the couples; the three must agree.
+ *
+ *   On Entry:
+ *	bodies	 - number of polyhedra.
+ *	steps	 - number of movements.
+ *	nthreads - threads for Collisions, or 0 for the OpenMP default.
+ *
+ *   Function Return : none.
+ *
+ ****************************************************************************/
+
+void bench(bodies, steps, nthreads)
+int	      bodies, steps, nthreads;
+{
+   Polyhedron	  polys;
+   Couple	  plain, climb, batch;
+   Boolean	  *collide, *expect;
+   double	  *xstp, *xoff, ty, tz;
+   int		  i, j, k, npairs, step;
+   long		  hits_plain, hits_climb, hits_batch, differ;
+   double	  t0, t_plain, t_climb, t_batch;
+
+   mak_box(box);
+   mak_cyl(cyl);
+   mak_sph(sphere);
+
+   polys = (Polyhedron)malloc(bodies * sizeof(struct polyhedron));
+   xstp	 = (double *)malloc(bodies * sizeof(double));
+   xoff	 = (double *)malloc(bodies * sizeof(double));
+   srand(1);
+   for (i = 0; i < bodies; i++) {
+      ty = 6.0 * rand() / RAND_MAX - 3.0;
+      tz = 6.0 * rand() / RAND_MAX - 3.0;
+      switch (i % 3) {
+	 case 0: init_polyhedron(&polys[i], sphere, 342, 12.0*i, ty, tz); break;
+	 case 1: init_polyhedron(&polys[i], box, 8, 12.0*i, ty, tz); break;
+	 case 2: init_polyhedron(&polys[i], cyl, 36, 12.0*i, ty, tz); break;
+      }
+      xstp[i] = 0.1 + 1.4 * rand() / RAND_MAX;
+      xoff[i] = 0.0;
+   }
+
+   npairs = 0;
+   plain = (Couple)malloc(2 * bodies * sizeof(struct couple));
+   climb = (Couple)malloc(2 * bodies * sizeof(struct couple));
+   batch = (Couple)malloc(2 * bodies * sizeof(struct couple));
+   collide = (Boolean *)malloc(2 * bodies * sizeof(Boolean));
+   expect  = (Boolean *)malloc(2 * bodies * sizeof(Boolean));
+   for (i = 0; i < bodies; i++)
+      for (j = i + 1; j <= i + 2 && j < bodies; j++) {
+	 init_couple(&plain[npairs], &polys[i], &polys[j]);
+	 init_couple(&climb[npairs], &polys[i], &polys[j]);
+	 init_couple(&batch[npairs], &polys[i], &polys[j]);
+	 npairs++;
+      }
+
+   hits_plain = hits_climb = hits_batch = differ = 0;
+   t_plain = t_climb = t_batch = 0;
+   for (step = 0; step < steps; step++) {
+      for (i = 0; i < bodies; i++) {
+	 move_polyhedron(&polys[i], xstp[i], 0.0, 0.0);
+	 xoff[i] += xstp[i];
+	 if (ABS(xoff[i]) > 6.0)
+	    xstp[i] = -xstp[i];
+      }
+
+      t0 = seconds();
+      for (k = 0; k < npairs; k++)
+	 if ((expect[k] = Collision(&plain[k])))
+	    hits_plain++;
+      t_plain += seconds() - t0;
+
+      t0 = seconds();
+      for (k = 0; k < npairs; k++)
+	 if ((collide[k] = Collision_climb(&climb[k])))
+	    hits_climb++;
+      t_climb += seconds() - t0;
+
+      for (k = 0; k < npairs; k++)
+	 if (collide[k] != expect[k])
+	    differ++;
+
+      t0 = seconds();
+      hits_batch += Collisions(batch, npairs, collide, nthreads);
+      t_batch += seconds() - t0;
+
+      for (k = 0; k < npairs; k++)
+	 if (collide[k] != expect[k])
+	    differ++;
+   }
+
+   printf("%d bodies, %d couples, %d steps\n", bodies, npairs, steps);
+   printf("Collision:	    %ld hits, %.3f s\n", hits_plain, t_plain);
+   printf("Collision_climb: %ld hits, %.3f s\n", hits_climb, t_climb);
+   printf("Collisions:	    %ld hits, %.3f s\n", hits_batch, t_batch);
+   printf("differing results: %ld\n", differ);
+}
+
+/****************************************************************************
+ *
+ *   Benchmark of the broad phase.  Spheres, boxes and cylinders drift
+ *   about inside a cube, bouncing off its walls, at a density that does
+ *   not change with their number.  Every step the sweep is brought up to
+ *   date and the pairs whose boxes overlap are tested with Collisions.
+ *   Prints the pairs tested and the time per step for each number of
+ *   bodies, from 1250 up to 20000 when bodies is 0.  Up to 2000 bodies
+ *   the pairs of the sweep are checked against those found by testing
+ *   every box against every other.
+ *
+ *   On Entry:
+ *	bodies	 - number of polyhedra, or 0.
+ *	steps	 - number of movements.
+ *	nthreads - threads for Collisions, or 0 for the OpenMP default.
+ *
+ *   Function Return : the number of pairs missed or wrongly reported.
+ *
+ ****************************************************************************/
+
+static int cmp_pair_key(a, b)
+const void    *a, *b;
+{
+   unsigned long long ka = *(const unsigned long long *)a,
+		      kb = *(const unsigned long long *)b;
+
+   return ka < kb ? -1 : ka > kb;
+}
+
+long bench_sweep(bodies, steps, nthreads)
+int	      bodies, steps, nthreads;
+{
+   struct sweep	  sweep;
+   struct polyhedron *polys;
+   Polyhedron	  *ptrs;
+   unsigned long long *found, key;
+   double	  (*vel)[3], side, t, t0, t_broad, t_narrow;
+   int		  i, j, k, n, step, last, a, b;
+   long		  pairs, hits, missed, wrong, failed = 0;
+
+   mak_box(box);
+   mak_cyl(cyl);
+   mak_sph(sphere);
+
+   printf("  bodies    all pairs   box pairs/step   hits/step   sweep ms/step"
+	  "   GJK ms/step\n");
+   last = bodies > 0 ? bodies : 20000;
+   for (n = bodies > 0 ? bodies : 1250; n <= last; n *= 2) {
+      polys = (struct polyhedron *)malloc(n * sizeof(struct polyhedron));
+      ptrs  = (Polyhedron *)malloc(n * sizeof(Polyhedron));
+      vel   = (double (*)[3])malloc(n * sizeof(*vel));
+      side  = 24.0 * pow((double)n, 1.0 / 3.0);
+      srand(1);
+      for (i = 0; i < n; i++) {
+	 double x = side * rand() / RAND_MAX, y = side * rand() / RAND_MAX,
+		z = side * rand() / RAND_MAX;
+	 switch (i % 3) {
+	    case 0: init_polyhedron(&polys[i], sphere, 342, x, y, z); break;
+	    case 1: init_polyhedron(&polys[i], box, 8, x, y, z); break;
+	    case 2: init_polyhedron(&polys[i], cyl, 36, x, y, z); break;
+	 }
+	 ptrs[i] = &polys[i];
+	 for (k = 0; k < 3; k++)
+	    vel[i][k] = 0.5 * rand() / RAND_MAX - 0.25;
+      }
+      init_sweep(&sweep, ptrs, n);
+
+      found = (unsigned long long *)malloc((n <= 2000 ? n * (n - 1) / 2 + 1 : 1)
+					   * sizeof(unsigned long long));
+      pairs = hits = missed = wrong = 0;
+      t_broad = t_narrow = 0;
+      for (step = 0; step < steps; step++) {
+	 for (i = 0; i < n; i++) {
+	    for (k = 0; k < 3; k++) {
+	       t = polys[i].trn[k] + vel[i][k];
+	       if (t < 0.0 || t > side)
+		  vel[i][k] = -vel[i][k];
+	    }
+	    move_polyhedron(&polys[i], vel[i][0], vel[i][1], vel[i][2]);
+	 }
+
+	 t0 = seconds();
+	 pairs += update_sweep(&sweep);
+	 t_broad += seconds() - t0;
+
+	 t0 = seconds();
+	 hits += Collisions(sweep.couples, sweep.npairs, NULL, nthreads);
+	 t_narrow += seconds() - t0;
+
+	 /** The bodies of the couples, sorted, against every overlap **/
+
+	 if (n <= 2000) {
+	    for (k = 0; k < sweep.npairs; k++) {
+	       a = (int)(sweep.couples[k].polyhdrn1 - polys);
+	       b = (int)(sweep.couples[k].polyhdrn2 - polys);
+	       found[k] = a < b ? (unsigned long long)a * n + b
+				: (unsigned long long)b * n + a;
+	    }
+	    qsort(found, sweep.npairs, sizeof(unsigned long long), cmp_pair_key);
+	    k = 0;
+	    for (i = 0; i < n; i++)
+	       for (j = i + 1; j < n; j++) {
+		  if (!boxes_overlap(&sweep, i, j))
+		     continue;
+		  key = (unsigned long long)i * n + j;
+		  while (k < sweep.npairs && found[k] < key) {
+		     wrong++;		 /** reported, no overlap **/
+		     k++;
+		  }
+		  if (k < sweep.npairs && found[k] == key)
+		     k++;
+		  else
+		     missed++;
+		  while (k < sweep.npairs && found[k] == key) {
+		     wrong++;		 /** reported twice **/
+		     k++;
+		  }
+	       }
+	    wrong += sweep.npairs - k;
+	 }
+      }
+
+      printf("%8d %12.0f %16.1f %11.1f %15.3f %13.3f\n", n,
+	     0.5 * n * (n - 1.0), (double)pairs / steps, (double)hits / steps,
+	     1000.0 * t_broad / steps, 1000.0 * t_narrow / steps);
+      if (missed != 0 || wrong != 0)
+	 printf("*** %ld box pairs missed, %ld wrong\n", missed, wrong);
+      failed += missed + wrong;
+
+      for (i = 0; i < n; i++)
+	 free(polys[i].nbr);
+      for (k = 0; k < 3; k++)
+	 free(sweep.ends[k]);
+      free(sweep.boxes);    free(sweep.couples);  free(sweep.pair_keys);
+      free(sweep.keys);	    free(sweep.slot);
+      free(polys);  free(ptrs);	 free(vel);  free(found);
+   }
+   return failed;
+}
+
 /*** RJR 05/26/93 ***********************************************************
  *
  *   This is the Main Program for the Collision Detection example. This test
@@ -882,8 +2155,15 @@ double	     tx, ty, tz;
  *   disjoint result it is exact, but when it returns an intersection result
  *   it is approximate.
  *
+ *   Run as "collide -b [bodies] [steps] [threads]" to time the hill climbing
+ *   functions against the originals instead; see bench.  Run as
+ *   "collide -s [bodies] [steps] [threads]" to time the broad phase on
+ *   many bodies; see bench_sweep.
+ *
  ****************************************************************************/
-int main()
+int main(argc, argv)
+int		  argc;
+char		  *argv[];
 {
    Polyhedron	  Polyhedron1, Polyhedron2, Polyhedron3;
    Couple	  Couple1, Couple2, Couple3;
@@ -891,6 +2171,22 @@ int main()
    int		  i, steps;
    long		  hits = 0;
 
+   /*** collide -b [bodies] [steps] [threads] runs the benchmark ***/
+
+   if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+      bench(argc > 2 ? atoi(argv[2]) : 1000, argc > 3 ? atoi(argv[3]) : 200,
+	    argc > 4 ? atoi(argv[4]) : 0);
+      return 0;
+   }
+
+   /*** collide -s [bodies] [steps] [threads] runs the broad phase one ***/
+
+   if (argc > 1 && strcmp(argv[1], "-s") == 0) {
+      return bench_sweep(argc > 2 ? atoi(argv[2]) : 0,
+			 argc > 3 ? atoi(argv[3]) : 100,
+			 argc > 4 ? atoi(argv[4]) : 0) != 0;
+   }
+
    /*** Initialize the 3 test polyhedra ***/
 
    mak_box(box);
@@ -907,19 +2203,13 @@ int main()
    init_polyhedron(Polyhedron3, cyl, 36, -50.0, 0.0, 0.0);
 
    Couple1 = (Couple)malloc(sizeof(struct couple));
-   Couple1->polyhdrn1 = Polyhedron1;   Couple1->polyhdrn2 = Polyhedron2;
-   Couple1->n = 0;
-   Couple1->plane_exists = FALSE;
+   init_couple(Couple1, Polyhedron1, Polyhedron2);
 
    Couple2 = (Couple)malloc(sizeof(struct couple));
-   Couple2->polyhdrn1 = Polyhedron1;   Couple2->polyhdrn2 = Polyhedron3;
-   Couple2->n = 0;
-   Couple2->plane_exists = FALSE;
+   init_couple(Couple2, Polyhedron1, Polyhedron3);
 
    Couple3 = (Couple)malloc(sizeof(struct couple));
-   Couple3->polyhdrn1 = Polyhedron3;   Couple3->polyhdrn2 = Polyhedron2;
-   Couple3->n = 0;
-   Couple3->plane_exists = FALSE;
+   init_couple(Couple3, Polyhedron3, Polyhedron2);
 
    /** Perform Collision Tests **/
 
@@ -946,4 +2236,5 @@ int main()
    }
    printf("number of tests = %d\n",(steps * 3));
    printf("number of hits = %ld\n", hits);
+   return 0;
 }
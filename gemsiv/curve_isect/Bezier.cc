@@ -255,6 +255,18 @@ void RecursivelyIntersect( Bezier a, double t0, double t1, int deptha,
     }
 
 inline double log4( double x ) { return 0.5 * log2( x ); }
+
+/*
+ * Number of midpoint subdivisions after which a curve is flat within
+ * 1/INV_EPS, from the largest second difference l0 of its control points.
+ */
+static int SubdivisionDepth( double l0 )
+    {
+    if( l0 * 0.75 * M_SQRT2 + 1.0 == 1.0 ) 
+	return 0;
+    else
+	return (int)ceil( log4( M_SQRT2 * 6.0 / 8.0 * INV_EPS * l0 ) );
+    }
     
 /*
  * Wang's theorem is used to estimate the level of subdivision required,
@@ -282,25 +294,8 @@ double ** FindIntersections( Bezier a, Bezier b )
 	vector lb;
 	if( lb1.x > lb2.x ) lb.x = lb1.x; else lb.x = lb2.x;
 	if( lb1.y > lb2.y ) lb.y = lb1.y; else lb.y = lb2.y;
-	double l0;
-	if( la.x > la.y ) 
-	    l0 = la.x;
-	else 
-	    l0 = la.y;
-	int ra;
-	if( l0 * 0.75 * M_SQRT2 + 1.0 == 1.0 ) 
-	    ra = 0;
-	else
-	    ra = (int)ceil( log4( M_SQRT2 * 6.0 / 8.0 * INV_EPS * l0 ) );
-	if( lb.x > lb.y ) 
-	    l0 = lb.x;
-	else 
-	    l0 = lb.y;
-	int rb;
-	if( l0 * 0.75 * M_SQRT2 + 1.0 == 1.0 ) 
-	    rb = 0;
-	else
-	    rb = (int)ceil(log4( M_SQRT2 * 6.0 / 8.0 * INV_EPS * l0 ) );
+	int ra = SubdivisionDepth( la.x > la.y ? la.x : la.y );
+	int rb = SubdivisionDepth( lb.x > lb.y ? lb.x : lb.y );
 	RecursivelyIntersect( a, 0., 1., ra, b, 0., 1., rb, parameters, index );
 	}
     if( index < 9 )
@@ -325,6 +320,29 @@ Bezier::ParameterSplitLeft( double t, Bezier &left )
     left.p0->refcount++; left.p1->refcount++; 
     left.p2->refcount++; left.p3->refcount++;
     }
+
+/*
+ * ParameterSplitLeft on a curve held by value: c is split at t into
+ * left and right, with the same arithmetic.
+ */
+void ParameterSplit( const BezierCurve &c, double t,
+		     BezierCurve &left, BezierCurve &right )
+    {
+    double x1 = c.x[1] + t * ( c.x[2] - c.x[1] );
+    double y1 = c.y[1] + t * ( c.y[2] - c.y[1] );
+    left.x[0] = c.x[0];				left.y[0] = c.y[0];
+    left.x[1] = c.x[0] + t * ( c.x[1] - c.x[0] );
+    left.y[1] = c.y[0] + t * ( c.y[1] - c.y[0] );
+    right.x[2] = c.x[2] + t * ( c.x[3] - c.x[2] );
+    right.y[2] = c.y[2] + t * ( c.y[3] - c.y[2] );
+    right.x[1] = x1 + t * ( right.x[2] - x1 );
+    right.y[1] = y1 + t * ( right.y[2] - y1 );
+    left.x[2] = left.x[1] + t * ( x1 - left.x[1] );
+    left.y[2] = left.y[1] + t * ( y1 - left.y[1] );
+    left.x[3] = right.x[0] = left.x[2] + t * ( right.x[1] - left.x[2] );
+    left.y[3] = right.y[0] = left.y[2] + t * ( right.y[1] - left.y[2] );
+    right.x[3] = c.x[3];			right.y[3] = c.y[3];
+    }
     
 /*
  * Intersect two curves, returning an array of two arrays of curves.
@@ -342,9 +360,6 @@ Bezier::ParameterSplitLeft( double t, Bezier &left )
 
 Bezier **Bezier::Intersect( Bezier B )
     {
-    // The return from FindIntersections will decrement all refcounts.
-    // (a c++-ism)
-    B.p0->refcount++; B.p1->refcount++; B.p2->refcount++; B.p3->refcount++; 
     Bezier **rvalue = new Bezier *[2];
     rvalue[0] = new Bezier[10];
     rvalue[1] = new Bezier[10];
@@ -355,7 +370,7 @@ Bezier **Bezier::Intersect( Bezier B )
 	ParameterSplitLeft( t[0][0], rvalue[0][0] );
 	B.ParameterSplitLeft( t[1][0], rvalue[1][0] );
 	index++;
-	while( t[0][index] > -0.5 && index < 9 )
+	while( index < 9 && t[0][index] > -0.5 )
 	    {
 	    double splitT = (t[0][index] - t[0][index-1])/(1.0 - t[0][index-1]);
 	    ParameterSplitLeft( splitT, rvalue[0][index] );
@@ -368,3 +383,282 @@ Bezier **Bezier::Intersect( Bezier B )
     rvalue[1][index] = B;
     return rvalue;
     }
+
+/*
+ * Intersection without memory allocation.
+ *
+ * IntersectCurves does the same subdivision as FindIntersections, on
+ * curves held by value.  Instead of recursing, the pairs of subcurves
+ * still to be examined are kept on a work list in a fixed array; they
+ * are taken in the order the recursion would visit them.  Besides the
+ * bounding boxes, each pair is culled with fat lines: if all control
+ * points of one subcurve lie on one side of the band around the chord of
+ * the other that holds that other's control points, the convex hulls are
+ * apart and so are the chords of all their subcurves.
+ */
+
+#define MAX_DEPTH 30		// each curve is split at most this often
+#define MAX_WORK (3 * 2 * MAX_DEPTH + 4)
+
+BezierCurve Bezier::Curve( ) const
+    {
+    BezierCurve c;
+    c.x[0] = p0->x; c.y[0] = p0->y;
+    c.x[1] = p1->x; c.y[1] = p1->y;
+    c.x[2] = p2->x; c.y[2] = p2->y;
+    c.x[3] = p3->x; c.y[3] = p3->y;
+    return c;
+    }
+
+struct CurvePair
+    {
+    BezierCurve a, b;
+    double t0, t1, u0, u1;
+    int deptha, depthb;
+    };
+
+static void SplitCurve( const BezierCurve &c, BezierCurve &l, BezierCurve &r )
+    {
+    double tx, ty;
+    l.x[0] = c.x[0];				l.y[0] = c.y[0];
+    r.x[3] = c.x[3];				r.y[3] = c.y[3];
+    l.x[1] = ( c.x[0] + c.x[1] ) * 0.5;		l.y[1] = ( c.y[0] + c.y[1] ) * 0.5;
+    r.x[2] = ( c.x[2] + c.x[3] ) * 0.5;		r.y[2] = ( c.y[2] + c.y[3] ) * 0.5;
+    tx = ( c.x[1] + c.x[2] ) * 0.5;		ty = ( c.y[1] + c.y[2] ) * 0.5;
+    l.x[2] = ( l.x[1] + tx ) * 0.5;		l.y[2] = ( l.y[1] + ty ) * 0.5;
+    r.x[1] = ( tx + r.x[2] ) * 0.5;		r.y[1] = ( ty + r.y[2] ) * 0.5;
+    l.x[3] = r.x[0] = ( l.x[2] + r.x[1] ) * 0.5;
+    l.y[3] = r.y[0] = ( l.y[2] + r.y[1] ) * 0.5;
+    }
+
+static void CurveBounds( const BezierCurve &c, CurveBox &box )
+    {
+    box.minx = box.maxx = c.x[0];
+    box.miny = box.maxy = c.y[0];
+    for( int i = 1; i < 4; i++ )
+	{
+	if( c.x[i] < box.minx ) box.minx = c.x[i];
+	if( c.x[i] > box.maxx ) box.maxx = c.x[i];
+	if( c.y[i] < box.miny ) box.miny = c.y[i];
+	if( c.y[i] > box.maxy ) box.maxy = c.y[i];
+	}
+    }
+
+// Are the control points of b outside the fat line of a ?
+static int FatLineMiss( const BezierCurve &a, const BezierCurve &b )
+    {
+    double dx = a.x[3] - a.x[0], dy = a.y[3] - a.y[0];
+    if( dx == 0.0 && dy == 0.0 )
+	return 0;
+    // Distances from the chord, scaled by its length
+    double d1 = ( a.x[1] - a.x[0] ) * dy - ( a.y[1] - a.y[0] ) * dx;
+    double d2 = ( a.x[2] - a.x[0] ) * dy - ( a.y[2] - a.y[0] ) * dx;
+    double dmin = d1 < d2 ? d1 : d2, dmax = d1 < d2 ? d2 : d1;
+    if( dmin > 0.0 ) dmin = 0.0;
+    if( dmax < 0.0 ) dmax = 0.0;
+    double slack = 1e-10 * ( dx * dx + dy * dy + dmax - dmin );
+    dmin -= slack;
+    dmax += slack;
+    int above = 0, below = 0;
+    for( int i = 0; i < 4; i++ )
+	{
+	double d = ( b.x[i] - a.x[0] ) * dy - ( b.y[i] - a.y[0] ) * dx;
+	if( d > dmax ) above++;
+	else if( d < dmin ) below++;
+	else return 0;
+	}
+    return above == 4 || below == 4;
+    }
+
+static int Interfere( const BezierCurve &a, const BezierCurve &b )
+    {
+    CurveBox ba, bb;
+    CurveBounds( a, ba );
+    CurveBounds( b, bb );
+    if( ( ba.minx > bb.maxx ) || ( ba.miny > bb.maxy )
+	|| ( bb.minx > ba.maxx ) || ( bb.miny > ba.maxy ) )
+	return 0;
+    return !FatLineMiss( a, b ) && !FatLineMiss( b, a );
+    }
+
+static int CurveDepth( const BezierCurve &c )
+    {
+    double lx = fabs( c.x[2] - 2.0 * c.x[1] + c.x[0] );
+    double ly = fabs( c.y[2] - 2.0 * c.y[1] + c.y[0] );
+    double l;
+    l = fabs( c.x[3] - 2.0 * c.x[2] + c.x[1] ); if( l > lx ) lx = l;
+    l = fabs( c.y[3] - 2.0 * c.y[2] + c.y[1] ); if( l > ly ) ly = l;
+    int depth = SubdivisionDepth( lx > ly ? lx : ly );
+    return depth < MAX_DEPTH ? depth : MAX_DEPTH;
+    }
+
+int IntersectCurves( const BezierCurve &a, const BezierCurve &b,
+		     double *ta, double *tb, int max )
+    {
+    CurvePair work[MAX_WORK];
+    int nwork = 0, found = 0;
+
+    if( max <= 0 || !Interfere( a, b ) )
+	return 0;
+    work[0].a = a;	work[0].b = b;
+    work[0].t0 = 0.0;	work[0].t1 = 1.0;
+    work[0].u0 = 0.0;	work[0].u1 = 1.0;
+    work[0].deptha = CurveDepth( a );
+    work[0].depthb = CurveDepth( b );
+    nwork = 1;
+
+    while( nwork > 0 && found < max )
+	{
+	CurvePair p = work[--nwork];
+	if( p.deptha > 0 || p.depthb > 0 )
+	    {
+	    BezierCurve A[2], B[2];
+	    double T[3], U[3];
+	    int na = 1, nb = 1;
+	    A[0] = p.a;  T[0] = p.t0;  T[1] = p.t1;
+	    B[0] = p.b;  U[0] = p.u0;  U[1] = p.u1;
+	    if( p.deptha > 0 )
+		{
+		SplitCurve( p.a, A[0], A[1] );
+		T[2] = p.t1;  T[1] = ( p.t0 + p.t1 ) * 0.5;
+		p.deptha--;
+		na = 2;
+		}
+	    if( p.depthb > 0 )
+		{
+		SplitCurve( p.b, B[0], B[1] );
+		U[2] = p.u1;  U[1] = ( p.u0 + p.u1 ) * 0.5;
+		p.depthb--;
+		nb = 2;
+		}
+	    // Push in reverse so the pairs come off as A0B0, A1B0, A0B1, A1B1
+	    for( int j = nb - 1; j >= 0; j-- )
+		for( int i = na - 1; i >= 0; i-- )
+		    if( Interfere( A[i], B[j] ) )
+			{
+			CurvePair &q = work[nwork++];
+			q.a = A[i];  q.t0 = T[i];  q.t1 = T[i + 1];
+			q.b = B[j];  q.u0 = U[j];  q.u1 = U[j + 1];
+			q.deptha = p.deptha;
+			q.depthb = p.depthb;
+			}
+	    }
+	else // Both segments are fully subdivided; now do line segments
+	    {
+	    double xlk = p.a.x[3] - p.a.x[0];
+	    double ylk = p.a.y[3] - p.a.y[0];
+	    double xnm = p.b.x[3] - p.b.x[0];
+	    double ynm = p.b.y[3] - p.b.y[0];
+	    double xmk = p.b.x[0] - p.a.x[0];
+	    double ymk = p.b.y[0] - p.a.y[0];
+	    double det = xnm * ylk - ynm * xlk;
+	    if( 1.0 + det == 1.0 )
+		continue;
+	    double detinv = 1.0 / det;
+	    double s = ( xnm * ymk - ynm * xmk ) * detinv;
+	    double t = ( xlk * ymk - ylk * xmk ) * detinv;
+	    if( ( s < 0.0 ) || ( s > 1.0 ) || ( t < 0.0 ) || ( t > 1.0 ) )
+		continue;
+	    ta[found] = p.t0 + s * ( p.t1 - p.t0 );
+	    tb[found] = p.u0 + t * ( p.u1 - p.u0 );
+	    found++;
+	    }
+	}
+
+    // Insertion sort of the pairs by ta; there are only a few
+    for( int i = 1; i < found; i++ )
+	{
+	double t = ta[i], u = tb[i];
+	int j;
+	for( j = i; j > 0 && ta[j - 1] > t; j-- )
+	    {
+	    ta[j] = ta[j - 1];
+	    tb[j] = tb[j - 1];
+	    }
+	ta[j] = t;
+	tb[j] = u;
+	}
+    return found;
+    }
+
+/*
+ * CurveSet: intersect one curve against many.
+ */
+struct BoxKey
+    {
+    double minx;
+    int curve;
+    };
+
+static int compare_keys( const void *a, const void *b )
+    {
+    double A = ((const BoxKey *)a)->minx, B = ((const BoxKey *)b)->minx;
+    return ( A > B ) ? 1 : ( A < B ? -1 : 0 );
+    }
+
+CurveSet::CurveSet( const BezierCurve *c, int count )
+    {
+    BoxKey *key = new BoxKey[count + 1];
+    n = count;
+    curves = new BezierCurve[n + 1];
+    boxes = new CurveBox[n + 1];
+    index = new int[n + 1];
+    maxwidth = 0.0;
+    for( int i = 0; i < n; i++ )
+	{
+	CurveBounds( c[i], boxes[i] );
+	key[i].minx = boxes[i].minx;
+	key[i].curve = i;
+	}
+    qsort( (char *)key, n, sizeof( BoxKey ), compare_keys );
+    for( int i = 0; i < n; i++ )
+	{
+	index[i] = key[i].curve;
+	curves[i] = c[index[i]];
+	CurveBounds( curves[i], boxes[i] );
+	if( boxes[i].maxx - boxes[i].minx > maxwidth )
+	    maxwidth = boxes[i].maxx - boxes[i].minx;
+	}
+    delete [] key;
+    }
+
+CurveSet::~CurveSet( )
+    {
+    delete [] curves;
+    delete [] boxes;
+    delete [] index;
+    }
+
+int CurveSet::Intersect( const BezierCurve &a, CurveHit *hits, int max ) const
+    {
+    CurveBox box;
+    double ta[16], tb[16];
+    int found = 0;
+
+    CurveBounds( a, box );
+    // First box whose left side is within maxwidth of a's left side
+    int lo = 0, hi = n;
+    while( lo < hi )
+	{
+	int mid = ( lo + hi ) / 2;
+	if( boxes[mid].minx < box.minx - maxwidth )
+	    lo = mid + 1;
+	else
+	    hi = mid;
+	}
+    for( int i = lo; i < n && boxes[i].minx <= box.maxx && found < max; i++ )
+	{
+	if( boxes[i].maxx < box.minx || boxes[i].miny > box.maxy
+	    || boxes[i].maxy < box.miny )
+	    continue;
+	int k = IntersectCurves( a, curves[i], ta, tb,
+				 max - found < 16 ? max - found : 16 );
+	for( int j = 0; j < k; j++, found++ )
+	    {
+	    hits[found].curve = index[i];
+	    hits[found].t = ta[j];
+	    hits[found].u = tb[j];
+	    }
+	}
+    return found;
+    }
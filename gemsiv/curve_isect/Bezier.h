@@ -1,5 +1,13 @@
 #ifndef _BEZIER_INCLUDED_
 #include "vector.h"
+
+// A cubic with its control points held by value, for the intersection
+// routines that don't allocate memory (IntersectCurves, CurveSet).
+struct BezierCurve
+    {
+    double x[4], y[4];
+    };
+
 class Bezier {
     public:
     point *p0, *p1, *p2, *p3;
@@ -13,18 +21,89 @@ class Bezier {
 	}
     Bezier * Split( );
     void ParameterSplitLeft( double t, Bezier &result );
+    BezierCurve Curve( ) const;
 
     // Intersect with another curve.  Return two 10-elt arrays. Array 0 
     // contains fragments of self. Array 1 contains fragments of other curve.
     // Fragments continue until one with nil pointers pointing at point data.
     Bezier **Intersect( Bezier B ); 
-    ~Bezier()
+
+    // Copies hold their own references to the points
+    Bezier( const Bezier &b )
+	{
+	p0 = b.p0; p1 = b.p1; p2 = b.p2; p3 = b.p3;
+	Hold( );
+	}
+    Bezier &operator=( const Bezier &b )
 	{
+	Bezier old( *this );	// keeps the old points until b holds them
+	Release( );
+	p0 = b.p0; p1 = b.p1; p2 = b.p2; p3 = b.p3;
+	Hold( );
+	return *this;
+	}
+    void Hold( )
+	{
+	if( p0 == 0 ) return;
+	p0->refcount++; p1->refcount++; p2->refcount++; p3->refcount++;
+	}
+    void Release( )
+	{
+	if( p0 == 0 ) return;
 	if( --p0->refcount <= 0 ) delete p0;
 	if( --p1->refcount <= 0 ) delete p1;
 	if( --p2->refcount <= 0 ) delete p2;
 	if( --p3->refcount <= 0 ) delete p3;
+	p0 = 0; p1 = 0; p2 = 0; p3 = 0;
+	}
+    ~Bezier()
+	{
+	Release( );
 	}
     };
+
+double ** FindIntersections( Bezier a, Bezier b );
+
+// Bezier::ParameterSplitLeft for a curve held by value: split c at t
+void ParameterSplit( const BezierCurve &c, double t,
+		     BezierCurve &left, BezierCurve &right );
+
+// Intersect two curves without allocating memory.  The parameters of up
+// to max intersections are stored in ta (on a) and tb (on b), sorted by
+// ta.  Returns the number of intersections stored.
+int IntersectCurves( const BezierCurve &a, const BezierCurve &b,
+		     double *ta, double *tb, int max );
+
+struct CurveBox
+    {
+    double minx, miny, maxx, maxy;
+    };
+
+// An intersection found by CurveSet::Intersect: parameter t on the
+// curve intersected, u on curve number curve of the set.
+struct CurveHit
+    {
+    int curve;
+    double t, u;
+    };
+
+// A set of curves to intersect single curves against.  The bounding
+// boxes are sorted by their left side once, so a query only looks at the
+// curves whose boxes can overlap its own.
+class CurveSet {
+    int n;
+    BezierCurve *curves;    // sorted by box.minx
+    CurveBox *boxes;
+    int *index;		    // original number of each curve
+    double maxwidth;	    // widest box
+    CurveSet( const CurveSet & );
+    void operator=( const CurveSet & );
+    public:
+    CurveSet( const BezierCurve *c, int count );
+    ~CurveSet( );
+    // Store up to max intersections of a with the curves, return the number
+    int Intersect( const BezierCurve &a, CurveHit *hits, int max ) const;
+    };
+
 #define _BEZIER_INCLUDED_
 #endif
@@ -0,0 +1,698 @@
+#include "Sweep.h"
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+/*
+ * The sweep moves from left to right over the x-monotone pieces of the
+ * curves.  Events are the ends of the pieces and the crossings of pieces
+ * that have been neighbours in the status, which holds the pieces cut by
+ * the sweep line in order of y.  A pair of pieces is intersected (with
+ * IntersectCurves) the first time it becomes neighbours; all its
+ * intersections are reported then, and those still ahead of the sweep
+ * line are queued as crossing events, where the pieces change order.
+ *
+ * At equal x, starts come first, then vertical pieces, then crossings,
+ * then ends.  At each event the pieces through its point are all
+ * intersected with each other, as they need not all be neighbours.
+ * Vertical pieces can't be ordered by y; they are intersected with the
+ * pieces of the status over their range of y instead.
+ */
+
+enum { START, VERTICAL, CROSS, END };
+
+#define MAX_HITS 16	// per pair of pieces; two cubics cross at most 9 times
+
+struct SweepPiece
+    {
+    BezierCurve c;	// with x increasing along the curve
+    double x0, x1;	// c.x[0], c.x[3]
+    double t0, t1;	// parameters on the original curve at the ends
+    int curve;
+    int vertical;
+    int node;		// in the status, or -1
+    int cross;		// last crossing handled with it by Cross(), or -1
+    double crossx;	// and its x
+    double cx, cy;	// last point evaluated by Y()
+    };
+
+struct SweepNode
+    {
+    int piece;
+    int left, right, parent;
+    unsigned prio;
+    };
+
+struct SweepEvent
+    {
+    double x;
+    int kind;
+    int a, b;
+    };
+
+#define NO_PAIR (~0ULL)
+
+static double Bernstein( const double *w, double s )
+    {
+    double r = 1.0 - s;
+    return r * r * r * w[0] + 3.0 * s * r * ( r * w[1] + s * w[2] )
+	   + s * s * s * w[3];
+    }
+
+static double Derivative( const double *w, double s )
+    {
+    double r = 1.0 - s;
+    return 3.0 * ( r * r * ( w[1] - w[0] ) + 2.0 * r * s * ( w[2] - w[1] )
+		   + s * s * ( w[3] - w[2] ) );
+    }
+
+/*
+ * Roots of the derivative of x inside (0,1), in increasing order;
+ * between them the curve is monotone in x.
+ */
+static int MonotoneSplits( const BezierCurve &c, double *s )
+    {
+    double d0 = c.x[1] - c.x[0], d1 = c.x[2] - c.x[1], d2 = c.x[3] - c.x[2];
+    double a = d0 - 2.0 * d1 + d2, b = 2.0 * ( d1 - d0 ), q = d0;
+    double r[2];
+    int n = 0, m = 0;
+    if( fabs( a ) <= 1e-12 * ( fabs( d0 ) + fabs( d1 ) + fabs( d2 ) ) )
+	{
+	if( b != 0.0 )
+	    r[n++] = -q / b;
+	}
+    else
+	{
+	double disc = b * b - 4.0 * a * q;
+	if( disc > 0.0 )
+	    {
+	    // The stable form of the quadratic formula
+	    double h = -0.5 * ( b + ( b < 0.0 ? -sqrt( disc ) : sqrt( disc ) ) );
+	    r[n++] = h / a;
+	    if( h != 0.0 )
+		r[n++] = q / h;
+	    }
+	}
+    if( n == 2 && r[1] < r[0] )
+	{
+	double t = r[0]; r[0] = r[1]; r[1] = t;
+	}
+    for( int i = 0; i < n; i++ )
+	if( r[i] > 1e-9 && r[i] < 1.0 - 1e-9 && ( m == 0 || r[i] > s[m - 1] ) )
+	    s[m++] = r[i];
+    return m;
+    }
+
+/*
+ * Newton's method on P(s) = Q(u), from the parameters found by
+ * subdivision, so that crossing events are at the crossings to nearly
+ * machine precision.  Leaves s and u alone if it does not converge.
+ */
+static void Polish( const BezierCurve &p, const BezierCurve &q,
+		    double &s, double &u )
+    {
+    double s1 = s, u1 = u;
+    for( int i = 0; i < 4; i++ )
+	{
+	double fx = Bernstein( p.x, s1 ) - Bernstein( q.x, u1 );
+	double fy = Bernstein( p.y, s1 ) - Bernstein( q.y, u1 );
+	double pxs = Derivative( p.x, s1 ), pys = Derivative( p.y, s1 );
+	double qxu = Derivative( q.x, u1 ), qyu = Derivative( q.y, u1 );
+	double det = qxu * pys - pxs * qyu;
+	if( det == 0.0 )
+	    return;
+	s1 -= ( qxu * fy - qyu * fx ) / det;
+	u1 -= ( pxs * fy - pys * fx ) / det;
+	}
+    if( s1 < -1e-9 || s1 > 1.0 + 1e-9 || u1 < -1e-9 || u1 > 1.0 + 1e-9
+	|| fabs( s1 - s ) > 1e-3 || fabs( u1 - u ) > 1e-3 )
+	return;
+    s = s1 < 0.0 ? 0.0 : ( s1 > 1.0 ? 1.0 : s1 );
+    u = u1 < 0.0 ? 0.0 : ( u1 > 1.0 ? 1.0 : u1 );
+    }
+
+CurveSweep::CurveSweep( const BezierCurve *c, int count )
+    {
+    double minx = HUGE_VAL, maxx = -HUGE_VAL, miny = HUGE_VAL, maxy = -HUGE_VAL;
+    pieces = new SweepPiece[3 * count + 1];
+    npieces = 0;
+    for( int i = 0; i < count; i++ )
+	{
+	double s[2], t = 0.0;
+	int n = MonotoneSplits( c[i], s );
+	BezierCurve rest = c[i];
+	for( int j = 0; j <= n; j++ )
+	    {
+	    SweepPiece &p = pieces[npieces++];
+	    double t1 = j < n ? s[j] : 1.0;
+	    if( j < n )	// split at t1, reparameterized as in Bezier::Intersect
+		{
+		BezierCurve right;
+		ParameterSplit( rest, ( t1 - t ) / ( 1.0 - t ), p.c, right );
+		rest = right;
+		}
+	    else
+		p.c = rest;
+	    p.t0 = t;
+	    p.t1 = t1;
+	    t = t1;
+	    if( p.c.x[3] < p.c.x[0] )
+		{
+		for( int k = 0; k < 2; k++ )
+		    {
+		    double x = p.c.x[k], y = p.c.y[k];
+		    p.c.x[k] = p.c.x[3 - k];  p.c.y[k] = p.c.y[3 - k];
+		    p.c.x[3 - k] = x;	      p.c.y[3 - k] = y;
+		    }
+		double u = p.t0; p.t0 = p.t1; p.t1 = u;
+		}
+	    p.x0 = p.c.x[0];
+	    p.x1 = p.c.x[3];
+	    p.curve = i;
+	    }
+	for( int k = 0; k < 4; k++ )
+	    {
+	    if( c[i].x[k] < minx ) minx = c[i].x[k];
+	    if( c[i].x[k] > maxx ) maxx = c[i].x[k];
+	    if( c[i].y[k] < miny ) miny = c[i].y[k];
+	    if( c[i].y[k] > maxy ) maxy = c[i].y[k];
+	    }
+	}
+    scale = maxx - minx > maxy - miny ? maxx - minx : maxy - miny;
+    if( !( scale > 0.0 ) )
+	scale = 1.0;
+    tol = 1e-10 * scale;
+    probe = 1e-7 * scale;
+    for( int p = 0; p < npieces; p++ )
+	pieces[p].vertical = pieces[p].x1 - pieces[p].x0 <= tol;
+
+    nodes = new SweepNode[npieces + 1];
+    freenodes = new int[npieces + 1];
+    vertical = new int[npieces + 1];
+    run = new int[npieces + 1];
+    order = new int[npieces + 1];
+    maxheap = 2 * npieces + 16;
+    heap = new SweepEvent[maxheap];
+    for( tablesize = 64; tablesize < 4 * npieces; tablesize *= 2 )
+	;
+    tested = new unsigned long long[tablesize];
+    }
+
+CurveSweep::~CurveSweep( )
+    {
+    delete [] pieces;
+    delete [] nodes;
+    delete [] freenodes;
+    delete [] vertical;
+    delete [] run;
+    delete [] order;
+    delete [] heap;
+    delete [] tested;
+    }
+
+// y of piece p at x
+double CurveSweep::Y( int p, double x )
+    {
+    SweepPiece &c = pieces[p];
+    if( x == c.cx )
+	return c.cy;
+    double s;
+    if( x <= c.x0 )
+	s = 0.0;
+    else if( x >= c.x1 )
+	s = 1.0;
+    else // Newton's method, kept inside a bracket by bisection
+	{
+	double lo = 0.0, hi = 1.0;
+	s = ( x - c.x0 ) / ( c.x1 - c.x0 );
+	for( int i = 0; i < 60; i++ )
+	    {
+	    double f = Bernstein( c.c.x, s ) - x;
+	    if( f == 0.0 )
+		break;
+	    if( f > 0.0 ) hi = s; else lo = s;
+	    double d = Derivative( c.c.x, s );
+	    double n = d > 0.0 ? s - f / d : lo;
+	    if( n <= lo || n >= hi )
+		n = 0.5 * ( lo + hi );
+	    if( fabs( n - s ) <= 1e-15 )
+		{
+		s = n;
+		break;
+		}
+	    s = n;
+	    }
+	}
+    c.cx = x;
+    c.cy = Bernstein( c.c.y, s );
+    return c.cy;
+    }
+
+/*
+ * Is piece p below piece q at x ?  Pieces that meet at x are ordered
+ * as they are just to the right of x; after does that for all pieces.
+ */
+int CurveSweep::Below( int p, int q, double x, int after )
+    {
+    double d;
+    if( !after )
+	{
+	d = Y( q, x ) - Y( p, x );
+	if( d > tol ) return 1;
+	if( d < -tol ) return 0;
+	}
+    double end = pieces[p].x1 < pieces[q].x1 ? pieces[p].x1 : pieces[q].x1;
+    if( end > x )
+	{
+	double xr = end - x < 2.0 * probe ? x + 0.5 * ( end - x ) : x + probe;
+	d = Y( q, xr ) - Y( p, xr );
+	}
+    else
+	d = Y( q, x ) - Y( p, x );
+    if( d != 0.0 )
+	return d > 0.0;
+    return p < q;
+    }
+
+/*
+ * The event queue: a binary heap ordered by x, then kind
+ */
+static int Earlier( const SweepEvent &a, const SweepEvent &b )
+    {
+    return a.x < b.x || ( a.x == b.x && a.kind < b.kind );
+    }
+
+void CurveSweep::Push( double x, int kind, int a, int b )
+    {
+    if( nheap == maxheap )
+	{
+	SweepEvent *h = new SweepEvent[2 * maxheap];
+	for( int i = 0; i < nheap; i++ )
+	    h[i] = heap[i];
+	delete [] heap;
+	heap = h;
+	maxheap *= 2;
+	}
+    SweepEvent e;
+    e.x = x;  e.kind = kind;  e.a = a;	e.b = b;
+    int i = nheap++;
+    while( i > 0 && Earlier( e, heap[( i - 1 ) / 2] ) )
+	{
+	heap[i] = heap[( i - 1 ) / 2];
+	i = ( i - 1 ) / 2;
+	}
+    heap[i] = e;
+    }
+
+void CurveSweep::Pop( SweepEvent &e )
+    {
+    e = heap[0];
+    SweepEvent last = heap[--nheap];
+    int i = 0;
+    for( ;; )
+	{
+	int c = 2 * i + 1;
+	if( c >= nheap )
+	    break;
+	if( c + 1 < nheap && Earlier( heap[c + 1], heap[c] ) )
+	    c++;
+	if( !Earlier( heap[c], last ) )
+	    break;
+	heap[i] = heap[c];
+	i = c;
+	}
+    heap[i] = last;
+    }
+
+/*
+ * Record that pieces p and q have been intersected, in an open
+ * addressed hash table; returns 0 if they had been already.
+ */
+int CurveSweep::MarkTested( int p, int q )
+    {
+    if( p > q )
+	{
+	int t = p; p = q; q = t;
+	}
+    unsigned long long key = (unsigned long long)p << 32 | (unsigned)q;
+    if( 2 * ( ntested + 1 ) > tablesize )
+	{
+	unsigned long long *old = tested;
+	int oldsize = tablesize;
+	tablesize *= 2;
+	tested = new unsigned long long[tablesize];
+	for( int i = 0; i < tablesize; i++ )
+	    tested[i] = NO_PAIR;
+	for( int i = 0; i < oldsize; i++ )
+	    if( old[i] != NO_PAIR )
+		{
+		unsigned long long h = old[i] * 0x9E3779B97F4A7C15ULL;
+		int j = (int)( ( h ^ ( h >> 29 ) ) & ( tablesize - 1 ) );
+		while( tested[j] != NO_PAIR )
+		    j = ( j + 1 ) & ( tablesize - 1 );
+		tested[j] = old[i];
+		}
+	delete [] old;
+	}
+    unsigned long long h = key * 0x9E3779B97F4A7C15ULL;
+    int j = (int)( ( h ^ ( h >> 29 ) ) & ( tablesize - 1 ) );
+    while( tested[j] != NO_PAIR )
+	{
+	if( tested[j] == key )
+	    return 0;
+	j = ( j + 1 ) & ( tablesize - 1 );
+	}
+    tested[j] = key;
+    ntested++;
+    return 1;
+    }
+
+/*
+ * Intersect pieces p and q if they haven't been: report the
+ * intersections, and queue those ahead of the sweep line.  If the two
+ * are already ordered as they are just to the right of the sweep line,
+ * a crossing on it is not queued.
+ */
+void CurveSweep::Test( int p, int q, int ordered )
+    {
+    if( p == q || !MarkTested( p, q ) )
+	return;
+    SweepPiece &P = pieces[p], &Q = pieces[q];
+    double ta[MAX_HITS], tb[MAX_HITS];
+    int k = IntersectCurves( P.c, Q.c, ta, tb, MAX_HITS );
+    for( int i = 0; i < k; i++ )
+	{
+	if( P.curve != Q.curve && found < maxhits )
+	    {
+	    double t = P.t0 + ta[i] * ( P.t1 - P.t0 );
+	    double u = Q.t0 + tb[i] * ( Q.t1 - Q.t0 );
+	    CurveCrossing &h = hits[found++];
+	    if( P.curve < Q.curve )
+		{
+		h.a = P.curve;	h.t = t;
+		h.b = Q.curve;	h.u = u;
+		}
+	    else
+		{
+		h.a = Q.curve;	h.t = u;
+		h.b = P.curve;	h.u = t;
+		}
+	    }
+	if( !P.vertical && !Q.vertical )
+	    {
+	    double s = ta[i], u = tb[i];
+	    Polish( P.c, Q.c, s, u );
+	    double x = Bernstein( P.c.x, s );
+	    if( x >= sweepx && !( ordered && x - sweepx <= tol ) )
+		Push( x, CROSS, p, q );
+	    }
+	}
+    }
+
+/*
+ * The status: a treap of nodes, in order of y at the sweep line
+ */
+int CurveSweep::Next( int k )
+    {
+    if( nodes[k].right >= 0 )
+	{
+	for( k = nodes[k].right; nodes[k].left >= 0; k = nodes[k].left )
+	    ;
+	return k;
+	}
+    while( nodes[k].parent >= 0 && nodes[nodes[k].parent].right == k )
+	k = nodes[k].parent;
+    return nodes[k].parent;
+    }
+
+int CurveSweep::Prev( int k )
+    {
+    if( nodes[k].left >= 0 )
+	{
+	for( k = nodes[k].left; nodes[k].right >= 0; k = nodes[k].right )
+	    ;
+	return k;
+	}
+    while( nodes[k].parent >= 0 && nodes[nodes[k].parent].left == k )
+	k = nodes[k].parent;
+    return nodes[k].parent;
+    }
+
+// Rotate node k above its parent
+void CurveSweep::RotateUp( int k )
+    {
+    int p = nodes[k].parent, g = nodes[p].parent;
+    if( nodes[p].left == k )
+	{
+	nodes[p].left = nodes[k].right;
+	if( nodes[k].right >= 0 )
+	    nodes[nodes[k].right].parent = p;
+	nodes[k].right = p;
+	}
+    else
+	{
+	nodes[p].right = nodes[k].left;
+	if( nodes[k].left >= 0 )
+	    nodes[nodes[k].left].parent = p;
+	nodes[k].left = p;
+	}
+    nodes[p].parent = k;
+    nodes[k].parent = g;
+    if( g < 0 )
+	root = k;
+    else if( nodes[g].left == p )
+	nodes[g].left = k;
+    else
+	nodes[g].right = k;
+    }
+
+int CurveSweep::Insert( int p )
+    {
+    int k = freenodes[--nfree], parent = -1, left = 0;
+    seed ^= seed << 13;  seed ^= seed >> 17;  seed ^= seed << 5;
+    nodes[k].piece = p;
+    nodes[k].left = nodes[k].right = -1;
+    nodes[k].prio = seed;
+    for( int n = root; n >= 0; n = left ? nodes[n].left : nodes[n].right )
+	{
+	parent = n;
+	left = Below( p, nodes[n].piece, sweepx, 0 );
+	}
+    nodes[k].parent = parent;
+    if( parent < 0 )
+	root = k;
+    else if( left )
+	nodes[parent].left = k;
+    else
+	nodes[parent].right = k;
+    while( nodes[k].parent >= 0 && nodes[k].prio < nodes[nodes[k].parent].prio )
+	RotateUp( k );
+    pieces[p].node = k;
+    return k;
+    }
+
+void CurveSweep::Remove( int k )
+    {
+    while( nodes[k].left >= 0 && nodes[k].right >= 0 )
+	{
+	int l = nodes[k].left, r = nodes[k].right;
+	RotateUp( nodes[l].prio < nodes[r].prio ? l : r );
+	}
+    int c = nodes[k].left >= 0 ? nodes[k].left : nodes[k].right;
+    int p = nodes[k].parent;
+    if( c >= 0 )
+	nodes[c].parent = p;
+    if( p < 0 )
+	root = c;
+    else if( nodes[p].left == k )
+	nodes[p].left = c;
+    else
+	nodes[p].right = c;
+    pieces[nodes[k].piece].node = -1;
+    freenodes[nfree++] = k;
+    }
+
+/*
+ * Intersect the piece at node k with its neighbours, and with all
+ * pieces of the status that pass with it through the point (sweepx, y).
+ */
+void CurveSweep::TestAround( int k, double y )
+    {
+    int p = nodes[k].piece, n;
+    if( ( n = Prev( k ) ) >= 0 )
+	Test( nodes[n].piece, p );
+    while( n >= 0 && fabs( Y( nodes[n].piece, sweepx ) - y ) <= tol )
+	{
+	Test( nodes[n].piece, p );
+	n = Prev( n );
+	}
+    if( ( n = Next( k ) ) >= 0 )
+	Test( p, nodes[n].piece );
+    while( n >= 0 && fabs( Y( nodes[n].piece, sweepx ) - y ) <= tol )
+	{
+	Test( p, nodes[n].piece );
+	n = Next( n );
+	}
+    }
+
+/*
+ * Intersect a vertical piece with the pieces of the status over its
+ * range of y, and with the other vertical pieces at this x.
+ */
+void CurveSweep::Vertical( int p )
+    {
+    const BezierCurve &c = pieces[p].c;
+    double lo = c.y[0], hi = c.y[0];
+    for( int i = 1; i < 4; i++ )
+	{
+	if( c.y[i] < lo ) lo = c.y[i];
+	if( c.y[i] > hi ) hi = c.y[i];
+	}
+    int first = -1;
+    for( int n = root; n >= 0; )
+	if( Y( nodes[n].piece, sweepx ) >= lo - tol )
+	    {
+	    first = n;
+	    n = nodes[n].left;
+	    }
+	else
+	    n = nodes[n].right;
+    for( int n = first; n >= 0 && Y( nodes[n].piece, sweepx ) <= hi + tol;
+	 n = Next( n ) )
+	Test( p, nodes[n].piece );
+    for( int i = 0; i < nvertical; i++ )
+	Test( p, vertical[i] );
+    vertical[nvertical++] = p;
+    }
+
+/*
+ * Pieces p and q cross at the sweep line.  All the pieces through the
+ * crossing, those between them and those next to them within tol, are
+ * handled at once: they are put in their order just to the right of
+ * it, and intersected with each other and with the pieces on either
+ * side.  k pieces through one point queue k(k-1)/2 crossing events;
+ * the pieces are stamped with the crossing so that all but the first
+ * of those are dropped here at once.
+ */
+void CurveSweep::Cross( int p, int q )
+    {
+    int a = pieces[p].node, b = pieces[q].node, first = -1, last = -1, n = 0, k;
+    if( a < 0 || b < 0 )
+	return;
+    if( pieces[p].cross >= 0 && pieces[p].cross == pieces[q].cross
+	&& sweepx - pieces[p].crossx <= tol )
+	return;
+    // Walk on from both at once, so that finding which one comes first
+    // costs no more than the run between them
+    for( int ka = a, kb = b; first < 0 && ( ka >= 0 || kb >= 0 ); )
+	{
+	if( ka >= 0 && ( ka = Next( ka ) ) == b )
+	    first = a, last = b;
+	else if( kb >= 0 && ( kb = Next( kb ) ) == a )
+	    first = b, last = a;
+	}
+    if( first < 0 )
+	return;
+    double y = Y( p, sweepx );
+    while( ( k = Prev( first ) ) >= 0 && fabs( Y( nodes[k].piece, sweepx ) - y ) <= tol )
+	first = k;
+    while( ( k = Next( last ) ) >= 0 && fabs( Y( nodes[k].piece, sweepx ) - y ) <= tol )
+	last = k;
+    for( k = first; ; k = Next( k ) )
+	{
+	run[n++] = k;
+	if( k == last )
+	    break;
+	}
+
+    // Pieces through one point come out in reverse order, so reverse
+    // them first and leave insertion sort only the rest to do
+    for( int i = 0; i < n; i++ )
+	{
+	int piece = nodes[run[n - 1 - i]].piece, j;
+	for( j = i; j > 0 && Below( piece, order[j - 1], sweepx, 1 ); j-- )
+	    order[j] = order[j - 1];
+	order[j] = piece;
+	}
+    ncross++;
+    for( int i = 0; i < n; i++ )
+	{
+	nodes[run[i]].piece = order[i];
+	pieces[order[i]].node = run[i];
+	pieces[order[i]].cross = ncross;
+	pieces[order[i]].crossx = sweepx;
+	}
+    for( int i = 0; i < n; i++ )
+	for( int j = i + 1; j < n; j++ )
+	    Test( order[i], order[j], 1 );
+    if( ( k = Prev( first ) ) >= 0 )
+	Test( nodes[k].piece, order[0] );
+    if( ( k = Next( last ) ) >= 0 )
+	Test( order[n - 1], nodes[k].piece );
+    }
+
+int CurveSweep::Intersect( CurveCrossing *h, int max )
+    {
+    SweepEvent e;
+    hits = h;
+    maxhits = max;
+    found = 0;
+    root = -1;
+    nfree = 0;
+    for( int k = npieces - 1; k >= 0; k-- )
+	freenodes[nfree++] = k;
+    for( int i = 0; i < tablesize; i++ )
+	tested[i] = NO_PAIR;
+    ntested = 0;
+    nvertical = 0;
+    ncross = 0;
+    seed = 2463534242u;
+    nheap = 0;
+    for( int p = 0; p < npieces; p++ )
+	{
+	pieces[p].node = -1;
+	pieces[p].cross = -1;
+	pieces[p].cx = HUGE_VAL;
+	if( pieces[p].vertical )
+	    Push( pieces[p].x0, VERTICAL, p, -1 );
+	else
+	    {
+	    Push( pieces[p].x0, START, p, -1 );
+	    Push( pieces[p].x1, END, p, -1 );
+	    }
+	}
+    sweepx = -HUGE_VAL;
+
+    while( nheap > 0 && found < maxhits )
+	{
+	Pop( e );
+	if( e.x != sweepx )
+	    nvertical = 0;
+	sweepx = e.x;
+	switch( e.kind )
+	    {
+	    case START:
+		{
+		int k = Insert( e.a );
+		TestAround( k, pieces[e.a].c.y[0] );
+		}
+		break;
+	    case VERTICAL:
+		Vertical( e.a );
+		break;
+	    case CROSS:
+		Cross( e.a, e.b );
+		break;
+	    case END:
+		{
+		int k = pieces[e.a].node;
+		TestAround( k, pieces[e.a].c.y[3] );
+		int prev = Prev( k ), next = Next( k );
+		Remove( k );
+		if( prev >= 0 && next >= 0 )
+		    Test( nodes[prev].piece, nodes[next].piece );
+		}
+		break;
+	    }
+	}
+    return found;
+    }
@@ -0,0 +1,66 @@
+#ifndef _SWEEP_INCLUDED_
+#include "Bezier.h"
+
+// An intersection found by CurveSweep::Intersect: parameter t on curve
+// number a, u on curve number b, with a < b.
+struct CurveCrossing
+    {
+    int a, b;
+    double t, u;
+    };
+
+struct SweepPiece;
+struct SweepNode;
+struct SweepEvent;
+
+// All intersections among a set of curves, found with a Bentley-Ottmann
+// sweep.  The curves are cut into pieces monotone in x; the pieces cut
+// by the sweep line are kept in a treap ordered by y, and only pieces
+// that become neighbours there are intersected.  That takes time
+// O( ( n + k ) log n ) for n pieces and k intersections, instead of
+// intersecting all n^2 pairs.  Intersections of a curve with itself are
+// not reported.
+class CurveSweep {
+    int npieces;
+    SweepPiece *pieces;
+    SweepNode *nodes;
+    int root;
+    int *freenodes, nfree;
+    SweepEvent *heap;		// event queue, ordered by x
+    int nheap, maxheap;
+    unsigned long long *tested;	// pairs of pieces already intersected
+    int tablesize, ntested;
+    int *vertical, nvertical;	// vertical pieces at the current x
+    int *run, *order;		// pieces through one crossing, for Cross()
+    int ncross;			// crossings handled by Cross()
+    double scale, tol, probe;
+    double sweepx;
+    unsigned seed;
+    CurveCrossing *hits;
+    int found, maxhits;
+
+    CurveSweep( const CurveSweep & );
+    void operator=( const CurveSweep & );
+    double Y( int p, double x );
+    int Below( int p, int q, double x, int after );
+    void Push( double x, int kind, int a, int b );
+    void Pop( SweepEvent &e );
+    int MarkTested( int p, int q );
+    void Test( int p, int q, int ordered = 0 );
+    void TestAround( int k, double y );
+    int Next( int k );
+    int Prev( int k );
+    void RotateUp( int k );
+    int Insert( int p );
+    void Remove( int k );
+    void Vertical( int p );
+    void Cross( int p, int q );
+    public:
+    CurveSweep( const BezierCurve *c, int count );
+    ~CurveSweep( );
+    // Store up to max intersections among the curves, return the number
+    int Intersect( CurveCrossing *hits, int max );
+    };
+
+#define _SWEEP_INCLUDED_
+#endif
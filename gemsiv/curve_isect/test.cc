@@ -1,10 +1,270 @@
 #include "Bezier.h"
+#include "Sweep.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <time.h>
 
 #define H 1200.0
 #define STEPS 3
-int main()
+
+static double Seconds( )
+    {
+    return (double)clock() / CLOCKS_PER_SEC;
+    }
+
+static void RandomCurve( BezierCurve &c, double x, double y, double size )
+    {
+    for( int i = 0; i < 4; i++ )
+	{
+	c.x[i] = x + size * rand() / RAND_MAX;
+	c.y[i] = y + size * rand() / RAND_MAX;
+	}
+    }
+
+static void Point( const BezierCurve &c, double t, double &x, double &y )
+    {
+    double s = 1.0 - t;
+    x = s * s * s * c.x[0] + 3.0 * t * s * ( s * c.x[1] + t * c.x[2] )
+	+ t * t * t * c.x[3];
+    y = s * s * s * c.y[0] + 3.0 * t * s * ( s * c.y[1] + t * c.y[2] )
+	+ t * t * t * c.y[3];
+    }
+
+// A crossing of curves a < b at (x,y)
+struct Crossing
+    {
+    int a, b;
+    double x, y;
+    };
+
+// k straight curves of length size through (x,y), at even angles
+static void Star( BezierCurve *c, int k, double x, double y, double size )
+    {
+    for( int i = 0; i < k; i++ )
+	{
+	double dx = cos( M_PI * ( i + 0.5 ) / k ), dy = sin( M_PI * ( i + 0.5 ) / k );
+	for( int j = 0; j < 4; j++ )
+	    {
+	    c[i].x[j] = x + ( j - 1.5 ) * dx * size / 3;
+	    c[i].y[j] = y + ( j - 1.5 ) * dy * size / 3;
+	    }
+	}
+    }
+
+static int CompareCrossings( const void *p, const void *q )
+    {
+    const Crossing *c = (const Crossing *)p, *d = (const Crossing *)q;
+    if( c->a != d->a ) return c->a < d->a ? -1 : 1;
+    if( c->b != d->b ) return c->b < d->b ? -1 : 1;
+    return c->x < d->x ? -1 : c->x > d->x ? 1 : 0;
+    }
+
+/*
+ * All intersections among n curves: every pair with IntersectCurves,
+ * and with CurveSweep.  Both sets of crossings are sorted by pair and x
+ * and matched up, point by point, to within a millionth of the page.
+ * Returns the number of crossings found by only one of them, plus one
+ * if faster is set and the sweep took longer than all pairs.
+ */
+static long SweepBenchmark( const BezierCurve *c, int n, const char *what,
+			    int faster )
     {
+    double ta[16], tb[16], t;
+    int max = 8 * n + n * n / 2, found1 = 0, found2;
+    CurveCrossing *crossings = new CurveCrossing[max];
+    Crossing *all = new Crossing[max], *swept = new Crossing[max];
+
+    t = Seconds( );
+    for( int i = 0; i < n; i++ )
+	for( int j = i + 1; j < n; j++ )
+	    {
+	    int k = IntersectCurves( c[i], c[j], ta, tb, 16 );
+	    for( int h = 0; h < k && found1 < max; h++, found1++ )
+		{
+		all[found1].a = i;
+		all[found1].b = j;
+		Point( c[i], ta[h], all[found1].x, all[found1].y );
+		}
+	    }
+    double t1 = Seconds( ) - t;
+    t = Seconds( );
+    CurveSweep sweep( c, n );
+    found2 = sweep.Intersect( crossings, max );
+    double t2 = Seconds( ) - t;
+
+    for( int h = 0; h < found2; h++ )
+	{
+	swept[h].a = crossings[h].a;
+	swept[h].b = crossings[h].b;
+	Point( c[crossings[h].a], crossings[h].t, swept[h].x, swept[h].y );
+	}
+    qsort( all, found1, sizeof( Crossing ), CompareCrossings );
+    qsort( swept, found2, sizeof( Crossing ), CompareCrossings );
+    // Crossings of one pair lie in a row in both lists; match each one
+    // of all pairs with the first one of the sweep still unmatched
+    double tol = 1e-6 * H;
+    long missed = 0, extra = 0;
+    char *used = new char[found2 + 1];
+    memset( used, 0, found2 + 1 );
+    for( int i = 0, j0 = 0; i < found1; i++ )
+	{
+	while( j0 < found2 && ( swept[j0].a < all[i].a || ( swept[j0].a == all[i].a
+				&& swept[j0].b < all[i].b ) ) )
+	    j0++;
+	int j;
+	for( j = j0; j < found2 && swept[j].a == all[i].a && swept[j].b == all[i].b; j++ )
+	    if( !used[j] && fabs( swept[j].x - all[i].x ) <= tol
+		&& fabs( swept[j].y - all[i].y ) <= tol )
+		break;
+	if( j < found2 && swept[j].a == all[i].a && swept[j].b == all[i].b )
+	    used[j] = 1;
+	else
+	    missed++;
+	}
+    for( int j = 0; j < found2; j++ )
+	if( !used[j] )
+	    extra++;
+    printf( "%d %s curves: all pairs %10.4f s, sweep %10.4f s, %d / %d found\n",
+	    n, what, t1, t2, found1, found2 );
+    if( missed || extra )
+	printf( "*** sweep missed %ld crossings and found %ld others\n",
+		missed, extra );
+    if( faster && t2 > t1 )
+	{
+	printf( "*** sweep slower than all pairs\n" );
+	extra++;
+	}
+    delete [] used;
+    delete [] all;
+    delete [] swept;
+    delete [] crossings;
+    return missed + extra;
+    }
+
+/*
+ * Throughput of FindIntersections against IntersectCurves on n random
+ * pairs of overlapping curves, of IntersectCurves against CurveSet
+ * for n curves each intersected with n curves scattered over a page,
+ * and of all pairs against the sweep within one set of curves.
+ * Returns the number of crossings on which the sweep and all pairs
+ * disagree.
+ */
+static long Benchmark( int n )
+    {
+    BezierCurve *a = new BezierCurve[n], *b = new BezierCurve[n];
+    double ta[16], tb[16], t;
+    long found0 = 0, found1 = 0, found2 = 0, mismatch = 0;
+    int i, j, k;
+
+    for( i = 0; i < n; i++ )
+	{
+	RandomCurve( a[i], 0.0, 0.0, H );
+	RandomCurve( b[i], 0.0, 0.0, H );
+	}
+
+    // The points never run out of references, so nothing is deleted
+    point **pts = new point *[8 * n];
+    for( i = 0; i < n; i++ )
+	for( k = 0; k < 4; k++ )
+	    {
+	    pts[8 * i + k] = new point( point( a[i].x[k], a[i].y[k] ), 1 << 30 );
+	    pts[8 * i + 4 + k] = new point( point( b[i].x[k], b[i].y[k] ), 1 << 30 );
+	    }
+
+    t = Seconds( );
+    int *count = new int[n];
+    for( i = 0; i < n; i++ )
+	{
+	point **p = pts + 8 * i;
+	double **r = FindIntersections( Bezier( p[0], p[1], p[2], p[3] ),
+					Bezier( p[4], p[5], p[6], p[7] ) );
+	for( count[i] = 0; count[i] < 9 && r[0][count[i]] > -0.5; count[i]++ )
+	    ;
+	found0 += count[i];
+	delete [] r[0];
+	delete [] r[1];
+	delete [] r;
+	}
+    double t0 = Seconds( ) - t;
+
+    t = Seconds( );
+    for( i = 0; i < n; i++ )
+	{
+	k = IntersectCurves( a[i], b[i], ta, tb, 16 );
+	found1 += k;
+	if( k != count[i] )
+	    mismatch++;
+	}
+    double t1 = Seconds( ) - t;
+    printf( "%d pairs: FindIntersections %10.0f pairs/s, %ld found\n",
+	    n, n / t0, found0 );
+    printf( "%d pairs: IntersectCurves   %10.0f pairs/s, %ld found, %ld differ\n",
+	    n, n / t1, found1, mismatch );
+
+    // One against many: small curves scattered over a large page
+    for( i = 0; i < n; i++ )
+	{
+	RandomCurve( a[i], 20 * H * rand() / RAND_MAX, 20 * H * rand() / RAND_MAX, H / 4 );
+	RandomCurve( b[i], 20 * H * rand() / RAND_MAX, 20 * H * rand() / RAND_MAX, H / 4 );
+	}
+    CurveHit *hits = new CurveHit[256];
+    found1 = 0;
+    t = Seconds( );
+    for( i = 0; i < n; i++ )
+	for( j = 0; j < n; j++ )
+	    found1 += IntersectCurves( a[i], b[j], ta, tb, 16 );
+    t1 = Seconds( ) - t;
+    t = Seconds( );
+    CurveSet set( b, n );
+    for( i = 0; i < n; i++ )
+	found2 += set.Intersect( a[i], hits, 256 );
+    double t2 = Seconds( ) - t;
+    printf( "%d x %d curves: all pairs %10.4f s, CurveSet %10.4f s, %ld / %ld found\n",
+	    n, n, t1, t2, found1, found2 );
+    long failures = SweepBenchmark( b, n, "scattered", 0 );
+
+    // Many intersections: curves all over the same square
+    for( i = 0; i < n / 10; i++ )
+	RandomCurve( a[i], 0.0, 0.0, H );
+    failures += SweepBenchmark( a, n / 10, "crowded", 0 );
+
+    // Many pieces through one crossing: straight lines through the centre
+    int star = n / 20 < 64 ? 64 : n / 20;
+    if( star > n )
+	star = n;
+    Star( a, star, H / 2, H / 2, H );
+    failures += SweepBenchmark( a, star, "star", 0 );
+
+    // Many such crossings, scattered over a large page: the sweep has to
+    // handle each as one event to stay ahead of all pairs
+    for( i = 0; i + 16 <= n; i += 16 )
+	Star( a + i, 16, 20 * H * rand() / RAND_MAX, 20 * H * rand() / RAND_MAX,
+	      H / 4 );
+    failures += SweepBenchmark( a, i, "star crossing", 1 );
+
+    for( i = 0; i < 8 * n; i++ )
+	delete pts[i];
+    delete [] pts;
+    delete [] count;
+    delete [] hits;
+    delete [] a;
+    delete [] b;
+    return failures;
+    }
+
+/*
+ * Without arguments prints the Postscript of testout.ps,
+ * with "bench [n]" runs the benchmark above.
+ */
+int main( int argc, char **argv )
+    {
+    if( argc > 1 && strcmp( argv[1], "bench" ) == 0 )
+	{
+	return Benchmark( argc > 2 ? atoi( argv[2] ) : 2000 ) != 0;
+	}
     point Origin = point( 0, 0 );
     point p0 = Origin;
     point p1 = Origin + vector( H, H/2 );
@@ -19,6 +279,8 @@ int main()
     int rg = 0;
     Bezier A = Bezier( &p0, &p1, &p2, &p3 );
     Bezier B = Bezier( &q0, &q1, &q2, &q3 );
+    A.Hold( );		// the points are on the stack; never delete them
+    B.Hold( );
     printf( "%g %g scale\n", 72 * 8.0 / H , 72 * 10.0/H );
     printf( "%g %g translate\n", H*0.1, H*0.1 );
     printf( "/rad 5 def\n" );
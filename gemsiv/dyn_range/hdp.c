@@ -6,6 +6,12 @@
 #include <stdlib.h>
 #include "hdp.h"
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 /*
 ** Encoding and Decoding Look-Up Tables
 */
@@ -13,6 +19,31 @@ byte *EncodeLut;
 real *DecodeLut;
 real  LutScale;
 
+/*
+** Filling of an Encoding Look-Up Table of NbVal entries : returns the
+** scaling factor and (if Bias is not NULL) the bias factor
+*/
+static real build_encode_lut (byte *Lut, real LoVal, real HiVal, int NbVal,
+                              real *Bias)
+{
+    real t, r;
+    int	 n;
+
+  NbVal--;
+
+/* Bias factor = ratio between the outcoming and the incoming range */
+  r = 256.f * LoVal / HiVal;
+  if (Bias) *Bias = r;
+
+  for (n = 0; n <= NbVal; n++) {
+      t = (float) n / NbVal;
+      Lut[n] = (byte)(255.f * t / (t-r*t+r) + 0.5f);
+  }
+
+/* Scaling factor = ratio between the encoding LUT and the incoming range */
+  return NbVal / HiVal;
+}
+
 /*
 ** Construction of the Encoding Look-Up Table
 **
@@ -26,24 +57,10 @@ real  LutScale;
 */
 int init_HDP_encode (real LoVal, real HiVal, int NbVal)
 {
-    real t, r;
-    int	 n;
-
   EncodeLut = (byte *) malloc (NbVal * sizeof (byte));
   if (! EncodeLut) return 0;
 
-  NbVal--;
-
-/* Scaling factor = ratio between the encoding LUT and the incoming range */
-  LutScale = NbVal / HiVal;
-
-/* Bias factor = ratio between the outcoming and the incoming range */
-  r = 256.f * LoVal / HiVal;
-
-  for (n = 0; n <= NbVal; n++) {
-      t = (float) n / NbVal;
-      EncodeLut[n] = (byte)(255.f * t / (t-r*t+r) + 0.5f);
-  }
+  LutScale = build_encode_lut (EncodeLut, LoVal, HiVal, NbVal, NULL);
   return (! NULL);
 }
 
@@ -55,6 +72,26 @@ void exit_HDP_encode (void)
   free (EncodeLut);
 }
 
+/*
+** Filling of a Decoding Look-Up Table of 256 entries
+*/
+static void build_decode_lut (real *Lut, real LoVal, real HiVal, real Bright)
+{
+    float t, r;
+    int n;
+
+/* Change Bright from (-1,1) into a scaling coefficient (0,infinity) */
+  Bright = Bright < 0.f ? Bright+1.f : 1.f / (1.f-Bright);
+
+/* Bias factor = ratio of incoming and outcoming range * brightness factor */
+  r = Bright * HiVal / LoVal / 256.f;
+
+  for (n = 0; n < 256; n++) {
+    t = (float) n / 255.f;
+    Lut[n] = t / (t-t*r+r) * HiVal;
+  }
+}
+
 /*
 ** Construction of the Decoding Look-Up Table
 **
@@ -69,22 +106,10 @@ void exit_HDP_encode (void)
 */
 int init_HDP_decode (real LoVal, real HiVal, real Bright)
 {
-    float t, r;
-    int n;
-
   DecodeLut = (real *) malloc (256 * sizeof (real));
   if (! DecodeLut) return 0;
 
-/* Change Bright from (-1,1) into a scaling coefficient (0,infinity) */
-  Bright = Bright < 0.f ? Bright+1.f : 1.f / (1.f-Bright);
-
-/* Bias factor = ratio of incoming and outcoming range * brightness factor */
-  r = Bright * HiVal / LoVal / 256.f;
-
-  for (n = 0; n <= 256; n++) {
-    t = (float) n / 255.f;
-    DecodeLut[n] = t / (t-t*r+r) * HiVal;
-  }
+  build_decode_lut (DecodeLut, LoVal, HiVal, Bright);
   return (! NULL);
 }
 
@@ -95,3 +120,139 @@ void exit_HDP_decode (void)
 {
   free (DecodeLut);
 }
+
+/*
+** Construction of an Encoding and Decoding Context
+**
+** Input :
+**    Codec  = Context to fill in
+**    LoVal, HiVal, NbVal = As for init_HDP_encode
+**    Bright = As for init_HDP_decode
+**
+** Output :
+**    The function returns 0 if the allocation failed
+**
+** A context is only read once built, so any number of them can be
+** used at the same time, each from any number of threads.
+*/
+int init_HDP_codec (HDP_codec *Codec, real LoVal, real HiVal, int NbVal,
+                    real Bright)
+{
+  Codec->EncodeLut = (byte *) malloc (NbVal * sizeof (byte));
+  if (! Codec->EncodeLut) return 0;
+
+  Codec->NbVal = NbVal;
+  Codec->LutScale = build_encode_lut (Codec->EncodeLut, LoVal, HiVal, NbVal,
+                                      &Codec->Bias);
+  build_decode_lut (Codec->DecodeLut, LoVal, HiVal, Bright);
+  return (! NULL);
+}
+
+/*
+** Destruction of an Encoding and Decoding Context
+*/
+void exit_HDP_codec (HDP_codec *Codec)
+{
+  free (Codec->EncodeLut);
+  Codec->EncodeLut = NULL;
+}
+
+/*
+** Encoding of a whole buffer of colors
+**
+** Input :
+**    Codec = Context
+**    Real  = Colors to encode
+**    Byte  = Encoded colors
+**    Count = Number of colors
+**
+** Unlike HDP_ENCODE, values out of the incoming range are clamped to
+** it. With SSE2 (and real = float), 16 values are encoded at a time
+** by evaluating the expression of the encoding LUT on their LUT
+** index in registers, which gives the very same bytes as the LUT.
+*/
+void HDP_encode_buffer (const HDP_codec *Codec, const realcolor *Real,
+                        bytecolor *Byte, int Count)
+{
+    const real *in = (const real *) Real;
+    byte *out = (byte *) Byte;
+    long n, Total = 3L * Count;
+    real v, Top = Codec->NbVal - 1 + 0.5f;
+
+  n = 0;
+#ifdef __SSE2__
+  if (sizeof (real) == sizeof (float)) {
+      __m128 scale = _mm_set1_ps (Codec->LutScale);
+      __m128 half  = _mm_set1_ps (0.5f);
+      __m128 top   = _mm_set1_ps (Top);
+      __m128 nbval = _mm_set1_ps ((float) (Codec->NbVal - 1));
+      __m128 r     = _mm_set1_ps (Codec->Bias);
+      __m128 c255  = _mm_set1_ps (255.f);
+      __m128 zero  = _mm_setzero_ps ();
+      __m128 t;
+      __m128i q[4];
+      int k;
+
+    for (; n + 16 <= Total; n += 16) {
+      for (k = 0; k < 4; k++) {
+        t = _mm_add_ps (_mm_mul_ps (_mm_loadu_ps ((const float *) in + n + 4*k),
+                                    scale), half);
+        t = _mm_min_ps (_mm_max_ps (t, zero), top);
+        t = _mm_div_ps (_mm_cvtepi32_ps (_mm_cvttps_epi32 (t)), nbval);
+        t = _mm_add_ps (_mm_div_ps (_mm_mul_ps (c255, t),
+                          _mm_add_ps (_mm_sub_ps (t, _mm_mul_ps (r, t)), r)),
+                        half);
+        q[k] = _mm_cvttps_epi32 (t);
+      }
+      _mm_storeu_si128 ((__m128i *) (out + n),
+                        _mm_packus_epi16 (_mm_packs_epi32 (q[0], q[1]),
+                                          _mm_packs_epi32 (q[2], q[3])));
+    }
+  }
+#endif
+  for (; n < Total; n++) {
+    v = in[n] * Codec->LutScale + 0.5f;
+    if (! (v > 0.f)) v = 0.f;
+    if (v > Top) v = Top;
+    out[n] = Codec->EncodeLut [(int) v];
+  }
+}
+
+/*
+** Decoding of a whole buffer of colors
+**
+** Input :
+**    Codec = Context
+**    Byte  = Colors to decode
+**    Real  = Decoded colors
+**    Count = Number of colors
+**
+** With AVX2 (and real = float), 8 values are looked up at a time by
+** a gather from the decoding LUT.
+*/
+void HDP_decode_buffer (const HDP_codec *Codec, const bytecolor *Byte,
+                        realcolor *Real, int Count)
+{
+    const byte *in = (const byte *) Byte;
+    const real *Lut = Codec->DecodeLut;
+    real *out = (real *) Real;
+    long n, Total = 3L * Count;
+
+  n = 0;
+#ifdef __AVX2__
+  if (sizeof (real) == sizeof (float))
+    for (; n + 8 <= Total; n += 8)
+      _mm256_storeu_ps ((float *) out + n,
+        _mm256_i32gather_ps ((const float *) Lut,
+          _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *) (in + n))),
+          4));
+#endif
+  for (; n + 4 <= Total; n += 4) {
+    out[n]   = Lut [in[n]];
+    out[n+1] = Lut [in[n+1]];
+    out[n+2] = Lut [in[n+2]];
+    out[n+3] = Lut [in[n+3]];
+  }
+  for (; n < Total; n++)
+    out[n] = Lut [in[n]];
+}
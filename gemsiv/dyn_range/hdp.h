@@ -18,6 +18,18 @@ extern byte *EncodeLut;
 extern real *DecodeLut;
 extern real  LutScale;
 
+/*
+** Encoding and Decoding Context : the same tables, for codecs that
+** are used side by side (or by several threads at once)
+*/
+typedef struct {
+  byte *EncodeLut;      /* NbVal entries */
+  int   NbVal;          /* Number of elements in the encoding LUT */
+  real  LutScale;       /* Ratio between the encoding LUT and the range */
+  real  Bias;           /* Bias factor of the encoding curve */
+  real  DecodeLut[256];
+} HDP_codec;
+
 /*
 ** Encoding and Decoding Functions
 */
@@ -26,6 +38,11 @@ extern int init_HDP_decode (real,real,real);
 extern void exit_HDP_encode (void);
 extern void exit_HDP_decode (void);
 
+extern int init_HDP_codec (HDP_codec *,real,real,int,real);
+extern void exit_HDP_codec (HDP_codec *);
+extern void HDP_encode_buffer (const HDP_codec *,const realcolor *,bytecolor *,int);
+extern void HDP_decode_buffer (const HDP_codec *,const bytecolor *,realcolor *,int);
+
 /*
 ** Encoding and Decoding Macros
 */
@@ -38,3 +55,13 @@ extern void exit_HDP_decode (void);
    RealColor[0] = DecodeLut [ByteColor[0]], \
    RealColor[1] = DecodeLut [ByteColor[1]], \
    RealColor[2] = DecodeLut [ByteColor[2]])
+
+#define HDP_CODEC_ENCODE(Codec,RealColor,ByteColor) ( \
+   ByteColor[0] = (Codec)->EncodeLut [(int) (RealColor[0] * (Codec)->LutScale + 0.5)], \
+   ByteColor[1] = (Codec)->EncodeLut [(int) (RealColor[1] * (Codec)->LutScale + 0.5)], \
+   ByteColor[2] = (Codec)->EncodeLut [(int) (RealColor[2] * (Codec)->LutScale + 0.5)])
+
+#define HDP_CODEC_DECODE(Codec,ByteColor,RealColor) ( \
+   RealColor[0] = (Codec)->DecodeLut [ByteColor[0]], \
+   RealColor[1] = (Codec)->DecodeLut [ByteColor[1]], \
+   RealColor[2] = (Codec)->DecodeLut [ByteColor[2]])
@@ -1,18 +1,180 @@
 /*
 ** TEST_HDP.C : Simple testing program for the HDP routines
+**
+** With -b [colors [threads]], measures the throughput of the buffer
+** routines instead (see Bench below)
 */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "hdp.h"
 
-int main (void)
+static double Seconds (void)
+{
+#ifdef _OPENMP
+  return omp_get_wtime ();
+#else
+  return (double) clock () / CLOCKS_PER_SEC;
+#endif
+}
+
+static void Report (char *Name, double Time, long Count)
+{
+  printf ("  %-24s %8.1f Mcolors/s %8.1f MB/s\n", Name,
+          Count / Time / 1e6, Count * sizeof (realcolor) / Time / 1e6);
+}
+
+/*
+** The buffer routines with the buffer split among threads that share
+** one context
+*/
+#define CHUNK 65536
+
+static void EncodeThreads (HDP_codec *Codec, realcolor *Real, bytecolor *Byte,
+                           long Count, int NbThread)
+{
+    long Index;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(NbThread)
+#endif
+  for (Index = 0; Index < Count; Index += CHUNK)
+    HDP_encode_buffer (Codec, Real + Index, Byte + Index,
+                       Count - Index < CHUNK ? Count - Index : CHUNK);
+}
+
+static void DecodeThreads (HDP_codec *Codec, bytecolor *Byte, realcolor *Real,
+                           long Count, int NbThread)
+{
+    long Index;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(NbThread)
+#endif
+  for (Index = 0; Index < Count; Index += CHUNK)
+    HDP_decode_buffer (Codec, Byte + Index, Real + Index,
+                       Count - Index < CHUNK ? Count - Index : CHUNK);
+}
+
+/* Best time of 3 runs of Stmt */
+#define TIME(Name,Stmt) { \
+    double Best = 1e30; \
+    int Rep; \
+  for (Rep = 0; Rep < 3; Rep++) { \
+    Time = Seconds (); \
+    Stmt; \
+    Time = Seconds () - Time; \
+    if (Time < Best) Best = Time; \
+  } \
+  Report (Name, Best, Count); }
+
+/*
+** Throughput of the encoding and decoding routines on Count colors
+** spread over the incoming range : the macros on the global tables,
+** the buffer routines on one thread, and the buffer routines on
+** NbThread threads (all there are if 0). Two contexts (dynamic
+** ranges of 4000 and 10^6) are alive at once, and the results of the
+** buffer routines, on one thread and on NbThread, are checked against
+** the macros. Returns the number of checks that fail.
+*/
+static long Bench (long Count, int NbThread)
+{
+    HDP_codec Codec[2];
+    static real Range[2][2] = { { 0.25, 1000.0 }, { 0.001, 1000.0 } };
+    realcolor *Real, *Back, *Back2;
+    bytecolor *Byte, *Byte2;
+    long Index, Bad, Fail = 0;
+    double Time;
+    int  Nb, Tst;
+
+  Real  = (realcolor *) malloc (Count * sizeof (realcolor));
+  Back  = (realcolor *) malloc (Count * sizeof (realcolor));
+  Back2 = (realcolor *) malloc (Count * sizeof (realcolor));
+  Byte  = (bytecolor *) malloc (Count * sizeof (bytecolor));
+  Byte2 = (bytecolor *) malloc (Count * sizeof (bytecolor));
+  if (! Real || ! Back || ! Back2 || ! Byte || ! Byte2) {
+    printf ("Not enough memory\n");
+    return 1;
+  }
+  memset (Back, 0, Count * sizeof (realcolor));
+  memset (Byte, 0, Count * sizeof (bytecolor));
+  memset (Byte2, 0, Count * sizeof (bytecolor));
+  srand (1);
+  for (Index = 0; Index < Count; Index++) {
+    Real[Index][0] = Range[0][1] * rand () / RAND_MAX;
+    Real[Index][1] = Range[0][1] * rand () / RAND_MAX * rand () / RAND_MAX;
+    Real[Index][2] = Range[0][1] * rand () / RAND_MAX / (1 + rand () % 100);
+  }
+  for (Tst = 0; Tst < 2; Tst++)
+    init_HDP_codec (&Codec[Tst], Range[Tst][0], Range[Tst][1], 8192, 0.0);
+#ifdef _OPENMP
+  Nb = NbThread > 0 ? NbThread : omp_get_max_threads ();
+#else
+  Nb = 1;
+#endif
+
+  for (Tst = 0; Tst < 2; Tst++) {
+    printf ("%ld colors, dynamic range %g, %d threads\n", Count,
+            Range[Tst][1] / Range[Tst][0], Nb);
+    init_HDP_encode (Range[Tst][0], Range[Tst][1], 8192);
+    init_HDP_decode (Range[Tst][0], Range[Tst][1], 0.0);
+
+    TIME ("HDP_ENCODE",
+          for (Index = 0; Index < Count; Index++)
+            HDP_ENCODE (Real[Index], Byte[Index]));
+    TIME ("HDP_encode_buffer",
+          HDP_encode_buffer (&Codec[Tst], Real, Byte2, Count));
+    Bad = memcmp (Byte, Byte2, Count * sizeof (bytecolor)) != 0;
+    memset (Byte2, 0xff, Count * sizeof (bytecolor));
+    TIME ("  threads", EncodeThreads (&Codec[Tst], Real, Byte2, Count, Nb));
+    Bad += memcmp (Byte, Byte2, Count * sizeof (bytecolor)) != 0;
+
+    TIME ("HDP_DECODE",
+          for (Index = 0; Index < Count; Index++)
+            HDP_DECODE (Byte[Index], Back[Index]));
+    TIME ("HDP_decode_buffer",
+          HDP_decode_buffer (&Codec[Tst], Byte, Back2, Count));
+    Bad += memcmp (Back, Back2, Count * sizeof (realcolor)) != 0;
+    memset (Back2, 0xff, Count * sizeof (realcolor));
+    TIME ("  threads", DecodeThreads (&Codec[Tst], Byte, Back2, Count, Nb));
+    Bad += memcmp (Back, Back2, Count * sizeof (realcolor)) != 0;
+    if (Bad)
+      printf ("  the buffer routines and the macros differ\n");
+    Fail += Bad;
+
+    exit_HDP_encode ();
+    exit_HDP_decode ();
+  }
+
+  for (Tst = 0; Tst < 2; Tst++)
+    exit_HDP_codec (&Codec[Tst]);
+  free (Byte2);
+  free (Byte);
+  free (Back2);
+  free (Back);
+  free (Real);
+  return Fail;
+}
+
+int main (int argc, char **argv)
 {
     realcolor RealColor;
     bytecolor ByteColor;
     real LoVal, HiVal, Bright;
     int  Index, NbTst, NbVal;
 
+  if (argc > 1 && ! strcmp (argv[1], "-b")) {
+    return Bench (argc > 2 ? atol (argv[2]) : 4000000L,
+                  argc > 3 ? atoi (argv[3]) : 0) != 0;
+  }
+
 /* Dynamic range of 4000 (try also larger or smaller values) */
   LoVal = 0.25;
   HiVal = 1000.0;
@@ -0,0 +1,75 @@
+/***************************************************************************
+**    TEST FILE FOR graph (Dynamic Layout Alg)
+**
+**    HEADER   - BINARY GRAPH FILES
+**
+**    A binary graph file is a header, the node table and the relation
+**    arrays, in the byte order of the machine that wrote it:
+**
+**	BinHeader			  24 bytes
+**	BinNode	  node[nfix + nmov]	  32 bytes each, fixed nodes first
+**	double	  intensity[nrel]
+**	int	  from[nrel], to[nrel]	  indices into node[]
+**
+**    Every part is aligned to its type, so the file can be mapped into
+**    memory and used in place.	 The node order is the order of the
+**    Graph list and of FastLayout, each relation is stored once and
+**    relation names are not stored.
+*****************************************************************************/
+#include "graph.hxx"
+
+#define BINGRAPH_MAGIC		"GRAPHBIN"
+#define BINGRAPH_VERSION	1
+
+struct BinHeader {
+    char	   magic[8];	     // BINGRAPH_MAGIC
+    int		   version;	     // BINGRAPH_VERSION, checks byte order
+    int		   nfix;	     // number of fix nodes
+    int		   nmov;	     // number of movable nodes
+    int		   nrel;	     // number of relations
+};
+
+struct BinNode {
+    double	   x, y;	     // position
+    char	   name[MAXNAME + 1];
+    TYPE	   type;	     // FIXED_NODE or MOVEABLE_NODE
+    char	   pad[4];
+};
+
+/************************************************************************/
+class BinGraph {
+/************************************************************************/
+    char *	   base;	     // file image
+    long	   length;	     // size of the file image
+    BOOL	   mapped;	     // base is mapped, not read
+    BinNode *	   node;	     // node table
+    double *	   intensity;	     // relation arrays
+    int *	   from, * to;
+    int		   nfix, nnode, nrel;
+    int *	   nametab;	     // hash table of node indices, -1 = empty
+    int		   namesize;	     // size of nametab (power of 2)
+
+    BOOL	 Check( void );	  // validate image, build nametab
+    static BOOL	 WriteHeader( FILE *, int nf, int nm, int nr );
+
+		 BinGraph( const BinGraph& );
+    void	 operator=( const BinGraph& );
+public:
+		 BinGraph( void );
+		 ~BinGraph( void );
+
+    BOOL	 Open( cpchar );	  // map binary graph file
+    void	 Close( void );
+    static BOOL	 IsBinGraph( cpchar );	  // has the file the magic ?
+
+    int		 Nodes( void )		  { return nnode;	       }
+    int		 FixNodes( void )	  { return nfix;	       }
+    int		 Relations( void )	  { return nrel;	       }
+    BinNode&	 GetNode( int i )	  { return node[i];	       }
+    int		 SearchNode( cpchar );	  // node index by name or -1
+
+    FastLayout * NewLayout( void );	  // layout of the graph, delete it
+    BOOL	 Save( cpchar, FastLayout * = NULL );	  // binary file
+    BOOL	 SaveNodes( cpchar, FastLayout * = NULL ); // text file
+    static BOOL	 Convert( Graph&, cpchar ); // text graph -> binary file
+};
@@ -16,6 +16,8 @@
 
 typedef char TYPE;
 
+unsigned NameHash( cpchar );	    // hash of node names
+
 /************************************************************************/
 class Node {
 /************************************************************************/
@@ -90,6 +92,10 @@ class Graph {
     NodeElem *	   last_node;	     // end of list
     RelationElem * currelation;	     // relation of nodes list
     RelationElem * prevrelation;     // previous to currelation
+    NodeElem **	   nametab;	     // hash table of node names
+    int		   namesize;	     // size of nametab (power of 2)
+
+    void	 HashNode( NodeElem * );  // enter node into nametab
 
     void	 SwapRelation( void );	  // swap currnode and relatenode
 					  // if currnode is further in the
@@ -124,6 +130,74 @@ public:
 
 };
 
+/************************************************************************/
+/*    FAST LAYOUT - DynamicLayout FOR LARGE GRAPHS			*/
+/*									*/
+/*    The same mechanical system as Graph :: DynamicLayout, with the	*/
+/*    nodes in arrays (fixed nodes first, then moveable nodes in	*/
+/*    serial number order) and the relations in compressed rows.	*/
+/*    The pairwise drives are split into an exact linear part, the	*/
+/*    relation corrections, and a sum of unit vectors that a quadtree	*/
+/*    (Barnes-Hut) approximates for far away groups of nodes.		*/
+/************************************************************************/
+struct QuadCell {
+    double	   cx, cy;	     // center of gravity of the nodes
+    double	   x0, y0, size;     // square covered by the cell
+    int		   count;	     // number of nodes in the cell
+    int		   child;	     // first of 4 children or -1 for leaf
+    int		   first;	     // leaf: first node index in order
+};
+
+/************************************************************************/
+class FastLayout {
+/************************************************************************/
+    int		   nfix;	     // number of fix nodes
+    int		   nnode;	     // number of all nodes
+    double *	   px, * py;	     // positions
+    double *	   vx, * vy;	     // speeds
+    double *	   fx, * fy;	     // driving forces
+    int *	   relstart;	     // relations of node i are at
+    int *	   relto;	     //	  relstart[i] .. relstart[i+1]-1
+    double *	   relint;	     // relation intensities
+    NodeElem **	   source;	     // graph nodes or NULL
+    double	   theta;	     // opening parameter, 0 = exact
+    int		   nthreads;	     // 0 = OpenMP default
+    long	   steps;	     // time steps of last DynamicLayout
+
+    QuadCell *	   cell;	     // quadtree
+    int		   ncell, maxcell;
+    int *	   order;	     // node indices sorted into leaves
+    int *	   scratch;
+
+    void	 Alloc( int nf, int nm, int nrel );
+    void	 BuildRelations( int nrel, const int *, const int *, const double * );
+    int		 NewCells( int );
+    void	 BuildTree( int c, int begin, int end, int depth );
+    void	 Drive( int i, int nactive, double sumx, double sumy );
+    double	 Step( int nactive, double friction, double iinertia );
+
+		 FastLayout( const FastLayout& );
+    void	 operator=( const FastLayout& );
+public:
+		 FastLayout( Graph& );
+		 FastLayout( int nf, int nm, const double * pos,
+			     int nrel, const int * from, const int * to,
+			     const double * intensity );
+		 ~FastLayout( void );
+
+    void	 SetTheta( double t )	  { theta = t;		       }
+    void	 SetThreads( int n )	  { nthreads = n;	       }
+    int		 DynamicLayout( int maxsernum = ALL_NODES, long maxsteps = 0 );
+    void	 Store( void );		  // positions back to graph nodes
+
+    int		 Nodes( void )		  { return nnode;	       }
+    int		 FixNodes( void )	  { return nfix;	       }
+    long	 Steps( void )		  { return steps;	       }
+    double	 X( int i )		  { return px[i];	       }
+    double	 Y( int i )		  { return py[i];	       }
+    void	 SetPos( int i, double x, double y ) { px[i] = x; py[i] = y; }
+};
+
 /************************************************************************/
 class ObjectSpace : public Graph {
 /************************************************************************/
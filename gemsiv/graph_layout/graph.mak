@@ -17,7 +17,7 @@ INCLUDEPATH = C:\BORLANDC\INCLUDE
 
 #		*List Macros*
 
-OBJS = fileio.obj layout.obj graph.obj mswindow.obj vector.obj
+OBJS = fileio.obj layout.obj graph.obj graphwin.obj mswindow.obj vector.obj
 
 #		*Explicit Rules*
 graph: $(OBJS)
@@ -26,6 +26,7 @@ c0ws.obj+
 fileio.obj+
 layout.obj+
 graph.obj+
+graphwin.obj+
 mswindow.obj+
 vector.obj
 graph
@@ -45,6 +46,8 @@ fileio.obj: fileio.cpp mswindow.hxx vector.hxx defines.h graph.hxx fileio.hxx
 
 graph.obj: graph.cpp mswindow.hxx vector.hxx defines.h graph.hxx
 
+graphwin.obj: graphwin.cpp mswindow.hxx vector.hxx defines.h graph.hxx
+
 layout.obj: layout.cpp mswindow.hxx vector.hxx defines.h graph.hxx 
 
 vector.obj: vector.cpp vector.hxx 
@@ -72,3 +72,240 @@ MultiJitter(Point2 p[], int m, int n) {
 	}
     }
 }
+
+
+/*
+ * Multi-jittered patterns in bulk.
+ *
+ * A renderer wants a different pattern for every pixel of every frame.
+ * Building each one with MultiJitter() costs 4mn calls to random(), and
+ * random() is a single shared stream, so patterns can be neither
+ * reproduced nor built from several threads.  Here the random numbers
+ * come from a counter-based generator instead: the k-th number of the
+ * stream for a given key is a hash of the two, so a pattern is a pure
+ * function of its key.  Patterns are stored as float pairs, m*n of
+ * them back to back per pattern.
+ *
+ * MJPoolCreate() keeps npatterns patterns in one block, built up front
+ * or on first use, and MJPoolGet() picks one for a pixel and frame by
+ * hashing the coordinates.  MJTile() instead builds a fresh pattern for
+ * every pixel of a tile, running rows of the tile in parallel.
+ */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+typedef struct {
+    float x, y;
+} Point2f;
+
+typedef struct MJPool {
+    int m, n;			/* cells per pattern, as in MultiJitter() */
+    int npatterns;
+    unsigned int seed;
+    Point2f *samples;		/* npatterns*m*n samples */
+    unsigned char *built;	/* per pattern: built yet? (lazy pools) */
+} MJPool;
+
+void MJPoolFill(MJPool *pool);
+
+
+/* integer hash with good avalanche; the mixing step of the generator */
+static unsigned int
+MJHash(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+/* k-th 32-bit number of the stream for key */
+#define MJ_RAND(key, k)		MJHash((key) ^ MJHash((k) + 0x9e3779b9U))
+#define MJ_RAN_DOUBLE(key, k, l, h) \
+    ((MJ_RAND(key, k)*(1.0/4294967296.0))*((h) - (l)) + (l))
+#define MJ_RAN_INT(key, k, l, h) ((int) (MJ_RAN_DOUBLE(key, k, 0, (h)-(l)+1) + (l)))
+
+
+/* sample in the subcell [cell, cell+1)/(m*n), kept below its upper edge */
+static float
+MJSubcell(int cell, double u, double subcell_width) {
+    double v = (cell + u)*subcell_width;
+    float f = (float) v;
+
+    if (f >= (float) ((cell + 1)*subcell_width))
+	f = nextafterf(f, 0.0f);
+    return f;
+}
+
+
+/*
+ * MultiJitterKeyed() is MultiJitter() with the counter-based generator:
+ * the same key always gives the same pattern.
+ */
+void
+MultiJitterKeyed(Point2f p[], int m, int n, unsigned int key) {
+
+    double subcell_width;
+    unsigned int k = 0;
+    int i, j;
+
+    subcell_width = 1.0/(m*n);
+    key = MJHash(key);
+
+    /* Initialize points to the "canonical" multi-jittered pattern. */
+    for (i = 0; i < m; i++) {
+	for (j = 0; j < n; j++) {
+	    p[i*n + j].x = MJSubcell(i*n + j,
+		MJ_RAN_DOUBLE(key, k, 0, 1.0), subcell_width);
+	    k++;
+	    p[i*n + j].y = MJSubcell(j*m + i,
+		MJ_RAN_DOUBLE(key, k, 0, 1.0), subcell_width);
+	    k++;
+	}
+    }
+
+    /* Shuffle x coordinates within each column of cells. */
+    for (i = 0; i < m; i++) {
+	for (j = 0; j < n; j++) {
+
+	    float t;
+	    int s;
+
+	    s = MJ_RAN_INT(key, k, j, n - 1);
+	    k++;
+	    t = p[i*n + j].x;
+	    p[i*n + j].x = p[i*n + s].x;
+	    p[i*n + s].x = t;
+	}
+    }
+
+    /* Shuffle y coordinates within each row of cells. */
+    for (i = 0; i < n; i++) {
+	for (j = 0; j < m; j++) {
+
+	    float t;
+	    int s;
+
+	    s = MJ_RAN_INT(key, k, j, m - 1);
+	    k++;
+	    t = p[j*n + i].y;
+	    p[j*n + i].y = p[s*n + i].y;
+	    p[s*n + i].y = t;
+	}
+    }
+}
+
+
+/*
+ * MJPoolCreate() allocates a pool of npatterns m x n patterns.  If lazy
+ * is zero all patterns are built now (in parallel); otherwise each is
+ * built the first time MJPoolGet() returns it, which is only safe from
+ * one thread at a time -- call MJPoolFill() before sharing a lazy pool.
+ * Returns NULL if memory runs out.
+ */
+MJPool *
+MJPoolCreate(int m, int n, int npatterns, unsigned int seed, int lazy) {
+
+    MJPool *pool;
+
+    pool = (MJPool *) malloc(sizeof(MJPool));
+    if (pool == NULL)
+	return NULL;
+    pool->m = m;
+    pool->n = n;
+    pool->npatterns = npatterns;
+    pool->seed = seed;
+    pool->samples = (Point2f *) malloc((size_t) npatterns*m*n*sizeof(Point2f));
+    pool->built = (unsigned char *) calloc(npatterns, 1);
+    if (pool->samples == NULL || pool->built == NULL) {
+	free(pool->samples);
+	free(pool->built);
+	free(pool);
+	return NULL;
+    }
+    if (!lazy)
+	MJPoolFill(pool);
+    return pool;
+}
+
+void
+MJPoolFill(MJPool *pool) {
+
+    int i;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (i = 0; i < pool->npatterns; i++) {
+	if (!pool->built[i]) {
+	    MultiJitterKeyed(pool->samples + (size_t) i*pool->m*pool->n,
+		pool->m, pool->n, pool->seed + (unsigned int) i);
+	    pool->built[i] = 1;
+	}
+    }
+}
+
+void
+MJPoolDestroy(MJPool *pool) {
+
+    if (pool) {
+	free(pool->samples);
+	free(pool->built);
+	free(pool);
+    }
+}
+
+/*
+ * MJPoolGet() returns the m*n samples to use for pixel (x, y) of a
+ * frame.  Neighbouring pixels and successive frames get unrelated
+ * patterns from the pool.
+ */
+const Point2f *
+MJPoolGet(MJPool *pool, int x, int y, int frame) {
+
+    unsigned int h;
+    int i;
+
+    h = MJHash((unsigned int) x ^ MJHash((unsigned int) y
+	^ MJHash((unsigned int) frame ^ pool->seed)));
+    i = (int) (h % (unsigned int) pool->npatterns);
+    if (!pool->built[i]) {
+	MultiJitterKeyed(pool->samples + (size_t) i*pool->m*pool->n,
+	    pool->m, pool->n, pool->seed + (unsigned int) i);
+	pool->built[i] = 1;
+    }
+    return pool->samples + (size_t) i*pool->m*pool->n;
+}
+
+
+/*
+ * MJTile() fills p with a fresh m x n pattern for each pixel of the
+ * w x h tile at (x0, y0): pattern for pixel (x, y) starts at
+ * p[((y - y0)*w + (x - x0))*m*n].  Each pattern depends only on the
+ * pixel, the frame and the seed, so tiles can be rendered in any order.
+ * nthreads is the number of threads, 0 for the OpenMP default.
+ */
+void
+MJTile(Point2f p[], int x0, int y0, int w, int h, int frame,
+    int m, int n, unsigned int seed, int nthreads) {
+
+    int y;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+    for (y = 0; y < h; y++) {
+	int x;
+
+	for (x = 0; x < w; x++) {
+	    unsigned int key = MJHash((unsigned int) (x0 + x)
+		^ MJHash((unsigned int) (y0 + y)
+		^ MJHash((unsigned int) frame ^ seed)));
+
+	    MultiJitterKeyed(p + ((size_t) y*w + x)*m*n, m, n, key);
+	}
+    }
+}
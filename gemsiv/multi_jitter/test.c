@@ -4,6 +4,11 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 
@@ -15,37 +20,38 @@ typedef struct {
 
 //int srandom(int seed);
 
+typedef struct {
+    float x, y;
+} Point2f;
+
+typedef struct MJPool MJPool;
+
 void MultiJitter(Point2 points[], int m, int n);
+MJPool *MJPoolCreate(int m, int n, int npatterns, unsigned int seed, int lazy);
+const Point2f *MJPoolGet(MJPool *pool, int x, int y, int frame);
+void MJPoolDestroy(MJPool *pool);
+void MJTile(Point2f p[], int x0, int y0, int w, int h, int frame,
+    int m, int n, unsigned int seed, int nthreads);
 
 
 #if WIN32
 void srandom(int);
 #endif
 
-int main(int argc, char *argv[]) {
+/*
+ * Check the jittered and n-rooks conditions; returns 1 if both hold.
+ */
+static int check(Point2 *points, int m, int n, const char *what) {
 
-    Point2 *points;
-    int m, n, i, x, y;
+    int i, x, y, ok = 1;
     int **counts, *x_bins, *y_bins;
 
-    if (argc != 4) {
-	fprintf(stderr, "Usage: multi-jitter <m> <n> <seed>.\n");
-	exit(1);
-    }
-
-    m = atoi(argv[1]);
-    n = atoi(argv[2]);
-    srandom(atoi(argv[3]));
-
-    points = (Point2 *) malloc(m*n*sizeof(Point2));
     counts = (int **) malloc(m*sizeof(int *));
     for (i = 0; i < m; i++)
 	counts[i] = (int *) malloc(n*sizeof(int));
     x_bins = (int *) malloc(m*n*sizeof(int));
     y_bins = (int *) malloc(m*n*sizeof(int));
 
-    MultiJitter(points, m, n);
-
     /*
      * Test jittered condition
      */
@@ -65,7 +71,8 @@ int main(int argc, char *argv[]) {
     for (x = 0; x < m; x++) {
 	for (y = 0; y < n; y++) {
 	    if (counts[x][y] != 1) {
-		fprintf(stderr, "Jittered condition not satisfied.\n");
+		fprintf(stderr, "%s: jittered condition not satisfied.\n", what);
+		ok = 0;
 		goto done1;
 	    }
 	}
@@ -90,7 +97,8 @@ int main(int argc, char *argv[]) {
 
     for (x = 0; x < m*n; x++) {
 	if (x_bins[x] != 1) {
-	    fprintf(stderr, "n-rooks condition not satisfied in x.\n");
+	    fprintf(stderr, "%s: n-rooks condition not satisfied in x.\n", what);
+	    ok = 0;
 	    goto done2;
 	}
     }
@@ -98,12 +106,121 @@ int main(int argc, char *argv[]) {
 
     for (y = 0; y < m*n; y++) {
 	if (y_bins[y] != 1) {
-	    fprintf(stderr, "n-rooks condition not satisfied in y.\n");
+	    fprintf(stderr, "%s: n-rooks condition not satisfied in y.\n", what);
+	    ok = 0;
 	    goto done3;
 	}
     }
     done3:;
 
+    for (i = 0; i < m; i++)
+	free(counts[i]);
+    free(counts);
+    free(x_bins);
+    free(y_bins);
+    return ok;
+}
+
+
+/*
+ * Wall clock time, so that the threaded MJTile can show its speedup
+ */
+static double seconds(void) {
+
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (double) clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+
+static void tofloat2(Point2 *points, const Point2f *p, int k) {
+
+    int i;
+
+    for (i = 0; i < k; i++) {
+	points[i].x = p[i].x;
+	points[i].y = p[i].y;
+    }
+}
+
+
+#define NPOOL	1024		/* patterns in the test pool */
+#define TILE	64		/* tile width and height */
+
+int main(int argc, char *argv[]) {
+
+    Point2 *points;
+    Point2f *tile;
+    MJPool *pool;
+    int m, n, i, x, y, ok = 1, nthreads;
+    double t, t_multi, t_pool, t_tile;
+
+    if (argc != 4) {
+	fprintf(stderr, "Usage: multi-jitter <m> <n> <seed>.\n");
+	exit(1);
+    }
+
+    m = atoi(argv[1]);
+    n = atoi(argv[2]);
+    srandom(atoi(argv[3]));
+
+    points = (Point2 *) malloc(m*n*sizeof(Point2));
+
+    MultiJitter(points, m, n);
+    ok &= check(points, m, n, "MultiJitter");
+
     for (i = 0; i < m*n; i++)
 	fprintf(stderr, "(%f, %f)\n", points[i].x, points[i].y);
+
+    /*
+     * The same conditions for the pooled and per-tile patterns
+     */
+
+    pool = MJPoolCreate(m, n, NPOOL, atoi(argv[3]), 0);
+    tile = (Point2f *) malloc((size_t) TILE*TILE*m*n*sizeof(Point2f));
+    for (i = 0; i < 16; i++) {
+	tofloat2(points, MJPoolGet(pool, i, 2*i, 0), m*n);
+	ok &= check(points, m, n, "MJPoolGet");
+    }
+    MJTile(tile, 0, 0, TILE, TILE, 0, m, n, atoi(argv[3]), 0);
+    for (i = 0; i < TILE*TILE; i += 97) {
+	tofloat2(points, tile + (size_t) i*m*n, m*n);
+	ok &= check(points, m, n, "MJTile");
+    }
+
+    /*
+     * Patterns per second, one pattern per pixel of a tile
+     */
+
+    t = seconds();
+    for (i = 0; i < TILE*TILE; i++)
+	MultiJitter(points, m, n);
+    t_multi = seconds() - t;
+
+    t = seconds();
+    for (y = 0; y < TILE; y++)
+	for (x = 0; x < TILE; x++)
+	    tofloat2(points, MJPoolGet(pool, x, y, 1), m*n);
+    t_pool = seconds() - t;
+
+    t = seconds();
+    MJTile(tile, 0, 0, TILE, TILE, 1, m, n, atoi(argv[3]), 0);
+    t_tile = seconds() - t;
+#ifdef _OPENMP
+    nthreads = omp_get_max_threads();
+#else
+    nthreads = 1;
+#endif
+
+    printf("MultiJitter: %.0f patterns/s\n", TILE*TILE/(t_multi + 1e-9));
+    printf("MJPoolGet:   %.0f patterns/s\n", TILE*TILE/(t_pool + 1e-9));
+    printf("MJTile:      %.0f patterns/s (%d threads)\n", TILE*TILE/(t_tile + 1e-9),
+	nthreads);
+
+    MJPoolDestroy(pool);
+    free(tile);
+    free(points);
+    return ok ? 0 : 1;
 }
@@ -1,6 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#define SECONDS()	omp_get_wtime()
+#else
+#include <time.h>
+#define SECONDS()	((double) clock() / CLOCKS_PER_SEC)
+#endif
 
 #include "nurbs.h"
 #include "drawing.h"
@@ -88,10 +97,374 @@ LineTriangle( SurfSample * v0, SurfSample * v1, SurfSample * v2 )
     LineTo( (short) (v0->point.x * 100 + 200), (short) (v0->point.y * 100 + 200) );
 }
 
-int main()
+static long triCount;
+
+static void
+CountTriangle( SurfSample * v0, SurfSample * v1, SurfSample * v2 )
+{
+    triCount++;
+}
+
+static SurfSample * drawn;	    /* Corners of the triangles drawn, in threes */
+static long ndrawn, maxdrawn;
+
+static void
+KeepTriangle( SurfSample * v0, SurfSample * v1, SurfSample * v2 )
+{
+    if (ndrawn + 3 > maxdrawn)
+    {
+	maxdrawn = maxdrawn ? 2 * maxdrawn : 3 * 1024;
+	CHECK( drawn = (SurfSample *) realloc( drawn, maxdrawn * sizeof( SurfSample ) ) );
+    }
+    drawn[ndrawn++] = *v0;
+    drawn[ndrawn++] = *v1;
+    drawn[ndrawn++] = *v2;
+}
+
+static int
+CompareUV( const void * a, const void * b )
+{
+    const SurfSample * s = (const SurfSample *) a, * t = (const SurfSample *) b;
+
+    if (s->u != t->u)
+	return (s->u < t->u) ? -1 : 1;
+    if (s->v != t->v)
+	return (s->v < t->v) ? -1 : 1;
+    return 0;
+}
+
+/* The distinct (u,v) of n samples, sorted; returns their number */
+static long
+SortUV( SurfSample * samp, long n, SurfSample ** uv )
+{
+    long i, k;
+
+    CHECK( *uv = (SurfSample *) malloc( (n + 1) * sizeof( SurfSample ) ) );
+    memcpy( *uv, samp, n * sizeof( SurfSample ) );
+    qsort( *uv, n, sizeof( SurfSample ), CompareUV );
+    for (i = k = 0; i < n; i++)
+	if ((k == 0) || CompareUV( &(*uv)[k-1], &(*uv)[i] ))
+	    (*uv)[k++] = (*uv)[i];
+    return k;
+}
+
+static long
+FindUV( SurfSample * uv, long n, SurfSample * s )
+{
+    SurfSample * p = (SurfSample *) bsearch( s, uv, n, sizeof( SurfSample ), CompareUV );
+
+    return p ? p - uv : -1;
+}
+
+typedef struct Edge { long a, b; } Edge;
+
+static int
+CompareEdge( const void * p, const void * q )
+{
+    const Edge * e = (const Edge *) p, * f = (const Edge *) q;
+
+    if (e->a != f->a)
+	return (e->a < f->a) ? -1 : 1;
+    if (e->b != f->b)
+	return (e->b < f->b) ? -1 : 1;
+    return 0;
+}
+
+/*
+ * Count the edges of ntris triangles (corners in threes in tri) that are
+ * used by a single triangle, or twice in the same direction, leaving out
+ * the edges on the border of the parameter range of surf.  On a surface
+ * with no cracks or T-junctions there are none.
+ */
+static long
+OpenEdges( SurfSample * tri, long ntris, NurbSurface * surf )
+{
+    double u0 = surf->kvU[surf->orderU-1], un = surf->kvU[surf->numU];
+    double v0 = surf->kvV[surf->orderV-1], vn = surf->kvV[surf->numV];
+    SurfSample * uv;
+    Edge * edge, rev;
+    long nuv, i, j, open = 0;
+
+    nuv = SortUV( tri, 3 * ntris, &uv );
+    CHECK( edge = (Edge *) malloc( (3 * ntris + 1) * sizeof( Edge ) ) );
+    for (i = 0; i < ntris; i++)
+	for (j = 0; j < 3; j++)
+	{
+	    edge[3*i+j].a = FindUV( uv, nuv, &tri[3*i+j] );
+	    edge[3*i+j].b = FindUV( uv, nuv, &tri[3*i+(j+1)%3] );
+	}
+    qsort( edge, 3 * ntris, sizeof( Edge ), CompareEdge );
+
+    for (i = 0; i < 3 * ntris; i++)
+    {
+	SurfSample * a = &uv[edge[i].a], * b = &uv[edge[i].b];
+
+	rev.a = edge[i].b;
+	rev.b = edge[i].a;
+	if (((i > 0) && ! CompareEdge( &edge[i-1], &edge[i] ))
+	    || ! bsearch( &rev, edge, 3 * ntris, sizeof( Edge ), CompareEdge ))
+	    open += ! (((a->u == b->u) && ((a->u == u0) || (a->u == un)))
+		       || ((a->v == b->v) && ((a->v == v0) || (a->v == vn))));
+    }
+
+    free( uv );
+    free( edge );
+    return open;
+}
+
+/*
+ * Tessellate a surface with DrawSubdivision and with MeshSubdivision and
+ * check the mesh: it must have no open edges, the same vertices (u,v)
+ * with about the same points, and cover the same area of (u,v) with
+ * triangles facing the same way.  Returns the number of failures and
+ * adds the T-junctions of DrawSubdivision to *tjunc.
+ */
+static int
+CheckMesh( NurbSurface * surf, int nthreads, long * tjunc )
+{
+    TriMesh mesh;
+    SurfSample * tri, * uvd, * uvm;
+    double aread = 0.0, aream = 0.0, a, dist = 0.0;
+    long i, j, nuvd, nuvm, open, flipped = 0;
+    int fail = 0;
+
+    DrawTriangle = KeepTriangle;
+    ndrawn = 0;
+    DrawSubdivision( surf );
+    MeshSubdivision( &surf, 1L, &mesh, nthreads );
+
+    CHECK( tri = (SurfSample *) malloc( (3 * mesh.ntris + 1) * sizeof( SurfSample ) ) );
+    for (i = 0; i < 3 * mesh.ntris; i++)
+	tri[i] = mesh.verts[mesh.tris[i]];
+
+#define UVAREA( t ) (((t)[1].u - (t)[0].u) * ((t)[2].v - (t)[0].v) \
+		     - ((t)[1].v - (t)[0].v) * ((t)[2].u - (t)[0].u))
+    for (i = 0; i < ndrawn; i += 3)
+	aread += UVAREA( &drawn[i] );
+    for (i = 0; i < 3 * mesh.ntris; i += 3)
+    {
+	aream += a = UVAREA( &tri[i] );
+	flipped += (a <= 0.0);
+    }
+
+    nuvd = SortUV( drawn, ndrawn, &uvd );
+    nuvm = SortUV( tri, 3 * mesh.ntris, &uvm );
+    if (nuvd == nuvm)
+	for (i = 0; i < ndrawn; i++)
+	{
+	    j = FindUV( uvm, nuvm, &drawn[i] );
+	    if (j < 0)
+	    {
+		nuvm = -1;
+		break;
+	    }
+	    dist = MAX( dist, V3DistanceBetween2Points( &drawn[i].point, &uvm[j].point ) );
+	}
+
+    open = OpenEdges( tri, mesh.ntris, surf );
+    *tjunc += OpenEdges( drawn, ndrawn / 3, surf );
+
+    if (open)
+    {
+	printf( "  %ld open edges in the mesh\n", open );
+	fail++;
+    }
+    if (nuvd != nuvm)
+    {
+	printf( "  mesh vertices differ from DrawSubdivision\n" );
+	fail++;
+    }
+    if (dist > 1e-9)
+    {
+	printf( "  mesh points differ by %g from DrawSubdivision\n", dist );
+	fail++;
+    }
+    if (flipped || (fabs( aream - aread ) > 1e-9 * fabs( aread )))
+    {
+	printf( "  mesh covers (u,v) area %g, DrawSubdivision %g, %ld triangles flipped\n",
+		aream / 2, aread / 2, flipped );
+	fail++;
+    }
+
+    FreeMesh( &mesh );
+    free( tri );
+    free( uvd );
+    free( uvm );
+    return fail;
+}
+
+/*
+ * Tessellate a number of tori with DrawSubdivision (counting the
+ * triangles) and with MeshSubdivision, report the times, and check
+ * the mesh of each different torus.  Returns the number of failures.
+ */
+static int
+MeshBenchmark( long ntori, int nthreads )
+{
+    NurbSurface ** tori;
+    TriMesh mesh;
+    double t0, t1, t2;
+    long i, tjunc = 0;
+    int fail = 0;
+
+    CHECK( tori = (NurbSurface **) malloc( ntori * sizeof( NurbSurface * ) ) );
+    for (i = 0; i < ntori; i++)
+	tori[i] = generateTorus( 1.0 + 0.1 * (i % 5), 0.2 + 0.05 * (i % 3) );
+
+    DrawTriangle = CountTriangle;
+    triCount = 0;
+    t0 = SECONDS();
+    for (i = 0; i < ntori; i++)
+	DrawSubdivision( tori[i] );
+    t1 = SECONDS();
+    MeshSubdivision( tori, ntori, &mesh, nthreads );
+    t2 = SECONDS();
+
+    printf( "%ld tori, tolerance %g\n", ntori, SubdivTolerance );
+    printf( "DrawSubdivision: %8ld triangles %10.4f s\n", triCount, t1 - t0 );
+    printf( "MeshSubdivision: %8ld triangles %10.4f s, %ld vertices (%.2f per triangle)\n",
+	    mesh.ntris, t2 - t1, mesh.nverts, (double) mesh.nverts / MAX( mesh.ntris, 1L ) );
+    FreeMesh( &mesh );
+
+    /* The tori repeat after 15 */
+    for (i = 0; i < MIN( ntori, 15L ); i++)
+	fail += CheckMesh( tori[i], nthreads, &tjunc );
+    printf( "check of %ld tori: %s (DrawSubdivision has %ld T-junctions)\n",
+	    MIN( ntori, 15L ), fail ? "FAILED" : "no cracks", tjunc );
+
+    for (i = 0; i < ntori; i++)
+    {
+	FreeNurb( tori[i] );
+	free( tori[i] );
+    }
+    free( tori );
+    free( drawn );
+    return fail;
+}
+
+/*
+ * A wavy surface with num x num control points of the given order
+ */
+static NurbSurface *
+generateWaves( long num, long order )
+{
+    long i, j;
+    double w;
+    NurbSurface * surf = (NurbSurface *) malloc( sizeof(NurbSurface) );
+    CHECK( surf );
+
+    surf->numU = surf->numV = num;
+    surf->orderU = surf->orderV = order;
+    AllocNurb( surf, NULL, NULL );
+
+    for (i = 0; i < num; i++)
+	for (j = 0; j < num; j++)
+	{
+	    w = 1.0 + 0.25 * sin( (double) (i + 2 * j) );
+	    surf->points[i][j].x = j * w;
+	    surf->points[i][j].y = i * w;
+	    surf->points[i][j].z = sin( (double) i ) * cos( (double) j ) * w;
+	    surf->points[i][j].w = w;
+	}
+
+    /* Clamped uniform knot vectors */
+    for (i = 0; i < num + order; i++)
+	surf->kvU[i] = surf->kvV[i] = (i < order) ? 0.0 :
+		       (i > num) ? (double) (num - order + 1) : (double) (i - order + 1);
+    return surf;
+}
+
+/*
+ * Evaluate grids of points and normals with CalcPoint (as DrawEvaluation
+ * did) and with EvalGrid, and report points per second and the largest
+ * difference.
+ */
+static void
+EvalBenchmark( void )
+{
+    static long grids[] = { 8, 32, 128, 512 };
+    NurbSurface * surf;
+    SurfSample * a, * b;
+    Point3 utan, vtan, p;
+    double * us, * vs, t0, t1, t2, d, diff;
+    long order, g, i, j, k, rep, nrep;
+
+    for (order = 2; order <= 5; order++)
+    {
+	surf = generateWaves( 16, order );
+	for (g = 0; g < 4; g++)
+	{
+	    long n = grids[g];
+
+	    CHECK( us = (double *) malloc( 2 * n * sizeof(double) ) );
+	    CHECK( a = (SurfSample *) malloc( 2 * n * n * sizeof(SurfSample) ) );
+	    vs = us + n;
+	    b = a + n * n;
+	    for (i = 0; i < n; i++)
+		us[i] = vs[i] = (double) i / (n - 1) * (16 - order + 1);
+	    nrep = 1 + 1000000 / (n * n);
+
+	    t0 = SECONDS();
+	    for (rep = 0; rep < nrep; rep++)
+		for (i = 0; i < n; i++)
+		    for (j = 0; j < n; j++)
+		    {
+			SurfSample * s = &a[i * n + j];
+
+			CalcPoint( us[j], vs[i], surf, &s->point, &utan, &vtan );
+			(void) V3Cross( &utan, &vtan, &p );
+			d = V3Length( &p );
+			if (d != 0.0)
+			{
+			    p.x /= d;
+			    p.y /= d;
+			    p.z /= d;
+			}
+			s->normLen = d;
+			s->normal = p;
+		    }
+	    t1 = SECONDS();
+	    for (rep = 0; rep < nrep; rep++)
+		EvalGrid( surf, us, n, vs, n, b );
+	    t2 = SECONDS();
+
+	    diff = 0.0;
+	    for (k = 0; k < n * n; k++)
+	    {
+		diff = MAX( diff, V3DistanceBetween2Points( &a[k].point, &b[k].point ) );
+		diff = MAX( diff, V3DistanceBetween2Points( &a[k].normal, &b[k].normal ) );
+	    }
+	    printf( "order %ld grid %3ld: CalcPoint %7.2f Mpts/s  EvalGrid %7.2f Mpts/s  max diff %g\n",
+		    order, n, nrep * n * n / (t1 - t0) * 1e-6,
+		    nrep * n * n / (t2 - t1) * 1e-6, diff );
+	    free( us );
+	    free( a );
+	}
+	FreeNurb( surf );
+	free( surf );
+    }
+}
+
+/*
+ * With arguments "mesh [tori] [threads] [tolerance]" or "eval" runs the
+ * benchmarks above instead of drawing.
+ */
+int main( int argc, char * argv[] )
 {
     NurbSurface * torus;
 
+    if ((argc > 1) && (strcmp( argv[1], "mesh" ) == 0))
+    {
+	SubdivTolerance = (argc > 4) ? atof( argv[4] ) : 0.1;
+	return MeshBenchmark( (argc > 2) ? atol( argv[2] ) : 100L,
+			      (argc > 3) ? atoi( argv[3] ) : 0 ) != 0;
+    }
+    if ((argc > 1) && (strcmp( argv[1], "eval" ) == 0))
+    {
+	EvalBenchmark();
+	return 0;
+    }
+
     MakeWindow();	    /* Create a window on the screen */
 
     /* Set up the subdivision tolerance (facets span about two pixels) */
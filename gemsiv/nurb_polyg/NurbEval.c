@@ -8,6 +8,10 @@
 #include <stdio.h>
 #include <math.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "nurbs.h"
 #include "drawing.h"
 
@@ -194,6 +198,213 @@ CalcPoint(double u, double v, NurbSurface * n,
     p->z = r.z / r.w;
 }
 
+/*
+ * Evaluation on a grid of (u,v).
+ *
+ * The basis functions are computed once for each u and each v of the
+ * grid.  For each row (one v) the control points are first combined
+ * down the columns with the v basis, giving one row of rational points
+ * for the position and one for the v tangent.  Each point of the row then
+ * takes only orderU of those, so a point costs O(orderU) instead of
+ * O(orderU * orderV).  The Point4 sums run two coordinates at a time
+ * with SSE2 where available.
+ */
+
+/*
+ * Basis functions and derivatives for a list of parameters, stored in
+ * the order of the control points: b[t*k + j] weights point first[t] + j.
+ */
+static void
+BasisRows( double * ts, long nt, double * kv, long num, long k,
+	   long * first, double * b, double * db )
+{
+    long t, j, brk;
+    double bv[MAXORDER], dv[MAXORDER];
+
+    for (t = 0; t < nt; t++)
+    {
+	brk = FindBreakPoint( ts[t], kv, num - 1L, k );
+	first[t] = brk - k + 1L;
+	BasisFunctions( ts[t], brk, kv, k, bv );
+	BasisDerivatives( ts[t], brk, kv, k, dv );
+	for (j = 0; j < k; j++)
+	{
+	    b[t * k + j] = bv[k - 1L - j];
+	    db[t * k + j] = dv[k - 1L - j];
+	}
+    }
+}
+
+/*
+ * q[c] = sum of b[r] * rows[r][c] and qd[c] = sum of db[r] * rows[r][c],
+ * for r = 0..k-1 and c = 0..num-1
+ */
+static void
+CombineRows( Point4 ** rows, double * b, double * db, long k, long num,
+	     Point4 * q, Point4 * qd )
+{
+    long r, c;
+
+#ifdef __SSE2__
+    for (c = 0; c < num; c++)
+    {
+	__m128d qxy = _mm_setzero_pd(), qzw = _mm_setzero_pd();
+	__m128d dxy = _mm_setzero_pd(), dzw = _mm_setzero_pd();
+
+	for (r = 0; r < k; r++)
+	{
+	    __m128d pxy = _mm_loadu_pd( &rows[r][c].x );
+	    __m128d pzw = _mm_loadu_pd( &rows[r][c].z );
+	    __m128d w = _mm_set1_pd( b[r] ), dw = _mm_set1_pd( db[r] );
+
+	    qxy = _mm_add_pd( qxy, _mm_mul_pd( pxy, w ) );
+	    qzw = _mm_add_pd( qzw, _mm_mul_pd( pzw, w ) );
+	    dxy = _mm_add_pd( dxy, _mm_mul_pd( pxy, dw ) );
+	    dzw = _mm_add_pd( dzw, _mm_mul_pd( pzw, dw ) );
+	}
+	_mm_storeu_pd( &q[c].x, qxy );
+	_mm_storeu_pd( &q[c].z, qzw );
+	_mm_storeu_pd( &qd[c].x, dxy );
+	_mm_storeu_pd( &qd[c].z, dzw );
+    }
+#else
+    for (c = 0; c < num; c++)
+    {
+	q[c].x = q[c].y = q[c].z = q[c].w = 0.0;
+	qd[c] = q[c];
+	for (r = 0; r < k; r++)
+	{
+	    Point4 * cp = &rows[r][c];
+
+	    q[c].x += cp->x * b[r];   qd[c].x += cp->x * db[r];
+	    q[c].y += cp->y * b[r];   qd[c].y += cp->y * db[r];
+	    q[c].z += cp->z * b[r];   qd[c].z += cp->z * db[r];
+	    q[c].w += cp->w * b[r];   qd[c].w += cp->w * db[r];
+	}
+    }
+#endif
+}
+
+/*
+ * Point, u and v tangents of one sample from the combined rows
+ */
+static void
+CombinePoint( Point4 * q, Point4 * qv, double * b, double * db, long k,
+	      Point4 * r, Point4 * ru, Point4 * rv )
+{
+    long c;
+
+#ifdef __SSE2__
+    __m128d rxy = _mm_setzero_pd(), rzw = _mm_setzero_pd();
+    __m128d uxy = _mm_setzero_pd(), uzw = _mm_setzero_pd();
+    __m128d vxy = _mm_setzero_pd(), vzw = _mm_setzero_pd();
+
+    for (c = 0; c < k; c++)
+    {
+	__m128d pxy = _mm_loadu_pd( &q[c].x ), pzw = _mm_loadu_pd( &q[c].z );
+	__m128d w = _mm_set1_pd( b[c] ), dw = _mm_set1_pd( db[c] );
+
+	rxy = _mm_add_pd( rxy, _mm_mul_pd( pxy, w ) );
+	rzw = _mm_add_pd( rzw, _mm_mul_pd( pzw, w ) );
+	uxy = _mm_add_pd( uxy, _mm_mul_pd( pxy, dw ) );
+	uzw = _mm_add_pd( uzw, _mm_mul_pd( pzw, dw ) );
+	vxy = _mm_add_pd( vxy, _mm_mul_pd( _mm_loadu_pd( &qv[c].x ), w ) );
+	vzw = _mm_add_pd( vzw, _mm_mul_pd( _mm_loadu_pd( &qv[c].z ), w ) );
+    }
+    _mm_storeu_pd( &r->x, rxy );    _mm_storeu_pd( &r->z, rzw );
+    _mm_storeu_pd( &ru->x, uxy );   _mm_storeu_pd( &ru->z, uzw );
+    _mm_storeu_pd( &rv->x, vxy );   _mm_storeu_pd( &rv->z, vzw );
+#else
+    r->x = r->y = r->z = r->w = 0.0;
+    *ru = *r;
+    *rv = *r;
+    for (c = 0; c < k; c++)
+    {
+	r->x += q[c].x * b[c];	  ru->x += q[c].x * db[c];   rv->x += qv[c].x * b[c];
+	r->y += q[c].y * b[c];	  ru->y += q[c].y * db[c];   rv->y += qv[c].y * b[c];
+	r->z += q[c].z * b[c];	  ru->z += q[c].z * db[c];   rv->z += qv[c].z * b[c];
+	r->w += q[c].w * b[c];	  ru->w += q[c].w * db[c];   rv->w += qv[c].w * b[c];
+    }
+#endif
+}
+
+/*
+ * Evaluate NurbSurface n at the grid of parameters us[0..nu-1] x
+ * vs[0..nv-1].	 Sample (us[j], vs[i]) goes to samples[i * nu + j], with
+ * its point, unit normal (normLen is the length before normalizing, 0
+ * if degenerate) and u, v.  The parameters have the range of CalcPoint.
+ */
+void
+EvalGrid( NurbSurface * n, double * us, long nu, double * vs, long nv,
+	  SurfSample * samples )
+{
+    long i, j, ku = n->orderU, kv = n->orderV;
+    long * ufirst, * vfirst;
+    double * ub, * udb, * vb, * vdb;
+    double wsqrdiv, d;
+    Point4 * q, * qv;
+    Point4 r, rutan, rvtan;
+    Point3 utan, vtan, norm;
+
+    CHECK( ufirst = (long *) malloc( (nu + 1L) * sizeof( long ) ) );
+    CHECK( vfirst = (long *) malloc( (nv + 1L) * sizeof( long ) ) );
+    CHECK( ub = (double *) malloc( (2L * nu * ku + 1L) * sizeof( double ) ) );
+    CHECK( vb = (double *) malloc( (2L * nv * kv + 1L) * sizeof( double ) ) );
+    CHECK( q = (Point4 *) malloc( 2L * n->numU * sizeof( Point4 ) ) );
+    udb = ub + nu * ku;
+    vdb = vb + nv * kv;
+    qv = q + n->numU;
+
+    BasisRows( us, nu, n->kvU, n->numU, ku, ufirst, ub, udb );
+    BasisRows( vs, nv, n->kvV, n->numV, kv, vfirst, vb, vdb );
+
+    for (i = 0; i < nv; i++)
+    {
+	CombineRows( &n->points[vfirst[i]], &vb[i * kv], &vdb[i * kv], kv,
+		     n->numU, q, qv );
+
+	for (j = 0; j < nu; j++)
+	{
+	    SurfSample * s = &samples[i * nu + j];
+
+	    CombinePoint( &q[ufirst[j]], &qv[ufirst[j]], &ub[j * ku], &udb[j * ku],
+			  ku, &r, &rutan, &rvtan );
+
+	    /* Project tangents, using the quotient rule for differentiation */
+	    wsqrdiv = 1.0 / (r.w * r.w);
+	    utan.x = (r.w * rutan.x - rutan.w * r.x) * wsqrdiv;
+	    utan.y = (r.w * rutan.y - rutan.w * r.y) * wsqrdiv;
+	    utan.z = (r.w * rutan.z - rutan.w * r.z) * wsqrdiv;
+	    vtan.x = (r.w * rvtan.x - rvtan.w * r.x) * wsqrdiv;
+	    vtan.y = (r.w * rvtan.y - rvtan.w * r.y) * wsqrdiv;
+	    vtan.z = (r.w * rvtan.z - rvtan.w * r.z) * wsqrdiv;
+
+	    s->point.x = r.x / r.w;
+	    s->point.y = r.y / r.w;
+	    s->point.z = r.z / r.w;
+
+	    (void) V3Cross( &utan, &vtan, &norm );
+	    d = V3Length( &norm );
+	    if (d != 0.0)
+	    {
+		norm.x /= d;
+		norm.y /= d;
+		norm.z /= d;
+	    }
+	    s->normLen = d;
+	    s->normal = norm;
+	    s->u = us[j];
+	    s->v = vs[i];
+	}
+    }
+
+    free( ufirst );
+    free( vfirst );
+    free( ub );
+    free( vb );
+    free( q );
+}
+
 /*
  * Draw a mesh of points by evaluating the surface at evenly spaced
  * points.
@@ -201,9 +412,8 @@ CalcPoint(double u, double v, NurbSurface * n,
 void
 DrawEvaluation( NurbSurface * n )
 {
-    Point3 p, utan, vtan;
     register long i, j;
-    register double u, v, d;
+    double * us, * vs;
     SurfSample ** pts ;
 
     long Granularity = 10;  /* Controls the number of steps in u and v */
@@ -218,39 +428,19 @@ DrawEvaluation( NurbSurface * n )
 
     /* Compute points on curve */
 
+    CHECK( us = (double *) malloc( 2L * (Granularity+1L) * sizeof( double ) ) );
+    vs = us + Granularity + 1L;
     for (i = 0; i <= Granularity; i++)
     {
-	v = ((double) i / (double) Granularity)
-	    * (n->kvV[n->numV] - n->kvV[n->orderV-1])
-	    + n->kvV[n->orderV-1];
-
-	for (j = 0; j <= Granularity; j++)
-	{
-	    u = ((double) j / (double) Granularity)
+	vs[i] = ((double) i / (double) Granularity)
+		* (n->kvV[n->numV] - n->kvV[n->orderV-1])
+		+ n->kvV[n->orderV-1];
+	us[i] = ((double) i / (double) Granularity)
 		* (n->kvU[n->numU] - n->kvU[n->orderU-1])
 		+ n->kvU[n->orderU-1];
-
-	    CalcPoint( u, v, n, &(pts[i][j].point), &utan, &vtan );
-	    (void) V3Cross( &utan, &vtan, &p );
-	    d = V3Length( &p );
-	    if (d != 0.0)
-	    {
-		p.x /= d;
-		p.y /= d;
-		p.z /= d;
-	    }
-	    else
-	    {
-		p.x = 0;
-		p.y = 0;
-		p.z = 0;
-	    }
-	    pts[i][j].normLen = d;
-	    pts[i][j].normal = p;
-	    pts[i][j].u = u;
-	    pts[i][j].v = v;
-	}
     }
+    EvalGrid( n, us, Granularity + 1L, vs, Granularity + 1L, pts[0] );
+    free( us );
 
     /* Draw the grid */
 
@@ -264,4 +454,3 @@ DrawEvaluation( NurbSurface * n )
     free( pts[0] );
     free( pts );
 }
-
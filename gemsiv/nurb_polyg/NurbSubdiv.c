@@ -9,6 +9,10 @@
 #include <stdio.h>
 #include <math.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "nurbs.h"
 #include "drawing.h"
 
@@ -523,14 +527,118 @@ TestFlat( NurbSurface * n, double tolerance )
 }
 
 /*
- * Turn a sufficiently flat surface into triangles.
+ * Flat subpatches collected for a mesh instead of drawn.  Each one is kept
+ * as a leaf with its corners and the diagonal it is cut along, and turned
+ * into triangles once the corners of all of them are known (see
+ * JoinLeaves).  Corners at the same (u,v) with about the same normal are
+ * found through a hash table and kept once.
  */
+#define SHARE_NORMAL 0.9999	/* Cosine of angle up to which normals are shared */
+
+typedef struct MeshLeaf {
+    long v[4];			/* Corners c00, c0n, cn0 and cnn */
+    Boolean cut00;		/* Cut along c00-cnn, else along c0n-cn0 */
+} MeshLeaf;
+
+typedef struct MeshPart {
+    SurfSample * verts;
+    long nverts, maxverts;
+    long * table;		/* Hash table of vertices, -1 is empty */
+    long size;			/* Size of table, a power of 2 */
+    MeshLeaf * leaves;
+    long nleaves, maxleaves;
+    long * sample;		/* Sample of each vertex in the EdgeCache */
+} MeshPart;
+
+static unsigned long
+SampleHash( long surfId, double u, double v )
+{
+    union { double d[2]; unsigned int w[4]; } key;
+    unsigned int h = (unsigned int) surfId;
+    int i;
+
+    key.d[0] = u;
+    key.d[1] = v;
+    for (i = 0; i < 4; i++)
+	h = (h ^ key.w[i]) * 0x9E3779B1U;
+    return( (unsigned long) (h ^ (h >> 15)) );
+}
+
+/*
+ * Find the vertex of a sample, or add a new one.
+ */
+static long
+FindVertex( MeshPart * part, SurfSample * s )
+{
+    unsigned long h;
+    long i, v;
+
+    if (2L * (part->nverts + 1L) > part->size)	/* Grow the hash table */
+    {
+	part->size = (part->size == 0L) ? 256L : 2L * part->size;
+	CHECK( part->table = (long *) realloc( part->table, part->size * sizeof( long ) ) );
+	for (i = 0L; i < part->size; i++)
+	    part->table[i] = -1L;
+	for (v = 0L; v < part->nverts; v++)
+	{
+	    h = SampleHash( 0L, part->verts[v].u, part->verts[v].v );
+	    for (h &= part->size - 1L; part->table[h] >= 0L; h = (h + 1L) & (part->size - 1L));
+	    part->table[h] = v;
+	}
+    }
+
+    h = SampleHash( 0L, s->u, s->v ) & (part->size - 1L);
+    for (; (v = part->table[h]) >= 0L; h = (h + 1L) & (part->size - 1L))
+    {
+	SurfSample * t = &part->verts[v];
+
+	if ((t->u == s->u) && (t->v == s->v)
+	    && (V3Dot( &t->normal, &s->normal ) >= SHARE_NORMAL))
+	    return( v );
+    }
+
+    if (part->nverts == part->maxverts)
+    {
+	part->maxverts = (part->maxverts == 0L) ? 128L : 2L * part->maxverts;
+	CHECK( part->verts = (SurfSample *) realloc( part->verts, part->maxverts
+						     * sizeof( SurfSample ) ) );
+    }
+    v = part->nverts++;
+    part->verts[v] = *s;
+    part->table[h] = v;
+    return( v );
+}
+
 static void
-EmitTriangles( NurbSurface * n )
+AddLeaf( MeshPart * part, NurbSurface * n, Boolean cut00 )
+{
+    MeshLeaf * leaf;
+
+    if (part->nleaves == part->maxleaves)
+    {
+	part->maxleaves = (part->maxleaves == 0L) ? 64L : 2L * part->maxleaves;
+	CHECK( part->leaves = (MeshLeaf *) realloc( part->leaves, part->maxleaves
+						    * sizeof( MeshLeaf ) ) );
+    }
+    leaf = &part->leaves[part->nleaves++];
+    leaf->v[0] = FindVertex( part, &n->c00 );
+    leaf->v[1] = FindVertex( part, &n->c0n );
+    leaf->v[2] = FindVertex( part, &n->cn0 );
+    leaf->v[3] = FindVertex( part, &n->cnn );
+    leaf->cut00 = cut00;
+}
+
+/*
+ * Turn a sufficiently flat surface into triangles, drawing them
+ * or adding the surface to out if it is not NULL.
+ */
+static void
+EmitTriangles( NurbSurface * n, MeshPart * out )
 {
     Point3 vecnn, vec0n;		/* Diagonal vectors */
     double len2nn, len20n;		/* Diagonal lengths squared */
     double u0, un, v0, vn;		/* Texture coords; */
+    SurfSample * tri[6];
 
     /*
      * Measure the distance along the two diagonals to decide the best
@@ -566,16 +674,40 @@ EmitTriangles( NurbSurface * n )
     if (n->c0n.normLen == 0.0)
 	FixNormals( &(n->c00), &(n->c0n), &(n->cnn) );
 
+    if (out)
+    {
+	AddLeaf( out, n, len2nn < len20n );
+	return;
+    }
+
     if ( len2nn < len20n )
     {
-	(*DrawTriangle)( &n->c00, &n->cnn, &n->cn0 );
-	(*DrawTriangle)( &n->c00, &n->c0n, &n->cnn );
+	tri[0] = &n->c00; tri[1] = &n->cnn; tri[2] = &n->cn0;
+	tri[3] = &n->c00; tri[4] = &n->c0n; tri[5] = &n->cnn;
     }
     else
     {
-	(*DrawTriangle)( &n->c0n, &n->cnn, &n->cn0 );
-	(*DrawTriangle)( &n->c0n, &n->cn0, &n->c00 );
+	tri[0] = &n->c0n; tri[1] = &n->cnn; tri[2] = &n->cn0;
+	tri[3] = &n->c0n; tri[4] = &n->cn0; tri[5] = &n->c00;
     }
+
+    (*DrawTriangle)( tri[0], tri[1], tri[2] );
+    (*DrawTriangle)( tri[3], tri[4], tri[5] );
+}
+
+/*
+ * Choose the direction of the next split of a surface that isn't flat.
+ */
+static Boolean
+SplitDirection( NurbSurface * n, Boolean dirflag )
+{
+    if ( ((! n->flatV) && (! n->flatU)) || ((n->flatV) && (n->flatU)) )
+	return( ! dirflag );	/* If twisted or curved in both directions, */
+				/* then alternate subdivision direction */
+    if (n->flatU)		/* Only split in directions that aren't flat */
+	return( FALSE );
+    else
+	return( TRUE );
 }
 
 /*
@@ -584,37 +716,31 @@ EmitTriangles( NurbSurface * n )
  * and invoke the procedure on each half.
  */
 static void
-DoSubdivision( NurbSurface * n, double tolerance, Boolean dirflag, long level )
+DoSubdivision( NurbSurface * n, double tolerance, Boolean dirflag, long level,
+	       MeshPart * out )
 {
     NurbSurface left, right;	/* ...or top or bottom. Whatever spins your wheels. */
 
     if (TestFlat( n, tolerance ))
     {
-	EmitTriangles( n );
+	EmitTriangles( n, out );
     }
     else
     {
-	if ( ((! n->flatV) && (! n->flatU)) || ((n->flatV) && (n->flatU)) )
-	    dirflag = ! dirflag;    /* If twisted or curved in both directions, */
-	else			    /* then alternate subdivision direction */
-	{
-	    if (n->flatU)	    /* Only split in directions that aren't flat */
-		dirflag = FALSE;
-	    else
-		dirflag = TRUE;
-	}
+	dirflag = SplitDirection( n, dirflag );
 	SplitSurface( n, &left, &right, dirflag );
-	DoSubdivision( &left, tolerance, dirflag, level + 1L );
-	DoSubdivision( &right, tolerance, dirflag, level + 1L );
+	DoSubdivision( &left, tolerance, dirflag, level + 1L, out );
+	DoSubdivision( &right, tolerance, dirflag, level + 1L, out );
 	FreeNurb( &left );
 	FreeNurb( &right );	    /* Deallocate surfaces made by SplitSurface */
     }
 }
 
 /*
- * Main entry point for subdivision */
-void
-DrawSubdivision( NurbSurface * surf )
+ * Reset the subdivision flags, corners and normals of a surface
+ */
+static void
+InitSubdivision( NurbSurface * surf )
 {
     surf->flatV = FALSE;
     surf->flatU = FALSE;
@@ -636,7 +762,487 @@ DrawSubdivision( NurbSurface * surf )
     GetNormal( surf, 0L, maxU(surf) );
     GetNormal( surf, maxV(surf), 0L );
     GetNormal( surf, maxV(surf), maxU(surf) );
+}
+
+/*
+ * Main entry point for subdivision */
+void
+DrawSubdivision( NurbSurface * surf )
+{
+    InitSubdivision( surf );
+    DoSubdivision( surf, SubdivTolerance, TRUE, 0L, NULL );
+}
+
+
+/*
+ * Tessellation into an indexed mesh.
+ *
+ * The surfaces are split breadth first until there are a few subpatches
+ * per thread, then the subpatches are subdivided in parallel, each into
+ * its own MeshPart of flat leaves.  The leaves are then joined through
+ * an EdgeCache into one mesh, in the order of the subpatches.
+ */
+
+#define TASKS_PER_THREAD 8L
+
+typedef struct SubdivTask {
+    NurbSurface surf;
+    Boolean dirflag;		/* Direction of the last split */
+    Boolean split;		/* surf was made by SplitSurface, free it */
+    long surfId;		/* Index of the original surface */
+    MeshPart part;		/* Corners and leaves of the subpatch */
+} SubdivTask;
+
+/*
+ * The shared edge sample cache.  It holds a single sample for each (u,v)
+ * of a surface where leaves meet, the first one found there, and every
+ * leaf takes the points of its corners from it.  The samples are also listed
+ * by the lines of constant u and of constant v they lie on, sorted by
+ * surface, line and parameter along the line, so the samples that fall
+ * inside an edge of a leaf are found there.  Those are the corners of
+ * neighbors split further; the leaf is cut at them too, so both sides of
+ * an edge have the same vertices and the mesh has no T-junctions.
+ */
+typedef struct LineSample {
+    long dir;			/* 0 for constant u, 1 for constant v */
+    double at, t;		/* Constant and varying parameter */
+    long sample;
+} LineSample;
+
+typedef struct EdgeCache {
+    SurfSample * samples;
+    long * surfIds;
+    long nsamples;
+    long * table;		/* Hash table of samples, -1 is empty */
+    long size;			/* Size of table, a power of 2 */
+    LineSample * line;		/* Two entries per sample */
+    long nline;
+    long * pos;			/* Where each sample is in line, by dir */
+} EdgeCache;
+
+/*
+ * Find the cached sample at the (u,v) of s, or add s.  The table must have
+ * room for it.
+ */
+static long
+FindSample( EdgeCache * cache, SurfSample * s, long surfId )
+{
+    unsigned long h;
+    long k;
+
+    h = SampleHash( surfId, s->u, s->v ) & (cache->size - 1L);
+    for (; (k = cache->table[h]) >= 0L; h = (h + 1L) & (cache->size - 1L))
+	if ((cache->samples[k].u == s->u) && (cache->samples[k].v == s->v)
+	    && (cache->surfIds[k] == surfId))
+	    return( k );
+
+    k = cache->nsamples++;
+    cache->samples[k] = *s;
+    cache->surfIds[k] = surfId;
+    cache->table[h] = k;
+    return( k );
+}
+
+#define LINE_LESS( p, q ) (((p)->at < (q)->at) || \
+			   (((p)->at == (q)->at) && ((p)->t < (q)->t)))
+
+/*
+ * Sort the n entries of one surface and direction by line and parameter
+ * (a merge sort, using tmp).
+ */
+static void
+SortLine( LineSample * l, LineSample * tmp, long n )
+{
+    LineSample x;
+    long i, j, k, h;
+
+    if (n <= 16L)
+    {
+	for (i = 1L; i < n; i++)
+	{
+	    x = l[i];
+	    for (j = i; (j > 0L) && LINE_LESS( &x, &l[j-1L] ); j--)
+		l[j] = l[j-1L];
+	    l[j] = x;
+	}
+	return;
+    }
+
+    h = n / 2L;
+    SortLine( l, tmp, h );
+    SortLine( l + h, tmp, n - h );
+    for (i = 0L, j = h, k = 0L; (i < h) && (j < n); )
+	tmp[k++] = LINE_LESS( &l[j], &l[i] ) ? l[j++] : l[i++];
+    while (i < h)
+	tmp[k++] = l[i++];
+    for (i = 0L; i < k; i++)
+	l[i] = tmp[i];
+}
+
+/*
+ * Enter the corners of all the parts into the cache, and list the
+ * samples along their lines.
+ */
+static void
+BuildEdgeCache( EdgeCache * cache, SubdivTask * task, long ntask, long nsurf, int nt )
+{
+    long i, k, nverts, * start;
+
+    for (i = nverts = 0L; i < ntask; i++)
+	nverts += task[i].part.nverts;
+
+    cache->size = 256L;
+    while (cache->size < 2L * nverts)
+	cache->size *= 2L;
+    CHECK( cache->table = (long *) malloc( cache->size * sizeof( long ) ) );
+    CHECK( cache->samples = (SurfSample *) malloc( (nverts + 1L) * sizeof( SurfSample ) ) );
+    CHECK( cache->surfIds = (long *) malloc( (nverts + 1L) * sizeof( long ) ) );
+    for (k = 0L; k < cache->size; k++)
+	cache->table[k] = -1L;
+    cache->nsamples = 0L;
+
+    for (i = 0L; i < ntask; i++)
+    {
+	MeshPart * part = &task[i].part;
+
+	CHECK( part->sample = (long *) malloc( (part->nverts + 1L) * sizeof( long ) ) );
+	for (k = 0L; k < part->nverts; k++)
+	    part->sample[k] = FindSample( cache, &part->verts[k], task[i].surfId );
+    }
+
+    /* Bucket the line entries by surface and direction, then sort each */
+    cache->nline = 2L * cache->nsamples;
+    CHECK( cache->line = (LineSample *) malloc( (cache->nline + 1L)
+						* sizeof( LineSample ) ) );
+    CHECK( start = (long *) calloc( 2L * nsurf + 2L, sizeof( long ) ) );
+    for (k = 0L; k < cache->nsamples; k++)
+    {
+	start[2L * cache->surfIds[k] + 1L]++;
+	start[2L * cache->surfIds[k] + 2L]++;
+    }
+    for (i = 0L; i < 2L * nsurf; i++)
+	start[i + 1L] += start[i];
+    for (k = 0L; k < cache->nsamples; k++)
+    {
+	LineSample * l = &cache->line[start[2L * cache->surfIds[k]]++];
+
+	l->dir = 0L;
+	l->at = cache->samples[k].u;
+	l->t = cache->samples[k].v;
+	l->sample = k;
+	l = &cache->line[start[2L * cache->surfIds[k] + 1L]++];
+	l->dir = 1L;
+	l->at = cache->samples[k].v;
+	l->t = cache->samples[k].u;
+	l->sample = k;
+    }
+    /* start[i] is now the end of bucket i */
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nt)
+#endif
+    for (i = 0L; i < 2L * nsurf; i++)
+    {
+	long first = (i == 0L) ? 0L : start[i - 1L];
+	LineSample * tmp;
+
+	CHECK( tmp = (LineSample *) malloc( (start[i] - first + 1L) * sizeof( LineSample ) ) );
+	SortLine( cache->line + first, tmp, start[i] - first );
+	free( tmp );
+    }
+    free( start );
+
+    CHECK( cache->pos = (long *) malloc( (cache->nline + 1L) * sizeof( long ) ) );
+    for (k = 0L; k < cache->nline; k++)
+	cache->pos[2L * cache->line[k].sample + cache->line[k].dir] = k;
+}
+
+static void
+FreeEdgeCache( EdgeCache * cache )
+{
+    free( cache->samples );
+    free( cache->surfIds );
+    free( cache->table );
+    free( cache->line );
+    free( cache->pos );
+}
+
+/*
+ * Find the samples strictly inside the edge from sample a to sample b
+ * of a leaf (none for a diagonal).  Returns their number and sets *first
+ * to the first of them in cache->line, where they follow in increasing
+ * parameter order.
+ */
+static long
+EdgeSamples( EdgeCache * cache, long a, long b, long * first )
+{
+    long pa, pb;
+
+    if (cache->samples[a].u == cache->samples[b].u)
+    {
+	pa = cache->pos[2L * a];
+	pb = cache->pos[2L * b];
+    }
+    else if (cache->samples[a].v == cache->samples[b].v)
+    {
+	pa = cache->pos[2L * a + 1L];
+	pb = cache->pos[2L * b + 1L];
+    }
+    else
+	return( 0L );
+
+    *first = MIN( pa, pb ) + 1L;
+    return( ABS( pb - pa ) - 1L );
+}
+
+/*
+ * The mesh as it is filled in.  Its first vertices are the samples of the
+ * cache.  A corner whose normal differs from the vertex there (a seam at
+ * a C1 discontinuity) gets another vertex with the same point; next
+ * chains the vertices of a sample.
+ */
+typedef struct MeshOut {
+    TriMesh * mesh;
+    long maxverts, maxindex, nindex;
+    long * next;		/* Next vertex of the same sample, -1 at the end */
+} MeshOut;
 
-    DoSubdivision( surf, SubdivTolerance, TRUE, 0L );
-    /* Note surf is deallocated by the subdivision process */
+static long
+LeafVertex( MeshOut * out, long sample, SurfSample * s )
+{
+    TriMesh * mesh = out->mesh;
+    long v, last;
+
+    for (v = last = sample; v >= 0L; last = v, v = out->next[v])
+	if (V3Dot( &mesh->verts[v].normal, &s->normal ) >= SHARE_NORMAL)
+	    return( v );
+
+    if (mesh->nverts == out->maxverts)
+    {
+	out->maxverts *= 2L;
+	CHECK( mesh->verts = (SurfSample *) realloc( mesh->verts, out->maxverts
+						     * sizeof( SurfSample ) ) );
+	CHECK( out->next = (long *) realloc( out->next, out->maxverts * sizeof( long ) ) );
+    }
+    v = mesh->nverts++;
+    mesh->verts[v] = *s;
+    mesh->verts[v].point = mesh->verts[sample].point;
+    out->next[last] = v;
+    out->next[v] = -1L;
+    return( v );
+}
+
+static void
+PutTriangle( MeshOut * out, long v0, long v1, long v2 )
+{
+    if (out->nindex + 3L > out->maxindex)
+    {
+	out->maxindex *= 2L;
+	CHECK( out->mesh->tris = (long *) realloc( out->mesh->tris, out->maxindex
+						   * sizeof( long ) ) );
+    }
+    out->mesh->tris[out->nindex++] = v0;
+    out->mesh->tris[out->nindex++] = v1;
+    out->mesh->tris[out->nindex++] = v2;
+}
+
+/*
+ * Add the triangle of corners t[0], t[1], t[2] of a leaf, in that order,
+ * cut at the samples inside its edges.  One edge is the diagonal of the
+ * leaf, with none; with the corners turned round to A, R, B so it is B-A,
+ * the samples inside A-R are fanned from B and those inside R-B from the
+ * last vertex before R.
+ */
+static void
+AddTriangle( MeshOut * out, EdgeCache * cache, MeshPart * part, long * map,
+	     MeshLeaf * leaf, const int * t )
+{
+    long v[3], id[3], first[3], n[3], k, x, prev, pivot;
+    int i, d, e;
+    SurfSample * a, * b;
+
+    for (i = 0; i < 3; i++)
+    {
+	v[i] = map[leaf->v[t[i]]];
+	id[i] = part->sample[leaf->v[t[i]]];
+    }
+    for (i = 0, d = 0; i < 3; i++)
+    {
+	a = &cache->samples[id[i]];
+	b = &cache->samples[id[(i + 1) % 3]];
+	n[i] = EdgeSamples( cache, id[i], id[(i + 1) % 3], &first[i] );
+	if ((a->u != b->u) && (a->v != b->v))
+	    d = i;				/* The diagonal */
+    }
+
+    if (n[0] + n[1] + n[2] == 0L)
+    {
+	PutTriangle( out, v[0], v[1], v[2] );
+	return;
+    }
+
+    /* A = corner (d+1), R = (d+2), B = d; the samples of A-R, then R-B */
+    for (i = 0, prev = v[(d + 1) % 3], pivot = v[d]; i < 2; i++)
+    {
+	e = (d + 1 + i) % 3;
+	a = &cache->samples[id[e]];
+	b = &cache->samples[id[(e + 1) % 3]];
+	for (k = 0L; k < n[e]; k++)
+	{
+	    /* Lines are in increasing order of the parameter, edges may not be */
+	    if ((a->u == b->u) ? (a->v < b->v) : (a->u < b->u))
+		x = cache->line[first[e] + k].sample;
+	    else
+		x = cache->line[first[e] + n[e] - 1L - k].sample;
+	    PutTriangle( out, pivot, prev, x );
+	    prev = x;
+	}
+	if (i == 0)
+	{
+	    pivot = prev;
+	    prev = v[(d + 2) % 3];
+	}
+    }
+    PutTriangle( out, pivot, prev, v[d] );
+}
+
+/*
+ * Join the leaves of the tasks into the mesh, cutting each into the same
+ * two triangles as EmitTriangles does.
+ */
+static void
+JoinLeaves( SubdivTask * task, long ntask, long nsurf, TriMesh * mesh, int nt )
+{
+    static const int cut00[2][3] = { { 0, 3, 2 }, { 0, 1, 3 } };
+    static const int cut0n[2][3] = { { 1, 3, 2 }, { 1, 2, 0 } };
+    EdgeCache cache;
+    MeshOut out;
+    long i, k, maxpart, * map;
+
+    BuildEdgeCache( &cache, task, ntask, nsurf, nt );
+
+    out.mesh = mesh;
+    out.maxverts = 2L * cache.nsamples + 1L;
+    out.maxindex = 6L * cache.nsamples + 3L;
+    out.nindex = 0L;
+    CHECK( mesh->verts = (SurfSample *) malloc( out.maxverts * sizeof( SurfSample ) ) );
+    CHECK( mesh->tris = (long *) malloc( out.maxindex * sizeof( long ) ) );
+    CHECK( out.next = (long *) malloc( out.maxverts * sizeof( long ) ) );
+    for (k = 0L; k < cache.nsamples; k++)
+    {
+	mesh->verts[k] = cache.samples[k];
+	out.next[k] = -1L;
+    }
+    mesh->nverts = cache.nsamples;
+
+    for (i = maxpart = 0L; i < ntask; i++)
+	maxpart = MAX( maxpart, task[i].part.nverts );
+    CHECK( map = (long *) malloc( (maxpart + 1L) * sizeof( long ) ) );
+
+    for (i = 0L; i < ntask; i++)
+    {
+	MeshPart * part = &task[i].part;
+
+	for (k = 0L; k < part->nverts; k++)
+	    map[k] = LeafVertex( &out, part->sample[k], &part->verts[k] );
+	for (k = 0L; k < part->nleaves; k++)
+	{
+	    MeshLeaf * leaf = &part->leaves[k];
+	    const int (*tri)[3] = leaf->cut00 ? cut00 : cut0n;
+
+	    AddTriangle( &out, &cache, part, map, leaf, tri[0] );
+	    AddTriangle( &out, &cache, part, map, leaf, tri[1] );
+	}
+    }
+    mesh->ntris = out.nindex / 3L;
+
+    free( map );
+    free( out.next );
+    FreeEdgeCache( &cache );
+}
+
+/*
+ * Tessellate nsurf surfaces into one indexed mesh, using nthreads
+ * threads (0 for the OpenMP default).  Release the mesh with FreeMesh.
+ */
+void
+MeshSubdivision( NurbSurface ** surfs, long nsurf, TriMesh * mesh, int nthreads )
+{
+    SubdivTask * task;
+    NurbSurface left, right;
+    long i, ntask, maxtask, scanned;
+    int nt = 1;
+
+#ifdef _OPENMP
+    nt = (nthreads > 0) ? nthreads : omp_get_max_threads();
+#endif
+    maxtask = MAX( nsurf, TASKS_PER_THREAD * nt );
+    CHECK( task = (SubdivTask *) malloc( (maxtask + 1L) * sizeof( SubdivTask ) ) );
+
+    for (i = 0L; i < nsurf; i++)
+    {
+	InitSubdivision( surfs[i] );
+	task[i].surf = *surfs[i];
+	task[i].dirflag = TRUE;
+	task[i].split = FALSE;
+	task[i].surfId = i;
+    }
+    ntask = nsurf;
+
+    /* Split the subpatches in turn until there is enough work */
+    for (i = 0L, scanned = 0L; (ntask > 0L) && (ntask < maxtask) && (scanned < ntask);
+	 i = (i + 1L) % ntask)
+    {
+	if (TestFlat( &task[i].surf, SubdivTolerance ))
+	{
+	    scanned++;
+	    continue;
+	}
+	scanned = 0L;
+	task[i].dirflag = SplitDirection( &task[i].surf, task[i].dirflag );
+	SplitSurface( &task[i].surf, &left, &right, task[i].dirflag );
+	if (task[i].split)
+	    FreeNurb( &task[i].surf );
+	task[i].surf = left;
+	task[i].split = TRUE;
+	task[ntask] = task[i];
+	task[ntask].surf = right;
+	ntask++;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic) num_threads(nt)
+#endif
+    for (i = 0L; i < ntask; i++)
+    {
+	MeshPart * part = &task[i].part;
+
+	part->verts = NULL;
+	part->table = part->sample = NULL;
+	part->leaves = NULL;
+	part->nverts = part->maxverts = part->size = part->nleaves = part->maxleaves = 0L;
+	DoSubdivision( &task[i].surf, SubdivTolerance, task[i].dirflag, 0L, part );
+	if (task[i].split)
+	    FreeNurb( &task[i].surf );
+    }
+
+    JoinLeaves( task, ntask, nsurf, mesh, nt );
+
+    for (i = 0L; i < ntask; i++)
+    {
+	free( task[i].part.verts );
+	free( task[i].part.table );
+	free( task[i].part.leaves );
+	free( task[i].part.sample );
+    }
+    free( task );
+}
+
+void
+FreeMesh( TriMesh * mesh )
+{
+    free( mesh->verts );
+    free( mesh->tris );
+    mesh->verts = NULL;
+    mesh->tris = NULL;
+    mesh->nverts = mesh->ntris = 0L;
 }
@@ -51,6 +51,19 @@ typedef struct NurbSurface {
 	       cn0, cnn;    /* Corner data structures for subdivision */
 } NurbSurface;
 
+/*
+ * Indexed triangle mesh made by MeshSubdivision.  Samples at the same
+ * (u,v) of the same surface share a point, and a vertex unless their
+ * normals differ; the mesh has no T-junctions inside a surface.  tris
+ * holds three vertex indices per triangle.
+ */
+typedef struct TriMesh {
+    SurfSample * verts;
+    long nverts;
+    long * tris;
+    long ntris;
+} TriMesh;
+
 extern double SubdivTolerance;	/* Screen space tolerance for subdivision */
 
 #define CHECK( n ) \
@@ -65,6 +78,8 @@ extern double SubdivTolerance;	/* Screen space tolerance for subdivision */
 
 extern void DrawSubdivision( NurbSurface * );
 extern void DrawEvaluation( NurbSurface * );
+extern void MeshSubdivision( NurbSurface **, long, TriMesh *, int );
+extern void FreeMesh( TriMesh * );
 
 extern long FindBreakPoint( double u, double * kv, long m, long k );
 extern void AllocNurb( NurbSurface *, double *, double * );
@@ -73,3 +88,4 @@ extern void FreeNurb( NurbSurface * );
 extern void RefineSurface( NurbSurface *, NurbSurface *, Boolean );
 
 extern void CalcPoint( double, double, NurbSurface *, Point3 *, Point3 *, Point3 * );
+extern void EvalGrid( NurbSurface *, double *, long, double *, long, SurfSample * );
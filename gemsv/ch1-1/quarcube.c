@@ -8,6 +8,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 double nought;
 double doub1,doub2;
@@ -19,18 +20,22 @@ double doubmin;       /* smallest double number */
 double doubtol;       /* tolerance of double numbers */
 double rt3;
 double inv2,inv3,inv4;
+int trace = 1;        /* print the working on stderr */
 
 void setcns();
 int descartes();
-double exp(),log(),sqrt(),cos(),acos();
+double exp(),log(),sqrt(),cos(),acos(),fabs();
 double cubic();
 int qudrtc();
 int quartic();
 int ferrari();
 int neumark();
 void errors();
+void bench();
 
-int main()
+int main(argc,argv)
+int argc;
+char *argv[];
 {
    double a,b,c,d;
    double rts[4];
@@ -38,6 +43,11 @@ int main()
    int nr;
 
    setcns();
+   if (argc > 1 && argv[1][0] == '-' && argv[1][1] == 'b')
+   {
+      bench(argc > 2 ? atoi(argv[2]) : 100000);
+      exit(0);
+   }
    a = -(double)10;
    b = (double)35;
    c = -(double)50;
@@ -192,7 +202,7 @@ int ferrari(a,b,c,d,rts)
    double e,f,esq,fsq,ef ;
    double g,gg,h,hh;
 
-   fprintf(stderr,"\nFerrari %g %g %g %g\n",a,b,c,d);
+   if (trace) fprintf(stderr,"\nFerrari %g %g %g %g\n",a,b,c,d);
    asq = a*a;
 
    p = b ;
@@ -313,7 +323,7 @@ int neumark(a,b,c,d,rts)
    double cubic();
    int qudrtc();
 
-   fprintf(stderr,"\nNeumark %g %g %g %g\n",a,b,c,d);
+   if (trace) fprintf(stderr,"\nNeumark %g %g %g %g\n",a,b,c,d);
    asq = a*a ;
 
    p =  -b*doub2 ;
@@ -436,11 +446,11 @@ int nrts;
                }
             }
          }
-         fprintf(stderr,"errorsa  %d %9g %9g\n",
+         if (trace) fprintf(stderr,"errorsa  %d %9g %9g\n",
                k,rts[k],rterr[k]);
       }
    }
-   else fprintf(stderr,"errors ans: none\n");
+   else if (trace) fprintf(stderr,"errors ans: none\n");
 } /* errors */
 /**********************************************/
 
@@ -604,7 +614,7 @@ double p,q,r;
          }
       }
    }
-   fprintf(stderr,"cubic %g %g %g %d %g\n",p,q,r,nrts,root);
+   if (trace) fprintf(stderr,"cubic %g %g %g %d %g\n",p,q,r,nrts,root);
    return(root);
 } /* cubic */
 /***************************************/
@@ -690,7 +700,7 @@ int simple(a,b,c,d,rts)
    double e,f,esq,fsq ;
    double g,gg,h,hh;
 
-   fprintf(stderr,"\nsimple %g %g %g %g\n",a,b,c,d);
+   if (trace) fprintf(stderr,"\nsimple %g %g %g %g\n",a,b,c,d);
    asq = a*a;
 
    p = -b ;
@@ -755,7 +765,7 @@ double a,b,c,d,rts[4];
    inv16 = doub1/(double)16;
    d3o256 = (double)3/(double)256;
 
-   fprintf(stderr,"\nDescartes %f %f %f %f\n",a,b,c,d);
+   if (trace) fprintf(stderr,"\nDescartes %f %f %f %f\n",a,b,c,d);
    asq = a*a;
 
    A = b - asq*d3o8;
@@ -794,3 +804,138 @@ double a,b,c,d,rts[4];
    return(nrts);
 } /* descartes */
 /****************************************************/
+
+void bench(n)
+int n;
+/*
+   compare the speed and accuracy of quartic with the
+   solvers of Graphics Gems I (Roots3And4.c), one equation
+   at a time and n at a time.
+
+   The equations are made from known roots in [-1,1]: for half
+   of them all roots are real, for the other half two of them
+   (or one, for cubics) are a complex pair.
+
+   called by main.
+*/
+{
+   int SolveCubic(),SolveQuartic();
+   long SolveCubics(),SolveQuartics();
+   double *c[5],*s[4],*tr[4],rts[4],rterr[4],cs[5],ss[4];
+   double e,x,y,t;
+   int *ntr,*num,*nr;
+   int i,j,k,nk,m,bad,diff;
+   long tot;
+   clock_t start;
+
+   trace = 0;
+   for (k = 0; k < 5; ++k) c[k] = (double*)malloc(n*sizeof(double));
+   for (k = 0; k < 4; ++k) s[k] = (double*)malloc(n*sizeof(double));
+   for (k = 0; k < 4; ++k) tr[k] = (double*)malloc(n*sizeof(double));
+   ntr = (int*)malloc(n*sizeof(int));
+   num = (int*)malloc(n*sizeof(int));
+   nr = (int*)malloc(n*sizeof(int));
+   srand(1);
+
+   for (nk = 3; nk <= 4; ++nk)
+   {
+/*
+     make the equations, and sort the real roots
+*/
+      for (i = 0; i < n; ++i)
+      {
+         c[0][i] = doub1;
+         for (k = 1; k <= nk; ++k) c[k][i] = nought;
+         m = (i & 1) ? nk-2 : nk;
+         for (k = 0; k < m; ++k)
+         {
+            x = doub2*rand()/(double)RAND_MAX - doub1;
+            for (j = k+1; j > 0; --j) c[j][i] = c[j-1][i] - x*c[j][i];
+            c[0][i] *= -x;
+            for (j = k; j > 0 && tr[j-1][i] > x; --j)
+               tr[j][i] = tr[j-1][i];
+            tr[j][i] = x;
+         }
+         ntr[i] = m;
+         if (m < nk)
+         {
+            x = doub2*rand()/(double)RAND_MAX - doub1;
+            y = 0.1 + 0.9*rand()/(double)RAND_MAX;
+            for (j = nk; j >= 0; --j)
+               c[j][i] = (j >= 2 ? c[j-2][i] : nought)
+                       - (j >= 1 ? doub2*x*c[j-1][i] : nought)
+                       + (x*x+y*y)*c[j][i];
+         }
+      }
+/*
+     one at a time
+*/
+      bad = 0; e = nought;
+      start = clock();
+      for (i = 0; i < n; ++i)
+      {
+         for (k = 0; k <= nk; ++k) cs[k] = c[k][i];
+         m = (nk == 3) ? SolveCubic(cs,ss) : SolveQuartic(cs,ss);
+         for (j = 1; j < m; ++j)
+            for (k = j; k > 0 && ss[k-1] > ss[k]; --k)
+            {
+               t = ss[k]; ss[k] = ss[k-1]; ss[k-1] = t;
+            }
+         nr[i] = m;
+         if (m != ntr[i]) ++bad;
+         else for (k = 0; k < m; ++k)
+            if (fabs(ss[k]-tr[k][i]) > e) e = fabs(ss[k]-tr[k][i]);
+      }
+      t = (double)(clock()-start)/CLOCKS_PER_SEC;
+      printf("%s  %8d equations\n", nk == 3 ? "cubic  " : "quartic", n);
+      printf("   %-15s %8.1f ns each  %6d wrong counts  max error %9.3g\n",
+         nk == 3 ? "SolveCubic" : "SolveQuartic", 1e9*t/n, bad, e);
+/*
+     n at a time; the roots should agree with those found
+     one at a time, to within the errors of the two
+*/
+      start = clock();
+      tot = (nk == 3) ? SolveCubics(n,c,s,num) : SolveQuartics(n,c,s,num);
+      t = (double)(clock()-start)/CLOCKS_PER_SEC;
+      bad = 0; e = nought; diff = 0;
+      for (i = 0; i < n; ++i)
+      {
+         if (num[i] != nr[i]) ++diff;
+         if (num[i] != ntr[i]) ++bad;
+         else for (k = 0; k < num[i]; ++k)
+            if (fabs(s[k][i]-tr[k][i]) > e) e = fabs(s[k][i]-tr[k][i]);
+      }
+      printf("   %-15s %8.1f ns each  %6d wrong counts  max error %9.3g\n",
+         nk == 3 ? "SolveCubics" : "SolveQuartics", 1e9*t/n, bad, e);
+      printf("      %ld roots, %d counts differing from one at a time\n",
+         tot, diff);
+/*
+     and Herbison-Evans' quartic
+*/
+      if (nk == 4)
+      {
+         bad = 0; e = nought;
+         start = clock();
+         for (i = 0; i < n; ++i)
+         {
+            m = quartic(c[3][i],c[2][i],c[1][i],c[0][i],rts,rterr);
+            for (j = 1; j < m; ++j)
+               for (k = j; k > 0 && rts[k-1] > rts[k]; --k)
+               {
+                  t = rts[k]; rts[k] = rts[k-1]; rts[k-1] = t;
+               }
+            if (m != ntr[i]) ++bad;
+            else for (k = 0; k < m; ++k)
+               if (fabs(rts[k]-tr[k][i]) > e) e = fabs(rts[k]-tr[k][i]);
+         }
+         t = (double)(clock()-start)/CLOCKS_PER_SEC;
+         printf("   %-15s %8.1f ns each  %6d wrong counts  max error %9.3g\n",
+            "quartic", 1e9*t/n, bad, e);
+      }
+   }
+
+   for (k = 0; k < 5; ++k) free(c[k]);
+   for (k = 0; k < 4; ++k) { free(s[k]); free(tr[k]); }
+   free(ntr); free(num); free(nr);
+} /* bench */
+/****************************************************/
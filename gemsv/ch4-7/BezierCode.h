@@ -1,3 +1,51 @@
 #pragma once
 
-typedef struct { int i; } BezierCurve;
\ No newline at end of file
+/*
+ *  BezierCode.h
+ *
+ *  The Bezier curve type and support functions that bezlen.c assumes
+ *  are defined elsewhere (see the comment at its top), as implemented in
+ *  bezcode.c, and the arc-length tables built in bezlen.c.
+ */
+
+typedef struct {
+  int dim, deg;                 /* Dimension of space, degree */
+  double **Q;                   /* Q[i][k], k < dim: control point i */
+} BezierCurve;
+
+BezierCurve *NewBezierCurve(int dim, int deg);
+void FreeBezierCurve(BezierCurve *b);
+double degree(BezierCurve *b);
+BezierCurve *DiffBezierCurve(BezierCurve *b);
+double sum_of_length(BezierCurve *b);
+double length_of_sum(BezierCurve *b);
+BezierCurve *destructive_subdiv(BezierCurve *b);
+
+double BezierLength1a(BezierCurve *b, double eps);
+double BezierLength1r(BezierCurve *b, double eps);
+double BezierLength2a(BezierCurve *b, double eps);
+double BezierLength2r(BezierCurve *b, double eps);
+double BezierLength3a(BezierCurve *b, double eps);
+double BezierLength3r(BezierCurve *b, double eps);
+
+/*
+ *  A cumulative arc-length table: the length s[i] of the curve from
+ *  t = 0 to t[i], for breakpoints 0 = t[0] < ... < t[n] = 1 placed by
+ *  adaptive Gauss-Legendre quadrature, and the derivative of the curve
+ *  in power form to refine lookups between them.
+ */
+typedef struct {
+  int n;                        /* Number of intervals */
+  double *s;                    /* s[0..n], increasing */
+  double *t;                    /* t[0..n], increasing */
+  int dim, deg;                 /* Dimension, degree of the derivative */
+  double *d;                    /* d[k*(deg+1)+j]: coefficient of t^j */
+} ArcLengthTable;
+
+int ArcLengthBuild(BezierCurve *b, double eps, ArcLengthTable *table);
+void ArcLengthFree(ArcLengthTable *table);
+double ArcLengthTotal(ArcLengthTable *table);
+double ArcLengthAt(ArcLengthTable *table, double t);
+double ArcLengthParameter(ArcLengthTable *table, double s);
+int ArcLengthBuildMany(BezierCurve **b, int n, double eps,
+                       ArcLengthTable *tables, int nthreads);
@@ -0,0 +1,160 @@
+/*
+ *  bezcode.c
+ *
+ *  The Bezier curve support functions that bezlen.c assumes are defined
+ *  elsewhere, for curves with control points in any dimension.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "BezierCode.h"
+
+
+/*
+ * -----------------------------------------------------------------
+ * NewBezierCurve
+ *
+ *      Allocates a Bezier curve of degree deg in dim dimensions, with
+ *      its control points stored in one block.
+ *
+ *  Results:
+ *      A pointer to the curve, with its control points uninitialized,
+ *      or NULL in case of failure.
+ *
+ *------------------------------------------------------------------
+ */
+BezierCurve *NewBezierCurve(dim, deg)
+     int dim, deg;
+{
+  BezierCurve *b;
+  int i;
+
+  b = (BezierCurve *)malloc(sizeof(BezierCurve));
+  if (!b)
+    return NULL;
+  b->Q = (double **)malloc((deg+1)*sizeof(double *));
+  if (b->Q)
+    b->Q[0] = (double *)malloc((deg+1)*dim*sizeof(double));
+  if (!b->Q || !b->Q[0]) {
+    free(b->Q);
+    free(b);
+    return NULL;
+  }
+  for (i = 1; i <= deg; i++)
+    b->Q[i] = b->Q[0] + i*dim;
+  b->dim = dim;
+  b->deg = deg;
+  return b;
+}
+
+
+void FreeBezierCurve(b)
+     BezierCurve *b;
+{
+  free(b->Q[0]);
+  free(b->Q);
+  free(b);
+}
+
+
+double degree(b)
+     BezierCurve *b;
+{
+  return b->deg;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * DiffBezierCurve
+ *
+ *      Returns a new curve of degree deg-1 whose control points are
+ *      the forward differences Q[i+1]-Q[i] of those of b, or NULL in
+ *      case of failure.
+ *
+ *------------------------------------------------------------------
+ */
+BezierCurve *DiffBezierCurve(b)
+     BezierCurve *b;
+{
+  BezierCurve *db;
+  int i, k;
+
+  if (b->deg < 1 || !(db = NewBezierCurve(b->dim, b->deg-1)))
+    return NULL;
+  for (i = 0; i < b->deg; i++)
+    for (k = 0; k < b->dim; k++)
+      db->Q[i][k] = b->Q[i+1][k] - b->Q[i][k];
+  return db;
+}
+
+
+/* The length of the sum of the control points of b */
+
+double length_of_sum(b)
+     BezierCurve *b;
+{
+  double x, sum = 0;
+  int i, k;
+
+  for (k = 0; k < b->dim; k++) {
+    x = 0;
+    for (i = 0; i <= b->deg; i++)
+      x += b->Q[i][k];
+    sum += x*x;
+  }
+  return sqrt(sum);
+}
+
+
+/* The sum of the lengths of the control points of b */
+
+double sum_of_length(b)
+     BezierCurve *b;
+{
+  double x, len, sum = 0;
+  int i, k;
+
+  for (i = 0; i <= b->deg; i++) {
+    len = 0;
+    for (k = 0; k < b->dim; k++) {
+      x = b->Q[i][k];
+      len += x*x;
+    }
+    sum += sqrt(len);
+  }
+  return sum;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * destructive_subdiv
+ *
+ *      Subdivides b at t = 1/2 by de Casteljau's algorithm.
+ *
+ *  Results:
+ *      A new curve holding the first half, or NULL in case of failure.
+ *
+ *  Side effects:
+ *      b is left holding the second half.
+ *
+ *------------------------------------------------------------------
+ */
+BezierCurve *destructive_subdiv(b)
+     BezierCurve *b;
+{
+  BezierCurve *b1;
+  int i, j, k;
+
+  if (!(b1 = NewBezierCurve(b->dim, b->deg)))
+    return NULL;
+  for (j = 0; j <= b->deg; j++) {
+    for (k = 0; k < b->dim; k++)
+      b1->Q[j][k] = b->Q[0][k];
+    for (i = 0; i < b->deg - j; i++)
+      for (k = 0; k < b->dim; k++)
+        b->Q[i][k] = (b->Q[i][k] + b->Q[i+1][k])/2;
+  }
+  return b1;
+}
@@ -51,7 +51,12 @@
 
 
 #include <math.h>
+#include <stdlib.h>
 #include "BezierCode.h"   /* arbitrary name, see above */
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
  
 #define SQRT2      1.4142135623730951
 #define ONE_OVER15 0.0666666666666667
@@ -643,4 +648,413 @@ static double destructive_length_3r(b, La0, eps)
 }
 
 
+
+/*********************************************************************
+ * Arc-length tables:
+ *
+ *  For reparameterizing by arc length many curves have to be measured
+ *  not once but at every t, and inverted.  The length is integrated by
+ *  5-point Gauss-Legendre quadrature, which is exact for polynomials of
+ *  degree 9, over intervals halved until the two halves agree with the
+ *  whole; the ends of the intervals and the cumulative lengths there
+ *  make the table.  Lookups between them integrate or invert the speed
+ *  |B'(t)| over a single interval.
+ *********************************************************************/
+
+#define GL_MINDEPTH 2            /* Shallowest subdivision of [0,1], */
+                                 /* lest the whole and the halves agree */
+                                 /* by chance */
+#define GL_MAXDEPTH 30           /* Deepest subdivision of [0,1] */
+#define GL_KPARENT 256           /* Parent's error allowed, in eps */
+#define GL_SAMPLES 16            /* Samples to look for minimum speed */
+
+static double gl_node[5] = {
+  -0.9061798459386640, -0.5384693101056831, 0.0,
+   0.5384693101056831,  0.9061798459386640 };
+static double gl_weight[5] = {
+   0.2369268850561891,  0.4786286704993665, 0.5688888888888889,
+   0.4786286704993665,  0.2369268850561891 };
+
+
+/* |B'(t)|, from the derivative in power form */
+
+static double speed(table, t)
+     ArcLengthTable *table;
+     double t;
+{
+  double *d, v, sum = 0;
+  int j, k;
+
+  for (k = 0; k < table->dim; k++) {
+    d = table->d + k*(table->deg+1);
+    v = d[table->deg];
+    for (j = table->deg-1; j >= 0; j--)
+      v = v*t + d[j];
+    sum += v*v;
+  }
+  return sqrt(sum);
+}
+
+
+/* B'(t).B''(t), half the derivative of the speed squared */
+
+static double speed_slope(table, t)
+     ArcLengthTable *table;
+     double t;
+{
+  double *d, v, dv, sum = 0;
+  int j, k;
+
+  for (k = 0; k < table->dim; k++) {
+    d = table->d + k*(table->deg+1);
+    v = d[table->deg];
+    dv = 0;
+    for (j = table->deg-1; j >= 0; j--) {
+      dv = dv*t + v;
+      v = v*t + d[j];
+    }
+    sum += v*dv;
+  }
+  return sum;
+}
+
+
+/* The minimum of the speed in [a,b], where its slope goes from - to + */
+
+static double speed_minimum(table, a, b)
+     ArcLengthTable *table;
+     double a, b;
+{
+  double m;
+
+  while (b - a > 1e-9) {
+    m = (a+b)/2;
+    if (speed_slope(table, m) < 0)
+      a = m;
+    else
+      b = m;
+  }
+  return (a+b)/2;
+}
+
+
+/* The length of the curve from a to b by Gauss-Legendre quadrature */
+
+static double gauss_length(table, a, b)
+     ArcLengthTable *table;
+     double a, b;
+{
+  double h = (b-a)/2, m = (a+b)/2, sum = 0;
+  int i;
+
+  for (i = 0; i < 5; i++)
+    sum += gl_weight[i]*speed(table, m + h*gl_node[i]);
+  return h*sum;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * add_breakpoint
+ *
+ *      Appends the breakpoint t with cumulative length s to a table,
+ *      growing it as needed; *size is the room allocated.
+ *
+ *  Results:
+ *      0, or -1 in case of failure.
+ *
+ *------------------------------------------------------------------
+ */
+static int add_breakpoint(table, t, s, size)
+     ArcLengthTable *table;
+     double t, s;
+     int *size;
+{
+  double *p;
+
+  if (table->n+1 == *size) {
+    p = (double *)realloc(table->t, 2*(*size)*sizeof(double));
+    if (!p)
+      return -1;
+    table->t = p;
+    p = (double *)realloc(table->s, 2*(*size)*sizeof(double));
+    if (!p)
+      return -1;
+    table->s = p;
+    *size *= 2;
+  }
+  table->n++;
+  table->t[table->n] = t;
+  table->s[table->n] = s;
+  return 0;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * adapt
+ *
+ *      Integrates the speed over [a,b], whose estimated length is
+ *      whole, to within eps, appending the breakpoints reached.
+ *      Both halves are kept as intervals once they agree with the
+ *      whole, which makes the table finer for lookups at no cost.
+ *      The halves and the whole can agree by chance where the speed
+ *      is not yet resolved, so the parent interval's disagreement,
+ *      parent_err, must also be small; where the rule has converged
+ *      it is about 1000 times this one's.
+ *
+ *  Results:
+ *      0, or -1 in case of failure.
+ *
+ *------------------------------------------------------------------
+ */
+static int adapt(table, a, b, whole, eps, parent_err, depth, size)
+     ArcLengthTable *table;
+     double a, b, whole, eps, parent_err;
+     int depth, *size;
+{
+  double m = (a+b)/2, l, r, s, err;
+
+  l = gauss_length(table, a, m);
+  r = gauss_length(table, m, b);
+  err = fabs(l+r-whole);
+  if (depth >= GL_MAXDEPTH ||
+      (depth >= GL_MINDEPTH && err <= eps && parent_err <= GL_KPARENT*eps)) {
+    s = table->s[table->n];
+    if (add_breakpoint(table, m, s+l, size) < 0)
+      return -1;
+    return add_breakpoint(table, b, s+l+r, size);
+  }
+  if (adapt(table, a, m, l, eps/2, err, depth+1, size) < 0)
+    return -1;
+  return adapt(table, m, b, r, eps/2, err, depth+1, size);
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * ArcLengthBuild
+ *
+ *      Builds the cumulative arc-length table of a BezierCurve, with
+ *      a given bound eps on the relative error of the lengths.  The
+ *      control polygon's length, which is at least the curve's, is
+ *      used to make the bound absolute.
+ *
+ *  Results:
+ *      0, or -1 in case of failure.
+ *
+ *  Side effects:
+ *      Allocates the table's arrays; free them with ArcLengthFree.
+ *
+ *------------------------------------------------------------------
+ */
+int ArcLengthBuild(b, eps, table)
+     BezierCurve *b;            /* The Bezier Curve */
+     double eps;                /* The given tolerance */
+     ArcLengthTable *table;     /* The table to build */
+{
+  BezierCurve *db;
+  double *d, binom, a, c, sum;
+  int i, j, k, m, size = 16;
+
+  table->n = 0;
+  table->dim = b->dim;
+  table->deg = m = b->deg > 0 ? b->deg-1 : 0;
+  table->t = (double *)malloc(size*sizeof(double));
+  table->s = (double *)malloc(size*sizeof(double));
+  table->d = (double *)calloc(b->dim*(m+1), sizeof(double));
+  if (!table->t || !table->s || !table->d) {
+    ArcLengthFree(table);
+    return -1;
+  }
+  table->t[0] = table->s[0] = 0;
+
+  if (b->deg == 0)               /* A point: no length at all */
+    return add_breakpoint(table, 1.0, 0.0, &size);
+
+  /* The derivative, n times the forward differences in Bernstein */
+  /* form, in power form: the coefficient of t^j is */
+  /* C(m,j) sum_i (-1)^(j-i) C(j,i) db_i */
+
+  if (!(db = DiffBezierCurve(b))) {
+    ArcLengthFree(table);
+    return -1;
+  }
+  for (k = 0; k < b->dim; k++) {
+    d = table->d + k*(m+1);
+    binom = 1;                   /* C(m,j) */
+    for (j = 0; j <= m; j++) {
+      sum = 0;
+      c = 1;                     /* C(j,i) */
+      for (i = 0; i <= j; i++) {
+        sum += ((j-i) & 1 ? -c : c)*db->Q[i][k];
+        c = c*(j-i)/(i+1);
+      }
+      d[j] = b->deg*binom*sum;
+      binom = binom*(m-j)/(j+1);
+    }
+  }
+  eps *= sum_of_length(db);
+  FreeBezierCurve(db);
+
+  /* Integrate piecewise between the minima of the speed, where it */
+  /* may all but vanish in a kink that quadrature handles badly */
+  /* inside an interval but well at its end */
+
+  a = 0;
+  for (i = 1; i <= GL_SAMPLES; i++) {
+    c = (double)i/GL_SAMPLES;
+    if (i < GL_SAMPLES && !(speed_slope(table, (i-1.0)/GL_SAMPLES) < 0 &&
+                            speed_slope(table, c) >= 0))
+      continue;
+    if (i < GL_SAMPLES)
+      c = speed_minimum(table, (i-1.0)/GL_SAMPLES, c);
+    if (c > a && adapt(table, a, c, gauss_length(table, a, c), eps*(c-a),
+                       HUGE_VAL, 0, &size) < 0) {
+      ArcLengthFree(table);
+      return -1;
+    }
+    a = c;
+  }
+  return 0;
+}
+
+
+void ArcLengthFree(table)
+     ArcLengthTable *table;
+{
+  free(table->t);
+  free(table->s);
+  free(table->d);
+  table->t = table->s = table->d = NULL;
+  table->n = 0;
+}
+
+
+double ArcLengthTotal(table)
+     ArcLengthTable *table;
+{
+  return table->s[table->n];
+}
+
+
+/* The interval i of a table with a[i] <= x < a[i+1], by bisection */
+
+static int find_interval(a, n, x)
+     double *a;
+     int n;
+     double x;
+{
+  int lo = 0, hi = n, mid;
+
+  while (hi - lo > 1) {
+    mid = (lo+hi)/2;
+    if (a[mid] <= x)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * ArcLengthAt
+ *
+ *      The length of the curve from 0 to t.
+ *
+ *------------------------------------------------------------------
+ */
+double ArcLengthAt(table, t)
+     ArcLengthTable *table;
+     double t;
+{
+  int i;
+
+  if (t <= 0)
+    return 0;
+  if (t >= 1)
+    return table->s[table->n];
+  i = find_interval(table->t, table->n, t);
+  return table->s[i] + gauss_length(table, table->t[i], t);
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * ArcLengthParameter
+ *
+ *      The inverse of ArcLengthAt: the t at which the length of the
+ *      curve from 0 is s.  The interval holding s is found in the
+ *      table, and t refined from linear interpolation there by
+ *      Newton's method, the derivative of the length being the speed.
+ *
+ *------------------------------------------------------------------
+ */
+double ArcLengthParameter(table, s)
+     ArcLengthTable *table;
+     double s;
+{
+  double t, t0, t1, s0, s1, f, v;
+  int i, its;
+
+  if (s <= 0)
+    return 0;
+  if (s >= table->s[table->n])
+    return 1;
+  i = find_interval(table->s, table->n, s);
+  t0 = table->t[i];  t1 = table->t[i+1];
+  s0 = table->s[i];  s1 = table->s[i+1];
+  if (s1 <= s0)
+    return t0;
+  t = t0 + (t1-t0)*(s-s0)/(s1-s0);
+
+  for (its = 0; its < 8; its++) {
+    f = s0 + gauss_length(table, t0, t) - s;
+    if (fabs(f) <= 1e-13*s1)
+      break;
+    v = speed(table, t);
+    if (v <= 0)
+      break;
+    t -= f/v;
+    if (t < t0) t = t0;          /* Stay in the interval */
+    if (t > t1) t = t1;
+  }
+  return t;
+}
+
+
+/*
+ * -----------------------------------------------------------------
+ * ArcLengthBuildMany
+ *
+ *      Builds the tables of n curves, sharing them out among nthreads
+ *      threads (0 for the OpenMP default).
+ *
+ *  Results:
+ *      The number of tables built; those that failed have n = 0.
+ *
+ *------------------------------------------------------------------
+ */
+int ArcLengthBuildMany(b, n, eps, tables, nthreads)
+     BezierCurve **b;           /* The Bezier Curves */
+     int n;                     /* Their number */
+     double eps;                /* The given tolerance */
+     ArcLengthTable *tables;    /* The tables to build */
+     int nthreads;              /* Threads to use */
+{
+  int i, built = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:built) schedule(dynamic, 16) \
+  num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+  for (i = 0; i < n; i++)
+    if (ArcLengthBuild(b[i], eps, &tables[i]) == 0)
+      built++;
+  return built;
+}
+
+
 /* end of file  BezierLength.c, 1994 */
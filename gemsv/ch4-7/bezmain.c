@@ -0,0 +1,152 @@
+/*
+ *  bezmain.c
+ *
+ *  Times the arc-length tables of bezlen.c against its subdivision
+ *  estimators, on random cubic curves in the plane.  The lengths are
+ *  checked against BezierLength3r with a tolerance of 1e-14.
+ *
+ *  usage: bezlen_time [curves [threads]]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "BezierCode.h"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+static double seconds(void)
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double)clock()/CLOCKS_PER_SEC;
+#endif
+}
+
+
+/*
+ *  Time one of the estimators on all the curves, printing the time per
+ *  curve and the largest relative error against the reference lengths.
+ */
+static void time_estimator(name, f, b, n, eps, ref)
+     char *name;
+     double (*f)(BezierCurve *, double);
+     BezierCurve **b;
+     int n;
+     double eps, *ref;
+{
+  double t, err, max_err = 0, *len;
+  int i;
+
+  len = (double *)malloc(n*sizeof(double));
+  t = seconds();
+  for (i = 0; i < n; i++)
+    len[i] = f(b[i], eps);
+  t = seconds() - t;
+  for (i = 0; i < n; i++) {
+    err = fabs(len[i] - ref[i])/ref[i];
+    if (err > max_err)
+      max_err = err;
+  }
+  printf("  %-15s %9.2f us/curve  max error %8.2g\n", name, 1e6*t/n,
+         max_err);
+  free(len);
+}
+
+
+static double table_length(b, eps)
+     BezierCurve *b;
+     double eps;
+{
+  ArcLengthTable table;
+  double len;
+
+  if (ArcLengthBuild(b, eps, &table) < 0)
+    return -HUGE_VAL;
+  len = ArcLengthTotal(&table);
+  ArcLengthFree(&table);
+  return len;
+}
+
+
+int main(argc, argv)
+     int argc;
+     char **argv;
+{
+  static double tolerance[] = { 1e-3, 1e-5, 1e-7, 1e-9 };
+  ArcLengthTable *tables;
+  BezierCurve **b;
+  double *ref, t, s, err, max_err;
+  int n, nthreads, i, j, k, built, lookups;
+
+  n = argc > 1 ? atoi(argv[1]) : 1000;
+  nthreads = argc > 2 ? atoi(argv[2]) : 0;
+
+  b = (BezierCurve **)malloc(n*sizeof(BezierCurve *));
+  ref = (double *)malloc(n*sizeof(double));
+  tables = (ArcLengthTable *)malloc(n*sizeof(ArcLengthTable));
+  srand(1);
+  for (i = 0; i < n; i++) {
+    b[i] = NewBezierCurve(2, 3);
+    for (j = 0; j <= 3; j++)
+      for (k = 0; k < 2; k++)
+        b[i]->Q[j][k] = (double)rand()/RAND_MAX;
+    ref[i] = BezierLength3r(b[i], 1e-14);
+  }
+  printf("%d cubic curves\n", n);
+
+  for (j = 0; j < (int)(sizeof(tolerance)/sizeof(double)); j++) {
+    printf("relative tolerance %g\n", tolerance[j]);
+    time_estimator("BezierLength1r", BezierLength1r, b, n, tolerance[j], ref);
+    time_estimator("BezierLength2r", BezierLength2r, b, n, tolerance[j], ref);
+    time_estimator("BezierLength3r", BezierLength3r, b, n, tolerance[j], ref);
+    time_estimator("ArcLengthBuild", table_length, b, n, tolerance[j], ref);
+  }
+
+  /* Tables for all the curves at once */
+
+  t = seconds();
+  built = ArcLengthBuildMany(b, n, 1e-9, tables, nthreads);
+  t = seconds() - t;
+  printf("ArcLengthBuildMany  %9.2f us/curve  (%d tables, %d threads)\n",
+         1e6*t/n, built,
+#ifdef _OPENMP
+         nthreads > 0 ? nthreads : omp_get_max_threads());
+#else
+         1);
+#endif
+
+  /* Lookups from s to t, checked by going back to s */
+
+  lookups = 100;
+  max_err = 0;
+  t = seconds();
+  for (i = 0; i < n; i++)
+    for (j = 0; j < lookups; j++)
+      ArcLengthParameter(&tables[i], ArcLengthTotal(&tables[i])*j/lookups);
+  t = seconds() - t;
+  for (i = 0; i < n; i++)
+    for (j = 0; j < lookups; j++) {
+      s = ArcLengthTotal(&tables[i])*j/lookups;
+      err = fabs(ArcLengthAt(&tables[i], ArcLengthParameter(&tables[i], s))
+                 - s)/ArcLengthTotal(&tables[i]);
+      if (err > max_err)
+        max_err = err;
+    }
+  printf("ArcLengthParameter  %9.3f us/lookup (max error in s %.2g)\n",
+         1e6*t/((double)n*lookups), max_err);
+
+  for (i = 0; i < n; i++) {
+    ArcLengthFree(&tables[i]);
+    FreeBezierCurve(b[i]);
+  }
+  free(tables);
+  free(ref);
+  free(b);
+  return 0;
+}
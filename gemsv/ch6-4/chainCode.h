@@ -5,12 +5,20 @@ class chainCode{
     public:
         char* code;
         int   length;       
+        int   count;        /* codes in the chain */
 
         chainCode();
+        chainCode(int capacity);
         ~chainCode();
         void add(char c);
+        void add(const char *c, int n);
+        void clear();
         chainCode* postProcess();
         void printSelf();
 };
 
-
+/* FOR THE STREAMING ENCODER, encodePacked() IN vectorize.C */
+struct pt2Struct;
+typedef int  (*rowReader)(unsigned char *rows, int nrows, void *data);
+typedef void (*contourWriter)(struct pt2Struct *start, chainCode *code,
+                              void *data);
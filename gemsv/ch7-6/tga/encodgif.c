@@ -13,20 +13,11 @@
 #define GIFBITS 12
 #define MSDOS   1
 
-#define HSIZE  5003            /* 80% occupancy */
-
 /*
  * a code_int must be able to hold 2**GIFBITS values of type int, and also -1
  */
 typedef int             code_int;
 
-#ifdef SIGNED_COMPARE_SLOW
-typedef unsigned long int count_int;
-typedef unsigned short int count_short;
-#else
-typedef long int          count_int;
-#endif
-
 #ifdef NO_UCHAR
  typedef char   char_type;
 #else
@@ -51,309 +42,179 @@ typedef long int          count_int;
 #include "lugfnts.h"
 #include <ctype.h>
 
-static void output();
-static void cl_block();
-static void cl_hash();
-static void writeerr();
-static void char_init();
-static void char_out();
 static void flush_char();
+static void writeerr();
 
-static int n_bits;                        /* number of bits/code */
-static int maxbits = GIFBITS;                /* user settable max # bits/code */
-static code_int maxcode;                  /* maximum code, given n_bits */
-static code_int maxmaxcode = (code_int)1 << GIFBITS; /* should NEVER generate this code */
-#ifdef COMPATIBLE               /* But wrong! */
-# define MAXCODE(n_bits)        ((code_int) 1 << (n_bits) - 1)
-#else
-# define MAXCODE(n_bits)        (((code_int) 1 << (n_bits)) - 1)
-#endif /* COMPATIBLE */
-
-static count_int htab [HSIZE];
-static unsigned short codetab [HSIZE];
-#define HashTabOf(i)       htab[i]
-#define CodeTabOf(i)    codetab[i]
-
-static code_int hsize = HSIZE;                 /* for dynamic table sizing */
-
-/*
- * To save much memory, we overlay the table used by compress() with those
- * used by decompress().  The tab_prefix table is the same size and type
- * as the codetab.  The tab_suffix table needs 2**GIFBITS characters.  We
- * get this from the beginning of htab.  The output stack uses the rest
- * of htab, and contains characters.  There is plenty of room for any
- * possible stack (stack used to be 8000 characters).
- */
-
-#define tab_prefixof(i) CodeTabOf(i)
-#define tab_suffixof(i)        ((char_type *)(htab))[i]
-#define de_stack               ((char_type *)&tab_suffixof((code_int)1<<GIFBITS))
-
-static code_int free_ent = 0;                  /* first unused entry */
+#define MAXCODE(n_bits)        (((code_int) 1 << (n_bits)) - 1)
+#define maxmaxcode             ((code_int) 1 << GIFBITS)
 
 /*
- * block compression parameters -- after all codes are used up,
- * and compression rate changes, start over.
+ * compress
+ *
+ * Algorithm:  LZW with a direct-indexed string table.  The code for
+ * string ent followed by pixel c is child[ent * roots + c], where
+ * roots = 2**(init_bits-1) is the number of pixel values, so finding
+ * a string is one load instead of a probe sequence.  An empty entry
+ * is 0, which is never a string's code.  Each new code remembers the
+ * entry it went in, so clearing the table when it fills only zeroes
+ * the entries in use.  Codes are packed into a 64 bit accumulator
+ * and written in the same 254 byte packets, with the same code sizes
+ * and clears, as the 'compress' based encoder this replaces, so the
+ * output is the same, except that the old hash table could lose
+ * the string of code 0 followed by pixel 0, whose key of 0 its
+ * probe loop took for an empty slot.
  */
-static int clear_flg = 0;
 
-static int offset;
-static long int in_count = 1;            /* length of input */
-static long int out_count = 0;           /* # of codes output (for debugging) */
+typedef struct {
+        FILE *outfile;
+        int init_bits;
+        int n_bits;                     /* number of bits/code */
+        code_int maxcode;               /* maximum code, given n_bits */
+        code_int free_ent;              /* first unused entry */
+        int clear_flg;
+        int ClearCode, EOFCode;
+        unsigned long long cur_accum;
+        int cur_bits;
+        int a_count;                    /* characters in this 'packet' */
+        char_type accum[ 256 ];
+} gif_encoder;
 
 /*
- * compress stdin to stdout
- *
- * Algorithm:  use open addressing double hashing (no chaining) on the
- * prefix code / next character combination.  We do a variant of Knuth's
- * algorithm D (vol. 3, sec. 6.4) along with G. Knott's relatively-prime
- * secondary probe.  Here, the modular division first probe is gives way
- * to a faster exclusive-or manipulation.  Also do block compression with
- * an adaptive reset, whereby the code table is cleared when the compression
- * ratio decreases, but after the table fills.  The variable-length output
- * codes are re-sized at this point, and a special CLEAR code is generated
- * for the decompressor.  Late addition:  construct the table according to
- * file size for noticeable speed improvement on small files.  Please direct
- * questions about this implementation to ames!jaw.
+ * Output the given code, and put out whole bytes of the
+ * accumulator.  Then, if the next entry is going to be too big
+ * for the code size, increase it, if possible.
  */
+#define OUTPUT(e, code) {                                               \
+        (e)->cur_accum |= (unsigned long long) (code) << (e)->cur_bits; \
+        (e)->cur_bits += (e)->n_bits;                                   \
+        while ( (e)->cur_bits >= 8 ) {                                  \
+          (e)->accum[ (e)->a_count++ ] = (char_type) (e)->cur_accum;    \
+          (e)->cur_accum >>= 8;                                         \
+          (e)->cur_bits -= 8;                                           \
+          if ( (e)->a_count >= 254 )                                    \
+            flush_char( e );                                            \
+        }                                                               \
+        if ( (e)->free_ent > (e)->maxcode || (e)->clear_flg ) {         \
+          if ( (e)->clear_flg ) {                                       \
+            (e)->maxcode = MAXCODE( (e)->n_bits = (e)->init_bits );     \
+            (e)->clear_flg = 0;                                         \
+          }else {                                                       \
+            (e)->n_bits++;                                              \
+            if ( (e)->n_bits == GIFBITS )                               \
+              (e)->maxcode = maxmaxcode;                                \
+            else (e)->maxcode = MAXCODE( (e)->n_bits );                 \
+          }                                                             \
+        }                                                               \
+}
 
-static int g_init_bits;
-static FILE *g_outfile;
-
-static int ClearCode;
-static int EOFCode;
-
-void compress( init_bits, outfile, ReadValue )
+void compress_buffer( init_bits, outfile, pixels, n )
 int init_bits;
 FILE *outfile;
-ifunptr ReadValue;
+byte *pixels;
+long n;
 {
-    register long fcode;
-    register code_int i = 0;
-    register int c;
-    register code_int ent;
-    register code_int disp;
-    register code_int hsize_reg;
-    register int hshift;
-
-    /*
-     * Set up the globals:  g_init_bits - initial number of bits
-     *                      g_outfile   - pointer to output file
-     */
-    g_init_bits = init_bits;
-    g_outfile = outfile;
-
-    /*
-     * Set up the necessary values
-     */
-    offset = 0;
-    out_count = 0;
-    clear_flg = 0;
-    in_count = 1;
-    maxcode = MAXCODE(n_bits = g_init_bits);
-
-    ClearCode = (1 << (init_bits - 1));
-    EOFCode = ClearCode + 1;
-    free_ent = ClearCode + 2;
-
-    char_init();
-
-    ent = ReadValue();
-
-    hshift = 0;
-    for ( fcode = (long) hsize;  fcode < 65536L; fcode *= 2L )
-        hshift++;
-    hshift = 8 - hshift;                /* set hash code range bound */
-
-    hsize_reg = hsize;
-    cl_hash( (count_int) hsize_reg);            /* clear hash table */
-
-    output( (code_int)ClearCode );
-
-#ifdef SIGNED_COMPARE_SLOW
-    while ( (c = ReadValue() ) != (unsigned) EOF ) {
-#else
-    while ( (c = ReadValue()) != EOF ) {
-#endif
-
-        in_count++;
-
-        fcode = (long) (((long) c << maxbits) + ent);
-        i = (((code_int)c << hshift) ^ ent);    /* xor hashing */
-
-        if ( HashTabOf (i) == fcode ) {
-            ent = CodeTabOf (i);
-            continue;
-        } else if ( (long)HashTabOf (i) < 0 )      /* empty slot */
-            goto nomatch;
-        disp = hsize_reg - i;           /* secondary hash (after G. Knott) */
-        if ( i == 0 )
-            disp = 1;
-probe:
-        if ( (i -= disp) < 0 )
-            i += hsize_reg;
-
-        if ( HashTabOf (i) == fcode ) {
-            ent = CodeTabOf (i);
-            continue;
+    gif_encoder enc;
+    unsigned short *child, *slot;
+    long *entry;                        /* where each code went in child */
+    code_int ent;
+    code_int roots;
+    code_int i;
+    int c;
+    long k;
+
+    enc.outfile = outfile;
+    enc.init_bits = init_bits;
+    enc.maxcode = MAXCODE( enc.n_bits = init_bits );
+    enc.ClearCode = (1 << (init_bits - 1));
+    enc.EOFCode = enc.ClearCode + 1;
+    enc.free_ent = enc.ClearCode + 2;
+    enc.clear_flg = 0;
+    enc.cur_accum = 0;
+    enc.cur_bits = 0;
+    enc.a_count = 0;
+
+    roots = enc.ClearCode;
+    child = (unsigned short *)
+            Malloc( maxmaxcode * roots * sizeof(unsigned short) );
+    entry = (long *) Malloc( maxmaxcode * sizeof(long) );
+
+    OUTPUT( &enc, enc.ClearCode );
+
+    if ( n > 0 ) {
+        ent = pixels[0] & (roots - 1);
+        for ( k = 1; k < n; k++ ) {
+            c = pixels[k] & (roots - 1);
+            slot = &child[ (long) ent * roots + c ];
+            if ( *slot ) {
+                ent = *slot;
+                continue;
+            }
+            OUTPUT( &enc, ent );
+            ent = c;
+            if ( enc.free_ent < maxmaxcode ) {
+                entry[ enc.free_ent ] = slot - child;
+                *slot = enc.free_ent++;
+            }else {
+                /* table clear for block compress */
+                for ( i = enc.ClearCode + 2; i < maxmaxcode; i++ )
+                    child[ entry[i] ] = 0;
+                enc.free_ent = enc.ClearCode + 2;
+                enc.clear_flg = 1;
+                OUTPUT( &enc, enc.ClearCode );
+            }
         }
-        if ( (long)HashTabOf (i) > 0 )
-            goto probe;
-nomatch:
-        output ( (code_int) ent );
-        out_count++;
-        ent = c;
-#ifdef SIGNED_COMPARE_SLOW
-        if ( (unsigned) free_ent < (unsigned) maxmaxcode) {
-#else
-        if ( free_ent < maxmaxcode ) {
-#endif
-            CodeTabOf (i) = free_ent++; /* code -> hashtable */
-            HashTabOf (i) = fcode;
-        } else
-                cl_block();
-    }
-    /*
-     * Put out the final code.
-     */
-    output( (code_int)ent );
-    out_count++;
-    output( (code_int) EOFCode );
-
-    return;
-}
-
-/*****************************************************************
- * TAG( output )
- *
- * Output the given code.
- * Inputs:
- *      code:   A n_bits-bit integer.  If == -1, then EOF.  This assumes
- *              that n_bits =< (long)wordsize - 1.
- * Outputs:
- *      Outputs code to the file.
- * Assumptions:
- *      Chars are 8 bits long.
- * Algorithm:
- *      Maintain a GIFBITS character long buffer (so that 8 codes will
- * fit in it exactly).  Use the VAX insv instruction to insert each
- * code in turn.  When the buffer fills up empty it and start over.
- */
-
-static unsigned long cur_accum = 0;
-static int  cur_bits = 0;
-
-static
-unsigned long masks[] = { 0x0000, 0x0001, 0x0003, 0x0007, 0x000F,
-                                  0x001F, 0x003F, 0x007F, 0x00FF,
-                                  0x01FF, 0x03FF, 0x07FF, 0x0FFF,
-                                  0x1FFF, 0x3FFF, 0x7FFF, 0xFFFF };
-
-static
-void output(code_int code)
-{
-    cur_accum &= masks[ cur_bits ];
 
-    if( cur_bits > 0 )
-        cur_accum |= ((long)code << cur_bits);
-    else
-        cur_accum = code;
-
-    cur_bits += n_bits;
-
-    while( cur_bits >= 8 ) {
-        char_out( (unsigned int)(cur_accum & 0xff) );
-        cur_accum >>= 8;
-        cur_bits -= 8;
+        /*
+         * Put out the final code.
+         */
+        OUTPUT( &enc, ent );
     }
+    OUTPUT( &enc, enc.EOFCode );
 
     /*
-     * If the next entry is going to be too big for the code size,
-     * then increase it, if possible.
+     * At EOF, write the rest of the buffer.
      */
-   if ( free_ent > maxcode || clear_flg ) {
-
-            if( clear_flg ) {
-        
-                maxcode = MAXCODE (n_bits = g_init_bits);
-                clear_flg = 0;
-                
-            } else {
-        
-                n_bits++;
-                if ( n_bits == maxbits )
-                    maxcode = maxmaxcode;
-                else
-                    maxcode = MAXCODE(n_bits);
-            }
-        }
-        
-    if( code == EOFCode ) {
-        /*
-         * At EOF, write the rest of the buffer.
-         */
-        while( cur_bits > 0 ) {
-                char_out( (unsigned int)(cur_accum & 0xff) );
-                cur_accum >>= 8;
-                cur_bits -= 8;
-        }
-
-        flush_char();
-        
-        fflush( g_outfile );
-
-        if( ferror( g_outfile ) )
-                writeerr();
+    while ( enc.cur_bits > 0 ) {
+        enc.accum[ enc.a_count++ ] = (char_type) enc.cur_accum;
+        enc.cur_accum >>= 8;
+        enc.cur_bits -= 8;
+        if ( enc.a_count >= 254 )
+            flush_char( &enc );
     }
+    flush_char( &enc );
+    free( entry );
+    free( child );
+
+    fflush( outfile );
+    if ( ferror( outfile ) )
+        writeerr();
 }
 
 /*
- * Clear out the hash table
+ * compress, for pixels handed over one at a time by ReadValue
+ * ( which returns EOF after the last ).
  */
-static
-void cl_block ()             /* table clear for block compress */
-{
-
-        cl_hash ( (count_int) hsize );
-        free_ent = ClearCode + 2;
-        clear_flg = 1;
-
-        output( (code_int)ClearCode );
-}
-
-static
-void cl_hash(hsize)          /* reset code table */
-register count_int hsize;
+void compress( init_bits, outfile, ReadValue )
+int init_bits;
+FILE *outfile;
+ifunptr ReadValue;
 {
+    byte *pixels;
+    long n = 0, size = 4096;
+    int c;
 
-        register count_int *htab_p = htab+hsize;
-
-        register long i;
-        register long m1 = -1;
-
-        i = hsize - 16;
-        do {                            /* might use Sys V memset(3) here */
-                *(htab_p-16) = m1;
-                *(htab_p-15) = m1;
-                *(htab_p-14) = m1;
-                *(htab_p-13) = m1;
-                *(htab_p-12) = m1;
-                *(htab_p-11) = m1;
-                *(htab_p-10) = m1;
-                *(htab_p-9) = m1;
-                *(htab_p-8) = m1;
-                *(htab_p-7) = m1;
-                *(htab_p-6) = m1;
-                *(htab_p-5) = m1;
-                *(htab_p-4) = m1;
-                *(htab_p-3) = m1;
-                *(htab_p-2) = m1;
-                *(htab_p-1) = m1;
-                htab_p -= 16;
-        } while ((i -= 16) >= 0);
-
-        for ( i += 16; i > 0; i-- )
-                *--htab_p = m1;
+    pixels = (byte *) Malloc( size );
+    while ( (c = ReadValue()) != EOF ) {
+        if ( n == size ) {
+            size *= 2;
+            pixels = (byte *) realloc( pixels, size );
+            if ( pixels == NULL )
+                error( 2 );
+        }
+        pixels[n++] = c;
+    }
+    compress_buffer( init_bits, outfile, pixels, n );
+    free( pixels );
 }
 
 static
@@ -369,48 +230,17 @@ void writeerr()
  *
  ******************************************************************************/
 
-/*
- * Number of characters so far in this 'packet'
- */
-static int a_count;
-
-/*
- * Set up the 'byte output' routine
- */
-static
-void char_init()
-{
-        a_count = 0;
-}
-
-/*
- * Define the storage for the packet accumulator
- */
-static char accum[ 256 ];
-
-/*
- * Add a character to the end of the current packet, and if it is 254
- * characters, flush the packet to disk.
- */
-static
-void char_out( c )
-int c;
-{
-        accum[ a_count++ ] = c;
-        if( a_count >= 254 )
-                flush_char();
-}
-
 /*
  * Flush the packet to disk, and reset the accumulator
  */
 static
-void flush_char()
+void flush_char( enc )
+gif_encoder *enc;
 {
-        if( a_count > 0 ) {
-                fputc( a_count, g_outfile );
-                fwrite( accum, 1, a_count, g_outfile );
-                a_count = 0;
+        if( enc->a_count > 0 ) {
+                fputc( enc->a_count, enc->outfile );
+                fwrite( enc->accum, 1, enc->a_count, enc->outfile );
+                enc->a_count = 0;
         }
 }       
 
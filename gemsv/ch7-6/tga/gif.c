@@ -24,6 +24,11 @@
  * Date:        Wed Jan 8 1992
  * Copyright (c) 1992, Raul Rivero
  *
+ * Modified:    Oct 18 2026
+ *              Decoder reads codes from a 64 bit accumulator and
+ *              expands them by copying from the image; the image
+ *              is compressed straight from its buffer.
+ *
  */
 
 #include "lug.h"
@@ -122,9 +127,25 @@ bitmap_hdr *bitmap;
 	Fclose( handle );
 }
 
-#define READCODE()      { code = read_code( ptrblocks, datamask,    \
-                                            &offset, codesize );    \
-                          ptrblocks += offset; }
+/*
+ * The decoder keeps its dictionary in the image itself: each code
+ * stands for a string already put out, so we only store where that
+ * string starts and its length, and expand a code with a copy from
+ * earlier in the image. A new code is the previous string plus the
+ * first pixel of the current one, which is just the previous string
+ * one pixel longer. Codes are taken from a 64 bit accumulator that
+ * is refilled with up to 7 bytes at a time.
+ */
+#define GIFMAXCODE              4096
+
+#define LOAD64(p)       ( (unsigned long long) (p)[0]         |     \
+                          (unsigned long long) (p)[1] << 8    |     \
+                          (unsigned long long) (p)[2] << 16   |     \
+                          (unsigned long long) (p)[3] << 24   |     \
+                          (unsigned long long) (p)[4] << 32   |     \
+                          (unsigned long long) (p)[5] << 40   |     \
+                          (unsigned long long) (p)[6] << 48   |     \
+                          (unsigned long long) (p)[7] << 56 )
 
 void uncode_gif( handle, codesize, mask, image )
 FILE *handle;
@@ -133,27 +154,27 @@ bitmap_hdr *image;
 {
   int endblock;
   int clearcode;
-  int offset;
   int freecode;
   int code;
-  int current, old;
   int datamask;
   int codetop;
   int orig_codesize;
-  short *sufix, *prefix;
-  byte *blocks, *ptrblocks;
-  int count = 0;
-  byte *stack;
-  int k;
+  int *start, *length;
+  byte *blocks, *ptrblocks, *endblocks;
+  unsigned long long bits = 0;
+  int nbits = 0;
+  byte *out, *from;
+  int len, i;
+  int old = -1, oldpos = 0, oldlen = 0;
+  long bytes;
   int totalsize;
-  int position;
+  int position = 0;
 
   /*
    * Allocate memory for internal buffers.
    */
-  stack  = (byte *) Malloc( 4096 );
-  sufix  = (short *) Malloc( 4096 * sizeof(short) );
-  prefix = (short *) Malloc( 4096 * sizeof(short) );
+  start  = (int *) Malloc( GIFMAXCODE * sizeof(int) );
+  length = (int *) Malloc( GIFMAXCODE * sizeof(int) );
 
   /*
    * Compute predefined values for uncompress.
@@ -166,18 +187,32 @@ bitmap_hdr *image;
   datamask = codetop - 1;
 
   /*
-   * Unblock the raster information.
+   * Unblock the raster information ( with room to read
+   * 8 bytes at a time up to its end ).
    */
-  ptrblocks = blocks = (byte *) unblock( handle );
+  ptrblocks = blocks = (byte *) unblock_gif( handle, &bytes );
+  endblocks = blocks + bytes;
 
   totalsize = image->xsize * image->ysize;
+  out = image->r;
 
   /*
    * and now, ... UNPACK !!!.
    */
   VPRINTF( stderr, "Uncompressing GIF raster information\n" );
-  READCODE();  /* read first code */
-  while ( code != endblock ) {
+  while ( position < totalsize ) {
+    /* Read the next code */
+    if ( nbits < codesize ) {
+      if ( ptrblocks >= endblocks )
+        break;
+      bits |= LOAD64( ptrblocks ) << nbits;
+      ptrblocks += (63 - nbits) >> 3;
+      nbits |= 56;
+    }
+    code = bits & datamask;
+    bits >>= codesize;
+    nbits -= codesize;
+
     if ( code == clearcode ) {
       /*
        * Current code is clear so we reinitialize our tables.
@@ -186,41 +221,37 @@ bitmap_hdr *image;
       freecode = clearcode + 2;
       codetop = 1 << codesize;
       datamask = codetop - 1;
-      READCODE();
-      old = current = code;
-      /* Next code to 'clear' is a root code */
-      k = code & mask;
-      position = push_gif( image->r, k );
-    }else {
-      /*
-       * We have a normal code.
-       */
-      current = code;
-      /*
-       * If it's a new code then we need add the last translation.
-       */
-      if( !(code < freecode) ) {
-        current = old;
-        stack[count++] = (byte) k;
-      }
+      old = -1;
+      continue;
+    }
+    if ( code == endblock )
+      break;
+
+    if ( code < clearcode ) {
+      /* A root code */
+      out[position] = code & mask;
+      len = 1;
+    }else if ( code < freecode && old >= 0 ) {
+      len = LUGMIN( length[code], totalsize - position );
+      from = out + start[code];
+      if ( len > 16 )
+        memcpy( out + position, from, len );
+      else for ( i = 0; i < len; i++ )
+             out[position + i] = from[i];
+    }else if ( code == freecode && old >= 0 ) {
+      /* The last translation, and its first pixel again */
+      len = LUGMIN( oldlen + 1, totalsize - position );
+      from = out + oldpos;
+      for ( i = 0; i < len; i++ )
+        out[position + i] = from[i];
+    }else break;  /* corrupt */
 
-      /*
-       * mask equals to 'last_root_code' so while current
-       * code greater [than mask] we haven't a root code
-       * and continue adding values into ioutput.
-       */
-      while ( current > mask ) {
-        stack[count++] = (unsigned char)sufix[current];
-        current = prefix[current];
-      }
-      k = current & mask;
-      stack[count] = k;
-      for ( ; count >= 0; count-- )
-        position = push_gif( image->r, (int) stack[count] );
-      count = 0;
-      prefix[freecode  ] = old;
-      sufix [freecode++] = k;
-      old = code;
+    /*
+     * Add the last translation plus our first pixel.
+     */
+    if ( old >= 0 && freecode < GIFMAXCODE ) {
+      start [freecode  ] = oldpos;
+      length[freecode++] = oldlen + 1;
       /*
        * Check if we use all posibles values ( for this
        * codesize ).
@@ -231,9 +262,10 @@ bitmap_hdr *image;
         datamask = codetop - 1;
       }
     }
-    READCODE();
-    if ( position > totalsize )
-      /*error(6)*/ break;
+    old = code;
+    oldpos = position;
+    oldlen = len;
+    position += len;
   }
 
   /*
@@ -241,9 +273,8 @@ bitmap_hdr *image;
    * internal buffers.
    */
   free( blocks );
-  free( prefix );
-  free( sufix );
-  free( stack );
+  free( length );
+  free( start );
 }
 
 int read_code( buffer, mask, offset, codesize )
@@ -389,12 +420,25 @@ int *width, *height;
 
 byte *unblock( handle )
 FILE *handle;
+{
+  long bytes;
+
+  return unblock_gif( handle, &bytes );
+}
+
+/*
+ * unblock, also giving the number of bytes of raster data; the
+ * buffer has 8 zero bytes more after them.
+ */
+byte *unblock_gif( handle, bytes )
+FILE *handle;
+long *bytes;
 {
   long position;
   long int totalsize;
   byte *out, *ptr;
   int size;
-  int count = 0;
+  long count = 0;
 
   VPRINTF( stderr, "Unblocking GIF file\n" );
   /*
@@ -408,13 +452,13 @@ FILE *handle;
   totalsize = ftell( handle ) - position;
   fseek( handle, position, 0 );
 
-  ptr = out = (byte *) Malloc( totalsize );
+  ptr = out = (byte *) Malloc( totalsize + 8 );
 
   /*
    * Format is:  <size><...block...><size><...block...>[...]<0>
    */
   size = fgetc( handle );
-  while ( size ) {
+  while ( size > 0 ) {
     /* Check if no problems with space */
     count += size;
     if ( count > totalsize )
@@ -425,6 +469,7 @@ FILE *handle;
     size = fgetc( handle );
   }
 
+  *bytes = count;
   return out;
 }
 
@@ -447,14 +492,13 @@ bitmap_hdr *image;
 
 }
 
-void compress(int, FILE*, int (*)());
+void compress_buffer(int, FILE*, byte *, long);
 
 void write_gif(handle, image)
 FILE *handle;
 bitmap_hdr *image;
 {
   int codesize;
-  int read_pixel();
 
   if ( image->magic != LUGUSED )
     error( 19 );
@@ -488,8 +532,7 @@ bitmap_hdr *image;
    * Compress the image.
    */
   VPRINTF(stdout, "Compressing raster information\n");
-  ptr_image = image->r;
-  compress( codesize, handle, read_pixel);
+  compress_buffer( codesize, handle, image->r, (long) image_size );
 
   /*
    * Block with a size of 0 bytes.
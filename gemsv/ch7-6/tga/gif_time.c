@@ -0,0 +1,151 @@
+/*
+ * gif_time.c - times the GIF encoder and decoder.
+ *
+ * Each image is compressed into a temporary file with write_gif
+ * and read back with read_gif, checking it, for a few synthetic
+ * 8 bit images: smooth shading with ordered dither ( like a
+ * scanned or rendered picture ), flat areas ( like a chart or a
+ * cartoon ) and noise ( the worst case ). GIF files named on
+ * the command line are timed the same way. Rates are MB/s of
+ * pixels. gif_time exits with status 1 if any image does not
+ * come back unchanged.
+ *
+ * usage: gif_time [-s size] [-r repeats] [file.gif ...]
+ */
+
+#include "lug.h"
+#include "lugfnts.h"
+#include <time.h>
+
+static double seconds()
+{
+  return (double) clock() / CLOCKS_PER_SEC;
+}
+
+static byte bayer[4][4] = {
+  {  0,  8,  2, 10 },
+  { 12,  4, 14,  6 },
+  {  3, 11,  1,  9 },
+  { 15,  7, 13,  5 }
+};
+
+static void make_image( image, size, kind )
+bitmap_hdr *image;
+int size;
+int kind;
+{
+  int x, y, i, v;
+  double f;
+
+  image->magic = LUGUSED;
+  image->xsize = image->ysize = size;
+  image->depth = 8;
+  image->colors = 256;
+  image->r = (byte *) Malloc( size * size );
+  image->g = image->b = NULL;
+  image->cmap = (byte *) Malloc( 3 * 256 );
+  for ( i = 0; i < 256; i++ )
+    image->cmap[3*i] = image->cmap[3*i+1] = image->cmap[3*i+2] = i;
+
+  for ( y = 0; y < size; y++ )
+    for ( x = 0; x < size; x++ ) {
+      i = y * size + x;
+      switch ( kind ) {
+        case 0:
+                /* Smooth shading, dithered down to 64 levels */
+                f = 0.5 + 0.25 * sin( x * 0.013 + sin( y * 0.007 ) ) +
+                          0.25 * cos( y * 0.011 - x * 0.003 );
+                v = (int) ( f * 63 * 16 ) + bayer[y & 3][x & 3];
+                image->r[i] = CLAMP( v / 16, 0, 63 ) * 4;
+                break;
+        case 1:
+                /* Flat rectangles */
+                image->r[i] = ( (x / 37) * 7 + (y / 23) * 13 ) & 255;
+                break;
+        default:
+                image->r[i] = rand();
+                break;
+      }
+    }
+}
+
+/*
+ * Returns 1 if the image came back unchanged every time.
+ */
+static int time_image( name, image, repeats )
+char *name;
+bitmap_hdr *image;
+int repeats;
+{
+  FILE *handle;
+  bitmap_hdr back;
+  double t_enc = 0, t_dec = 0, t;
+  long bytes = 0;
+  int i, ok = 1;
+  double mb = (double) image->xsize * image->ysize * repeats / 1e6;
+
+  for ( i = 0; i < repeats; i++ ) {
+    if ( (handle = tmpfile()) == NULL )
+      error( 1 );
+    t = seconds();
+    write_gif( handle, image );
+    fflush( handle );
+    t_enc += seconds() - t;
+    bytes = ftell( handle );
+
+    rewind( handle );
+    t = seconds();
+    read_gif( handle, &back );
+    t_dec += seconds() - t;
+    fclose( handle );
+
+    ok &= back.xsize == image->xsize && back.ysize == image->ysize &&
+          !memcmp( back.r, image->r, image->xsize * image->ysize );
+    free( back.r );
+    free( back.cmap );
+  }
+
+  printf( "%-12s %5dx%-5d %5.1f:1  encode %7.1f MB/s  decode %7.1f MB/s%s\n",
+          name, image->xsize, image->ysize,
+          (double) image->xsize * image->ysize / bytes,
+          mb / t_enc, mb / t_dec, ok ? "" : "  MISMATCH" );
+  return ok;
+}
+
+int main( argc, argv )
+int argc;
+char **argv;
+{
+  static char *kinds[] = { "shaded", "flat", "noise" };
+  bitmap_hdr image;
+  int size = 2048, repeats = 4;
+  int i, ok = 1;
+
+  for ( i = 1; i < argc && argv[i][0] == '-'; i++ ) {
+    if ( !strcmp( argv[i], "-s" ) && i + 1 < argc )
+      size = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-r" ) && i + 1 < argc )
+      repeats = atoi( argv[++i] );
+  }
+
+  srand( 1 );
+  for ( i = 0; i < 3; i++ ) {
+    make_image( &image, size, i );
+    ok &= time_image( kinds[i], &image, repeats );
+    free( image.r );
+    free( image.cmap );
+  }
+
+  for ( i = 1; i < argc; i++ ) {
+    if ( argv[i][0] == '-' ) {
+      i++;
+      continue;
+    }
+    read_gif_file( argv[i], &image );
+    ok &= time_image( argv[i], &image, repeats );
+    free( image.r );
+    free( image.cmap );
+  }
+
+  return ok ? 0 : 1;
+}
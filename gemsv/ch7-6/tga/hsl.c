@@ -24,6 +24,11 @@
  * Date:        Sat Feb 1 1992
  * Copyright (c) 1992, Raul Rivero
  *
+ * Modified:    Oct 18 2026
+ *              Single precision buffer conversions, four pixels
+ *              at a time with SSE2 and split among threads for
+ *              large buffers.
+ *
  */
 /*
  * RGB <--> HSL routines extracted from Graphics Gems I.
@@ -32,6 +37,19 @@
 #include "lug.h"
 #include "lugfnts.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/*
+ * The float buffers are converted in blocks of HSL_BLOCK pixels,
+ * which are shared out among the threads.
+ */
+#define HSL_BLOCK               16384
+
 void hsl_to_rgb_buffer( h, s, l, r, g, b, size )
 double *h, *s, *l;
 byte *r, *g, *b;
@@ -147,3 +165,228 @@ void HSL_to_RGB(double h, double sl, double l, byte* r, byte* g, byte* b)
     }
   }
 }
+
+/*
+ * Single precision versions for whole buffers. They give the same
+ * results as the routines above ( to float precision ), but choose
+ * the hue sector without branches:
+ *
+ *   RGB -> HSL  the hue is ( g - b ) / ( v - m ) when red is the
+ *               largest, 2 + ( b - r ) / ( v - m ) when green is,
+ *               and 4 + ( r - g ) / ( v - m ) when blue is, over 6
+ *               and taken into [0, 1);
+ *   HSL -> RGB  each channel is v - ( v - m ) * clamp( min( k, 4 - k ) )
+ *               with k = ( n + 6 * h ) mod 6, and n = 5, 3, 1 for
+ *               red, green and blue.
+ *
+ * Hue and saturation are 0 for grays ( RGB_to_HSL leaves them as
+ * they were ), and hue 1 is hue 0.
+ */
+static void rgb_to_hsl_pixel(byte r1, byte g1, byte b1,
+                             float* h, float* s, float* l)
+{
+  float r = r1, g = g1, b = b1;
+  float v, m, vm, d, sum;
+
+  v = LUGMAX( r, LUGMAX( g, b ) );
+  m = LUGMIN( r, LUGMIN( g, b ) );
+  vm = v - m;
+  sum = v + m;
+  *l = sum * (1.f / 510.f);
+  if ( vm <= 0.f ) {
+    *h = *s = 0.f;
+    return;
+  }
+  *s = vm / ( sum <= 255.f ? sum : 510.f - sum );
+  if ( r == v )
+    d = (g - b) / vm;
+  else if ( g == v )
+    d = 2.f + (b - r) / vm;
+  else d = 4.f + (r - g) / vm;
+  if ( d < 0.f )
+    d += 6.f;
+  *h = d * (1.f / 6.f);
+}
+
+static void hsl_to_rgb_pixel(float h, float sl, float l,
+                             byte* r, byte* g, byte* b)
+{
+  float v, m, h6, k, c[3];
+  int n;
+
+  v = (l <= 0.5f) ? (l * (1.f + sl)) : (l + sl - l * sl);
+  m = l + l - v;
+  h6 = 6.f * h;
+  for ( n = 0; n < 3; n++ ) {
+    k = (5 - 2 * n) + h6;
+    if ( k >= 6.f )
+      k -= 6.f;
+    k = LUGMIN( k, 4.f - k );
+    k = CLAMP( k, 0.f, 1.f );
+    c[n] = 255.f * ( v - (v - m) * k );
+  }
+  *r = (byte) CORRECT( c[0] );
+  *g = (byte) CORRECT( c[1] );
+  *b = (byte) CORRECT( c[2] );
+}
+
+#ifdef __SSE2__
+/*
+ * Four bytes to floats and back ( truncating, saturated ).
+ */
+static __m128 load4( p )
+byte *p;
+{
+  __m128i zero = _mm_setzero_si128();
+  int w;
+
+  memcpy( &w, p, 4 );
+  return _mm_cvtepi32_ps( _mm_unpacklo_epi16(
+           _mm_unpacklo_epi8( _mm_cvtsi32_si128( w ), zero ), zero ) );
+}
+
+static void store4( p, x )
+byte *p;
+__m128 x;
+{
+  __m128i zero = _mm_setzero_si128();
+  int w;
+
+  w = _mm_cvtsi128_si32( _mm_packus_epi16(
+        _mm_packs_epi32( _mm_cvttps_epi32( x ), zero ), zero ) );
+  memcpy( p, &w, 4 );
+}
+#endif
+
+static void rgb_to_hsl_block( r, g, b, h, s, l, size )
+byte *r, *g, *b;
+float *h, *s, *l;
+int size;
+{
+  int i = 0;
+#ifdef __SSE2__
+  __m128 vr, vg, vb, v, m, vm, sum, d, isr, isg, gray;
+  __m128 c255 = _mm_set1_ps( 255.f ), c510 = _mm_set1_ps( 510.f );
+  __m128 c2 = _mm_set1_ps( 2.f ), c4 = _mm_set1_ps( 4.f );
+  __m128 c6 = _mm_set1_ps( 6.f ), zerof = _mm_setzero_ps();
+
+  for ( ; i + 4 <= size; i += 4 ) {
+    vr = load4( r + i );
+    vg = load4( g + i );
+    vb = load4( b + i );
+    v = _mm_max_ps( vr, _mm_max_ps( vg, vb ) );
+    m = _mm_min_ps( vr, _mm_min_ps( vg, vb ) );
+    vm = _mm_sub_ps( v, m );
+    sum = _mm_add_ps( v, m );
+    gray = _mm_cmple_ps( vm, zerof );
+    _mm_storeu_ps( l + i, _mm_mul_ps( sum, _mm_set1_ps( 1.f / 510.f ) ) );
+
+    /* Saturation, over v + m or 2 - v - m */
+    d = _mm_cmple_ps( sum, c255 );
+    d = _mm_or_ps( _mm_and_ps( d, sum ),
+                   _mm_andnot_ps( d, _mm_sub_ps( c510, sum ) ) );
+    _mm_storeu_ps( s + i, _mm_andnot_ps( gray, _mm_div_ps( vm, d ) ) );
+
+    /* Hue: pick the sector of the largest channel */
+    isr = _mm_cmpeq_ps( vr, v );
+    isg = _mm_andnot_ps( isr, _mm_cmpeq_ps( vg, v ) );
+    d = _mm_add_ps( c4, _mm_div_ps( _mm_sub_ps( vr, vg ), vm ) );
+    d = _mm_or_ps( _mm_and_ps( isg, _mm_add_ps( c2,
+                     _mm_div_ps( _mm_sub_ps( vb, vr ), vm ) ) ),
+                   _mm_andnot_ps( isg, d ) );
+    d = _mm_or_ps( _mm_and_ps( isr,
+                     _mm_div_ps( _mm_sub_ps( vg, vb ), vm ) ),
+                   _mm_andnot_ps( isr, d ) );
+    d = _mm_add_ps( d, _mm_and_ps( _mm_cmplt_ps( d, zerof ), c6 ) );
+    _mm_storeu_ps( h + i, _mm_andnot_ps( gray,
+                     _mm_mul_ps( d, _mm_set1_ps( 1.f / 6.f ) ) ) );
+  }
+#endif
+  for ( ; i < size; i++ )
+    rgb_to_hsl_pixel( r[i], g[i], b[i], &h[i], &s[i], &l[i] );
+}
+
+static void hsl_to_rgb_block( h, s, l, r, g, b, size )
+float *h, *s, *l;
+byte *r, *g, *b;
+int size;
+{
+  int i = 0;
+#ifdef __SSE2__
+  __m128 vh, vs, vl, v, m, vm, k, c;
+  __m128 half = _mm_set1_ps( 0.5f ), one = _mm_set1_ps( 1.f );
+  __m128 c4 = _mm_set1_ps( 4.f ), c6 = _mm_set1_ps( 6.f );
+  __m128 c255 = _mm_set1_ps( 255.f ), zerof = _mm_setzero_ps();
+
+#define CHANNEL(n, p)   {                                               \
+          k = _mm_add_ps( vh, _mm_set1_ps( n ) );                       \
+          k = _mm_sub_ps( k, _mm_and_ps( _mm_cmpge_ps( k, c6 ), c6 ) ); \
+          k = _mm_min_ps( k, _mm_sub_ps( c4, k ) );                     \
+          k = _mm_max_ps( _mm_min_ps( k, one ), zerof );                \
+          c = _mm_sub_ps( v, _mm_mul_ps( vm, k ) );                     \
+          c = _mm_max_ps( _mm_min_ps( _mm_mul_ps( c, c255 ), c255 ),    \
+                          zerof );                                      \
+          store4( p, c );                                               \
+        }
+
+  for ( ; i + 4 <= size; i += 4 ) {
+    vh = _mm_mul_ps( _mm_loadu_ps( h + i ), c6 );
+    vs = _mm_loadu_ps( s + i );
+    vl = _mm_loadu_ps( l + i );
+    k = _mm_cmple_ps( vl, half );
+    v = _mm_or_ps( _mm_and_ps( k, _mm_mul_ps( vl, _mm_add_ps( one, vs ) ) ),
+                   _mm_andnot_ps( k, _mm_sub_ps( _mm_add_ps( vl, vs ),
+                                                 _mm_mul_ps( vl, vs ) ) ) );
+    m = _mm_sub_ps( _mm_add_ps( vl, vl ), v );
+    vm = _mm_sub_ps( v, m );
+    CHANNEL( 5.f, r + i );
+    CHANNEL( 3.f, g + i );
+    CHANNEL( 1.f, b + i );
+  }
+#undef CHANNEL
+#endif
+  for ( ; i < size; i++ )
+    hsl_to_rgb_pixel( h[i], s[i], l[i], &r[i], &g[i], &b[i] );
+}
+
+void rgb_to_hsl_buffer_float( r, g, b, h, s, l, size, nthreads )
+byte *r, *g, *b;
+float *h, *s, *l;
+int size;
+int nthreads;
+{
+  int i;
+  int blocks = (size + HSL_BLOCK - 1) / HSL_BLOCK;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(blocks > 1) \
+        num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+  for ( i = 0; i < blocks; i++ ) {
+    int first = i * HSL_BLOCK;
+    rgb_to_hsl_block( r + first, g + first, b + first,
+                      h + first, s + first, l + first,
+                      LUGMIN( HSL_BLOCK, size - first ) );
+  }
+}
+
+void hsl_to_rgb_buffer_float( h, s, l, r, g, b, size, nthreads )
+float *h, *s, *l;
+byte *r, *g, *b;
+int size;
+int nthreads;
+{
+  int i;
+  int blocks = (size + HSL_BLOCK - 1) / HSL_BLOCK;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if(blocks > 1) \
+        num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+  for ( i = 0; i < blocks; i++ ) {
+    int first = i * HSL_BLOCK;
+    hsl_to_rgb_block( h + first, s + first, l + first,
+                      r + first, g + first, b + first,
+                      LUGMIN( HSL_BLOCK, size - first ) );
+  }
+}
@@ -0,0 +1,255 @@
+/*
+ * hsl_time.c - checks and times the RGB <--> HSL buffer conversions.
+ *
+ * The single precision buffer routines are first checked against
+ * RGB_to_HSL and HSL_to_RGB on every 24 bit color: the largest
+ * difference in h, s and l ( hue taken round the circle ), the
+ * largest difference in a channel when the HSL values of the
+ * double routine are turned back into RGB, and the largest error
+ * of a round trip with each. h, s and l must agree to 1e-6, the
+ * channels to one level, and the float round trip must be no worse
+ * than the double one; otherwise hsl_time exits with status 1. Then
+ * a frame of size x size pixels of scattered colors is converted
+ * with the double routines and with the float ones on one thread and
+ * on all of them. Rates are millions of pixels per second.
+ *
+ * usage: hsl_time [-s size] [-r repeats] [-t threads]
+ */
+
+#include "lug.h"
+#include "lugfnts.h"
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define CHUNK           ( 1 << 20 )
+#define HSL_TOLERANCE   1e-6
+
+static double seconds()
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/*
+ * The n colors from first on, scattered over the RGB cube ( the
+ * multiplier is odd, so all 2^24 colors come out once ).
+ */
+static void make_colors( r, g, b, first, n )
+byte *r, *g, *b;
+long first;
+int n;
+{
+  unsigned long c;
+  int i;
+
+  for ( i = 0; i < n; i++ ) {
+    c = ( (unsigned long) (first + i) * 2654435761UL ) & 0xffffff;
+    r[i] = c >> 16;
+    g[i] = c >> 8;
+    b[i] = c;
+  }
+}
+
+static double hue_error( a, b )
+double a, b;
+{
+  double d = fabs( a - b );
+
+  return LUGMIN( d, 1. - d );
+}
+
+static int byte_error( a, b )
+int a, b;
+{
+  return a > b ? a - b : b - a;
+}
+
+/*
+ * Returns the number of bounds exceeded.
+ */
+static int check( nthreads )
+int nthreads;
+{
+  byte *r, *g, *b, *r1, *g1, *b1, *r2, *g2, *b2;
+  double *h, *s, *l;
+  float *hf, *sf, *lf;
+  double eh = 0, es = 0, el = 0;
+  int erev = 0, etrip = 0, etripf = 0;
+  long first;
+  int i, failures = 0;
+
+  r = (byte *) Malloc( CHUNK ), g = (byte *) Malloc( CHUNK );
+  b = (byte *) Malloc( CHUNK );
+  r1 = (byte *) Malloc( CHUNK ), g1 = (byte *) Malloc( CHUNK );
+  b1 = (byte *) Malloc( CHUNK );
+  r2 = (byte *) Malloc( CHUNK ), g2 = (byte *) Malloc( CHUNK );
+  b2 = (byte *) Malloc( CHUNK );
+  h = (double *) Malloc( CHUNK * sizeof(double) );
+  s = (double *) Malloc( CHUNK * sizeof(double) );
+  l = (double *) Malloc( CHUNK * sizeof(double) );
+  hf = (float *) Malloc( CHUNK * sizeof(float) );
+  sf = (float *) Malloc( CHUNK * sizeof(float) );
+  lf = (float *) Malloc( CHUNK * sizeof(float) );
+
+  for ( first = 0; first < 1L << 24; first += CHUNK ) {
+    make_colors( r, g, b, first, CHUNK );
+
+    /* RGB_to_HSL leaves h and s alone for grays */
+    memset( h, 0, CHUNK * sizeof(double) );
+    memset( s, 0, CHUNK * sizeof(double) );
+    rgb_to_hsl_buffer( r, g, b, h, s, l, CHUNK );
+    rgb_to_hsl_buffer_float( r, g, b, hf, sf, lf, CHUNK, nthreads );
+    for ( i = 0; i < CHUNK; i++ ) {
+      eh = LUGMAX( eh, hue_error( h[i], hf[i] ) );
+      es = LUGMAX( es, fabs( s[i] - sf[i] ) );
+      el = LUGMAX( el, fabs( l[i] - lf[i] ) );
+    }
+
+    /* Round trips ( hue 1 is out of range for HSL_to_RGB ) */
+    for ( i = 0; i < CHUNK; i++ )
+      if ( h[i] >= 1. )
+        h[i] -= 1.;
+    hsl_to_rgb_buffer( h, s, l, r1, g1, b1, CHUNK );
+    hsl_to_rgb_buffer_float( hf, sf, lf, r2, g2, b2, CHUNK, nthreads );
+    for ( i = 0; i < CHUNK; i++ ) {
+      etrip = LUGMAX( etrip, byte_error( r[i], r1[i] ) );
+      etrip = LUGMAX( etrip, byte_error( g[i], g1[i] ) );
+      etrip = LUGMAX( etrip, byte_error( b[i], b1[i] ) );
+      etripf = LUGMAX( etripf, byte_error( r[i], r2[i] ) );
+      etripf = LUGMAX( etripf, byte_error( g[i], g2[i] ) );
+      etripf = LUGMAX( etripf, byte_error( b[i], b2[i] ) );
+    }
+
+    /* The same HSL values back to RGB */
+    for ( i = 0; i < CHUNK; i++ )
+      hf[i] = h[i], sf[i] = s[i], lf[i] = l[i];
+    hsl_to_rgb_buffer_float( hf, sf, lf, r2, g2, b2, CHUNK, nthreads );
+    for ( i = 0; i < CHUNK; i++ ) {
+      erev = LUGMAX( erev, byte_error( r1[i], r2[i] ) );
+      erev = LUGMAX( erev, byte_error( g1[i], g2[i] ) );
+      erev = LUGMAX( erev, byte_error( b1[i], b2[i] ) );
+    }
+  }
+
+  printf( "all 2^24 colors, float against double:\n" );
+  printf( "  RGB -> HSL       max error  h %.2g  s %.2g  l %.2g\n",
+          eh, es, el );
+  printf( "  HSL -> RGB       max error  %d\n", erev );
+  printf( "  round trip       max error  %d ( double %d )\n",
+          etripf, etrip );
+  if ( eh > HSL_TOLERANCE || es > HSL_TOLERANCE || el > HSL_TOLERANCE ) {
+    printf( "*** RGB -> HSL differs by more than %g\n", HSL_TOLERANCE );
+    failures++;
+  }
+  if ( erev > 1 ) {
+    printf( "*** HSL -> RGB differs by more than one level\n" );
+    failures++;
+  }
+  if ( etripf > etrip ) {
+    printf( "*** float round trip is worse than the double one\n" );
+    failures++;
+  }
+
+  free( r ), free( g ), free( b );
+  free( r1 ), free( g1 ), free( b1 );
+  free( r2 ), free( g2 ), free( b2 );
+  free( h ), free( s ), free( l );
+  free( hf ), free( sf ), free( lf );
+
+  return failures;
+}
+
+static void report( name, t, n, nthreads )
+char *name;
+double t;
+double n;
+int nthreads;
+{
+  printf( "  %-28s %8.1f Mpixels/s", name, n / t / 1e6 );
+  if ( nthreads )
+    printf( "  ( %d threads )", nthreads );
+  printf( "\n" );
+}
+
+int main( argc, argv )
+int argc;
+char **argv;
+{
+  byte *r, *g, *b, *ro, *go, *bo;
+  double *h, *s, *l;
+  float *hf, *sf, *lf;
+  int size = 2048, repeats = 4, nthreads = 0;
+  int n, i, all, failures;
+  double t;
+
+  for ( i = 1; i < argc; i++ ) {
+    if ( !strcmp( argv[i], "-s" ) && i + 1 < argc )
+      size = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-r" ) && i + 1 < argc )
+      repeats = atoi( argv[++i] );
+    else if ( !strcmp( argv[i], "-t" ) && i + 1 < argc )
+      nthreads = atoi( argv[++i] );
+  }
+#ifdef _OPENMP
+  all = nthreads > 0 ? nthreads : omp_get_max_threads();
+#else
+  all = 1;
+#endif
+
+  failures = check( nthreads );
+
+  n = size * size;
+  r = (byte *) Malloc( n ), g = (byte *) Malloc( n );
+  b = (byte *) Malloc( n );
+  ro = (byte *) Malloc( n ), go = (byte *) Malloc( n );
+  bo = (byte *) Malloc( n );
+  h = (double *) Malloc( n * sizeof(double) );
+  s = (double *) Malloc( n * sizeof(double) );
+  l = (double *) Malloc( n * sizeof(double) );
+  hf = (float *) Malloc( n * sizeof(float) );
+  sf = (float *) Malloc( n * sizeof(float) );
+  lf = (float *) Malloc( n * sizeof(float) );
+  make_colors( r, g, b, 0L, n );
+  printf( "%dx%d frame\n", size, size );
+
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    rgb_to_hsl_buffer( r, g, b, h, s, l, n );
+  report( "rgb_to_hsl_buffer", seconds() - t, (double) n * repeats, 0 );
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    rgb_to_hsl_buffer_float( r, g, b, hf, sf, lf, n, 1 );
+  report( "rgb_to_hsl_buffer_float", seconds() - t, (double) n * repeats, 1 );
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    rgb_to_hsl_buffer_float( r, g, b, hf, sf, lf, n, nthreads );
+  report( "rgb_to_hsl_buffer_float", seconds() - t, (double) n * repeats,
+          all );
+
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    hsl_to_rgb_buffer( h, s, l, ro, go, bo, n );
+  report( "hsl_to_rgb_buffer", seconds() - t, (double) n * repeats, 0 );
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    hsl_to_rgb_buffer_float( hf, sf, lf, ro, go, bo, n, 1 );
+  report( "hsl_to_rgb_buffer_float", seconds() - t, (double) n * repeats, 1 );
+  t = seconds();
+  for ( i = 0; i < repeats; i++ )
+    hsl_to_rgb_buffer_float( hf, sf, lf, ro, go, bo, n, nthreads );
+  report( "hsl_to_rgb_buffer_float", seconds() - t, (double) n * repeats,
+          all );
+
+  free( r ), free( g ), free( b );
+  free( ro ), free( go ), free( bo );
+  free( h ), free( s ), free( l );
+  free( hf ), free( sf ), free( lf );
+
+  return failures ? 1 : 0;
+}
@@ -183,6 +183,14 @@ extern byte
 #endif
 );
 
+extern byte
+*unblock_gif(
+#ifdef USE_PROTOTYPES
+        FILE *,
+        long *
+#endif
+);
+
 extern void
 write_gif_file(
 #ifdef USE_PROTOTYPES
@@ -896,6 +904,92 @@ write_tga_rle_line24(
 #endif
 );
 
+extern void
+open_tga_reader(
+#ifdef USE_PROTOTYPES
+        FILE *,
+        tga_reader *
+#endif
+);
+
+extern void
+init_tga_reader(
+#ifdef USE_PROTOTYPES
+        tga_reader *,
+        FILE *,
+        tga_hdr *
+#endif
+);
+
+extern void
+close_tga_reader(
+#ifdef USE_PROTOTYPES
+        tga_reader *
+#endif
+);
+
+extern void
+fill_tga_reader(
+#ifdef USE_PROTOTYPES
+        tga_reader *,
+        int
+#endif
+);
+
+extern void
+unpack_tga_pixels(
+#ifdef USE_PROTOTYPES
+        byte *,
+        int ,
+        int ,
+        byte *,
+        byte *,
+        byte *,
+        byte *
+#endif
+);
+
+extern int
+read_tga_line(
+#ifdef USE_PROTOTYPES
+        tga_reader *,
+        byte *,
+        byte *,
+        byte *
+#endif
+);
+
+extern int
+read_tga_lines(
+#ifdef USE_PROTOTYPES
+        FILE *,
+        ifunptr,
+        void *
+#endif
+);
+
+extern void
+put_tga_header(
+#ifdef USE_PROTOTYPES
+        FILE *,
+        int ,
+        int ,
+        int ,
+        int
+#endif
+);
+
+extern int
+convert_tga_files(
+#ifdef USE_PROTOTYPES
+        char **,
+        char **,
+        int ,
+        int ,
+        int
+#endif
+);
+
 
 /* tiff.c */
 
@@ -1385,6 +1479,34 @@ rgb_to_hsl_buffer(
 #endif
 );
 
+extern void
+hsl_to_rgb_buffer_float(
+#ifdef USE_PROTOTYPES
+        float *,
+        float *,
+        float *,
+        byte *,
+        byte *,
+        byte *,
+        int,
+        int
+#endif
+);
+
+extern void
+rgb_to_hsl_buffer_float(
+#ifdef USE_PROTOTYPES
+        byte *,
+        byte *,
+        byte *,
+        float *,
+        float *,
+        float *,
+        int,
+        int
+#endif
+);
+
 extern void
 RGB_to_HSL(
 #ifdef USE_PROTOTYPES
@@ -53,4 +53,24 @@ typedef struct {
         byte   image_descriptor;
 } tga_hdr;
 
+/*
+ * A Targa file read a scanline at a time. The raster is read
+ * ahead in blocks of TGA_BUFSIZE bytes, and as a RLE packet
+ * can run on from one line into the next we keep the packet
+ * we are in.
+ */
+#define TGA_BUFSIZE             65536
+
+typedef struct {
+        FILE   *handle;
+        tga_hdr tga;
+        byte   *cmap;           /* r, g, b for each entry ( or NULL ) */
+        int    line;            /* next line to read */
+        byte   *buffer;         /* TGA_BUFSIZE bytes */
+        byte   *ptr, *end;      /* what is left of it */
+        int    count;           /* pixels left in the packet */
+        int    repeat;          /* is it a run ? */
+        byte   pixel[4];        /* the pixel of a run */
+} tga_reader;
+
 #endif       /* MY_TGA */
@@ -24,11 +24,24 @@
  * Date:        Wed Jan 22 1992
  * Copyright (c) 1992, Raul Rivero
  *
+ * Modified:    Oct 18 2026
+ *              Scanline reader with read ahead ( RLE included ),
+ *              run detection with SSE2 in the RLE encoder, no
+ *              more fixed size line buffers, and batch conversion
+ *              of frames in parallel.
+ *
  */
 
 #include "lug.h"
 #include "lugfnts.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 void rm_compress();
 
 int read_tga_file(char* name, bitmap_hdr* bitmap)
@@ -158,94 +171,16 @@ FILE *handle;
 byte *r, *g, *b;
 tga_hdr *tga;
 {
-  register int i, j;
-  int aux;
-  byte *ptr;
-  byte *buffer;
-  int totalsize;
-  int count = 0;
-  byte repeat;
-  byte rbyte, gbyte, bbyte;
-  int code;
-
-  if ( tga->image_type < 9 ) {
-    /* No RLE ! */
-/*    VPRINTF(stderr, "Reading true color Targa image\n"); */
-    buffer = (byte *) Malloc( tga->pixel_size * tga->xsize );
-    for ( j = 0; j < tga->ysize; j++ ) {
-#ifdef DEBUG
-/*      VPRINTF(stderr, "Reading line %d\r", j); VFLUSH( stderr ); */
-#endif
-      fread( buffer, tga->xsize, tga->pixel_size, handle);
-      ptr = buffer;
-      if ( tga->pixel_size < 3 ) {
-        for ( i = 0 ; i < tga->xsize; i++ ) {
-          aux = ( ptr[1] << 8 ) | ptr[0];
-          *r++ = (aux & 0x7c00) >> 7;
-          *g++ = (aux & 0x03e0) >> 2;
-          *b++ = (aux & 0x001F) << 3;
-          ptr += 2;
-        }
-      }else {
-        for ( i = 0 ; i < tga->xsize; i++ ) {
-          *b++ = *ptr++;
-          *g++ = *ptr++;
-          *r++ = *ptr++;
-          if ( tga->pixel_size == 4 )
-            ptr++;
-        }
-      }
-    }
-#ifdef DEBUG
-/*    VPRINTF( stderr, "\n" ); */
-#endif
-    free( buffer );
-  }else {
-/*    VPRINTF(stderr, "Reading true color Targa RLE image\n"); */
-    /* RLE */
-    buffer = (byte *) Malloc( 256 * tga->pixel_size );
-    totalsize = tga->xsize * tga->ysize;
-    while ( count < totalsize ) {
-      Fread( &repeat, 1, 1, handle );
-      code = (repeat & 127) + 1;
-      count += code;
-      if ( (repeat & 128) ) {
-        Fread( buffer, tga->pixel_size, 1, handle );
-        if ( tga->pixel_size < 3 ) {
-          aux = ( buffer[1] << 8 ) | buffer[0];
-          rbyte = (aux & 0x7c00) >> 7;
-          gbyte = (aux & 0x03e0) >> 2;
-          bbyte = (aux & 0x001F) << 3;
-        }else {
-          rbyte = buffer[2];
-          gbyte = buffer[1];
-          bbyte = buffer[0];
-        }
-        memset( r, rbyte, code ); r += code;
-        memset( g, gbyte, code ); g += code;
-        memset( b, bbyte, code ); b += code;
-      }else {
-        Fread( buffer, tga->pixel_size, code, handle );
-        ptr = buffer;
-        while ( code-- ) {
-          if ( tga->pixel_size < 3 ) {
-            aux = ( ptr[1] << 8 ) | ptr[0];
-            *r++ = (aux & 0x7c00) >> 7;
-            *g++ = (aux & 0x03e0) >> 2;
-            *b++ = (aux & 0x001F) << 3;
-            ptr += 2;
-          }else {
-            *b++ = *ptr++;
-            *g++ = *ptr++;
-            *r++ = *ptr++;
-            if ( tga->pixel_size == 4 )
-              ptr++;
-          }
-        }
-      } /* if ( (repeat ... ) ) */
-    } /* while ( count ... ) */
-    free( buffer );
+  tga_reader reader;
+
+  /* Header and cmap are read, so start with the raster */
+  init_tga_reader( &reader, handle, tga );
+  while ( read_tga_line( &reader, r, g, b ) >= 0 ) {
+    r += tga->xsize;
+    g += tga->xsize;
+    b += tga->xsize;
   }
+  close_tga_reader( &reader );
 }
 
 void read_tga_to24( handle, r, g, b, tga, cmap )
@@ -263,32 +198,267 @@ FILE *handle;
 byte *r;
 tga_hdr *tga;
 {
-  if ( tga->image_type == 1 ) {
-/*    VPRINTF( stderr, "Reading mapped Targa image\n" ); */
-    Fread( r, tga->xsize, tga->ysize, handle );
-  }else {
-    byte buffer, repeat;
-    int totalsize = tga->xsize * tga->ysize;
-    int count = 0;
-    int code;
-
-/*    VPRINTF( stderr, "Reading mapped RLE Targa image\n" ); */
-    /* RLE */
-    while ( count < totalsize ) {
-      Fread( &repeat, 1, 1, handle );
-      code = (repeat & 127) + 1;
-      count += code;
-      if ( (repeat & 128) ) {
-        Fread( &buffer, 1, 1, handle );
-        memset( r, buffer, code ); r += code;
-      }else {
-        Fread( r, code, 1, handle );
-        r += code;
+  tga_reader reader;
+
+  /* Without g and b planes we get the indices */
+  init_tga_reader( &reader, handle, tga );
+  while ( read_tga_line( &reader, r, NULL, NULL ) >= 0 )
+    r += tga->xsize;
+  close_tga_reader( &reader );
+}
+
+/*
+ * The scanline reader. open_tga_reader reads the header and the
+ * cmap ( if any ) of an image, and each read_tga_line decodes
+ * the next line into r, g and b, returning its number ( in
+ * file order, see TGA_FLIP ) or -1 when there are no more.
+ * Mapped images give the cmap colors, or just the indices in r
+ * if g and b are NULL.
+ */
+void open_tga_reader( handle, reader )
+FILE *handle;
+tga_reader *reader;
+{
+  register int i;
+  tga_hdr tga;
+  byte *ptr;
+
+  read_tga_header( handle, &tga );
+  init_tga_reader( reader, handle, &tga );
+
+  if ( tga.cmap_type ) {
+    if ( tga.image_type == TGA_MAPPED || tga.image_type == TGA_RLE_MAPPED )
+      ptr = reader->cmap = (byte *) Malloc( 3 * tga.cmap_length );
+    else ptr = NULL;
+    for ( i = 0; i < tga.cmap_length; i++ ) {
+      fill_tga_reader( reader, tga.cmap_entry_size );
+      if ( ptr != NULL ) {
+        unpack_tga_pixels( reader->ptr, 1, tga.cmap_entry_size, NULL,
+                           ptr, ptr + 1, ptr + 2 );
+        ptr += 3;
       }
-    } /* while ( count ... ) */
+      reader->ptr += tga.cmap_entry_size;
+    }
   }
 }
 
+void init_tga_reader( reader, handle, tga )
+tga_reader *reader;
+FILE *handle;
+tga_hdr *tga;
+{
+  reader->handle = handle;
+  reader->tga = *tga;
+  reader->cmap = NULL;
+  reader->line = 0;
+  reader->buffer = (byte *) Malloc( TGA_BUFSIZE );
+  reader->ptr = reader->end = reader->buffer;
+  reader->count = 0;
+  reader->repeat = 0;
+
+  switch ( tga->pixel_size ) {
+    case 1:
+    case 2:
+    case 3:
+    case 4:
+                break;
+    default:
+                error( 14 );
+                break;
+  }
+}
+
+void close_tga_reader( reader )
+tga_reader *reader;
+{
+  Free( reader->cmap );
+  Free( reader->buffer );
+  reader->cmap = reader->buffer = NULL;
+}
+
+/*
+ * Make sure there are at least need bytes ( need <= TGA_BUFSIZE )
+ * ready in the buffer.
+ */
+void fill_tga_reader( reader, need )
+tga_reader *reader;
+int need;
+{
+  int left = reader->end - reader->ptr;
+
+  if ( left >= need )
+    return;
+  memmove( reader->buffer, reader->ptr, left );
+  reader->ptr = reader->buffer;
+  reader->end = reader->buffer + left;
+  reader->end += fread( reader->end, 1, TGA_BUFSIZE - left, reader->handle );
+  if ( reader->end - reader->ptr < need )
+    error( 3 );
+}
+
+/*
+ * Split n pixels of size bytes each into the planes. Pixels of
+ * two bytes are 5-5-5 RGB, of one a cmap index.
+ */
+void unpack_tga_pixels( ptr, n, size, cmap, r, g, b )
+byte *ptr;
+int n, size;
+byte *cmap;
+byte *r, *g, *b;
+{
+  register int i;
+  int aux;
+  byte *color;
+
+  switch ( size ) {
+    case 1:
+                if ( g == NULL ) {
+                  memcpy( r, ptr, n );
+                  break;
+                }
+                if ( cmap == NULL )
+                  error( 13 );
+                for ( i = 0; i < n; i++ ) {
+                  color = cmap + 3 * ptr[i];
+                  r[i] = color[0];
+                  g[i] = color[1];
+                  b[i] = color[2];
+                }
+                break;
+    case 2:
+                for ( i = 0; i < n; i++ ) {
+                  aux = ( ptr[1] << 8 ) | ptr[0];
+                  r[i] = (aux & 0x7c00) >> 7;
+                  g[i] = (aux & 0x03e0) >> 2;
+                  b[i] = (aux & 0x001F) << 3;
+                  ptr += 2;
+                }
+                break;
+    case 3:
+                for ( i = 0; i < n; i++ ) {
+                  b[i] = ptr[0];
+                  g[i] = ptr[1];
+                  r[i] = ptr[2];
+                  ptr += 3;
+                }
+                break;
+    case 4:
+                for ( i = 0; i < n; i++ ) {
+                  b[i] = ptr[0];
+                  g[i] = ptr[1];
+                  r[i] = ptr[2];
+                  ptr += 4;
+                }
+                break;
+  }
+}
+
+/*
+ * Read n raw pixels, straight from the buffer.
+ */
+static void read_tga_raw( reader, n, r, g, b )
+tga_reader *reader;
+int n;
+byte *r, *g, *b;
+{
+  int size = reader->tga.pixel_size;
+  int chunk;
+
+  while ( n > 0 ) {
+    fill_tga_reader( reader, size );
+    chunk = LUGMIN( n, (reader->end - reader->ptr) / size );
+    unpack_tga_pixels( reader->ptr, chunk, size, reader->cmap, r, g, b );
+    reader->ptr += chunk * size;
+    r += chunk;
+    if ( g != NULL ) {
+      g += chunk;
+      b += chunk;
+    }
+    n -= chunk;
+  }
+}
+
+int read_tga_line( reader, r, g, b )
+tga_reader *reader;
+byte *r, *g, *b;
+{
+  int size = reader->tga.pixel_size;
+  int xsize = reader->tga.xsize;
+  byte rbyte, gbyte, bbyte;
+  byte code;
+  int n;
+
+  if ( reader->line >= reader->tga.ysize )
+    return -1;
+
+  if ( reader->tga.image_type < 9 ) {
+    /* No RLE ! */
+    read_tga_raw( reader, xsize, r, g, b );
+    return reader->line++;
+  }
+
+  while ( xsize > 0 ) {
+    if ( !reader->count ) {
+      /* Next packet */
+      fill_tga_reader( reader, 1 + size );
+      code = *reader->ptr++;
+      reader->count = (code & 127) + 1;
+      reader->repeat = code & 128;
+      if ( reader->repeat ) {
+        memcpy( reader->pixel, reader->ptr, size );
+        reader->ptr += size;
+      }
+    }
+    n = LUGMIN( reader->count, xsize );
+    if ( reader->repeat ) {
+      if ( g != NULL ) {
+        unpack_tga_pixels( reader->pixel, 1, size, reader->cmap,
+                           &rbyte, &gbyte, &bbyte );
+        memset( g, gbyte, n ); g += n;
+        memset( b, bbyte, n ); b += n;
+      }else rbyte = reader->pixel[0];
+      memset( r, rbyte, n ); r += n;
+    }else {
+      read_tga_raw( reader, n, r, g, b );
+      r += n;
+      if ( g != NULL ) {
+        g += n;
+        b += n;
+      }
+    }
+    reader->count -= n;
+    xsize -= n;
+  }
+
+  return reader->line++;
+}
+
+/*
+ * Call fn( data, line, r, g, b, xsize ) for each line of the
+ * image, with r, g and b only valid for the call. Returns the
+ * number of lines.
+ */
+int read_tga_lines( handle, fn, data )
+FILE *handle;
+ifunptr fn;
+void *data;
+{
+  tga_reader reader;
+  byte *r, *g, *b;
+  int line;
+
+  open_tga_reader( handle, &reader );
+  r = (byte *) Malloc( 3 * reader.tga.xsize );
+  g = r + reader.tga.xsize;
+  b = g + reader.tga.xsize;
+  while ( (line = read_tga_line( &reader, r, g, b )) >= 0 )
+    (*fn)( data, line, r, g, b, (int) reader.tga.xsize );
+  free( r );
+  close_tga_reader( &reader );
+
+  return reader.tga.ysize;
+}
+
 void read_tga_header(handle, tga)
 FILE *handle;
 tga_hdr *tga;
@@ -457,114 +627,380 @@ FILE *handle;
 bitmap_hdr *image;
 int rle;
 {
-  byte buffer[ sizeof(tga_hdr) ];
-
-/*  VPRINTF(stderr, "Writing Targa header\n"); */
-  /* First we fill with zero, then skip too asigments */
-  bzero( buffer, sizeof(tga_hdr) );
+  int type;
 
   /* image_type */
   if ( image->depth > 8 ) {
     if ( rle )
-      buffer[2] = TGA_RLE_RGB;
-    else buffer[2] = TGA_RGB;
+      type = TGA_RLE_RGB;
+    else type = TGA_RGB;
   }else {
     if ( rle )
-      buffer[2] = TGA_RLE_MAPPED;
-    else buffer[2] = TGA_MAPPED;
+      type = TGA_RLE_MAPPED;
+    else type = TGA_MAPPED;
   }
 
-  buffer[12] = LSB( image->xsize );
-  buffer[13] = MSB( image->xsize );     /* the weigth */
-  buffer[14] = LSB( image->ysize );
-  buffer[15] = MSB( image->ysize );     /* the height */
+  put_tga_header( handle, image->xsize, image->ysize, type, 32 );
+}
+
+void put_tga_header(handle, xsize, ysize, type, descriptor)
+FILE *handle;
+int xsize, ysize;
+int type;
+int descriptor;
+{
+  byte buffer[ 18 ];
+
+/*  VPRINTF(stderr, "Writing Targa header\n"); */
+  /* First we fill with zero, then skip too asigments */
+  bzero( buffer, 18 );
+
+  buffer[2] = type;
+  buffer[12] = LSB( xsize );
+  buffer[13] = MSB( xsize );            /* the weigth */
+  buffer[14] = LSB( ysize );
+  buffer[15] = MSB( ysize );            /* the height */
   buffer[16] = 24;                      /* Targa 24 => RGB */
-  buffer[17] = 32;              /* flipped */
+  buffer[17] = descriptor;              /* 32 => flipped */
 
   /* Write the header */
   Fwrite( buffer, 18, 1, handle );
 }
 
+#define TGA_CHUNK               1024
+
 void write_tga_line24(handle, r, g, b, xsize)
 FILE *handle;
 byte *r, *g, *b;
 int xsize;
 {
-  static byte buffer[3*2560];
+  byte buffer[3*TGA_CHUNK];
   byte *ptr;
   byte *end;
+  int chunk;
+
+  while ( xsize > 0 ) {
+    chunk = LUGMIN( xsize, TGA_CHUNK );
+    end = r + chunk;
+    ptr = buffer;
+
+    /* Do a single buffer */
+    while ( r < end ) {
+      *ptr++ = *b++;
+      *ptr++ = *g++;
+      *ptr++ = *r++;
+    }
 
-  end = r + xsize;
-  ptr = buffer;
+    /* Write it ! */
+    Fwrite( buffer, chunk, 3, handle );
+    xsize -= chunk;
+  }
+}
 
-  /* Do a single buffer */
-  while ( r < end ) {
-    *ptr++ = *b++;
-    *ptr++ = *g++;
-    *ptr++ = *r++;
+/*
+ * Run detection for the RLE encoder: tga_run counts the pixels
+ * from i on ( up to max ) equal to pixel i, and tga_raw those
+ * from i on ( up to max ) before a pair of equal neighbours,
+ * which starts the next run. With SSE2 16 pixels are compared
+ * at a time.
+ */
+static int tga_run( r, g, b, i, max )
+byte *r, *g, *b;
+int i, max;
+{
+  int k = i + 1;
+  int end = i + max;
+#ifdef __SSE2__
+  __m128i vr = _mm_set1_epi8( (char) r[i] );
+  __m128i vg = _mm_set1_epi8( (char) g[i] );
+  __m128i vb = _mm_set1_epi8( (char) b[i] );
+  __m128i eq;
+  int mask;
+
+  for ( ; k + 16 <= end; k += 16 ) {
+    eq = _mm_and_si128(
+           _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (r + k) ), vr ),
+           _mm_and_si128(
+             _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (g + k) ), vg ),
+             _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (b + k) ), vb ) ) );
+    mask = _mm_movemask_epi8( eq );
+    if ( mask != 0xffff ) {
+      for ( ; mask & 1; mask >>= 1 )
+        k++;
+      return k - i;
+    }
   }
+#endif
+  while ( k < end && r[k] == r[i] && g[k] == g[i] && b[k] == b[i] )
+    k++;
+  return k - i;
+}
 
-  /* Write it ! */
-  Fwrite( buffer, xsize, 3, handle );
+static int tga_raw( r, g, b, i, max, xsize )
+byte *r, *g, *b;
+int i, max;
+int xsize;
+{
+  int k = i;
+  int end = LUGMIN( i + max, xsize - 1 );
+#ifdef __SSE2__
+  __m128i eq;
+  int mask;
+
+  for ( ; k + 16 <= end; k += 16 ) {
+    eq = _mm_and_si128(
+           _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (r + k) ),
+                           _mm_loadu_si128( (__m128i *) (r + k + 1) ) ),
+           _mm_and_si128(
+             _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (g + k) ),
+                             _mm_loadu_si128( (__m128i *) (g + k + 1) ) ),
+             _mm_cmpeq_epi8( _mm_loadu_si128( (__m128i *) (b + k) ),
+                             _mm_loadu_si128( (__m128i *) (b + k + 1) ) ) ) );
+    mask = _mm_movemask_epi8( eq );
+    if ( mask ) {
+      for ( ; !(mask & 1); mask >>= 1 )
+        k++;
+      return k - i;
+    }
+  }
+#endif
+  for ( ; k < end; k++ )
+    if ( r[k] == r[k+1] && g[k] == g[k+1] && b[k] == b[k+1] )
+      return k - i;
+  return LUGMIN( max, xsize - i );
 }
 
+/*
+ * Each line is coded on its own, with runs of 2 to 128 equal
+ * pixels and raw packets of up to 128 pixels in between.
+ */
 void write_tga_rle_line24(handle, r, g, b, xsize)
 FILE *handle;
 byte *r, *g, *b;
 int xsize;
 {
-  byte *end;
-  byte cr, cb, cg;
-  short repeat= 1;
-  short diferent= 0;
-  static byte salida[4*2560];
-  byte bufaux[4*256];
-  byte *ptr, *aux;
+  byte salida[4*TGA_CHUNK];
+  byte *ptr;
+  int i, j, n;
 
   ptr = salida;
-  end = r + xsize + 1;
-  cr = *r++;
-  cg = *g++;
-  cb = *b++;
-  while ( r < end ) {
-    while ( cr == *r  && cg == *g  && cb == *b  &&
-            repeat < 127 && r < end) {
-      r++, g++, b++;
-      repeat++;
+  for ( i = 0; i < xsize; i += n ) {
+    /* Room for the biggest packet ? */
+    if ( ptr - salida > (int) sizeof(salida) - (1 + 3*128) ) {
+      Fwrite( salida, ptr - salida, 1, handle );
+      ptr = salida;
     }
-    if (repeat > 1 ) {
+    n = tga_run( r, g, b, i, LUGMIN( 128, xsize - i ) );
+    if ( n > 1 ) {
       /* Put this information on our buffer */
-      *ptr++ = 128 | (repeat - 1);
-      *ptr++ = cb;
-      *ptr++ = cg;
-      *ptr++ = cr;
-      repeat = 1;
-      cr = *r++;
-      cg = *g++;
-      cb = *b++;
+      *ptr++ = 128 | (n - 1);
+      *ptr++ = b[i];
+      *ptr++ = g[i];
+      *ptr++ = r[i];
+    }else {
+      /* Pixels up to the next run go raw */
+      n = tga_raw( r, g, b, i, 128, xsize );
+      *ptr++ = n - 1;
+      for ( j = i; j < i + n; j++ ) {
+        *ptr++ = b[j];
+        *ptr++ = g[j];
+        *ptr++ = r[j];
+      }
     }
-    aux= bufaux;
-    /*
-     * If there are diferents bytes, then we need
-     * know how many.
-     */
-    while ( (cr != *r  || cg != *g  || cb != *b)  &&
-            diferent< 127 && r < end) {
-      *aux++ = cb;
-      *aux++ = cg;
-      *aux++ = cr;
-      cr = *r++;
-      cg = *g++;
-      cb = *b++;
-      diferent++;
+  }
+
+  if ( ptr > salida )
+    Fwrite( salida, ptr - salida, 1, handle );
+}
+
+/*
+ * A frame read ahead through a small buffer, for check_tga_frame.
+ */
+typedef struct {
+        FILE   *handle;
+        byte   buffer[4096];
+        int    n, i;
+} tga_scan;
+
+static int scan_tga_byte( scan )
+tga_scan *scan;
+{
+  if ( scan->i == scan->n ) {
+    scan->n = fread( scan->buffer, 1, sizeof(scan->buffer), scan->handle );
+    scan->i = 0;
+    if ( scan->n <= 0 )
+      return -1;
+  }
+  return scan->buffer[scan->i++];
+}
+
+/*
+ * Skip n pixels of size bytes each, making sure that one byte
+ * pixels are below ncmap. Returns 0 if the file ends first or
+ * an index is out of range.
+ */
+static int scan_tga_pixels( scan, n, size, ncmap )
+tga_scan *scan;
+long n;
+int size, ncmap;
+{
+  long bytes = n * size;
+  int i, chunk;
+
+  while ( bytes > 0 ) {
+    if ( scan->i == scan->n ) {
+      scan->n = fread( scan->buffer, 1, sizeof(scan->buffer), scan->handle );
+      scan->i = 0;
+      if ( scan->n <= 0 )
+        return 0;
     }
-    if (diferent) {
-      *ptr++ = diferent - 1;
-      bcopy( bufaux, ptr, 3*diferent );
-      ptr += 3*diferent;
-      diferent = 0;
+    chunk = LUGMIN( bytes, scan->n - scan->i );
+    if ( size == 1 && ncmap < 256 )
+      for ( i = 0; i < chunk; i++ )
+        if ( scan->buffer[scan->i + i] >= ncmap )
+          return 0;
+    scan->i += chunk;
+    bytes -= chunk;
+  }
+  return 1;
+}
+
+/*
+ * Walk the header, cmap and raster of a frame without decoding
+ * it, and leave the file back at its start. Returns 1 if the
+ * reader can get through it without calling error().
+ */
+static int check_tga_frame( handle )
+FILE *handle;
+{
+  tga_scan scan;
+  byte hdr[18];
+  int i, c, type, size, ncmap;
+  long start, left;
+  int ok = 0;
+
+  scan.handle = handle;
+  scan.n = scan.i = 0;
+  for ( i = 0; i < 18; i++ ) {
+    if ( (c = scan_tga_byte( &scan )) < 0 )
+      goto done;
+    hdr[i] = c;
+  }
+  type = hdr[2];
+  size = hdr[16] / 8;
+  if ( TGA_INTERLACED(hdr[17]) || size < 1 || size > 4 )
+    goto done;
+  if ( type == TGA_MAPPED || type == TGA_RLE_MAPPED ) {
+    if ( hdr[1] != 1 || hdr[7] / 8 < 2 || hdr[7] / 8 > 4 )
+      goto done;
+    ncmap = ( hdr[6] << 8 ) | hdr[5];
+  }else if ( type == TGA_RGB || type == TGA_RLE_RGB ) {
+    if ( size == 1 )
+      goto done;
+    ncmap = 256;
+  }else goto done;
+
+  /* The identification and the cmap */
+  if ( !scan_tga_pixels( &scan, hdr[0] + ( hdr[1] ?
+         (long) ( ( hdr[6] << 8 ) | hdr[5] ) * ( hdr[7] / 8 ) : 0L ), 1, 256 ) )
+    goto done;
+
+  /* The raster */
+  left = (long) ( ( hdr[13] << 8 ) | hdr[12] ) * ( ( hdr[15] << 8 ) | hdr[14] );
+  if ( type < 9 ) {
+    if ( size == 1 && ncmap < 256 ) {
+      ok = scan_tga_pixels( &scan, left, size, ncmap );
+      goto done;
     }
+    /* Nothing to check but the length */
+    start = ftell( handle ) - ( scan.n - scan.i );
+    ok = fseek( handle, 0L, SEEK_END ) == 0 &&
+         ftell( handle ) - start >= left * size;
+    goto done;
+  }
+  while ( left > 0 ) {
+    if ( (c = scan_tga_byte( &scan )) < 0 )
+      goto done;
+    if ( !scan_tga_pixels( &scan, c & 128 ? 1L : LUGMIN( (c & 127) + 1, left ),
+                           size, ncmap ) )
+      goto done;
+    left -= (c & 127) + 1;
   }
+  ok = 1;
+
+done:
+  rewind( handle );
+  return ok;
+}
+
+/*
+ * Frame-level batch conversion: each of the n files in[i] is
+ * read a line at a time and written to out[i] as 24 bit Targa,
+ * RLE or not, keeping its orientation. The frames are done in
+ * parallel on nthreads threads ( all of them if 0 ). Returns
+ * the number of frames converted; those that cannot be opened,
+ * and those the reader would stop on ( a bad header, a cmap
+ * index out of range or a truncated raster ), are skipped, as
+ * each frame is walked through once before it is decoded. Out
+ * of memory and write errors still stop the program.
+ */
+static int convert_tga_frame( in, out, rle )
+char *in, *out;
+int rle;
+{
+  FILE *input, *output;
+  tga_reader reader;
+  byte *r, *g, *b;
+  int xsize;
+
+  if ( (input = fopen( in, "rb" )) == NULL )
+    return 0;
+  if ( !check_tga_frame( input ) ) {
+    fclose( input );
+    return 0;
+  }
+  if ( (output = fopen( out, "wb" )) == NULL ) {
+    fclose( input );
+    return 0;
+  }
+
+  open_tga_reader( input, &reader );
+  xsize = reader.tga.xsize;
+  put_tga_header( output, xsize, reader.tga.ysize,
+                  rle ? TGA_RLE_RGB : TGA_RGB,
+                  reader.tga.image_descriptor & 0x20 );
+  r = (byte *) Malloc( 3 * xsize );
+  g = r + xsize;
+  b = g + xsize;
+  while ( read_tga_line( &reader, r, g, b ) >= 0 ) {
+    if ( rle )
+      write_tga_rle_line24( output, r, g, b, xsize );
+    else write_tga_line24( output, r, g, b, xsize );
+  }
+  free( r );
+  close_tga_reader( &reader );
+
+  fclose( input );
+  if ( fclose( output ) )
+    error( 4 );
+  return 1;
+}
+
+int convert_tga_files( in, out, n, rle, nthreads )
+char **in, **out;
+int n;
+int rle;
+int nthreads;
+{
+  int i;
+  int done = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:done) schedule(dynamic, 1) \
+        num_threads(nthreads > 0 ? nthreads : omp_get_max_threads())
+#endif
+  for ( i = 0; i < n; i++ )
+    done += convert_tga_frame( in[i], out[i], rle );
 
-  Fwrite(salida, ptr-salida, 1, handle);
+  return done;
 }
@@ -0,0 +1,275 @@
+/*
+ * tga_time.c - times the Targa reader and writer.
+ *
+ * Frames of a synthetic image ( flat areas, a gradient and
+ * noisy spans ) are written as raw and RLE Targa files and read
+ * back, whole with read_tga and a line at a time with
+ * read_tga_lines, and checked. Then the raw frames are converted
+ * to RLE with convert_tga_files, and a batch with truncated and
+ * garbled frames among good ones is converted to check that only
+ * the good ones come out. Rates are MB/s of 24 bit pixels. Exits
+ * with status 1 if any check fails.
+ *
+ * usage: tga_time [frames [xsize ysize [threads]]]
+ */
+
+#include "lug.h"
+#include "lugfnts.h"
+#include <time.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+static double seconds()
+{
+#ifdef _OPENMP
+  return omp_get_wtime();
+#else
+  return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static void make_frame( image, xsize, ysize, frame )
+bitmap_hdr *image;
+int xsize, ysize;
+int frame;
+{
+  int x, y, i, span = 0;
+  byte cr = 0, cg = 0, cb = 0;
+
+  image->magic = LUGUSED;
+  image->xsize = xsize;
+  image->ysize = ysize;
+  image->depth = 24;
+  image->colors = 1 << 24;
+  image->r = (byte *) Malloc( xsize * ysize );
+  image->g = (byte *) Malloc( xsize * ysize );
+  image->b = (byte *) Malloc( xsize * ysize );
+  image->cmap = NULL;
+
+  for ( y = 0; y < ysize; y++ )
+    for ( x = 0; x < xsize; x++ ) {
+      i = y * xsize + x;
+      if ( x < xsize / 3 ) {
+        /* Flat blocks */
+        image->r[i] = ( (x >> 6) + (y >> 6) + frame ) * 40;
+        image->g[i] = ( (y >> 6) + frame ) * 20;
+        image->b[i] = 128;
+      }else if ( x < 2 * xsize / 3 ) {
+        /* A gradient */
+        image->r[i] = x + frame;
+        image->g[i] = y;
+        image->b[i] = x ^ y;
+      }else {
+        /* Noisy spans */
+        if ( !span-- ) {
+          span = rand() % 16;
+          cr = rand();
+          cg = rand();
+          cb = rand();
+        }
+        image->r[i] = cr;
+        image->g[i] = cg;
+        image->b[i] = cb;
+      }
+    }
+}
+
+static int same_image( a, b )
+bitmap_hdr *a, *b;
+{
+  int n = a->xsize * a->ysize;
+
+  return a->xsize == b->xsize && a->ysize == b->ysize &&
+         !memcmp( a->r, b->r, n ) && !memcmp( a->g, b->g, n ) &&
+         !memcmp( a->b, b->b, n );
+}
+
+/*
+ * read_tga_lines callback: compare each line with the frame.
+ */
+static int bad_lines;
+
+static int check_line( data, line, r, g, b, xsize )
+void *data;
+int line;
+byte *r, *g, *b;
+int xsize;
+{
+  bitmap_hdr *image = (bitmap_hdr *) data;
+  int i = line * xsize;
+
+  if ( memcmp( r, image->r + i, xsize ) || memcmp( g, image->g + i, xsize ) ||
+       memcmp( b, image->b + i, xsize ) )
+    bad_lines++;
+  return 0;
+}
+
+/*
+ * Copy the first n bytes of file from to file to, with byte at
+ * ( if not negative ) replaced by value.
+ */
+static void copy_frame( from, to, n, at, value )
+char *from, *to;
+long n, at;
+int value;
+{
+  FILE *in, *out;
+  long i;
+  int c;
+
+  in = Fopen( from, "rb" );
+  out = Fopen( to, "wb" );
+  for ( i = 0; i < n && (c = getc( in )) != EOF; i++ )
+    putc( i == at ? value : c, out );
+  Fclose( in );
+  Fclose( out );
+}
+
+static void free_frame( image )
+bitmap_hdr *image;
+{
+  free( image->r );
+  free( image->g );
+  free( image->b );
+}
+
+int main( argc, argv )
+int argc;
+char **argv;
+{
+  int frames, xsize, ysize, nthreads;
+  int i, rle, bad, converted, failures = 0;
+  long size;
+  static char *mixed[6] = { NULL, "tga_time_cut.tga",
+                            "tga_time_cut_rle.tga", "tga_time_head.tga",
+                            "tga_time_type.tga", "tga_time_nocmap.tga" };
+  static char *mixed_out[6] = { "tga_time_0_mix.tga", "tga_time_1_mix.tga",
+                                "tga_time_2_mix.tga", "tga_time_3_mix.tga",
+                                "tga_time_4_mix.tga", "tga_time_5_mix.tga" };
+  bitmap_hdr *images, image;
+  char **raw_names, **rle_names, **out_names;
+  char **names;
+  FILE *handle;
+  double t, mb, bytes;
+
+  frames = argc > 1 ? atoi( argv[1] ) : 8;
+  xsize = argc > 3 ? atoi( argv[2] ) : 1920;
+  ysize = argc > 3 ? atoi( argv[3] ) : 1080;
+  nthreads = argc > 4 ? atoi( argv[4] ) : 0;
+
+  images = (bitmap_hdr *) Malloc( frames * sizeof(bitmap_hdr) );
+  raw_names = (char **) Malloc( 3 * frames * sizeof(char *) );
+  rle_names = raw_names + frames;
+  out_names = rle_names + frames;
+  srand( 1 );
+  for ( i = 0; i < frames; i++ ) {
+    make_frame( &images[i], xsize, ysize, i );
+    raw_names[i] = Malloc( 32 );
+    rle_names[i] = Malloc( 32 );
+    out_names[i] = Malloc( 32 );
+    sprintf( raw_names[i], "tga_time_%d.tga", i );
+    sprintf( rle_names[i], "tga_time_%d_rle.tga", i );
+    sprintf( out_names[i], "tga_time_%d_out.tga", i );
+  }
+  mb = 3.0 * xsize * ysize * frames / 1e6;
+  printf( "%d frames of %dx%d ( %.1f MB of pixels )\n", frames, xsize,
+          ysize, mb );
+
+  for ( rle = 0; rle <= 1; rle++ ) {
+    names = rle ? rle_names : raw_names;
+
+    t = seconds();
+    bytes = 0;
+    for ( i = 0; i < frames; i++ ) {
+      handle = Fopen( names[i], "wb" );
+      write_tga( handle, &images[i], rle );
+      bytes += ftell( handle );
+      Fclose( handle );
+    }
+    t = seconds() - t;
+    printf( "%s  write       %8.1f MB/s  ( %.1f MB of files )\n",
+            rle ? "RLE" : "raw", mb / t, bytes / 1e6 );
+
+    t = seconds();
+    bad = 0;
+    for ( i = 0; i < frames; i++ ) {
+      handle = Fopen( names[i], "rb" );
+      read_tga( handle, &image );
+      Fclose( handle );
+      bad += !same_image( &image, &images[i] );
+      free_frame( &image );
+    }
+    t = seconds() - t;
+    printf( "%s  read_tga    %8.1f MB/s  ( %d bad frames )\n",
+            rle ? "RLE" : "raw", mb / t, bad );
+    failures += bad;
+
+    t = seconds();
+    bad_lines = 0;
+    for ( i = 0; i < frames; i++ ) {
+      handle = Fopen( names[i], "rb" );
+      read_tga_lines( handle, check_line, (void *) &images[i] );
+      Fclose( handle );
+    }
+    t = seconds() - t;
+    printf( "%s  lines       %8.1f MB/s  ( %d bad lines )\n",
+            rle ? "RLE" : "raw", mb / t, bad_lines );
+    failures += bad_lines;
+  }
+
+  t = seconds();
+  converted = convert_tga_files( raw_names, out_names, frames, 1, nthreads );
+  t = seconds() - t;
+  bad = 0;
+  for ( i = 0; i < frames; i++ ) {
+    handle = Fopen( out_names[i], "rb" );
+    read_tga( handle, &image );
+    Fclose( handle );
+    bad += !same_image( &image, &images[i] );
+    free_frame( &image );
+  }
+  printf( "raw to RLE  %8.1f MB/s  ( %d frames, %d bad, %d threads )\n",
+          mb / t, converted, bad,
+#ifdef _OPENMP
+          nthreads > 0 ? nthreads : omp_get_max_threads() );
+#else
+          1 );
+#endif
+  failures += bad + ( converted != frames );
+
+  /*
+   * Frames the reader would stop on: the raw and RLE frames cut
+   * short, a header alone, an unknown image type and 8 bit pixels
+   * without a cmap. Only the good frame comes out.
+   */
+  size = 18 + 3L * xsize * ysize;
+  mixed[0] = rle_names[0];
+  copy_frame( raw_names[0], mixed[1], size - 1, -1L, 0 );
+  copy_frame( rle_names[0], mixed[2], 200L, -1L, 0 );
+  copy_frame( raw_names[0], mixed[3], 18L, -1L, 0 );
+  copy_frame( raw_names[0], mixed[4], size, 2L, 5 );
+  copy_frame( raw_names[0], mixed[5], size, 16L, 8 );
+  converted = convert_tga_files( mixed, mixed_out, 6, 1, nthreads );
+  printf( "corrupt     %d of 6 frames converted\n", converted );
+  failures += converted != 1;
+  for ( i = 0; i < 6; i++ ) {
+    if ( i > 0 )
+      remove( mixed[i] );
+    remove( mixed_out[i] );
+  }
+
+  for ( i = 0; i < frames; i++ ) {
+    remove( raw_names[i] );
+    remove( rle_names[i] );
+    remove( out_names[i] );
+    free( raw_names[i] );
+    free( rle_names[i] );
+    free( out_names[i] );
+    free_frame( &images[i] );
+  }
+  free( raw_names );
+  free( images );
+  return failures ? 1 : 0;
+}